@@ -0,0 +1,212 @@
+// latency benchmark of hotcakeyd compared with the in-process backend.
+//
+// measures the time from emitting a keydown to the listener being called,
+// once with this process reading the devices and once through a forked
+// hotcakeyd. keys are typed on a uinput keyboard when /dev/uinput is
+// writable, otherwise they go through the synthetic input. clients cannot
+// type into hotcakeyd, so the forked one reads them from a pipe then.
+
+#include <fcntl.h>
+#include <linux/uinput.h>
+#include <signal.h>
+#include <sys/ioctl.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../src/hotcakey/daemon.h"
+#include "../src/hotcakey/hotcakey.h"
+#include "../src/hotcakey/ring.h"
+#include "../src/hotcakey/synthetic.h"
+#include "../src/hotcakeyd/server.h"
+
+namespace {
+
+constexpr std::size_t kIterations = 2000;
+constexpr const char* kSocketPath = "/tmp/hotcakey-bench-daemon.sock";
+
+std::atomic<std::int64_t> received(0);
+
+// pipe to the synthetic input of the forked hotcakeyd, one byte per key
+int typing[2] = {-1, -1};
+bool isTypingToDaemon = false;
+
+int OpenKeyboard() {
+  auto fd = open("/dev/uinput", O_WRONLY | O_NONBLOCK | O_CLOEXEC);
+  if (fd < 0) return -1;
+
+  ioctl(fd, UI_SET_EVBIT, EV_KEY);
+  ioctl(fd, UI_SET_KEYBIT, KEY_A);
+  ioctl(fd, UI_SET_KEYBIT, KEY_F13);
+
+  uinput_setup setup{};
+  setup.id.bustype = BUS_VIRTUAL;
+  std::strcpy(setup.name, "hotcakey bench keyboard");
+
+  if (ioctl(fd, UI_DEV_SETUP, &setup) != 0 || ioctl(fd, UI_DEV_CREATE) != 0) {
+    close(fd);
+    return -1;
+  }
+
+  // give udev a moment to create the device node
+  std::this_thread::sleep_for(std::chrono::milliseconds(500));
+
+  return fd;
+}
+
+void Type(int keyboard, bool pressed) {
+  if (keyboard < 0 && isTypingToDaemon) {
+    char key = pressed ? 1 : 0;
+    auto written = write(typing[1], &key, 1);
+    (void)written;
+    return;
+  }
+
+  if (keyboard < 0) {
+    hotcakey::synthetic::Emit("F13",
+                              pressed ? hotcakey::kKeyDown : hotcakey::kKeyUp);
+    return;
+  }
+
+  input_event events[2] = {};
+  events[0].type = EV_KEY;
+  events[0].code = KEY_F13;
+  events[0].value = pressed ? 1 : 0;
+  events[1].type = EV_SYN;
+  events[1].code = SYN_REPORT;
+
+  auto written = write(keyboard, events, sizeof(events));
+  (void)written;
+}
+
+bool WaitReceived(std::int64_t since) {
+  auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(1);
+  while (received.load(std::memory_order_acquire) < since) {
+    if (std::chrono::steady_clock::now() > deadline) return false;
+  }
+  return true;
+}
+
+bool Bench(const char* name, int keyboard) {
+  if (hotcakey::Activate() != hotcakey::kSuccess) return false;
+
+  auto [result, registration] = hotcakey::Register(
+      {"F13"}, [](const hotcakey::Event& event) {
+        if (event.type == hotcakey::kKeyDown) {
+          received.store(hotcakey::ring::Now(), std::memory_order_release);
+        }
+      });
+
+  if (result != hotcakey::kSuccess) {
+    hotcakey::Inactivate();
+    return false;
+  }
+
+  std::vector<double> latencies;
+  latencies.reserve(kIterations);
+
+  for (std::size_t i = 0; i < kIterations; i++) {
+    auto now = hotcakey::ring::Now();
+    Type(keyboard, true);
+
+    if (!WaitReceived(now)) {
+      std::fprintf(stderr, "%s: keydown was not delivered\n", name);
+      hotcakey::Inactivate();
+      return false;
+    }
+
+    latencies.push_back((received.load() - now) / 1000.0);
+    Type(keyboard, false);
+  }
+
+  hotcakey::Unregister(registration);
+  hotcakey::Inactivate();
+
+  std::sort(latencies.begin(), latencies.end());
+
+  std::printf("%12s %10.1f %10.1f %10.1f\n", name,
+              latencies[latencies.size() / 2],
+              latencies[latencies.size() * 99 / 100], latencies.back());
+
+  return true;
+}
+
+pid_t StartDaemon() {
+  std::fflush(stdout);
+
+  if (pipe2(typing, O_CLOEXEC) != 0) return -1;
+
+  auto pid = fork();
+
+  if (pid == 0) {
+    close(typing[1]);
+    signal(SIGTERM, [](int) { hotcakeyd::Stop(); });
+    hotcakey::daemon::SetEnabled(false);
+    if (hotcakey::Activate() != hotcakey::kSuccess) std::_Exit(1);
+
+    std::thread([] {
+      char key;
+      while (read(typing[0], &key, 1) == 1) {
+        hotcakey::synthetic::Emit("F13",
+                                  key ? hotcakey::kKeyDown : hotcakey::kKeyUp);
+      }
+    }).detach();
+
+    auto served = hotcakeyd::Serve(kSocketPath);
+    hotcakey::Inactivate();
+    std::_Exit(served ? 0 : 1);
+  }
+
+  close(typing[0]);
+
+  struct stat st;
+  auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(3);
+  while (stat(kSocketPath, &st) != 0) {
+    if (std::chrono::steady_clock::now() > deadline) break;
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+
+  return pid;
+}
+
+}  // namespace
+
+int main() {
+  auto keyboard = OpenKeyboard();
+
+  std::printf("input: %s\n", keyboard < 0 ? "synthetic" : "uinput");
+  std::printf("%12s %10s %10s %10s\n", "mode", "p50 us", "p99 us", "max us");
+
+  // fork before this process starts any thread
+  auto daemon = StartDaemon();
+  if (daemon < 0) return 1;
+
+  hotcakey::daemon::SetEnabled(false);
+  auto ok = Bench("in-process", keyboard);
+
+  setenv("HOTCAKEY_SOCKET", kSocketPath, 1);
+  hotcakey::daemon::SetEnabled(true);
+  isTypingToDaemon = true;
+  ok = Bench("hotcakeyd", keyboard) && ok;
+
+  kill(daemon, SIGTERM);
+  waitpid(daemon, nullptr, 0);
+
+  if (keyboard >= 0) {
+    ioctl(keyboard, UI_DEV_DESTROY);
+    close(keyboard);
+  }
+
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,104 @@
+// gc pressure benchmark of the event delivery modes.
+//
+// a hotkey is fed sustained key presses through the synthetic input, once
+// per delivery mode, and the garbage collections seen meanwhile are
+// counted along with their pause time.
+//
+//   npm run bench:delivery
+
+import { PerformanceObserver, performance } from 'perf_hooks'
+import hotcakey, { Delivery, InjectedEvent } from '../'
+
+const presses = 20000
+// 4000 events per second, which is far beyond key repeat
+const interval = 0.25
+
+function typing(): InjectedEvent[] {
+  const events: InjectedEvent[] = []
+
+  for (let i = 0; i < presses; i++) {
+    events.push({ code: 'F13', type: 'keydown', at: i * interval })
+    events.push({ code: 'F13', type: 'keyup', at: i * interval + interval / 2 })
+  }
+
+  return events
+}
+
+function tick(): Promise<void> {
+  return new Promise((resolve) => setImmediate(resolve))
+}
+
+async function bench(delivery: Delivery) {
+  let received = 0
+  let downs = 0
+
+  const unsubscribe =
+    delivery === 'positional'
+      ? hotcakey.register(
+          ['F13'],
+          (type) => {
+            received++
+            if (type === hotcakey.eventTypeCodes.keydown) downs++
+          },
+          { delivery }
+        )
+      : hotcakey.register(
+          ['F13'],
+          (event) => {
+            received++
+            if (event.type === 'keydown') downs++
+          },
+          { delivery }
+        )
+
+  const sequence = typing()
+
+  global.gc?.()
+
+  let collections = 0
+  let pause = 0
+  const observer = new PerformanceObserver((list) => {
+    for (const entry of list.getEntries()) {
+      collections++
+      pause += entry.duration
+    }
+  })
+  observer.observe({ entryTypes: ['gc'] })
+
+  const start = performance.now()
+  await hotcakey.inject(sequence, { target: 'synthetic' })
+  while (received < sequence.length) await tick()
+  const elapsed = performance.now() - start
+
+  // gc entries are observed asynchronously
+  await new Promise((resolve) => setTimeout(resolve, 100))
+  observer.disconnect()
+  unsubscribe()
+
+  console.log(
+    delivery.padStart(10),
+    String(Math.round(received / (elapsed / 1000))).padStart(10),
+    String(collections).padStart(10),
+    pause.toFixed(1).padStart(10),
+    String(downs === presses).padStart(6)
+  )
+}
+
+async function main() {
+  if (!global.gc) {
+    console.error('run with --expose-gc')
+    process.exit(1)
+  }
+
+  await hotcakey.activate({ verbose: false })
+
+  console.log('delivery'.padStart(10), 'events/s'.padStart(10), 'gcs'.padStart(10), 'pause ms'.padStart(10), 'ok'.padStart(6))
+
+  for (const delivery of ['object', 'reuse', 'positional'] as Delivery[]) {
+    await bench(delivery)
+  }
+
+  await hotcakey.inactivate()
+}
+
+main()
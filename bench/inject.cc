@@ -0,0 +1,83 @@
+// throughput benchmark of `Inject` into the synthetic device.
+//
+// keys are injected as fast as possible and at a fixed pace, and the time
+// until a hotkey saw all of them is measured along with the writes.
+//
+//   npm run bench:inject
+
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+#include "../src/hotcakey/daemon.h"
+#include "../src/hotcakey/hotcakey.h"
+#include "../src/hotcakey/ring.h"
+
+namespace {
+
+constexpr std::size_t kPresses = 100000;
+
+std::atomic<std::size_t> calls(0);
+
+std::vector<hotcakey::InjectedEvent> Typing(std::size_t times,
+                                            std::int64_t interval) {
+  std::vector<hotcakey::InjectedEvent> events;
+
+  for (std::size_t i = 0; i < times; i++) {
+    auto at = static_cast<std::int64_t>(i) * interval;
+    events.push_back({"F13", hotcakey::kKeyDown, at});
+    events.push_back({"F13", hotcakey::kKeyUp, at + interval / 2});
+  }
+
+  return events;
+}
+
+bool Bench(const char* name, std::size_t times, std::int64_t interval,
+           hotcakey::ReplayPace pace) {
+  hotcakey::InjectOption option;
+  option.target = hotcakey::kInjectSynthetic;
+  option.pace = pace;
+
+  auto events = Typing(times, interval);
+  calls = 0;
+
+  hotcakey::InjectReport report;
+  auto start = hotcakey::ring::Now();
+
+  if (hotcakey::Inject(events, option, report) != hotcakey::kSuccess) {
+    return false;
+  }
+
+  while (calls < events.size()) {
+    std::this_thread::yield();
+  }
+
+  auto elapsed = (hotcakey::ring::Now() - start) / 1e9;
+  std::printf("%10s %12.0f %10zu %12.1f\n", name, events.size() / elapsed,
+              report.writes, report.lateness / 1e3);
+
+  return true;
+}
+
+}  // namespace
+
+int main() {
+  hotcakey::daemon::SetEnabled(false);
+
+  if (hotcakey::Activate() != hotcakey::kSuccess) return 1;
+
+  hotcakey::Register({"F13"}, [](const hotcakey::Event&) { calls++; });
+
+  std::printf("%10s %12s %10s %12s\n", "timing", "events/s", "writes",
+              "lateness us");
+
+  auto ok = Bench("fastest", kPresses, 0, hotcakey::kReplayFastest);
+  // 10000 events per second
+  ok = Bench("paced", kPresses / 20, 200000, hotcakey::kReplayOriginal) && ok;
+
+  hotcakey::Inactivate();
+
+  return ok ? 0 : 1;
+}
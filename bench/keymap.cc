@@ -0,0 +1,143 @@
+// startup benchmark of registering a large keymap.
+//
+// registers the same 400 bindings per call with key names, as an app
+// reading its own json would, and then in one batch from a keymap
+// compiled by `hotcakeyc`, and measures the time until all are registered.
+//
+//   npm run bench:keymap
+
+#include <unistd.h>
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "../src/hotcakey/daemon.h"
+#include "../src/hotcakey/hotcakey.h"
+#include "../src/hotcakey/keymap.h"
+#include "../src/hotcakey/ring.h"
+#include "../src/hotcakeyc/compiler.h"
+
+namespace {
+
+constexpr int kRounds = 50;
+
+struct Binding {
+  std::vector<std::string> keys;
+  std::string layer;
+};
+
+// 25 keys with 8 modifier combinations in 2 layers
+std::vector<Binding> Generate() {
+  const char* keys[] = {"KeyA", "KeyB", "KeyC", "KeyD", "KeyE", "KeyF", "KeyG",
+                        "KeyH", "KeyI", "KeyJ", "KeyK", "KeyL", "KeyM", "KeyN",
+                        "KeyO", "KeyP", "KeyQ", "KeyR", "KeyS", "KeyT", "KeyU",
+                        "KeyV", "KeyW", "KeyX", "KeyY"};
+  const char* modifiers[] = {"Control", "Shift", "Alt"};
+
+  std::vector<Binding> bindings;
+
+  for (auto layer : {"", "vim"}) {
+    for (int mask = 0; mask < 8; mask++) {
+      for (auto key : keys) {
+        Binding binding{{}, layer};
+        for (int i = 0; i < 3; i++) {
+          if (mask & (1 << i)) binding.keys.push_back(modifiers[i]);
+        }
+        binding.keys.push_back(key);
+        bindings.push_back(binding);
+      }
+    }
+  }
+
+  return bindings;
+}
+
+std::string ToJson(const std::vector<Binding>& bindings) {
+  std::string json = "{\"bindings\": [";
+
+  for (std::size_t i = 0; i < bindings.size(); i++) {
+    if (i > 0) json += ",";
+    json += "{\"keys\": [";
+    for (std::size_t j = 0; j < bindings[i].keys.size(); j++) {
+      if (j > 0) json += ",";
+      json += "\"" + bindings[i].keys[j] + "\"";
+    }
+    json += "], \"layer\": \"" + bindings[i].layer +
+            "\", \"action\": \"" + std::to_string(i) + "\"}";
+  }
+
+  return json + "]}";
+}
+
+void UnregisterAll(const std::vector<hotcakey::Registration>& registrations) {
+  for (auto registration : registrations) hotcakey::Unregister(registration);
+}
+
+}  // namespace
+
+int main() {
+  hotcakey::daemon::SetEnabled(false);
+
+  auto bindings = Generate();
+  auto path = "/tmp/hotcakey-bench-" + std::to_string(getpid()) + ".hkkm";
+
+  hotcakeyc::Keymap keymap;
+  std::string error;
+
+  auto compileStart = hotcakey::ring::Now();
+  if (!hotcakeyc::Compile(ToJson(bindings), keymap, error) ||
+      !hotcakey::keymap::Write(path, keymap.bindings, keymap.layers,
+                               keymap.actions)) {
+    std::fprintf(stderr, "failed to compile keymap: %s\n", error.c_str());
+    return 1;
+  }
+  auto compiled = hotcakey::ring::Now() - compileStart;
+
+  if (hotcakey::Activate() != hotcakey::kSuccess) return 1;
+
+  auto noop = [](const hotcakey::Event&) {};
+  std::vector<hotcakey::Registration> registrations;
+  std::int64_t perCall = 0;
+  std::int64_t batched = 0;
+
+  for (int round = 0; round < kRounds; round++) {
+    registrations.clear();
+
+    auto start = hotcakey::ring::Now();
+    for (auto& binding : bindings) {
+      registrations.push_back(
+          hotcakey::RegisterInLayer(binding.layer, binding.keys, noop).second);
+    }
+    perCall += hotcakey::ring::Now() - start;
+
+    UnregisterAll(registrations);
+
+    start = hotcakey::ring::Now();
+    auto result = hotcakey::RegisterKeymap(
+        path, [&](std::size_t) -> hotcakey::Callback { return noop; },
+        registrations);
+    batched += hotcakey::ring::Now() - start;
+
+    if (result != hotcakey::kSuccess) {
+      hotcakey::Inactivate();
+      return 1;
+    }
+
+    UnregisterAll(registrations);
+  }
+
+  hotcakey::Inactivate();
+  unlink(path.c_str());
+
+  std::printf("bindings: %zu, rounds: %d, compiled once in %.1f us\n",
+              bindings.size(), kRounds, compiled / 1e3);
+  std::printf("per call: %.1f us per keymap, %.0f ns per binding\n",
+              perCall / 1e3 / kRounds,
+              static_cast<double>(perCall) / kRounds / bindings.size());
+  std::printf("keymap:   %.1f us per keymap, %.0f ns per binding\n",
+              batched / 1e3 / kRounds,
+              static_cast<double>(batched) / kRounds / bindings.size());
+
+  return 0;
+}
@@ -0,0 +1,160 @@
+// microbenchmark of the chord matcher used by the raw input backend.
+//
+// drives 1M synthetic keystrokes against a growing number of registered
+// chords and compares the indexed matcher with a naive linear scan.
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include "../src/hotcakey/matcher.h"
+
+namespace {
+
+constexpr std::size_t kKeystrokes = 1000000;
+
+// mirrors the modifier layout of linux evdev key codes
+constexpr hotcakey::KeyCode kLeftCtrl = 29;
+constexpr hotcakey::KeyCode kLeftShift = 42;
+constexpr hotcakey::KeyCode kLeftAlt = 56;
+constexpr hotcakey::KeyCode kLeftMeta = 125;
+
+constexpr hotcakey::KeyCode kModifierCodes[] = {kLeftCtrl, kLeftShift,
+                                                kLeftAlt, kLeftMeta};
+
+struct Keystroke {
+  hotcakey::KeyCode key;
+  std::uint8_t modifiers;
+};
+
+bool IsModifierCode(hotcakey::KeyCode code) {
+  for (auto modifier : kModifierCodes) {
+    if (code == modifier) return true;
+  }
+  return false;
+}
+
+hotcakey::KeyCode RandomKey(std::mt19937& random) {
+  std::uniform_int_distribution<int> keys(1, 255);
+  while (true) {
+    auto key = static_cast<hotcakey::KeyCode>(keys(random));
+    if (!IsModifierCode(key)) return key;
+  }
+}
+
+std::vector<hotcakey::Chord> MakeChords(std::size_t count) {
+  std::mt19937 random(42);
+  std::uniform_int_distribution<int> modifiers(0, 15);
+
+  std::vector<hotcakey::Chord> chords;
+  chords.reserve(count);
+
+  for (std::size_t i = 0; i < count; i++) {
+    chords.push_back({RandomKey(random),
+                      static_cast<std::uint8_t>(modifiers(random))});
+  }
+
+  return chords;
+}
+
+std::vector<Keystroke> MakeKeystrokes() {
+  std::mt19937 random(7);
+  std::uniform_int_distribution<int> modifiers(0, 15);
+
+  std::vector<Keystroke> keystrokes;
+  keystrokes.reserve(kKeystrokes);
+
+  for (std::size_t i = 0; i < kKeystrokes; i++) {
+    keystrokes.push_back({RandomKey(random),
+                          static_cast<std::uint8_t>(modifiers(random))});
+  }
+
+  return keystrokes;
+}
+
+template <typename F>
+double Measure(F f) {
+  auto start = std::chrono::steady_clock::now();
+  f();
+  auto end = std::chrono::steady_clock::now();
+  return std::chrono::duration<double, std::nano>(end - start).count();
+}
+
+double BenchMatcher(const std::vector<hotcakey::Chord>& chords,
+                    const std::vector<Keystroke>& keystrokes,
+                    std::size_t& fired) {
+  hotcakey::Matcher matcher;
+  matcher.SetModifierKey(kLeftCtrl, hotcakey::kModifierControl);
+  matcher.SetModifierKey(kLeftShift, hotcakey::kModifierShift);
+  matcher.SetModifierKey(kLeftAlt, hotcakey::kModifierAlt);
+  matcher.SetModifierKey(kLeftMeta, hotcakey::kModifierMeta);
+
+  hotcakey::Registration registration = 0;
+  for (auto& chord : chords) matcher.Add(chord, ++registration);
+
+  fired = 0;
+
+  return Measure([&] {
+    for (auto& keystroke : keystrokes) {
+      for (std::size_t i = 0; i < 4; i++) {
+        if (keystroke.modifiers & (1 << i)) matcher.Press(kModifierCodes[i]);
+      }
+
+      fired += matcher.Press(keystroke.key).size();
+      fired += matcher.Release(keystroke.key).size();
+
+      for (std::size_t i = 0; i < 4; i++) {
+        if (keystroke.modifiers & (1 << i)) matcher.Release(kModifierCodes[i]);
+      }
+    }
+  });
+}
+
+double BenchLinearScan(const std::vector<hotcakey::Chord>& chords,
+                       const std::vector<Keystroke>& keystrokes,
+                       std::size_t& fired) {
+  fired = 0;
+
+  return Measure([&] {
+    for (auto& keystroke : keystrokes) {
+      for (auto& chord : chords) {
+        if (chord.key == keystroke.key &&
+            chord.modifiers == keystroke.modifiers) {
+          fired += 2;
+        }
+      }
+    }
+  });
+}
+
+}  // namespace
+
+int main() {
+  auto keystrokes = MakeKeystrokes();
+
+  std::printf("%10s %16s %16s %10s\n", "chords", "matcher ns/key",
+              "linear ns/key", "fired");
+
+  for (std::size_t count : {10, 100, 1000, 10000}) {
+    auto chords = MakeChords(count);
+
+    std::size_t matched = 0;
+    std::size_t scanned = 0;
+
+    auto matcher = BenchMatcher(chords, keystrokes, matched);
+    auto linear = BenchLinearScan(chords, keystrokes, scanned);
+
+    if (matched != scanned) {
+      std::fprintf(stderr, "mismatch: matcher=%zu linear=%zu\n", matched,
+                   scanned);
+      return 1;
+    }
+
+    std::printf("%10zu %16.1f %16.1f %10zu\n", count, matcher / kKeystrokes,
+                linear / kKeystrokes, matched);
+  }
+
+  return 0;
+}
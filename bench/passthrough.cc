@@ -0,0 +1,150 @@
+// latency benchmark of the passthrough path while grabbing.
+//
+// a grabbed synthetic keyboard is typed on, and the time until the key
+// comes out of the passthrough is measured. the passthrough is a pipe in
+// place of the uinput keyboard, so a bare hop through two pipes is
+// measured too, and the difference is what hotcakey adds.
+//
+//   npm run bench:passthrough
+
+#include <fcntl.h>
+#include <linux/input.h>
+#include <poll.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+#include "../src/hotcakey/daemon.h"
+#include "../src/hotcakey/hotcakey.h"
+#include "../src/hotcakey/ring.h"
+#include "../src/hotcakey/synthetic.h"
+
+namespace {
+
+constexpr std::size_t kIterations = 20000;
+
+// waits for a keydown of `code` at `fd`
+bool WaitKeyDown(int fd, unsigned int code) {
+  input_event events[16];
+
+  while (true) {
+    pollfd readable{fd, POLLIN, 0};
+    if (poll(&readable, 1, 1000) <= 0) return false;
+
+    auto size = read(fd, events, sizeof(events));
+    if (size <= 0) continue;
+
+    for (std::size_t i = 0; i < size / sizeof(input_event); i++) {
+      if (events[i].type == EV_KEY && events[i].code == code &&
+          events[i].value == 1) {
+        return true;
+      }
+    }
+  }
+}
+
+void Print(const char* name, std::vector<double>& latencies) {
+  std::sort(latencies.begin(), latencies.end());
+  std::printf("%12s %10.1f %10.1f %10.1f\n", name,
+              latencies[latencies.size() / 2],
+              latencies[latencies.size() * 99 / 100], latencies.back());
+}
+
+// the same two pipe hops with a thread copying between them
+bool BenchPipes() {
+  int in[2], out[2];
+  if (pipe(in) != 0 || pipe(out) != 0) return false;
+
+  std::thread copier([&] {
+    input_event event;
+    while (read(in[0], &event, sizeof(event)) == sizeof(event)) {
+      if (write(out[1], &event, sizeof(event)) != sizeof(event)) break;
+    }
+  });
+
+  std::vector<double> latencies;
+  input_event event{};
+  event.type = EV_KEY;
+  event.code = KEY_F13;
+
+  for (std::size_t i = 0; i < kIterations; i++) {
+    auto now = hotcakey::ring::Now();
+    event.value = 1;
+    if (write(in[1], &event, sizeof(event)) != sizeof(event)) break;
+    if (!WaitKeyDown(out[0], KEY_F13)) break;
+    latencies.push_back((hotcakey::ring::Now() - now) / 1000.0);
+  }
+
+  close(in[1]);
+  copier.join();
+  close(in[0]);
+  close(out[0]);
+  close(out[1]);
+
+  if (latencies.size() != kIterations) return false;
+
+  Print("pipes only", latencies);
+
+  return true;
+}
+
+bool BenchPassthrough() {
+  int passthrough[2];
+  if (pipe2(passthrough, O_CLOEXEC) != 0) return false;
+
+  hotcakey::synthetic::SetPassthrough(passthrough[1]);
+
+  hotcakey::ActivationOption option;
+  option.grab = true;
+
+  if (hotcakey::Activate(option) != hotcakey::kSuccess) return false;
+
+  auto [added, keyboard] = hotcakey::synthetic::AddDevice({});
+  auto ok = added == hotcakey::kSuccess;
+
+  // a hotkey on another key, so the matcher is on the path
+  hotcakey::Register({"Control", "KeyK"}, [](const hotcakey::Event&) {});
+
+  std::vector<double> latencies;
+  latencies.reserve(kIterations);
+
+  for (std::size_t i = 0; ok && i < kIterations; i++) {
+    auto now = hotcakey::ring::Now();
+    hotcakey::synthetic::Emit(keyboard, "F13", hotcakey::kKeyDown);
+
+    if (!WaitKeyDown(passthrough[0], KEY_F13)) {
+      std::fprintf(stderr, "keydown was not passed through\n");
+      ok = false;
+      break;
+    }
+
+    latencies.push_back((hotcakey::ring::Now() - now) / 1000.0);
+    hotcakey::synthetic::Emit(keyboard, "F13", hotcakey::kKeyUp);
+  }
+
+  hotcakey::Inactivate();
+  hotcakey::synthetic::SetPassthrough(-1);
+  close(passthrough[0]);
+  close(passthrough[1]);
+
+  if (ok) Print("passthrough", latencies);
+
+  return ok;
+}
+
+}  // namespace
+
+int main() {
+  hotcakey::daemon::SetEnabled(false);
+
+  std::printf("%12s %10s %10s %10s\n", "path", "p50 us", "p99 us", "max us");
+
+  auto ok = BenchPipes();
+  ok = BenchPassthrough() && ok;
+
+  return ok ? 0 : 1;
+}
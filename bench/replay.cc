@@ -0,0 +1,130 @@
+// throughput benchmark of the dispatch pipeline.
+//
+// replays a recording (or a generated typing session when no path is
+// given) as fast as possible through the input thread, and measures the
+// time until the last event reaches the listeners.
+//
+//   npm run bench:replay -- path/to/session.rec
+
+#include <unistd.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <thread>
+
+#include "../src/hotcakey/daemon.h"
+#include "../src/hotcakey/hotcakey.h"
+#include "../src/hotcakey/recording.h"
+#include "../src/hotcakey/ring.h"
+
+namespace {
+
+constexpr std::size_t kStrokes = 100000;
+
+// evdev codes of KEY_Q .. KEY_P and KEY_LEFTCTRL
+constexpr std::uint16_t kFirstKey = 16;
+constexpr std::uint16_t kLastKey = 25;
+constexpr std::uint16_t kControl = 29;
+
+std::atomic<std::uint64_t> received(0);
+
+// control + one of ten keys, one chord out of four
+bool Generate(const std::string& path) {
+  auto writer = hotcakey::recording::Writer::Create(path);
+  if (!writer) return false;
+
+  std::int64_t now = 0;
+  auto write = [&](std::uint16_t code, hotcakey::EventType type) {
+    now += 1000000;
+    writer->Write({now, code, static_cast<std::uint8_t>(type), 0, 0});
+  };
+
+  for (std::size_t i = 0; i < kStrokes; i++) {
+    auto code =
+        static_cast<std::uint16_t>(kFirstKey + i % (kLastKey - kFirstKey + 1));
+    auto chord = i % 4 == 0;
+    if (chord) write(kControl, hotcakey::kKeyDown);
+    write(code, hotcakey::kKeyDown);
+    write(code, hotcakey::kKeyUp);
+    if (chord) write(kControl, hotcakey::kKeyUp);
+  }
+
+  return writer->Flush();
+}
+
+bool WaitReceived(std::uint64_t count) {
+  auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+  while (received.load(std::memory_order_acquire) < count) {
+    if (std::chrono::steady_clock::now() > deadline) return false;
+    std::this_thread::sleep_for(std::chrono::microseconds(100));
+  }
+  return true;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  hotcakey::daemon::SetEnabled(false);
+
+  std::string path;
+
+  if (argc > 1) {
+    path = argv[1];
+  } else {
+    path = "/tmp/hotcakey-bench-" + std::to_string(getpid()) + ".rec";
+    if (!Generate(path)) return 1;
+  }
+
+  if (hotcakey::Activate() != hotcakey::kSuccess) return 1;
+
+  auto count = [](const hotcakey::Event&) {
+    received.fetch_add(1, std::memory_order_release);
+  };
+
+  for (auto key : {"KeyQ", "KeyW", "KeyE", "KeyR", "KeyT", "KeyY", "KeyU",
+                   "KeyI", "KeyO", "KeyP"}) {
+    hotcakey::Register({"Control", key}, count);
+  }
+
+  hotcakey::Subscribe({}, count);
+
+  hotcakey::ReplayReport report;
+  auto start = hotcakey::ring::Now();
+
+  if (hotcakey::Replay(path, hotcakey::kReplayFastest, report) !=
+      hotcakey::kSuccess) {
+    hotcakey::Inactivate();
+    return 1;
+  }
+
+  // every event reaches the stream, and chords of a recording made without
+  // these registrations are counted by the stream only
+  auto expected = argc > 1 ? report.events : report.events + kStrokes / 4 * 2;
+
+  if (!WaitReceived(expected)) {
+    std::fprintf(stderr, "only %llu of %llu events were delivered\n",
+                 static_cast<unsigned long long>(received.load()),
+                 static_cast<unsigned long long>(expected));
+    hotcakey::Inactivate();
+    return 1;
+  }
+
+  auto elapsed = hotcakey::ring::Now() - start;
+
+  hotcakey::Inactivate();
+
+  if (argc <= 1) unlink(path.c_str());
+
+  std::printf("events: %llu, deliveries: %llu, elapsed: %.1f ms\n",
+              static_cast<unsigned long long>(report.events),
+              static_cast<unsigned long long>(received.load()),
+              elapsed / 1e6);
+  std::printf("throughput: %.0f events/s, %.2f us per event\n",
+              report.events * 1e9 / elapsed,
+              elapsed / 1e3 / report.events);
+
+  return 0;
+}
@@ -0,0 +1,152 @@
+// latency benchmark of the input thread under cpu contention.
+//
+// keeps every cpu busy with twice as many spinning threads and measures
+// the time from a synthetic keydown to the listener being called, with
+// each scheduling option of the input thread. realtime policies usually
+// need root or CAP_SYS_NICE, otherwise they fall back as reported.
+
+#include <sched.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../src/hotcakey/daemon.h"
+#include "../src/hotcakey/hotcakey.h"
+#include "../src/hotcakey/ring.h"
+#include "../src/hotcakey/synthetic.h"
+
+namespace {
+
+constexpr std::size_t kIterations = 2000;
+
+std::atomic<std::int64_t> received(0);
+std::atomic<bool> isBusy(true);
+
+struct Case {
+  const char* name;
+  hotcakey::ActivationOption option;
+};
+
+std::vector<Case> MakeCases() {
+  hotcakey::ActivationOption nice;
+  nice.nice = -10;
+
+  hotcakey::ActivationOption fifo;
+  fifo.policy = hotcakey::kSchedulingFifo;
+  fifo.priority = 10;
+  fifo.lockMemory = true;
+
+  hotcakey::ActivationOption pinned = fifo;
+  pinned.cpus = {0};
+
+  return {{"default", {}}, {"nice -10", nice}, {"fifo", fifo},
+          {"fifo cpu0", pinned}};
+}
+
+void Spin() {
+  volatile std::uint64_t counter = 0;
+  while (isBusy.load(std::memory_order_relaxed)) counter++;
+}
+
+bool WaitReceived(std::int64_t since) {
+  auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(1);
+  while (received.load(std::memory_order_acquire) < since) {
+    if (std::chrono::steady_clock::now() > deadline) return false;
+    std::this_thread::sleep_for(std::chrono::microseconds(50));
+  }
+  return true;
+}
+
+bool Bench(const Case& c) {
+  if (hotcakey::Activate(c.option) != hotcakey::kSuccess) return false;
+
+  auto report = hotcakey::GetActivationReport();
+
+  auto [result, registration] = hotcakey::Register(
+      {"F13"}, [](const hotcakey::Event& event) {
+        if (event.type == hotcakey::kKeyDown) {
+          received.store(hotcakey::ring::Now(), std::memory_order_release);
+        }
+      });
+
+  if (result != hotcakey::kSuccess) {
+    hotcakey::Inactivate();
+    return false;
+  }
+
+  std::vector<double> latencies;
+  latencies.reserve(kIterations);
+
+  // the emitting thread takes part in the contention too, so raise it
+  // when permitted to measure only the input thread. it is raised after
+  // activation since new threads inherit the policy.
+  sched_param param{};
+  param.sched_priority = 20;
+  sched_setscheduler(0, SCHED_FIFO, &param);
+
+  for (std::size_t i = 0; i < kIterations; i++) {
+    auto now = hotcakey::ring::Now();
+    hotcakey::synthetic::Emit("F13", hotcakey::kKeyDown);
+
+    if (!WaitReceived(now)) {
+      std::fprintf(stderr, "%s: keydown was not delivered\n", c.name);
+      hotcakey::Inactivate();
+      return false;
+    }
+
+    latencies.push_back((received.load() - now) / 1000.0);
+    hotcakey::synthetic::Emit("F13", hotcakey::kKeyUp);
+
+    // let the input thread go back to sleep like real typing
+    std::this_thread::sleep_for(std::chrono::microseconds(500));
+  }
+
+  param.sched_priority = 0;
+  sched_setscheduler(0, SCHED_OTHER, &param);
+
+  hotcakey::Unregister(registration);
+  hotcakey::Inactivate();
+
+  std::sort(latencies.begin(), latencies.end());
+
+  auto applied = hotcakey::ToString(report.policy);
+  if (report.nice != 0) applied += " nice " + std::to_string(report.nice);
+  if (!report.cpus.empty()) applied += " pinned";
+  if (report.lockMemory) applied += " locked";
+
+  std::printf("%12s %10.1f %10.1f %10.1f   %s\n", c.name,
+              latencies[latencies.size() / 2],
+              latencies[latencies.size() * 99 / 100], latencies.back(),
+              applied.c_str());
+
+  return true;
+}
+
+}  // namespace
+
+int main() {
+  hotcakey::daemon::SetEnabled(false);
+
+  auto cpus = std::max(1u, std::thread::hardware_concurrency());
+
+  std::printf("cpus: %u, spinning threads: %u\n", cpus, cpus * 2);
+  std::printf("%12s %10s %10s %10s   %s\n", "option", "p50 us", "p99 us",
+              "max us", "applied");
+
+  std::vector<std::thread> spinners;
+  for (unsigned i = 0; i < cpus * 2; i++) spinners.emplace_back(Spin);
+
+  auto ok = true;
+  for (auto& c : MakeCases()) ok = Bench(c) && ok;
+
+  isBusy.store(false, std::memory_order_relaxed);
+  for (auto& spinner : spinners) spinner.join();
+
+  return ok ? 0 : 1;
+}
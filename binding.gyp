@@ -1,4 +1,19 @@
 {
+    "variables": {
+        "linux_core_sources": [
+            "src/hotcakey/daemon.linux.cc",
+            "src/hotcakey/executor.linux.cc",
+            "src/hotcakey/hotcakey.linux.cc",
+            "src/hotcakey/keymap.linux.cc",
+            "src/hotcakey/matcher.cc",
+            "src/hotcakey/recording.linux.cc",
+            "src/hotcakey/ring.linux.cc",
+            "src/hotcakey/scheduling.linux.cc",
+            "src/hotcakey/trace.cc",
+            "src/hotcakey/utils/strings.cc",
+            "src/hotcakey/utils/logger.cc"
+        ]
+    },
     "targets": [
         {
             "target_name": "hotcakey",
@@ -17,7 +32,10 @@
                         "defines": ["_HAS_EXCEPTIONS=1"],
                         "sources": [
                             "src/addon.cc",
+                            "src/hotcakey/accelerator.cc",
                             "src/hotcakey/hotcakey.win.cc",
+                            "src/hotcakey/scheduling.win.cc",
+                            "src/hotcakey/trace.cc",
                             "src/hotcakey/utils/strings.cc",
                             "src/hotcakey/utils/logger.cc"
                         ],
@@ -38,7 +56,10 @@
                     {
                         "sources": [
                             "src/addon.cc",
+                            "src/hotcakey/accelerator.cc",
                             "src/hotcakey/hotcakey.mac.cc",
+                            "src/hotcakey/scheduling.mac.cc",
+                            "src/hotcakey/trace.cc",
                             "src/hotcakey/utils/strings.cc",
                             "src/hotcakey/utils/logger.cc"
                         ],
@@ -60,8 +81,59 @@
                             "CLANG_CXX_LANGUAGE_STANDARD": "c++17"
                         }
                     }
+                ],
+                [
+                    "OS=='linux'",
+                    {
+                        "sources": [
+                            "src/addon.cc",
+                            "src/hotcakey/accelerator.cc",
+                            "<@(linux_core_sources)"
+                        ],
+                        "cflags_cc": ["-std=c++17"],
+                        "libraries": ["-lpthread", "-lrt", "-ldl"]
+                    }
                 ]
             ]
         }
+    ],
+    "conditions": [
+        [
+            "OS=='linux'",
+            {
+                "targets": [
+                    {
+                        "target_name": "hotcakeyd",
+                        "type": "executable",
+
+                        "cflags!": ["-fno-exceptions"],
+                        "cflags_cc!": ["-fno-exceptions"],
+
+                        "sources": [
+                            "src/hotcakeyd/hotcakeyd.cc",
+                            "src/hotcakeyd/server.cc",
+                            "<@(linux_core_sources)"
+                        ],
+                        "cflags_cc": ["-std=c++17"],
+                        "libraries": ["-lpthread", "-lrt", "-ldl"]
+                    },
+                    {
+                        "target_name": "hotcakeyc",
+                        "type": "executable",
+
+                        "cflags!": ["-fno-exceptions"],
+                        "cflags_cc!": ["-fno-exceptions"],
+
+                        "sources": [
+                            "src/hotcakeyc/hotcakeyc.cc",
+                            "src/hotcakeyc/compiler.cc",
+                            "<@(linux_core_sources)"
+                        ],
+                        "cflags_cc": ["-std=c++17"],
+                        "libraries": ["-lpthread", "-lrt", "-ldl"]
+                    }
+                ]
+            }
+        ]
     ]
 }
@@ -1,11 +1,23 @@
 #include <napi.h>
 
+#include <algorithm>
+#include <atomic>
 #include <chrono>
 #include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
 #include <thread>
 #include <unordered_map>
+#include <utility>
+#include <vector>
 
+#include "./hotcakey/accelerator.h"
 #include "./hotcakey/hotcakey.h"
+#include "./hotcakey/lag.h"
+#include "./hotcakey/queue.h"
+#include "./hotcakey/trace.h"
 #include "./hotcakey/utils/logger.h"
 #include "./hotcakey/utils/strings.h"
 
@@ -13,13 +25,94 @@ namespace {
 
 std::unordered_map<hotcakey::Registration, Napi::ThreadSafeFunction> tsfs;
 
+// how events are handed to a javascript listener
+enum Delivery {
+  // a new event object per event
+  kDeliverObject,
+  // one event object per listener, overwritten for every event
+  kDeliverReuse,
+  // `(type, time, registration, code)` arguments without any object
+  kDeliverPositional,
+  // `(binding, type, time)` arguments for a binding of a keymap
+  kDeliverBinding,
+  // `(action, type, time)` arguments for a binding of a watched keymap
+  kDeliverAction,
+};
+
+// action names of a watched keymap. the watching thread adds names and the
+// main thread reads them, and an index stays valid for good.
+class ActionNames {
+ public:
+  std::uint32_t Intern(const std::string& name) {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    auto it = std::find(names.begin(), names.end(), name);
+    if (it != names.end()) return it - names.begin();
+
+    names.push_back(name);
+    return names.size() - 1;
+  }
+
+  std::string At(std::uint32_t index) {
+    std::lock_guard<std::mutex> lock(mutex);
+    return names[index];
+  }
+
+ private:
+  std::mutex mutex;
+  std::vector<std::string> names;
+};
+
+// state of a listener only touched on the main thread. owned by the
+// thread safe function as its context and deleted by its finalizer.
+struct Deliverer {
+  Delivery delivery;
+  hotcakey::Registration registration = 0;
+  Napi::ObjectReference event;
+  // events still queued in the thread safe function when unsubscribed
+  // are dropped instead of reaching the listener
+  bool isUnsubscribed = false;
+  // of a watched keymap, and their strings interned for delivery
+  std::shared_ptr<ActionNames> actions;
+  std::unordered_map<std::uint32_t, Napi::Reference<Napi::String>> actionNames;
+};
+
+// strings interned once, so that delivering an event creates none.
+// event codes are string literals of the backend, so the pointer is the key.
+Napi::Reference<Napi::String> typeNames[2];
+std::unordered_map<const char*, Napi::Reference<Napi::String>> codeNames;
+
+// queues of event streams. the input thread pushes to them, and the main
+// thread pops from them when woken up. see `Events`.
+std::unordered_map<hotcakey::Registration,
+                   std::shared_ptr<hotcakey::EventQueue>>
+    queues;
+
+// an event on its way from the input thread to the main thread
+struct Pending {
+  hotcakey::Event event;
+  std::chrono::steady_clock::time_point enqueued;
+  // index of the binding in a keymap, or of the action in `ActionNames`
+  std::uint32_t binding = 0;
+};
+
+// how long events wait for the main thread. everything but `pending` is
+// only touched on the main thread.
+hotcakey::Lag lag;
+std::atomic<std::size_t> pending(0);
+Napi::FunctionReference stallListener;
+
+// keeps the typed array written by the input thread alive
+Napi::ObjectReference keyState;
+
 class ActivationWorker : public Napi::AsyncWorker {
  public:
   ActivationWorker(const Napi::Env& env,
-                   const Napi::Promise::Deferred& deferred)
-      : Napi::AsyncWorker(env), deferred(deferred) {}
+                   const Napi::Promise::Deferred& deferred,
+                   const hotcakey::ActivationOption& option)
+      : Napi::AsyncWorker(env), deferred(deferred), option(option) {}
 
-  void Execute() { result = hotcakey::Activate(); }
+  void Execute() { result = hotcakey::Activate(option); }
 
   void OnError(const Napi::Error& e) {
     Napi::HandleScope scope(Env());
@@ -45,19 +138,24 @@ class ActivationWorker : public Napi::AsyncWorker {
 
  private:
   Napi::Promise::Deferred deferred;
+  hotcakey::ActivationOption option;
   hotcakey::Result result;
 };
 
 class InactivationWorker : public Napi::AsyncWorker {
  public:
   InactivationWorker(const Napi::Env& env,
-                     const Napi::Promise::Deferred& deferred)
-      : Napi::AsyncWorker(env), deferred(deferred) {}
+                     const Napi::Promise::Deferred& deferred,
+                     decltype(tsfs)&& listeners)
+      : Napi::AsyncWorker(env),
+        deferred(deferred),
+        listeners(std::move(listeners)) {}
 
   void Execute() { result = hotcakey::Inactivate(); }
 
   void OnError(const Napi::Error& e) {
     Napi::HandleScope scope(Env());
+    ReleaseListeners();
     deferred.Reject(Napi::String::New(Env(), "failure"));
   }
 
@@ -66,6 +164,8 @@ class InactivationWorker : public Napi::AsyncWorker {
 
     LOG("inactivation callback called");
 
+    ReleaseListeners();
+
     switch (result) {
       case hotcakey::Result::kSuccess:
         LOG("inactivation finished with status: success");
@@ -78,8 +178,100 @@ class InactivationWorker : public Napi::AsyncWorker {
     }
   }
 
+ private:
+  // NOTICE:
+  // the input thread may call them until `hotcakey::Inactivate` joins it,
+  // so they are released afterward on the main thread.
+  void ReleaseListeners() {
+    for (auto& [registration, tsf] : listeners) tsf.Release();
+    listeners.clear();
+  }
+
+  Napi::Promise::Deferred deferred;
+  decltype(tsfs) listeners;
+  hotcakey::Result result;
+};
+
+// replays on a worker thread since the original pace may take as long as
+// the recording itself
+class ReplayWorker : public Napi::AsyncWorker {
+ public:
+  ReplayWorker(const Napi::Env& env, const Napi::Promise::Deferred& deferred,
+               const std::string& path, hotcakey::ReplayPace pace)
+      : Napi::AsyncWorker(env), deferred(deferred), path(path), pace(pace) {}
+
+  void Execute() { result = hotcakey::Replay(path, pace, report); }
+
+  void OnError(const Napi::Error& e) {
+    Napi::HandleScope scope(Env());
+    deferred.Reject(Napi::String::New(Env(), "failure"));
+  }
+
+  void OnOK() {
+    Napi::HandleScope scope(Env());
+
+    if (result != hotcakey::Result::kSuccess) {
+      ERR("replay finished with status: failure");
+      deferred.Reject(Napi::String::New(Env(), hotcakey::ToString(result)));
+      return;
+    }
+
+    auto value = Napi::Object::New(Env());
+    value["events"] = Napi::Number::New(Env(), report.events);
+    value["matches"] = Napi::Number::New(Env(), report.matches);
+    value["elapsed"] = Napi::Number::New(Env(), report.elapsed / 1e6);
+
+    deferred.Resolve(value);
+  }
+
+ private:
+  Napi::Promise::Deferred deferred;
+  std::string path;
+  hotcakey::ReplayPace pace;
+  hotcakey::ReplayReport report;
+  hotcakey::Result result;
+};
+
+class InjectWorker : public Napi::AsyncWorker {
+ public:
+  InjectWorker(const Napi::Env& env, const Napi::Promise::Deferred& deferred,
+               std::vector<hotcakey::InjectedEvent>&& events,
+               const hotcakey::InjectOption& option)
+      : Napi::AsyncWorker(env),
+        deferred(deferred),
+        events(std::move(events)),
+        option(option) {}
+
+  void Execute() { result = hotcakey::Inject(events, option, report); }
+
+  void OnError(const Napi::Error& e) {
+    Napi::HandleScope scope(Env());
+    deferred.Reject(Napi::String::New(Env(), "failure"));
+  }
+
+  void OnOK() {
+    Napi::HandleScope scope(Env());
+
+    if (result != hotcakey::Result::kSuccess) {
+      ERR("injection finished with status: failure");
+      deferred.Reject(Napi::String::New(Env(), hotcakey::ToString(result)));
+      return;
+    }
+
+    auto value = Napi::Object::New(Env());
+    value["events"] = Napi::Number::New(Env(), report.events);
+    value["writes"] = Napi::Number::New(Env(), report.writes);
+    value["elapsed"] = Napi::Number::New(Env(), report.elapsed / 1e6);
+    value["lateness"] = Napi::Number::New(Env(), report.lateness / 1e6);
+
+    deferred.Resolve(value);
+  }
+
  private:
   Napi::Promise::Deferred deferred;
+  std::vector<hotcakey::InjectedEvent> events;
+  hotcakey::InjectOption option;
+  hotcakey::InjectReport report;
   hotcakey::Result result;
 };
 
@@ -97,67 +289,243 @@ std::vector<std::string> NormalizeKeys(const Napi::Array& keys) {
   return results;
 }
 
+// releases the thread safe function of `registration`, if any
+void ReleaseListener(hotcakey::Registration registration) {
+  auto it = tsfs.find(registration);
+
+  if (it != tsfs.end()) {
+    auto deliverer = static_cast<Deliverer*>(it->second.GetContext());
+    if (deliverer != nullptr) deliverer->isUnsubscribed = true;
+
+    it->second.Release();
+    tsfs.erase(it);
+  }
+
+  // an event stream ends with its registration
+  queues.erase(registration);
+}
+
 void Unregister(const Napi::CallbackInfo& info) {
   LOG("start exported function `Unregister`");
 
+  // owned by the unsubscribe function, see `ToUnsubscribe`
   auto registration = static_cast<hotcakey::Registration*>(info.Data());
 
-  if (registration != nullptr) {
-    LOG("valid registration accepted");
-    auto result = hotcakey::Unregister(*registration);
+  if (registration == nullptr) return;
 
-    if (result != hotcakey::Result::kSuccess) {
-      Napi::TypeError::New(info.Env(), "cannot unregister listener")
+  LOG("valid registration accepted");
+
+  // NOTICE:
+  // once this returns, the backend never calls the native listener again,
+  // so the thread safe function can be released right away. calling it
+  // twice is fine since registrations are never reused.
+  auto result = hotcakey::Unregister(*registration);
+
+  if (result != hotcakey::Result::kSuccess) {
+    Napi::TypeError::New(info.Env(), "cannot unregister listener")
+        .ThrowAsJavaScriptException();
+    return;
+  }
+
+  ReleaseListener(*registration);
+}
+
+void UnregisterKeymap(const Napi::CallbackInfo& info) {
+  LOG("start exported function `UnregisterKeymap`");
+
+  // owned by the unsubscribe function, see `LoadKeymap`
+  auto registrations =
+      static_cast<std::vector<hotcakey::Registration>*>(info.Data());
+
+  if (registrations == nullptr || registrations->empty()) return;
+
+  for (auto registration : *registrations) {
+    if (hotcakey::Unregister(registration) != hotcakey::Result::kSuccess) {
+      Napi::TypeError::New(info.Env(), "cannot unregister keymap")
           .ThrowAsJavaScriptException();
       return;
     }
+  }
+
+  // the bindings share the listener kept under the first one
+  ReleaseListener(registrations->front());
+  registrations->clear();
+}
 
-    delete registration;
+Napi::String ToTypeName(const Napi::Env& env, hotcakey::EventType type) {
+  auto& name = typeNames[type];
+  if (name.IsEmpty()) {
+    name = Napi::Persistent(Napi::String::New(env, hotcakey::ToString(type)));
   }
+  return name.Value();
 }
 
-Napi::Value Register(const Napi::CallbackInfo& info) {
-  LOG("start exported function `Register`");
+Napi::Value ToCodeName(const Napi::Env& env, const char* code) {
+  if (code == nullptr) return env.Undefined();
 
-  auto env = info.Env();
+  auto& name = codeNames[code];
+  if (name.IsEmpty()) name = Napi::Persistent(Napi::String::New(env, code));
+  return name.Value();
+}
 
-  if (info.Length() < 2 || !info[0].IsArray() || !info[1].IsFunction()) {
-    Napi::TypeError::New(env, "invalid arguments").ThrowAsJavaScriptException();
-    return env.Undefined();
+Napi::String ToActionName(const Napi::Env& env, Deliverer* deliverer,
+                          std::uint32_t index) {
+  auto& name = deliverer->actionNames[index];
+  if (name.IsEmpty()) {
+    name = Napi::Persistent(
+        Napi::String::New(env, deliverer->actions->At(index)));
   }
+  return name.Value();
+}
 
-  auto keys = info[0].As<Napi::Array>();
-  auto callback = info[1].As<Napi::Function>();
+// `isReused` keeps the shape of the object the same for every event
+Napi::Object SetEvent(const Napi::Env& env, Napi::Object event,
+                      const hotcakey::Event& value, bool isReused) {
+  event["type"] = ToTypeName(env, value.type);
+  event["time"] = Napi::Number::New(env, value.time);
 
-  auto listener =
-      Napi::ThreadSafeFunction::New(env, callback, "HotCakey Listener", 0, 1);
+  if (value.code != nullptr || isReused) {
+    event["code"] = ToCodeName(env, value.code);
+  }
 
-  auto [result, registration] = hotcakey::Register(
-      NormalizeKeys(keys), [listener](const hotcakey::Event& event) {
-        auto wrapper = [](Napi::Env env, Napi::Function jsCallback,
-                          hotcakey::Event* value) {
-          LOG("call wrapper from thread safe function");
+  if (value.origin != 0 || isReused) {
+    event["origin"] = value.origin != 0 ? Napi::Number::New(env, value.origin)
+                                        : env.Undefined();
+  }
+
+  return event;
+}
+
+void Deliver(Napi::Env env, Napi::Function jsCallback, Deliverer* deliverer,
+             const Pending& pending) {
+  auto& value = pending.event;
 
-          auto event = Napi::Object::New(env);
-          event["type"] =
-              Napi::String::New(env, hotcakey::ToString(value->type));
-          event["time"] = Napi::Number::New(env, value->time);
+  if (deliverer->delivery == kDeliverAction) {
+    jsCallback.Call({ToActionName(env, deliverer, pending.binding),
+                     Napi::Number::New(env, value.type),
+                     Napi::Number::New(env, value.time)});
+    return;
+  }
 
-          jsCallback.Call({event});
+  if (deliverer->delivery == kDeliverBinding) {
+    jsCallback.Call({Napi::Number::New(env, pending.binding),
+                     Napi::Number::New(env, value.type),
+                     Napi::Number::New(env, value.time)});
+    return;
+  }
 
-          delete value;
-        };
+  if (deliverer->delivery == kDeliverPositional) {
+    // a followed event belongs to the registration of the publisher
+    auto registration = value.origin != 0 ? value.origin
+                                          : deliverer->registration;
+    jsCallback.Call({Napi::Number::New(env, value.type),
+                     Napi::Number::New(env, value.time),
+                     Napi::Number::New(env, registration),
+                     ToCodeName(env, value.code)});
+    return;
+  }
 
-        LOG("callback " << hotcakey::ToString(event.type) << " at "
-                        << event.time);
+  if (deliverer->delivery == kDeliverReuse) {
+    if (deliverer->event.IsEmpty()) {
+      deliverer->event = Napi::Persistent(Napi::Object::New(env));
+    }
+    jsCallback.Call({SetEvent(env, deliverer->event.Value(), value, true)});
+    return;
+  }
 
-        auto value = new hotcakey::Event(event.type, event.time);
-        auto status = listener.BlockingCall(value, wrapper);
+  jsCallback.Call({SetEvent(env, Napi::Object::New(env), value, false)});
+}
 
-        if (status != napi_ok) {
-          ERR("failed to invoke thread safe function");
-        }
-      });
+// records the lag of an event reaching the main thread. warns once when
+// the lag exceeds the threshold, and returns false if the event is too old.
+bool Admit(const Napi::Env& env, const Pending& value) {
+  auto elapsed = std::chrono::steady_clock::now() - value.enqueued;
+  auto ms = std::chrono::duration<double, std::milli>(elapsed).count();
+  auto depth = --pending;
+
+  bool stalled;
+  auto admitted = lag.Admit(ms, stalled);
+
+  if (stalled) {
+    WRN("main thread stalled, events are delivered " << ms << "ms late");
+
+    if (!stallListener.IsEmpty()) {
+      auto stall = Napi::Object::New(env);
+      stall["lag"] = Napi::Number::New(env, ms);
+      stall["pending"] = Napi::Number::New(env, depth);
+      stallListener.Call({stall});
+    }
+  }
+
+  if (!admitted) LOG("drop an event delivered " << ms << "ms late");
+
+  return admitted;
+}
+
+// NOTICE:
+// `deliverer` is only dereferenced on the main thread
+hotcakey::Callback ToNativeListener(const Napi::ThreadSafeFunction& listener,
+                                    Deliverer* deliverer,
+                                    std::uint32_t binding = 0) {
+  return [listener, deliverer, binding](const hotcakey::Event& event) {
+    auto wrapper = [deliverer](Napi::Env env, Napi::Function jsCallback,
+                               Pending* value) {
+      LOG("call wrapper from thread safe function");
+
+      // the thread safe function is being torn down with events left
+      if (env == nullptr) {
+        pending--;
+        delete value;
+        return;
+      }
+
+      if (Admit(env, *value) && !deliverer->isUnsubscribed) {
+        auto id = value->event.trace;
+        hotcakey::trace::Record(hotcakey::trace::kInvoked, id);
+        Deliver(env, jsCallback, deliverer, *value);
+        hotcakey::trace::Record(hotcakey::trace::kReturned, id);
+      }
+
+      delete value;
+    };
+
+    LOG("callback " << hotcakey::ToString(event.type) << " at " << event.time);
+
+    pending++;
+
+    hotcakey::trace::Record(hotcakey::trace::kEnqueued, event.trace);
+
+    auto value = new Pending{event, std::chrono::steady_clock::now(), binding};
+    auto status = listener.BlockingCall(value, wrapper);
+
+    if (status != napi_ok) {
+      ERR("failed to invoke thread safe function");
+      pending--;
+      delete value;
+    }
+  };
+}
+
+Napi::Value ToUnsubscribe(const Napi::Env& env,
+                          const hotcakey::Registration& registration) {
+  auto data = new hotcakey::Registration(registration);
+  auto unsubscribe = Napi::Function::New(env, Unregister, "Unregister", data);
+
+  // the function may be called any number of times, or never
+  unsubscribe.AddFinalizer(
+      [](Napi::Env, hotcakey::Registration* data) { delete data; }, data);
+
+  // lets a publisher tell followers which event belongs to which binding
+  unsubscribe["registration"] = Napi::Number::New(env, registration);
+
+  return unsubscribe;
+}
+
+Napi::Value ToUnsubscribe(const Napi::Env& env,
+                          Napi::ThreadSafeFunction& listener,
+                          Deliverer* deliverer,
+                          const hotcakey::RegistrationResult& registered) {
+  auto [result, registration] = registered;
 
   if (result != hotcakey::Result::kSuccess) {
     // otherwise you cannot shutdown node.js main loop
@@ -165,80 +533,1033 @@ Napi::Value Register(const Napi::CallbackInfo& info) {
     return env.Undefined();
   }
 
+  deliverer->registration = registration;
   tsfs[registration] = listener;
 
-  auto data = new hotcakey::Registration(registration);
-  return Napi::Function::New(env, Unregister, "Unregister", data);
+  return ToUnsubscribe(env, registration);
 }
 
-void ClearThreadSafeFunctions() {
-  if (tsfs.empty()) return;
+// reads `{ delivery }` of the optional argument at `index`
+bool ToDelivery(const Napi::CallbackInfo& info, std::size_t index,
+                Delivery& delivery) {
+  delivery = kDeliverObject;
 
-  for (auto [registration, tsf] : tsfs) {
-    tsf.Release();
+  if (info.Length() <= index || !info[index].IsObject()) return true;
+
+  auto value = info[index].As<Napi::Object>().Get("delivery");
+  if (!value.IsString()) return true;
+
+  auto name = value.As<Napi::String>().Utf8Value();
+
+  if (name == "object") {
+    delivery = kDeliverObject;
+  } else if (name == "reuse") {
+    delivery = kDeliverReuse;
+  } else if (name == "positional") {
+    delivery = kDeliverPositional;
+  } else {
+    Napi::TypeError::New(info.Env(), "invalid delivery: " + name)
+        .ThrowAsJavaScriptException();
+    return false;
   }
-  tsfs.clear();
+
+  return true;
 }
 
-Napi::Promise Activate(const Napi::CallbackInfo& info) {
-  LOG("start exported function `Activate`");
+// reads `{ layer }` of the optional argument at `index`. "" is the base.
+std::string ToLayer(const Napi::CallbackInfo& info, std::size_t index) {
+  if (info.Length() <= index || !info[index].IsObject()) return "";
 
-  if (info.Length() > 0) {
-    auto config = info[0].As<Napi::Object>();
-    auto verbose = config.Get("verbose");
+  auto value = info[index].As<Napi::Object>().Get("layer");
+  return value.IsString() ? value.As<Napi::String>().Utf8Value() : "";
+}
 
-    if (verbose.IsBoolean()) {
-      hotcakey::utils::SetVerbose(verbose.As<Napi::Boolean>().Value());
+// false unless the option at `index` has a `device`
+bool ToDeviceFilter(const Napi::CallbackInfo& info, std::size_t index,
+                    hotcakey::DeviceFilter& device) {
+  if (info.Length() <= index || !info[index].IsObject()) return false;
+
+  auto value = info[index].As<Napi::Object>().Get("device");
+  if (!value.IsObject()) return false;
+
+  auto filter = value.As<Napi::Object>();
+  auto name = filter.Get("name");
+  auto vendor = filter.Get("vendor");
+  auto product = filter.Get("product");
+  auto phys = filter.Get("phys");
+
+  if (name.IsString()) device.name = name.As<Napi::String>().Utf8Value();
+  if (vendor.IsNumber()) device.vendor = vendor.As<Napi::Number>().Uint32Value();
+  if (product.IsNumber()) {
+    device.product = product.As<Napi::Number>().Uint32Value();
+  }
+  if (phys.IsString()) device.phys = phys.As<Napi::String>().Utf8Value();
+
+  return true;
+}
+
+Napi::ThreadSafeFunction ToThreadSafeFunction(const Napi::Env& env,
+                                              const Napi::Function& callback,
+                                              const char* name,
+                                              Deliverer* deliverer) {
+  return Napi::ThreadSafeFunction::New(
+      env, callback, name, 0, 1, deliverer,
+      [](Napi::Env, Deliverer* deliverer) { delete deliverer; });
+}
+
+bool ToEventTypes(const Napi::Env& env, const Napi::Value& value,
+                  std::vector<hotcakey::EventType>& types) {
+  if (!value.IsArray()) return true;
+
+  for (auto type : NormalizeKeys(value.As<Napi::Array>())) {
+    if (type == hotcakey::ToString(hotcakey::kKeyDown)) {
+      types.push_back(hotcakey::kKeyDown);
+    } else if (type == hotcakey::ToString(hotcakey::kKeyUp)) {
+      types.push_back(hotcakey::kKeyUp);
+    } else {
+      Napi::TypeError::New(env, "invalid event type: " + type)
+          .ThrowAsJavaScriptException();
+      return false;
     }
   }
 
+  return true;
+}
+
+bool ToAction(const Napi::Env& env, const Napi::Object& config,
+              hotcakey::Action& action) {
+  auto type = config.Get("type");
+  auto name = type.IsString() ? type.As<Napi::String>().Utf8Value() : "";
+
+  if (name == "write" && config.Get("fd").IsNumber()) {
+    action.type = hotcakey::kActionWrite;
+    action.fd = config.Get("fd").As<Napi::Number>().Int32Value();
+  } else if (name == "send" && config.Get("path").IsString()) {
+    action.type = hotcakey::kActionSend;
+    action.path = config.Get("path").As<Napi::String>().Utf8Value();
+  } else if (name == "call" && config.Get("path").IsString() &&
+             config.Get("symbol").IsString()) {
+    action.type = hotcakey::kActionCall;
+    action.path = config.Get("path").As<Napi::String>().Utf8Value();
+    action.symbol = config.Get("symbol").As<Napi::String>().Utf8Value();
+  } else {
+    Napi::TypeError::New(env, "invalid action").ThrowAsJavaScriptException();
+    return false;
+  }
+
+  return ToEventTypes(env, config.Get("types"), action.types);
+}
+
+Napi::Value Register(const Napi::CallbackInfo& info) {
+  LOG("start exported function `Register`");
+
   auto env = info.Env();
-  auto deferred = Napi::Promise::Deferred::New(info.Env());
 
-  auto worker = new ActivationWorker(env, deferred);
-  worker->Queue();
+  if (info.Length() < 2 || !info[0].IsArray() || !info[1].IsFunction()) {
+    Napi::TypeError::New(env, "invalid arguments").ThrowAsJavaScriptException();
+    return env.Undefined();
+  }
 
-  env.AddCleanupHook([] {
-    LOG("try to cleanup");
+  auto keys = info[0].As<Napi::Array>();
+  auto callback = info[1].As<Napi::Function>();
 
-    ClearThreadSafeFunctions();
+  Delivery delivery;
+  if (!ToDelivery(info, 2, delivery)) return env.Undefined();
 
-    auto result = hotcakey::Inactivate();
+  auto deliverer = new Deliverer{delivery};
+  auto listener =
+      ToThreadSafeFunction(env, callback, "HotCakey Listener", deliverer);
 
-    if (result != hotcakey::Result::kSuccess) {
-      ERR("clean up failed");
-      return;
+  hotcakey::HotkeyOption option;
+  option.layer = ToLayer(info, 2);
+
+  hotcakey::DeviceFilter device;
+  if (ToDeviceFilter(info, 2, device)) option.device = device;
+
+  // set along with the chord, so its first key is never passed on by mistake
+  if (info.Length() > 2 && info[2].IsObject()) {
+    auto consume = info[2].As<Napi::Object>().Get("consume");
+    if (consume.IsBoolean()) {
+      option.consume = consume.As<Napi::Boolean>().Value();
     }
+  }
 
-    LOG("clean up finished");
-  });
+  auto registered = hotcakey::Register(NormalizeKeys(keys), option,
+                                       ToNativeListener(listener, deliverer));
 
-  return deferred.Promise();
+  return ToUnsubscribe(env, listener, deliverer, registered);
 }
 
-Napi::Promise Inactivate(const Napi::CallbackInfo& info) {
-  LOG("start exported function `Inactivate`");
+Napi::Value RegisterCombo(const Napi::CallbackInfo& info) {
+  LOG("start exported function `RegisterCombo`");
 
-  // unregister all listeners
-  for (auto [registration, tsf] : tsfs) {
-    tsf.Release();
+  auto env = info.Env();
+
+  if (info.Length() < 2 || !info[0].IsArray() || !info[1].IsFunction()) {
+    Napi::TypeError::New(env, "invalid arguments").ThrowAsJavaScriptException();
+    return env.Undefined();
   }
 
-  tsfs.clear();
+  auto keys = info[0].As<Napi::Array>();
+  auto callback = info[1].As<Napi::Function>();
+
+  Delivery delivery;
+  if (!ToDelivery(info, 2, delivery)) return env.Undefined();
+
+  hotcakey::ComboOption option;
+
+  if (info.Length() > 2 && info[2].IsObject()) {
+    auto config = info[2].As<Napi::Object>();
+
+    auto window = config.Get("window");
+    if (window.IsNumber()) {
+      option.window = static_cast<std::int64_t>(
+          window.As<Napi::Number>().DoubleValue() * 1e6);
+    }
+
+    auto key = config.Get("key");
+    if (key.IsString()) option.key = key.As<Napi::String>().Utf8Value();
+  }
+
+  auto deliverer = new Deliverer{delivery};
+  auto listener =
+      ToThreadSafeFunction(env, callback, "HotCakey Combo Listener", deliverer);
+
+  auto registered = hotcakey::RegisterCombo(
+      NormalizeKeys(keys), option, ToNativeListener(listener, deliverer));
+
+  return ToUnsubscribe(env, listener, deliverer, registered);
+}
+
+Napi::Value RegisterAction(const Napi::CallbackInfo& info) {
+  LOG("start exported function `RegisterAction`");
 
   auto env = info.Env();
-  auto deferred = Napi::Promise::Deferred::New(info.Env());
 
-  auto worker = new InactivationWorker(env, deferred);
-  worker->Queue();
+  if (info.Length() < 2 || !info[0].IsArray() || !info[1].IsObject()) {
+    Napi::TypeError::New(env, "invalid arguments").ThrowAsJavaScriptException();
+    return env.Undefined();
+  }
 
-  return deferred.Promise();
+  auto keys = NormalizeKeys(info[0].As<Napi::Array>());
+
+  hotcakey::Action action;
+  if (!ToAction(env, info[1].As<Napi::Object>(), action)) {
+    return env.Undefined();
+  }
+
+  if (info.Length() < 3 || !info[2].IsFunction()) {
+    auto [result, registration] = hotcakey::Register(keys, action, nullptr);
+    if (result != hotcakey::Result::kSuccess) return env.Undefined();
+    return ToUnsubscribe(env, registration);
+  }
+
+  Delivery delivery;
+  if (!ToDelivery(info, 3, delivery)) return env.Undefined();
+
+  auto deliverer = new Deliverer{delivery};
+  auto listener =
+      ToThreadSafeFunction(env, info[2].As<Napi::Function>(),
+                           "HotCakey Action Listener", deliverer);
+
+  auto registered = hotcakey::Register(keys, action,
+                                       ToNativeListener(listener, deliverer));
+
+  return ToUnsubscribe(env, listener, deliverer, registered);
 }
 
-Napi::Object Init(Napi::Env env, Napi::Object exports) {
-  exports["activate"] = Napi::Function::New(env, Activate);
-  exports["inactivate"] = Napi::Function::New(env, Inactivate);
-  exports["register"] = Napi::Function::New(env, Register);
+bool ToEventQueue(const Napi::Env& env, const Napi::Object& config,
+                  std::shared_ptr<hotcakey::EventQueue>& queue) {
+  std::size_t capacity = 256;
+  auto policy = hotcakey::kDropOldest;
+
+  auto size = config.Get("capacity");
+  if (size.IsNumber()) capacity = size.As<Napi::Number>().Uint32Value();
+
+  auto overflow = config.Get("overflow");
+  if (overflow.IsString()) {
+    auto name = overflow.As<Napi::String>().Utf8Value();
+    if (name == "drop-oldest") {
+      policy = hotcakey::kDropOldest;
+    } else if (name == "drop-newest") {
+      policy = hotcakey::kDropNewest;
+    } else {
+      Napi::TypeError::New(env, "invalid overflow policy: " + name)
+          .ThrowAsJavaScriptException();
+      return false;
+    }
+  }
+
+  queue = std::make_shared<hotcakey::EventQueue>(capacity, policy);
+
+  return true;
+}
+
+Napi::Value Events(const Napi::CallbackInfo& info) {
+  LOG("start exported function `Events`");
+
+  auto env = info.Env();
+
+  if (info.Length() < 3 || !info[0].IsArray() || !info[1].IsObject() ||
+      !info[2].IsFunction()) {
+    Napi::TypeError::New(env, "invalid arguments").ThrowAsJavaScriptException();
+    return env.Undefined();
+  }
+
+  std::shared_ptr<hotcakey::EventQueue> queue;
+  if (!ToEventQueue(env, info[1].As<Napi::Object>(), queue)) {
+    return env.Undefined();
+  }
+
+  // called without arguments when the queue has something to read
+  auto wake = Napi::ThreadSafeFunction::New(
+      env, info[2].As<Napi::Function>(), "HotCakey Event Stream", 0, 1);
+
+  auto [result, registration] = hotcakey::Register(
+      NormalizeKeys(info[0].As<Napi::Array>()),
+      [queue, wake](const hotcakey::Event& event) {
+        // unlike `BlockingCall`, never waits for the main thread
+        if (queue->Push(event)) wake.NonBlockingCall();
+      });
+
+  if (result != hotcakey::Result::kSuccess) {
+    wake.Release();
+    return env.Undefined();
+  }
+
+  tsfs[registration] = wake;
+  queues[registration] = queue;
+
+  auto unsubscribe = ToUnsubscribe(env, registration).As<Napi::Object>();
+
+  unsubscribe["read"] = Napi::Function::New(
+      env,
+      [registration](const Napi::CallbackInfo& info) -> Napi::Value {
+        auto env = info.Env();
+        auto it = queues.find(registration);
+        hotcakey::Event event(hotcakey::kKeyDown, 0);
+
+        if (it == queues.end() || !it->second->Pop(event)) {
+          return env.Undefined();
+        }
+
+        return SetEvent(env, Napi::Object::New(env), event, false);
+      },
+      "read");
+
+  unsubscribe["dropped"] = Napi::Function::New(
+      env,
+      [queue](const Napi::CallbackInfo& info) -> Napi::Value {
+        return Napi::Number::New(info.Env(), queue->Dropped());
+      },
+      "dropped");
+
+  return unsubscribe;
+}
+
+Napi::Value Subscribe(const Napi::CallbackInfo& info) {
+  LOG("start exported function `Subscribe`");
+
+  auto env = info.Env();
+
+  if (info.Length() < 2 || !info[0].IsObject() || !info[1].IsFunction()) {
+    Napi::TypeError::New(env, "invalid arguments").ThrowAsJavaScriptException();
+    return env.Undefined();
+  }
+
+  auto config = info[0].As<Napi::Object>();
+  auto callback = info[1].As<Napi::Function>();
+
+  hotcakey::Filter filter;
+
+  auto keys = config.Get("keys");
+  if (keys.IsArray()) filter.keys = NormalizeKeys(keys.As<Napi::Array>());
+
+  auto modifiers = config.Get("modifiers");
+  if (modifiers.IsArray()) {
+    filter.modifiers = NormalizeKeys(modifiers.As<Napi::Array>());
+  }
+
+  auto exact = config.Get("exact");
+  if (exact.IsBoolean()) filter.exact = exact.As<Napi::Boolean>().Value();
+
+  if (!ToEventTypes(env, config.Get("types"), filter.types)) {
+    return env.Undefined();
+  }
+
+  Delivery delivery;
+  if (!ToDelivery(info, 2, delivery)) return env.Undefined();
+
+  auto deliverer = new Deliverer{delivery};
+  auto listener = ToThreadSafeFunction(env, callback,
+                                       "HotCakey Stream Listener", deliverer);
+
+  auto registered =
+      hotcakey::Subscribe(filter, ToNativeListener(listener, deliverer));
+
+  return ToUnsubscribe(env, listener, deliverer, registered);
+}
+
+void Suspend(const Napi::CallbackInfo& info) {
+  LOG("start exported function `Suspend`");
+
+  if (hotcakey::Suspend() != hotcakey::Result::kSuccess) {
+    Napi::Error::New(info.Env(), "cannot suspend hotkeys")
+        .ThrowAsJavaScriptException();
+  }
+}
+
+void Resume(const Napi::CallbackInfo& info) {
+  LOG("start exported function `Resume`");
+
+  if (hotcakey::Resume() != hotcakey::Result::kSuccess) {
+    Napi::Error::New(info.Env(), "cannot resume some hotkeys")
+        .ThrowAsJavaScriptException();
+  }
+}
+
+Napi::Value IsSuspended(const Napi::CallbackInfo& info) {
+  return Napi::Boolean::New(info.Env(), hotcakey::IsSuspended());
+}
+
+// thread safe functions are kept as they are, since the registrations of
+// a snapshot stay valid until they are unsubscribed
+void SwitchLayer(const Napi::CallbackInfo& info) {
+  LOG("start exported function `SwitchLayer`");
+
+  auto env = info.Env();
+  auto layer = info.Length() > 0 && info[0].IsString()
+                   ? info[0].As<Napi::String>().Utf8Value()
+                   : "";
+
+  if (hotcakey::SwitchLayer(layer) != hotcakey::Result::kSuccess) {
+    Napi::Error::New(env, "cannot switch layer to: " + layer)
+        .ThrowAsJavaScriptException();
+  }
+}
+
+Napi::Value ActiveLayer(const Napi::CallbackInfo& info) {
+  return Napi::String::New(info.Env(), hotcakey::ActiveLayer());
+}
+
+Napi::Value Snapshot(const Napi::CallbackInfo& info) {
+  LOG("start exported function `Snapshot`");
+
+  auto env = info.Env();
+  auto [result, snapshot] = hotcakey::TakeSnapshot();
+
+  if (result != hotcakey::Result::kSuccess) {
+    Napi::Error::New(env, "cannot take a snapshot")
+        .ThrowAsJavaScriptException();
+    return env.Undefined();
+  }
+
+  return Napi::Number::New(env, snapshot);
+}
+
+void Restore(const Napi::CallbackInfo& info) {
+  LOG("start exported function `Restore`");
+
+  auto env = info.Env();
+
+  if (info.Length() < 1 || !info[0].IsNumber()) {
+    Napi::TypeError::New(env, "invalid arguments").ThrowAsJavaScriptException();
+    return;
+  }
+
+  auto snapshot = static_cast<hotcakey::Snapshot>(
+      info[0].As<Napi::Number>().Int64Value());
+
+  if (hotcakey::Restore(snapshot) != hotcakey::Result::kSuccess) {
+    Napi::Error::New(env, "cannot restore snapshot")
+        .ThrowAsJavaScriptException();
+  }
+}
+
+void Publish(const Napi::CallbackInfo& info) {
+  LOG("start exported function `Publish`");
+
+  auto env = info.Env();
+
+  if (info.Length() < 2 || !info[0].IsString() || !info[1].IsNumber()) {
+    Napi::TypeError::New(env, "invalid arguments").ThrowAsJavaScriptException();
+    return;
+  }
+
+  auto name = info[0].As<Napi::String>().Utf8Value();
+  auto capacity = info[1].As<Napi::Number>().Uint32Value();
+
+  if (hotcakey::Publish(name, capacity) != hotcakey::Result::kSuccess) {
+    Napi::Error::New(env, "cannot publish events to ring: " + name)
+        .ThrowAsJavaScriptException();
+  }
+}
+
+void StartRecording(const Napi::CallbackInfo& info) {
+  LOG("start exported function `StartRecording`");
+
+  auto env = info.Env();
+
+  if (info.Length() < 1 || !info[0].IsString()) {
+    Napi::TypeError::New(env, "invalid arguments").ThrowAsJavaScriptException();
+    return;
+  }
+
+  auto path = info[0].As<Napi::String>().Utf8Value();
+
+  if (hotcakey::StartRecording(path) != hotcakey::Result::kSuccess) {
+    Napi::Error::New(env, "cannot record key events to: " + path)
+        .ThrowAsJavaScriptException();
+  }
+}
+
+void StopRecording(const Napi::CallbackInfo& info) {
+  LOG("start exported function `StopRecording`");
+  hotcakey::StopRecording();
+}
+
+Napi::Value LoadKeymap(const Napi::CallbackInfo& info) {
+  LOG("start exported function `LoadKeymap`");
+
+  auto env = info.Env();
+
+  if (info.Length() < 2 || !info[0].IsString() || !info[1].IsFunction()) {
+    Napi::TypeError::New(env, "invalid arguments").ThrowAsJavaScriptException();
+    return env.Undefined();
+  }
+
+  auto path = info[0].As<Napi::String>().Utf8Value();
+  auto callback = info[1].As<Napi::Function>();
+
+  // one thread safe function for the whole keymap, however many bindings
+  auto deliverer = new Deliverer{kDeliverBinding};
+  auto listener =
+      ToThreadSafeFunction(env, callback, "HotCakey Keymap Listener", deliverer);
+
+  auto registrations = new std::vector<hotcakey::Registration>();
+  auto result = hotcakey::RegisterKeymap(
+      path,
+      [&listener, deliverer](std::size_t index) {
+        return ToNativeListener(listener, deliverer, index);
+      },
+      *registrations);
+
+  if (result != hotcakey::Result::kSuccess || registrations->empty()) {
+    // otherwise you cannot shutdown node.js main loop
+    listener.Release();
+  } else {
+    deliverer->registration = registrations->front();
+    tsfs[registrations->front()] = listener;
+  }
+
+  if (result != hotcakey::Result::kSuccess) {
+    delete registrations;
+    return env.Undefined();
+  }
+
+  auto unsubscribe =
+      Napi::Function::New(env, UnregisterKeymap, "UnregisterKeymap",
+                          registrations);
+
+  // the function may be called any number of times, or never
+  unsubscribe.AddFinalizer(
+      [](Napi::Env, std::vector<hotcakey::Registration>* data) { delete data; },
+      registrations);
+
+  return unsubscribe;
+}
+
+Napi::Value WatchKeymap(const Napi::CallbackInfo& info) {
+  LOG("start exported function `WatchKeymap`");
+
+  auto env = info.Env();
+
+  if (info.Length() < 2 || !info[0].IsString() || !info[1].IsFunction()) {
+    Napi::TypeError::New(env, "invalid arguments").ThrowAsJavaScriptException();
+    return env.Undefined();
+  }
+
+  auto path = info[0].As<Napi::String>().Utf8Value();
+  auto callback = info[1].As<Napi::Function>();
+
+  auto actions = std::make_shared<ActionNames>();
+  auto deliverer = new Deliverer{kDeliverAction};
+  deliverer->actions = actions;
+
+  auto listener =
+      ToThreadSafeFunction(env, callback, "HotCakey Keymap Listener", deliverer);
+
+  // called on the watching thread for every binding added
+  auto registered = hotcakey::WatchKeymap(
+      path, [listener, deliverer, actions](const std::string& action) {
+        return ToNativeListener(listener, deliverer, actions->Intern(action));
+      });
+
+  return ToUnsubscribe(env, listener, deliverer, registered);
+}
+
+Napi::Promise Replay(const Napi::CallbackInfo& info) {
+  LOG("start exported function `Replay`");
+
+  auto env = info.Env();
+  auto deferred = Napi::Promise::Deferred::New(env);
+
+  if (info.Length() < 2 || !info[0].IsString() || !info[1].IsString()) {
+    deferred.Reject(Napi::TypeError::New(env, "invalid arguments").Value());
+    return deferred.Promise();
+  }
+
+  auto path = info[0].As<Napi::String>().Utf8Value();
+  auto pace = info[1].As<Napi::String>().Utf8Value() == "fastest"
+                  ? hotcakey::kReplayFastest
+                  : hotcakey::kReplayOriginal;
+
+  auto worker = new ReplayWorker(env, deferred, path, pace);
+  worker->Queue();
+
+  return deferred.Promise();
+}
+
+Napi::Promise Inject(const Napi::CallbackInfo& info) {
+  LOG("start exported function `Inject`");
+
+  auto env = info.Env();
+  auto deferred = Napi::Promise::Deferred::New(env);
+
+  if (info.Length() < 3 || !info[0].IsArray() || !info[1].IsString() ||
+      !info[2].IsString()) {
+    deferred.Reject(Napi::TypeError::New(env, "invalid arguments").Value());
+    return deferred.Promise();
+  }
+
+  auto sequence = info[0].As<Napi::Array>();
+  auto events = std::vector<hotcakey::InjectedEvent>(sequence.Length());
+
+  for (uint32_t i = 0; i < sequence.Length(); i++) {
+    Napi::Value value = sequence[i];
+    auto event = value.As<Napi::Object>();
+    auto type = event.Get("type").As<Napi::String>().Utf8Value();
+    auto at = event.Get("at").As<Napi::Number>().DoubleValue();
+
+    events[i].key = event.Get("code").As<Napi::String>().Utf8Value();
+    events[i].type = type == "keyup" ? hotcakey::kKeyUp : hotcakey::kKeyDown;
+    events[i].at = static_cast<std::int64_t>(at * 1e6);
+  }
+
+  hotcakey::InjectOption option;
+  option.pace = info[1].As<Napi::String>().Utf8Value() == "fastest"
+                    ? hotcakey::kReplayFastest
+                    : hotcakey::kReplayOriginal;
+  option.target = info[2].As<Napi::String>().Utf8Value() == "synthetic"
+                      ? hotcakey::kInjectSynthetic
+                      : hotcakey::kInjectUinput;
+
+  auto worker = new InjectWorker(env, deferred, std::move(events), option);
+  worker->Queue();
+
+  return deferred.Promise();
+}
+
+void Unpublish(const Napi::CallbackInfo& info) {
+  LOG("start exported function `Unpublish`");
+  hotcakey::Unpublish();
+}
+
+Napi::Value Follow(const Napi::CallbackInfo& info) {
+  LOG("start exported function `Follow`");
+
+  auto env = info.Env();
+
+  if (info.Length() < 2 || !info[0].IsString() || !info[1].IsFunction()) {
+    Napi::TypeError::New(env, "invalid arguments").ThrowAsJavaScriptException();
+    return env.Undefined();
+  }
+
+  auto name = info[0].As<Napi::String>().Utf8Value();
+  auto callback = info[1].As<Napi::Function>();
+
+  Delivery delivery;
+  if (!ToDelivery(info, 2, delivery)) return env.Undefined();
+
+  auto deliverer = new Deliverer{delivery};
+  auto listener = ToThreadSafeFunction(env, callback, "HotCakey Ring Follower",
+                                       deliverer);
+
+  auto registered =
+      hotcakey::Follow(name, ToNativeListener(listener, deliverer));
+
+  return ToUnsubscribe(env, listener, deliverer, registered);
+}
+
+void AttachKeyState(const Napi::CallbackInfo& info) {
+  LOG("start exported function `AttachKeyState`");
+
+  auto env = info.Env();
+
+  if (info.Length() < 1 || !info[0].IsTypedArray() ||
+      info[0].As<Napi::TypedArray>().TypedArrayType() != napi_int32_array) {
+    Napi::TypeError::New(env, "invalid arguments").ThrowAsJavaScriptException();
+    return;
+  }
+
+  // NOTICE:
+  // the array is usually backed by a SharedArrayBuffer. its memory never
+  // moves, so the input thread can write it directly.
+  auto words = info[0].As<Napi::Int32Array>();
+
+  auto result = hotcakey::AttachKeyState(
+      reinterpret_cast<std::uint32_t*>(words.Data()), words.ElementLength());
+
+  if (result != hotcakey::Result::kSuccess) {
+    Napi::Error::New(env, "cannot attach key state view")
+        .ThrowAsJavaScriptException();
+    return;
+  }
+
+  keyState = Napi::Persistent(words.As<Napi::Object>());
+}
+
+void DetachKeyState() {
+  hotcakey::DetachKeyState();
+  keyState.Reset();
+}
+
+Napi::Value KeyStateIndexes(const Napi::CallbackInfo& info) {
+  auto env = info.Env();
+
+  if (info.Length() < 1 || !info[0].IsString()) {
+    Napi::TypeError::New(env, "invalid arguments").ThrowAsJavaScriptException();
+    return env.Undefined();
+  }
+
+  auto indexes =
+      hotcakey::KeyStateIndexes(info[0].As<Napi::String>().Utf8Value());
+
+  auto results = Napi::Array::New(env, indexes.size());
+  for (uint32_t i = 0; i < indexes.size(); i++) {
+    results[i] = Napi::Number::New(env, indexes[i]);
+  }
+
+  return results;
+}
+
+Napi::Value Remap(const Napi::CallbackInfo& info) {
+  auto env = info.Env();
+
+  if (info.Length() < 2 || !info[0].IsString() || !info[1].IsString()) {
+    Napi::TypeError::New(env, "invalid arguments").ThrowAsJavaScriptException();
+    return env.Undefined();
+  }
+
+  auto result = hotcakey::Remap(info[0].As<Napi::String>().Utf8Value(),
+                                info[1].As<Napi::String>().Utf8Value());
+
+  return Napi::Boolean::New(env, result == hotcakey::Result::kSuccess);
+}
+
+Napi::Value Devices(const Napi::CallbackInfo& info) {
+  auto env = info.Env();
+  auto devices = hotcakey::Devices();
+
+  auto results = Napi::Array::New(env, devices.size());
+  for (uint32_t i = 0; i < devices.size(); i++) {
+    auto device = Napi::Object::New(env);
+    device["path"] = Napi::String::New(env, devices[i].path);
+    device["name"] = Napi::String::New(env, devices[i].name);
+    device["vendor"] = Napi::Number::New(env, devices[i].vendor);
+    device["product"] = Napi::Number::New(env, devices[i].product);
+    device["phys"] = Napi::String::New(env, devices[i].phys);
+    results[i] = device;
+  }
+
+  return results;
+}
+
+Napi::Value ParseAccelerator(const Napi::CallbackInfo& info) {
+  auto env = info.Env();
+
+  if (info.Length() < 1 || !info[0].IsString()) {
+    Napi::TypeError::New(env, "invalid arguments").ThrowAsJavaScriptException();
+    return env.Undefined();
+  }
+
+  // NOTICE:
+  // copied onto the stack instead of `Utf8Value` to keep the whole parse
+  // free of allocations. anything not fitting the buffer is too long to be
+  // an accelerator anyway. the length is asked first, since a truncated
+  // copy ends at a character boundary and may look like a whole string.
+  char buffer[256];
+  std::size_t length = 0;
+
+  if (napi_get_value_string_utf8(env, info[0], nullptr, 0, &length) !=
+          napi_ok ||
+      length >= sizeof(buffer)) {
+    return env.Undefined();
+  }
+
+  if (napi_get_value_string_utf8(env, info[0], buffer, sizeof(buffer),
+                                 &length) != napi_ok) {
+    return env.Undefined();
+  }
+
+  auto packed = hotcakey::accelerator::Parse(std::string_view(buffer, length));
+  if (packed == hotcakey::accelerator::kInvalid) return env.Undefined();
+
+  const char* modifiers[4];
+  auto count = hotcakey::accelerator::ModifierNames(
+      hotcakey::accelerator::ModifiersOf(packed), modifiers);
+
+  auto keys = Napi::Array::New(env, count + 1);
+  for (uint32_t i = 0; i < count; i++) keys[i] = ToCodeName(env, modifiers[i]);
+  keys[count] = ToCodeName(env, hotcakey::accelerator::CodeOf(packed));
+
+  return keys;
+}
+
+void ClearThreadSafeFunctions() {
+  if (tsfs.empty()) return;
+
+  for (auto [registration, tsf] : tsfs) {
+    tsf.Release();
+  }
+  tsfs.clear();
+  queues.clear();
+}
+
+bool ToActivationOption(const Napi::Env& env, const Napi::Object& config,
+                        hotcakey::ActivationOption& option) {
+  auto policy = config.Get("policy");
+  if (policy.IsString()) {
+    auto name = policy.As<Napi::String>().Utf8Value();
+    if (name == hotcakey::ToString(hotcakey::kSchedulingDefault)) {
+      option.policy = hotcakey::kSchedulingDefault;
+    } else if (name == hotcakey::ToString(hotcakey::kSchedulingFifo)) {
+      option.policy = hotcakey::kSchedulingFifo;
+    } else if (name == hotcakey::ToString(hotcakey::kSchedulingRoundRobin)) {
+      option.policy = hotcakey::kSchedulingRoundRobin;
+    } else {
+      Napi::TypeError::New(env, "invalid scheduling policy: " + name)
+          .ThrowAsJavaScriptException();
+      return false;
+    }
+  }
+
+  auto priority = config.Get("priority");
+  if (priority.IsNumber()) {
+    option.priority = priority.As<Napi::Number>().Int32Value();
+  }
+
+  auto nice = config.Get("nice");
+  if (nice.IsNumber()) option.nice = nice.As<Napi::Number>().Int32Value();
+
+  auto cpus = config.Get("cpus");
+  if (cpus.IsArray()) {
+    auto array = cpus.As<Napi::Array>();
+    for (uint32_t i = 0; i < array.Length(); i++) {
+      Napi::Value cpu = array[i];
+      option.cpus.push_back(cpu.As<Napi::Number>().Int32Value());
+    }
+  }
+
+  auto lockMemory = config.Get("lockMemory");
+  if (lockMemory.IsBoolean()) {
+    option.lockMemory = lockMemory.As<Napi::Boolean>().Value();
+  }
+
+  auto grab = config.Get("grab");
+  if (grab.IsBoolean()) option.grab = grab.As<Napi::Boolean>().Value();
+
+  return true;
+}
+
+void ToLagOption(const Napi::Object& config) {
+  auto stall = config.Get("stall");
+  if (!stall.IsObject()) return;
+
+  auto threshold = stall.As<Napi::Object>().Get("threshold");
+  if (threshold.IsNumber()) {
+    lag.threshold = threshold.As<Napi::Number>().DoubleValue();
+  }
+
+  auto maxAge = stall.As<Napi::Object>().Get("maxAge");
+  if (maxAge.IsNumber()) lag.maxAge = maxAge.As<Napi::Number>().DoubleValue();
+}
+
+void OnStall(const Napi::CallbackInfo& info) {
+  if (info.Length() > 0 && info[0].IsFunction()) {
+    stallListener = Napi::Persistent(info[0].As<Napi::Function>());
+  } else {
+    stallListener.Reset();
+  }
+}
+
+Napi::Value DeliveryStats(const Napi::CallbackInfo& info) {
+  auto env = info.Env();
+
+  auto stats = Napi::Object::New(env);
+  stats["pending"] = Napi::Number::New(env, pending.load());
+  stats["lag"] = Napi::Number::New(env, lag.last);
+  stats["maxLag"] = Napi::Number::New(env, lag.max);
+  stats["stalls"] = Napi::Number::New(env, lag.stalls);
+  stats["dropped"] = Napi::Number::New(env, lag.dropped);
+
+  return stats;
+}
+
+void StartTracing(const Napi::CallbackInfo& info) {
+  LOG("start exported function `StartTracing`");
+
+  std::size_t capacity = 65536;
+  if (info.Length() > 0 && info[0].IsNumber()) {
+    capacity = info[0].As<Napi::Number>().Uint32Value();
+  }
+
+  hotcakey::trace::SetThreadName("main");
+  hotcakey::trace::Start(capacity);
+}
+
+Napi::Value StopTracing(const Napi::CallbackInfo& info) {
+  LOG("start exported function `StopTracing`");
+
+  hotcakey::trace::Stop();
+  return Napi::String::New(info.Env(), hotcakey::trace::Dump());
+}
+
+Napi::Promise Activate(const Napi::CallbackInfo& info) {
+  LOG("start exported function `Activate`");
+
+  auto env = info.Env();
+  auto deferred = Napi::Promise::Deferred::New(info.Env());
+
+  hotcakey::ActivationOption option;
+
+  // the options and stats of a previous activation are not carried over
+  lag = hotcakey::Lag();
+
+  if (info.Length() > 0) {
+    auto config = info[0].As<Napi::Object>();
+    auto verbose = config.Get("verbose");
+
+    if (verbose.IsBoolean()) {
+      hotcakey::utils::SetVerbose(verbose.As<Napi::Boolean>().Value());
+    }
+
+    if (!ToActivationOption(env, config, option)) {
+      return deferred.Promise();
+    }
+
+    ToLagOption(config);
+  }
+
+  auto worker = new ActivationWorker(env, deferred, option);
+  worker->Queue();
+
+  env.AddCleanupHook([] {
+    LOG("try to cleanup");
+
+    // stops the input thread before releasing what it calls
+    auto result = hotcakey::Inactivate();
+
+    ClearThreadSafeFunctions();
+
+    if (result != hotcakey::Result::kSuccess) {
+      ERR("clean up failed");
+      return;
+    }
+
+    LOG("clean up finished");
+  });
+
+  return deferred.Promise();
+}
+
+Napi::Value ActivationReport(const Napi::CallbackInfo& info) {
+  auto env = info.Env();
+  auto report = hotcakey::GetActivationReport();
+
+  auto cpus = Napi::Array::New(env, report.cpus.size());
+  for (uint32_t i = 0; i < report.cpus.size(); i++) {
+    cpus[i] = Napi::Number::New(env, report.cpus[i]);
+  }
+
+  auto warnings = Napi::Array::New(env, report.warnings.size());
+  for (uint32_t i = 0; i < report.warnings.size(); i++) {
+    warnings[i] = Napi::String::New(env, report.warnings[i]);
+  }
+
+  auto result = Napi::Object::New(env);
+  result["policy"] = Napi::String::New(env, hotcakey::ToString(report.policy));
+  result["priority"] = Napi::Number::New(env, report.priority);
+  result["nice"] = Napi::Number::New(env, report.nice);
+  result["cpus"] = cpus;
+  result["lockMemory"] = Napi::Boolean::New(env, report.lockMemory);
+  result["grab"] = Napi::Boolean::New(env, report.grab);
+  result["warnings"] = warnings;
+
+  return result;
+}
+
+Napi::Promise Inactivate(const Napi::CallbackInfo& info) {
+  LOG("start exported function `Inactivate`");
+
+  auto env = info.Env();
+  auto deferred = Napi::Promise::Deferred::New(info.Env());
+
+  // unregister all listeners
+  auto worker = new InactivationWorker(env, deferred, std::move(tsfs));
+  tsfs.clear();
+  queues.clear();
+
+  worker->Queue();
+
+  return deferred.Promise();
+}
+
+Napi::Object Init(Napi::Env env, Napi::Object exports) {
+  exports["activate"] = Napi::Function::New(env, Activate);
+  exports["inactivate"] = Napi::Function::New(env, Inactivate);
+  exports["activationReport"] = Napi::Function::New(env, ActivationReport);
+  exports["deliveryStats"] = Napi::Function::New(env, DeliveryStats);
+  exports["onStall"] = Napi::Function::New(env, OnStall);
+  exports["startTracing"] = Napi::Function::New(env, StartTracing);
+  exports["stopTracing"] = Napi::Function::New(env, StopTracing);
+  exports["register"] = Napi::Function::New(env, Register);
+  exports["registerAction"] = Napi::Function::New(env, RegisterAction);
+  exports["registerCombo"] = Napi::Function::New(env, RegisterCombo);
+  exports["subscribe"] = Napi::Function::New(env, Subscribe);
+  exports["events"] = Napi::Function::New(env, Events);
+  exports["switchLayer"] = Napi::Function::New(env, SwitchLayer);
+  exports["activeLayer"] = Napi::Function::New(env, ActiveLayer);
+  exports["suspend"] = Napi::Function::New(env, Suspend);
+  exports["resume"] = Napi::Function::New(env, Resume);
+  exports["isSuspended"] = Napi::Function::New(env, IsSuspended);
+  exports["snapshot"] = Napi::Function::New(env, Snapshot);
+  exports["restore"] = Napi::Function::New(env, Restore);
+  exports["loadKeymap"] = Napi::Function::New(env, LoadKeymap);
+  exports["watchKeymap"] = Napi::Function::New(env, WatchKeymap);
+  exports["startRecording"] = Napi::Function::New(env, StartRecording);
+  exports["stopRecording"] = Napi::Function::New(env, StopRecording);
+  exports["replay"] = Napi::Function::New(env, Replay);
+  exports["inject"] = Napi::Function::New(env, Inject);
+  exports["publish"] = Napi::Function::New(env, Publish);
+  exports["unpublish"] = Napi::Function::New(env, Unpublish);
+  exports["follow"] = Napi::Function::New(env, Follow);
+  exports["attachKeyState"] = Napi::Function::New(env, AttachKeyState);
+  exports["keyStateIndexes"] = Napi::Function::New(env, KeyStateIndexes);
+  exports["parseAccelerator"] = Napi::Function::New(env, ParseAccelerator);
+  exports["devices"] = Napi::Function::New(env, Devices);
+  exports["remap"] = Napi::Function::New(env, Remap);
+  exports["keyStateWords"] = Napi::Number::New(env, hotcakey::kKeyStateWords);
+
+  env.AddCleanupHook([] {
+    DetachKeyState();
+    hotcakey::StopRecording();
+    hotcakey::Unpublish();
+
+    for (auto& name : typeNames) name.Reset();
+    codeNames.clear();
+    stallListener.Reset();
+  });
 
   return exports;
 }
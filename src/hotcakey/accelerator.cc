@@ -0,0 +1,246 @@
+#include "./accelerator.h"
+
+#include <algorithm>
+#include <iterator>
+
+namespace {
+
+// every `Code` of index.ts but the generic modifiers
+const char* const kCodes[] = {
+    "KeyA", "KeyB", "KeyC", "KeyD", "KeyE", "KeyF", "KeyG", "KeyH", "KeyI",
+    "KeyJ", "KeyK", "KeyL", "KeyM", "KeyN", "KeyO", "KeyP", "KeyQ", "KeyR",
+    "KeyS", "KeyT", "KeyU", "KeyV", "KeyW", "KeyX", "KeyY", "KeyZ", "Digit1",
+    "Digit2", "Digit3", "Digit4", "Digit5", "Digit6", "Digit7", "Digit8",
+    "Digit9", "Digit0", "Minus", "Equal", "BracketLeft", "BracketRight",
+    "Backslash", "Semicolon", "Quote", "Backquote", "Comma", "Period", "Slash",
+    "Enter", "Escape", "Backspace", "Tab", "Space", "CapsLock", "F1", "F2",
+    "F3", "F4", "F5", "F6", "F7", "F8", "F9", "F10", "F11", "F12", "F13",
+    "F14", "F15", "F16", "F17", "F18", "F19", "F20", "F21", "F22", "F23",
+    "F24", "PrintScreen", "ScrollLock", "Pause", "Insert", "Home", "PageUp",
+    "Delete", "End", "PageDown", "ArrowRight", "ArrowLeft", "ArrowDown",
+    "ArrowUp", "NumLock", "NumpadDivide", "NumpadMultiply", "NumpadSubtract",
+    "NumpadAdd", "NumpadEnter", "Numpad1", "Numpad2", "Numpad3", "Numpad4",
+    "Numpad5", "Numpad6", "Numpad7", "Numpad8", "Numpad9", "Numpad0",
+    "NumpadDecimal", "IntlBackslash", "ContextMenu", "NumpadEqual", "Power",
+    "Help", "Undo", "Cut", "Copy", "Paste", "AudioVolumeMute", "AudioVolumeUp",
+    "AudioVolumeDown", "NumpadComma", "IntlRo", "KanaMode", "IntlYen",
+    "Convert", "NonConvert", "Lang1", "Lang2", "Lang3", "Lang4",
+    "MediaTrackNext", "MediaTrackPrevious", "MediaStop", "Eject",
+    "MediaPlayPause", "MediaSelect", "LaunchMail", "LaunchApp2", "LaunchApp1",
+    "BrowserSearch", "BrowserHome", "BrowserBack", "BrowserForward",
+    "BrowserStop", "BrowserRefresh", "BrowserFavorites", "Sleep", "WakeUp",
+    "ControlRight", "ControlLeft", "ShiftRight", "ShiftLeft", "AltRight",
+    "AltLeft", "MetaRight", "MetaLeft",
+};
+
+constexpr std::size_t kCodeCount = sizeof(kCodes) / sizeof(kCodes[0]);
+constexpr std::uint32_t kNoKey = UINT32_MAX;
+
+#if defined(__APPLE__)
+constexpr std::uint8_t kCommandOrControl = hotcakey::kModifierMeta;
+#else
+constexpr std::uint8_t kCommandOrControl = hotcakey::kModifierControl;
+#endif
+
+struct ModifierAlias {
+  const char* name;
+  std::uint8_t modifier;
+};
+
+const ModifierAlias kModifierAliases[] = {
+    {"Control", hotcakey::kModifierControl},
+    {"Ctrl", hotcakey::kModifierControl},
+    {"Shift", hotcakey::kModifierShift},
+    {"Alt", hotcakey::kModifierAlt},
+    {"Option", hotcakey::kModifierAlt},
+    {"Opt", hotcakey::kModifierAlt},
+    {"Meta", hotcakey::kModifierMeta},
+    {"Cmd", hotcakey::kModifierMeta},
+    {"Command", hotcakey::kModifierMeta},
+    {"Super", hotcakey::kModifierMeta},
+    {"Win", hotcakey::kModifierMeta},
+    {"CmdOrCtrl", kCommandOrControl},
+    {"CommandOrControl", kCommandOrControl},
+};
+
+// names of keys other than their `Code`. `modifiers` are implied, since
+// "+" is shift and "=" on a us layout.
+struct KeyAlias {
+  const char* name;
+  const char* code;
+  std::uint8_t modifiers;
+};
+
+const KeyAlias kKeyAliases[] = {
+    {"-", "Minus", 0},
+    {"=", "Equal", 0},
+    {"+", "Equal", hotcakey::kModifierShift},
+    {"Plus", "Equal", hotcakey::kModifierShift},
+    {"[", "BracketLeft", 0},
+    {"]", "BracketRight", 0},
+    {"\\", "Backslash", 0},
+    {";", "Semicolon", 0},
+    {"'", "Quote", 0},
+    {"`", "Backquote", 0},
+    {",", "Comma", 0},
+    {".", "Period", 0},
+    {"/", "Slash", 0},
+    {"Esc", "Escape", 0},
+    {"Return", "Enter", 0},
+    {"Del", "Delete", 0},
+    {"Ins", "Insert", 0},
+    {"Up", "ArrowUp", 0},
+    {"Down", "ArrowDown", 0},
+    {"Left", "ArrowLeft", 0},
+    {"Right", "ArrowRight", 0},
+    {"PgUp", "PageUp", 0},
+    {"PgDn", "PageDown", 0},
+    {"PrtSc", "PrintScreen", 0},
+    {"VolumeUp", "AudioVolumeUp", 0},
+    {"VolumeDown", "AudioVolumeDown", 0},
+    {"VolumeMute", "AudioVolumeMute", 0},
+    {"MediaNextTrack", "MediaTrackNext", 0},
+    {"MediaPreviousTrack", "MediaTrackPrevious", 0},
+    {"Num0", "Numpad0", 0},
+    {"Num1", "Numpad1", 0},
+    {"Num2", "Numpad2", 0},
+    {"Num3", "Numpad3", 0},
+    {"Num4", "Numpad4", 0},
+    {"Num5", "Numpad5", 0},
+    {"Num6", "Numpad6", 0},
+    {"Num7", "Numpad7", 0},
+    {"Num8", "Numpad8", 0},
+    {"Num9", "Numpad9", 0},
+    {"NumAdd", "NumpadAdd", 0},
+    {"NumSub", "NumpadSubtract", 0},
+    {"NumMult", "NumpadMultiply", 0},
+    {"NumDiv", "NumpadDivide", 0},
+    {"NumDec", "NumpadDecimal", 0},
+};
+
+char ToLower(char c) { return c >= 'A' && c <= 'Z' ? c - 'A' + 'a' : c; }
+
+bool EqualsIgnoreCase(std::string_view a, std::string_view b) {
+  if (a.size() != b.size()) return false;
+
+  for (std::size_t i = 0; i < a.size(); i++) {
+    if (ToLower(a[i]) != ToLower(b[i])) return false;
+  }
+
+  return true;
+}
+
+std::uint32_t FindCode(std::string_view name) {
+  for (std::uint32_t i = 0; i < kCodeCount; i++) {
+    if (EqualsIgnoreCase(name, kCodes[i])) return i;
+  }
+  return kNoKey;
+}
+
+// a single letter or digit, which is not worth an alias each
+std::uint32_t FindCharacter(char c) {
+  c = ToLower(c);
+
+  if (c >= 'a' && c <= 'z') return c - 'a';
+  if (c == '0') return FindCode("Digit0");
+  if (c >= '1' && c <= '9') return FindCode("Digit1") + (c - '1');
+
+  return kNoKey;
+}
+
+std::string_view Trim(std::string_view token) {
+  while (!token.empty() && token.front() == ' ') token.remove_prefix(1);
+  while (!token.empty() && token.back() == ' ') token.remove_suffix(1);
+  return token;
+}
+
+// adds `token` to the chord. false if it is unknown or a second key.
+bool Apply(std::string_view token, std::uint8_t& modifiers,
+           std::uint32_t& key) {
+  if (token.empty()) return false;
+
+  for (auto& alias : kModifierAliases) {
+    if (EqualsIgnoreCase(token, alias.name)) {
+      modifiers |= alias.modifier;
+      return true;
+    }
+  }
+
+  if (key != kNoKey) return false;
+
+  if (token.size() == 1) key = FindCharacter(token[0]);
+
+  for (std::size_t i = 0; key == kNoKey && i < std::size(kKeyAliases); i++) {
+    if (EqualsIgnoreCase(token, kKeyAliases[i].name)) {
+      key = FindCode(kKeyAliases[i].code);
+      modifiers |= kKeyAliases[i].modifiers;
+    }
+  }
+
+  if (key == kNoKey) key = FindCode(token);
+
+  return key != kNoKey;
+}
+
+}  // namespace
+
+namespace hotcakey {
+namespace accelerator {
+
+Packed Parse(std::string_view accelerator) {
+  std::uint8_t modifiers = kModifierNone;
+  std::uint32_t key = kNoKey;
+  std::size_t offset = 0;
+
+  while (true) {
+    while (offset < accelerator.size() && accelerator[offset] == ' ') {
+      offset++;
+    }
+
+    // an empty token such as the end of "Ctrl+"
+    if (offset == accelerator.size()) return kInvalid;
+
+    // a '+' where a token starts is the key itself, as in "Ctrl++"
+    auto end = accelerator[offset] == '+'
+                   ? offset + 1
+                   : std::min(accelerator.find('+', offset),
+                              accelerator.size());
+
+    if (!Apply(Trim(accelerator.substr(offset, end - offset)), modifiers,
+               key)) {
+      return kInvalid;
+    }
+
+    offset = end;
+
+    while (offset < accelerator.size() && accelerator[offset] == ' ') {
+      offset++;
+    }
+
+    if (offset == accelerator.size()) break;
+    if (accelerator[offset++] != '+') return kInvalid;
+  }
+
+  if (key == kNoKey) return kInvalid;
+
+  return key << 8 | modifiers;
+}
+
+const char* CodeOf(Packed packed) {
+  auto key = packed >> 8;
+  return key < kCodeCount ? kCodes[key] : nullptr;
+}
+
+std::size_t ModifierNames(std::uint8_t modifiers, const char* names[4]) {
+  std::size_t count = 0;
+
+  if (modifiers & kModifierControl) names[count++] = "Control";
+  if (modifiers & kModifierShift) names[count++] = "Shift";
+  if (modifiers & kModifierAlt) names[count++] = "Alt";
+  if (modifiers & kModifierMeta) names[count++] = "Meta";
+
+  return count;
+}
+
+}  // namespace accelerator
+}  // namespace hotcakey
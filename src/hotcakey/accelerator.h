@@ -0,0 +1,41 @@
+#ifndef HOTCAKEY_ACCELERATOR_H_
+#define HOTCAKEY_ACCELERATOR_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+#include "./matcher.h"
+
+namespace hotcakey {
+namespace accelerator {
+
+// a chord packed into 32 bits: the index of the key in the code table
+// shifted by 8 bits, and the `Modifier` mask in the lowest byte.
+using Packed = std::uint32_t;
+
+constexpr Packed kInvalid = UINT32_MAX;
+
+// parses an accelerator string such as "Ctrl+Shift+/" or "CmdOrCtrl+K".
+// tokens are separated by '+' and matched case insensitively against
+// aliases (Ctrl, Cmd, Option, Esc, Up, ...), symbols ("/", ",", "+", ...)
+// and every `Code` of index.ts. exactly one token must be a key.
+// returns `kInvalid` for anything else. never allocates.
+//
+// NOTICE:
+// "CmdOrCtrl" is Meta on macos and Control elsewhere, like electron.
+Packed Parse(std::string_view accelerator);
+
+inline std::uint8_t ModifiersOf(Packed packed) { return packed & 0xFF; }
+
+// the `Code` name of the key, a string literal
+const char* CodeOf(Packed packed);
+
+// the generic modifier names ("Control", ...) of `modifiers` in the order
+// `Register` takes them. returns how many were written to `names`.
+std::size_t ModifierNames(std::uint8_t modifiers, const char* names[4]);
+
+}  // namespace accelerator
+}  // namespace hotcakey
+
+#endif  // HOTCAKEY_ACCELERATOR_H_
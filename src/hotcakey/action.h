@@ -0,0 +1,38 @@
+#ifndef HOTCAKEY_ACTION_H_
+#define HOTCAKEY_ACTION_H_
+
+/*
+ * c abi of native actions. include this from the shared library loaded by
+ * a call action, or use the layout to decode messages of fd and socket
+ * actions.
+ */
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define HOTCAKEY_ACTION_KEYDOWN 0
+#define HOTCAKEY_ACTION_KEYUP 1
+
+typedef struct hotcakey_action_event {
+  uint64_t registration;
+  /* CLOCK_MONOTONIC in nanoseconds */
+  int64_t timestamp;
+  /* HOTCAKEY_ACTION_KEYDOWN or HOTCAKEY_ACTION_KEYUP */
+  uint32_t type;
+  uint32_t reserved;
+} hotcakey_action_event;
+
+/*
+ * called on the input thread. never block here, every other hotkey waits
+ * until it returns.
+ */
+typedef void (*hotcakey_action_callback)(const hotcakey_action_event* event);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* HOTCAKEY_ACTION_H_ */
@@ -0,0 +1,117 @@
+#ifndef HOTCAKEY_CALLBACK_H_
+#define HOTCAKEY_CALLBACK_H_
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace hotcakey {
+
+// a type erased callable stored inline, never on the heap.
+//
+// `std::function` silently allocates once a callable outgrows its small
+// buffer (16 bytes on libstdc++), so registering and dispatching would
+// touch the global allocator. a callable too large for `Capacity` is a
+// compile error instead.
+template <typename Signature, std::size_t Capacity>
+class InlineFunction;
+
+template <typename R, typename... Args, std::size_t Capacity>
+class InlineFunction<R(Args...), Capacity> {
+ public:
+  InlineFunction() = default;
+  InlineFunction(std::nullptr_t) {}
+
+  template <typename F,
+            typename T = std::decay_t<F>,
+            typename = std::enable_if_t<
+                !std::is_same_v<T, InlineFunction> &&
+                std::is_invocable_r_v<R, T&, Args...>>>
+  InlineFunction(F&& f) {
+    static_assert(sizeof(T) <= Capacity,
+                  "callable is too large to be stored inline");
+    static_assert(alignof(T) <= alignof(std::max_align_t),
+                  "callable is over aligned");
+
+    // e.g. an empty std::function or a null function pointer
+    if constexpr (std::is_constructible_v<bool, T&>) {
+      if (!static_cast<bool>(f)) return;
+    }
+
+    new (&storage) T(std::forward<F>(f));
+    ops = &kOps<T>;
+  }
+
+  InlineFunction(const InlineFunction& other) : ops(other.ops) {
+    if (ops != nullptr) ops->copy(&storage, &other.storage);
+  }
+
+  InlineFunction(InlineFunction&& other) noexcept : ops(other.ops) {
+    if (ops != nullptr) ops->move(&storage, &other.storage);
+  }
+
+  InlineFunction& operator=(const InlineFunction& other) {
+    if (this != &other) {
+      Reset();
+      ops = other.ops;
+      if (ops != nullptr) ops->copy(&storage, &other.storage);
+    }
+    return *this;
+  }
+
+  InlineFunction& operator=(InlineFunction&& other) noexcept {
+    if (this != &other) {
+      Reset();
+      ops = other.ops;
+      if (ops != nullptr) ops->move(&storage, &other.storage);
+    }
+    return *this;
+  }
+
+  ~InlineFunction() { Reset(); }
+
+  R operator()(Args... args) const {
+    return ops->invoke(&storage, std::forward<Args>(args)...);
+  }
+
+  explicit operator bool() const { return ops != nullptr; }
+
+ private:
+  using Storage = std::aligned_storage_t<Capacity, alignof(std::max_align_t)>;
+
+  struct Ops {
+    R (*invoke)(const Storage*, Args&&...);
+    void (*copy)(Storage*, const Storage*);
+    void (*move)(Storage*, Storage*);
+    void (*destroy)(Storage*);
+  };
+
+  template <typename T>
+  static constexpr Ops kOps = {
+      [](const Storage* s, Args&&... args) -> R {
+        // callables may be stateful like std::function, hence the cast
+        auto& f = *std::launder(reinterpret_cast<T*>(const_cast<Storage*>(s)));
+        return f(std::forward<Args>(args)...);
+      },
+      [](Storage* dst, const Storage* src) {
+        new (dst) T(*std::launder(reinterpret_cast<const T*>(src)));
+      },
+      [](Storage* dst, Storage* src) {
+        new (dst) T(std::move(*std::launder(reinterpret_cast<T*>(src))));
+      },
+      [](Storage* s) { std::launder(reinterpret_cast<T*>(s))->~T(); },
+  };
+
+  void Reset() {
+    if (ops != nullptr) ops->destroy(&storage);
+    ops = nullptr;
+  }
+
+  Storage storage;
+  const Ops* ops = nullptr;
+};
+
+}  // namespace hotcakey
+
+#endif  // HOTCAKEY_CALLBACK_H_
@@ -0,0 +1,66 @@
+#ifndef HOTCAKEY_DAEMON_H_
+#define HOTCAKEY_DAEMON_H_
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "./hotcakey.h"
+#include "./ring.h"
+
+namespace hotcakey {
+namespace daemon {
+
+constexpr const char* kDefaultSocketPath = "/run/hotcakey/hotcakeyd.sock";
+
+// path of the hotcakeyd socket. `HOTCAKEY_SOCKET` overrides the default.
+std::string SocketPath();
+
+// the linux backend talks to hotcakeyd instead of reading devices when
+// the daemon is running. hotcakeyd itself disables this.
+void SetEnabled(bool enabled);
+bool IsEnabled();
+
+// client side of the hotcakeyd protocol.
+//
+// the protocol is line based text over a unix domain socket.
+//
+//   register <id> <key>...   -> ok | error
+//   unregister <id>          -> ok | error
+//
+// right after accepting a client, hotcakeyd sends an anonymous ring with
+// SCM_RIGHTS. matched events are written there with the client's id as
+// the registration, so no event goes through the socket.
+//
+// NOTICE:
+// clients cannot feed key events to hotcakeyd, otherwise any of them
+// could fire the hotkeys of every other client.
+class Client {
+ public:
+  ~Client();
+
+  bool Connect(const std::string& path);
+  void Close();
+  bool IsConnected() const { return fd >= 0; }
+
+  bool Register(Registration registration,
+                const std::vector<std::string>& keys);
+  bool Unregister(Registration registration);
+
+  ring::Reader* Events() { return reader.get(); }
+
+ private:
+  bool Request(const std::string& line);
+
+  int fd = -1;
+  // set once a request failed, e.g. timed out
+  bool isBroken = false;
+  std::unique_ptr<ring::Reader> reader;
+  std::mutex mutex;
+};
+
+}  // namespace daemon
+}  // namespace hotcakey
+
+#endif  // HOTCAKEY_DAEMON_H_
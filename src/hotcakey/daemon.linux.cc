@@ -0,0 +1,201 @@
+#include "./daemon.h"
+
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+
+#include "./utils/logger.h"
+#include "./utils/strings.h"
+
+namespace {
+
+std::atomic<bool> isEnabled(true);
+
+bool SendLine(int fd, const std::string& line) {
+  auto message = line + "\n";
+  auto data = message.data();
+  auto size = message.size();
+
+  while (size > 0) {
+    auto sent = send(fd, data, size, MSG_NOSIGNAL);
+    if (sent < 0 && errno == EINTR) continue;
+    if (sent <= 0) return false;
+    data += sent;
+    size -= sent;
+  }
+
+  return true;
+}
+
+bool ReceiveLine(int fd, std::string& line) {
+  line.clear();
+
+  char ch;
+  while (true) {
+    auto received = recv(fd, &ch, 1, 0);
+    if (received < 0 && errno == EINTR) continue;
+    if (received <= 0) return false;
+    if (ch == '\n') return true;
+    line += ch;
+  }
+}
+
+// receives the records and the signal page of a ring
+bool ReceiveRing(int fd, int (&fds)[2]) {
+  char byte;
+  iovec iov{&byte, 1};
+
+  char control[CMSG_SPACE(sizeof(fds))] = {};
+
+  msghdr message{};
+  message.msg_iov = &iov;
+  message.msg_iovlen = 1;
+  message.msg_control = control;
+  message.msg_controllen = sizeof(control);
+
+  if (recvmsg(fd, &message, MSG_CMSG_CLOEXEC) <= 0) return false;
+
+  auto cmsg = CMSG_FIRSTHDR(&message);
+  if (cmsg == nullptr || cmsg->cmsg_level != SOL_SOCKET ||
+      cmsg->cmsg_type != SCM_RIGHTS ||
+      cmsg->cmsg_len != CMSG_LEN(sizeof(fds))) {
+    return false;
+  }
+
+  std::memcpy(fds, CMSG_DATA(cmsg), sizeof(fds));
+  return true;
+}
+
+}  // namespace
+
+namespace hotcakey {
+namespace daemon {
+
+std::string SocketPath() {
+  auto path = std::getenv("HOTCAKEY_SOCKET");
+  return path != nullptr && *path != 0 ? path : kDefaultSocketPath;
+}
+
+void SetEnabled(bool enabled) {
+  isEnabled.store(enabled, std::memory_order_release);
+}
+
+bool IsEnabled() { return isEnabled.load(std::memory_order_acquire); }
+
+Client::~Client() { Close(); }
+
+bool Client::Connect(const std::string& path) {
+  std::lock_guard<std::mutex> lock(mutex);
+
+  sockaddr_un address{};
+  address.sun_family = AF_UNIX;
+
+  if (path.size() >= sizeof(address.sun_path)) {
+    ERR("too long socket path: " << path);
+    return false;
+  }
+
+  std::strncpy(address.sun_path, path.c_str(), sizeof(address.sun_path) - 1);
+
+  fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+
+  if (fd < 0) {
+    ERR("failed to create socket: " << std::strerror(errno));
+    return false;
+  }
+
+  if (connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) !=
+      0) {
+    LOG("hotcakeyd is not available at " << path << ": "
+                                         << std::strerror(errno));
+    close(fd);
+    fd = -1;
+    return false;
+  }
+
+  // never hang the caller if the daemon stops responding
+  timeval timeout{1, 0};
+  setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+  int ringFds[2];
+
+  if (!ReceiveRing(fd, ringFds)) {
+    ERR("failed to receive event ring from hotcakeyd");
+    close(fd);
+    fd = -1;
+    return false;
+  }
+
+  reader = ring::Reader::Attach(ringFds[0], ringFds[1]);
+
+  if (!reader) {
+    close(fd);
+    fd = -1;
+    return false;
+  }
+
+  LOG("connected to hotcakeyd at " << path);
+
+  return true;
+}
+
+void Client::Close() {
+  std::lock_guard<std::mutex> lock(mutex);
+
+  if (fd >= 0) close(fd);
+  fd = -1;
+  isBroken = false;
+  reader.reset();
+}
+
+bool Client::Register(Registration registration,
+                      const std::vector<std::string>& keys) {
+  return Request("register " + std::to_string(registration) + " " +
+                 utils::Join(keys, " "));
+}
+
+bool Client::Unregister(Registration registration) {
+  return Request("unregister " + std::to_string(registration));
+}
+
+bool Client::Request(const std::string& line) {
+  std::lock_guard<std::mutex> lock(mutex);
+
+  if (fd < 0) return false;
+
+  if (isBroken) {
+    ERR("connection to hotcakeyd is broken");
+    return false;
+  }
+
+  std::string response;
+
+  // NOTICE:
+  // a response that timed out may still arrive and be taken for the
+  // response of the next request, so the connection is never used again.
+  // the socket is shut down to let hotcakeyd release our registrations,
+  // while the event ring stays mapped until `Close` since the event loop
+  // may be reading it.
+  if (!SendLine(fd, line) || !ReceiveLine(fd, response)) {
+    ERR("lost connection to hotcakeyd: " << std::strerror(errno));
+    isBroken = true;
+    shutdown(fd, SHUT_RDWR);
+    return false;
+  }
+
+  if (response != "ok") {
+    ERR("hotcakeyd rejected request: " << line);
+    return false;
+  }
+
+  return true;
+}
+
+}  // namespace daemon
+}  // namespace hotcakey
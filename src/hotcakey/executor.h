@@ -0,0 +1,40 @@
+#ifndef HOTCAKEY_EXECUTOR_H_
+#define HOTCAKEY_EXECUTOR_H_
+
+#include <sys/un.h>
+
+#include <cstdint>
+#include <memory>
+
+#include "./action.h"
+#include "./hotcakey.h"
+
+namespace hotcakey {
+
+// an `Action` resolved up front, so that firing it from the input thread
+// is a single syscall or function call.
+class Executor {
+ public:
+  // returns nullptr if the action cannot be prepared.
+  static std::unique_ptr<Executor> Prepare(const Action& action);
+
+  ~Executor();
+
+  void Fire(Registration registration, EventType type, std::int64_t timestamp);
+
+ private:
+  Executor(ActionType type, std::uint8_t types);
+
+  ActionType type;
+  // bitmask of `EventType`
+  std::uint8_t types;
+  int fd = -1;
+  bool isEventFd = false;
+  sockaddr_un address{};
+  void* library = nullptr;
+  hotcakey_action_callback callback = nullptr;
+};
+
+}  // namespace hotcakey
+
+#endif  // HOTCAKEY_EXECUTOR_H_
@@ -0,0 +1,153 @@
+#include "./executor.h"
+
+#include <dlfcn.h>
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+#include <string>
+
+#include "./utils/logger.h"
+
+namespace {
+
+bool IsEventFd(int fd) {
+  char link[64];
+  auto path = "/proc/self/fd/" + std::to_string(fd);
+  auto size = readlink(path.c_str(), link, sizeof(link) - 1);
+  if (size < 0) return false;
+  link[size] = 0;
+  return std::strcmp(link, "anon_inode:[eventfd]") == 0;
+}
+
+// NOTICE:
+// setting O_NONBLOCK on a dup would change the caller's descriptor too,
+// so pipes and fifos are reopened to get a file description of our own.
+int OpenNonBlocking(int fd) {
+  auto path = "/proc/self/fd/" + std::to_string(fd);
+  auto reopened = open(path.c_str(), O_WRONLY | O_NONBLOCK | O_CLOEXEC);
+  if (reopened >= 0) return reopened;
+
+  WRN("cannot reopen fd " << fd << " as non blocking: "
+                          << std::strerror(errno));
+
+  return fcntl(fd, F_DUPFD_CLOEXEC, 0);
+}
+
+}  // namespace
+
+namespace hotcakey {
+
+std::unique_ptr<Executor> Executor::Prepare(const Action& action) {
+  std::uint8_t types = 0;
+  for (auto type : action.types) types |= 1 << type;
+  if (types == 0) types = 1 << kKeyDown | 1 << kKeyUp;
+
+  std::unique_ptr<Executor> executor(new Executor(action.type, types));
+
+  switch (action.type) {
+    case kActionWrite:
+      if (action.fd < 0) {
+        ERR("write action needs a file descriptor");
+        return nullptr;
+      }
+
+      executor->isEventFd = IsEventFd(action.fd);
+      executor->fd = executor->isEventFd
+                         ? fcntl(action.fd, F_DUPFD_CLOEXEC, 0)
+                         : OpenNonBlocking(action.fd);
+
+      if (executor->fd < 0) {
+        ERR("cannot use fd " << action.fd << ": " << std::strerror(errno));
+        return nullptr;
+      }
+
+      return executor;
+
+    case kActionSend:
+      if (action.path.empty() ||
+          action.path.size() >= sizeof(executor->address.sun_path)) {
+        ERR("invalid socket path for send action: " << action.path);
+        return nullptr;
+      }
+
+      executor->address.sun_family = AF_UNIX;
+      std::strncpy(executor->address.sun_path, action.path.c_str(),
+                   sizeof(executor->address.sun_path) - 1);
+      executor->fd =
+          socket(AF_UNIX, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+
+      if (executor->fd < 0) {
+        ERR("failed to create socket: " << std::strerror(errno));
+        return nullptr;
+      }
+
+      return executor;
+
+    case kActionCall:
+      executor->library = dlopen(action.path.c_str(), RTLD_NOW | RTLD_LOCAL);
+
+      if (executor->library == nullptr) {
+        ERR("failed to load " << action.path << ": " << dlerror());
+        return nullptr;
+      }
+
+      executor->callback = reinterpret_cast<hotcakey_action_callback>(
+          dlsym(executor->library, action.symbol.c_str()));
+
+      if (executor->callback == nullptr) {
+        ERR("cannot find " << action.symbol << " in " << action.path);
+        return nullptr;
+      }
+
+      return executor;
+  }
+
+  ERR("unknown action type: " << action.type);
+
+  return nullptr;
+}
+
+Executor::Executor(ActionType type, std::uint8_t types)
+    : type(type), types(types) {}
+
+Executor::~Executor() {
+  if (fd >= 0) close(fd);
+  if (library != nullptr) dlclose(library);
+}
+
+void Executor::Fire(Registration registration, EventType type,
+                    std::int64_t timestamp) {
+  if ((types & 1 << type) == 0) return;
+
+  hotcakey_action_event event{registration, timestamp,
+                              static_cast<std::uint32_t>(type), 0};
+
+  switch (this->type) {
+    case kActionWrite:
+      if (isEventFd) {
+        std::uint64_t one = 1;
+        if (write(fd, &one, sizeof(one)) < 0) {
+          WRN("eventfd action failed: " << std::strerror(errno));
+        }
+      } else if (write(fd, &event, sizeof(event)) < 0 && errno != EAGAIN) {
+        // EAGAIN means the reader is behind, so the event is just dropped
+        WRN("write action failed: " << std::strerror(errno));
+      }
+      break;
+
+    case kActionSend:
+      // nobody listening is not an error, the receiver may come later
+      sendto(fd, &event, sizeof(event), MSG_DONTWAIT | MSG_NOSIGNAL,
+             reinterpret_cast<const sockaddr*>(&address), sizeof(address));
+      break;
+
+    case kActionCall:
+      callback(&event);
+      break;
+  }
+}
+
+}  // namespace hotcakey
@@ -0,0 +1,81 @@
+#ifndef HOTCAKEY_FANOUT_H_
+#define HOTCAKEY_FANOUT_H_
+
+#include <algorithm>
+#include <cstddef>
+#include <unordered_map>
+#include <vector>
+
+#include "./hotcakey.h"
+
+namespace hotcakey {
+
+// `Fanout` reference counts listeners sharing a chord, so that each unique
+// chord takes exactly one registration of the os (or hotcakeyd) and its
+// events are fanned out to every listener natively.
+//
+// `ChordKey` is the canonical chord of the backend, such as the modifier
+// mask and the key code packed into an integer, so that "Shift+Control+A"
+// and "Control+Shift+A" share one entry. `Handle` is whatever the os
+// returns for the registration.
+//
+// NOTICE:
+// `Fanout` is not thread safe. the owner must serialize calls.
+template <typename ChordKey, typename Handle>
+class Fanout {
+ public:
+  struct Entry {
+    Handle handle{};
+    std::vector<Registration> registrations;
+  };
+
+  // adds a listener of `chord`. returns true if it is the first one, and
+  // then the caller registers the chord to the os and sets `handle`.
+  bool Add(ChordKey chord, Registration registration) {
+    auto& entry = entries[chord];
+    entry.registrations.push_back(registration);
+    return entry.registrations.size() == 1;
+  }
+
+  // removes a listener of `chord`. returns true if it was the last one,
+  // and then the caller unregisters `handle` from the os.
+  bool Remove(ChordKey chord, Registration registration, Handle& handle) {
+    auto it = entries.find(chord);
+    if (it == entries.end()) return false;
+
+    auto& registrations = it->second.registrations;
+    registrations.erase(
+        std::remove(registrations.begin(), registrations.end(), registration),
+        registrations.end());
+
+    if (!registrations.empty()) return false;
+
+    handle = it->second.handle;
+    entries.erase(it);
+
+    return true;
+  }
+
+  Entry* Find(ChordKey chord) {
+    auto it = entries.find(chord);
+    return it != entries.end() ? &it->second : nullptr;
+  }
+
+  // calls `f(chord, entry)` for every chord
+  template <typename F>
+  void ForEach(F f) {
+    for (auto& [chord, entry] : entries) f(chord, entry);
+  }
+
+  void Clear() { entries.clear(); }
+
+  // number of unique chords, which is the number of os registrations
+  std::size_t Size() const { return entries.size(); }
+
+ private:
+  std::unordered_map<ChordKey, Entry> entries;
+};
+
+}  // namespace hotcakey
+
+#endif  // HOTCAKEY_FANOUT_H_
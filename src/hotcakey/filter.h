@@ -0,0 +1,30 @@
+#ifndef HOTCAKEY_FILTER_H_
+#define HOTCAKEY_FILTER_H_
+
+#include <cstdint>
+
+#include "./hotcakey.h"
+#include "./matcher.h"
+
+namespace hotcakey {
+
+// `Filter` compiled into masks so that the input thread can evaluate it
+// with a few bit operations and no string processing.
+struct CompiledFilter {
+  KeyBitset keys;
+  std::uint8_t requiredModifiers = kModifierNone;
+  std::uint8_t forbiddenModifiers = kModifierNone;
+  std::uint8_t types = 0;
+
+  bool Matches(KeyCode code, std::uint8_t modifiers, EventType type) const {
+    if (code >= kKeyCodeCount) return false;
+
+    return (types & (1 << type)) != 0 && keys.Test(code) &&
+           (modifiers & requiredModifiers) == requiredModifiers &&
+           (modifiers & forbiddenModifiers) == 0;
+  }
+};
+
+}  // namespace hotcakey
+
+#endif  // HOTCAKEY_FILTER_H_
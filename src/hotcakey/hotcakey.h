@@ -1,17 +1,59 @@
 #ifndef HOTCAKEY_H_
 #define HOTCAKEY_H_
 
+#include <cstddef>
+#include <cstdint>
 #include <ctime>
 #include <functional>
+#include <optional>
 #include <string>
 #include <vector>
 
+#include "./callback.h"
+
 namespace hotcakey {
 
 enum Result { kSuccess, kFailure };
 
-Result Activate();
+enum SchedulingPolicy {
+  // the default time sharing scheduler, adjusted by `nice`
+  kSchedulingDefault,
+  kSchedulingFifo,
+  kSchedulingRoundRobin,
+};
+
+// tuning of the input thread. every item is best effort: what cannot be
+// applied is skipped with a warning and left out of `ActivationReport`.
+struct ActivationOption {
+  SchedulingPolicy policy = kSchedulingDefault;
+  // realtime priority for fifo and round robin, clamped to the valid range
+  int priority = 1;
+  // used with the default policy, or as the fallback of a realtime policy
+  int nice = 0;
+  // cpus the input thread may run on. empty means any.
+  std::vector<int> cpus;
+  // locks the stack of the input thread in memory
+  bool lockMemory = false;
+  // linux: reads keyboards exclusively with EVIOCGRAB and passes the keys
+  // no hotkey consumes on through a uinput keyboard, so hotkeys can keep
+  // their keys from other applications. see `SetConsume` and `Remap`.
+  bool grab = false;
+};
+
+// what was actually applied to the input thread by the last activation
+struct ActivationReport {
+  SchedulingPolicy policy = kSchedulingDefault;
+  int priority = 0;
+  int nice = 0;
+  std::vector<int> cpus;
+  bool lockMemory = false;
+  bool grab = false;
+  std::vector<std::string> warnings;
+};
+
+Result Activate(const ActivationOption& option = {});
 Result Inactivate();
+ActivationReport GetActivationReport();
 
 inline std::string ToString(Result result) {
   switch (result) {
@@ -30,13 +72,301 @@ using RegistrationResult = std::pair<Result, Registration>;
 struct Event {
   EventType type;
   std::time_t time;
-  Event(EventType type, std::time_t time) : type(type), time(time){};
+  // physical key code such as "KeyA". only set for stream subscriptions.
+  const char* code;
+  // registration in the publishing process. only set for followed rings.
+  Registration origin;
+  // ties the stages of the event together while tracing. see `trace.h`.
+  std::uint64_t trace = 0;
+  Event(EventType type, std::time_t time, const char* code = nullptr,
+        Registration origin = 0)
+      : type(type), time(time), code(code), origin(origin){};
+};
+
+// listeners are stored inline without allocation. a lambda capturing up
+// to six pointers fits, and a larger one does not compile.
+constexpr std::size_t kCallbackCapacity = 6 * sizeof(void*);
+using Callback = InlineFunction<void(Event), kCallbackCapacity>;
+
+// declarative filter for a stream of raw key events.
+// empty `keys` matches any key, and empty `types` matches any event type.
+struct Filter {
+  std::vector<std::string> keys;
+  // modifiers which must be held such as "Control"
+  std::vector<std::string> modifiers;
+  // if true, modifiers other than `modifiers` must not be held
+  bool exact = false;
+  std::vector<EventType> types;
+};
+
+// a native action runs on the input thread as soon as a chord matches,
+// before the listener is called. it keeps working while the thread owning
+// the listener (e.g. the node.js main thread) is busy.
+enum ActionType {
+  // writes to `fd`. an eventfd is incremented by one, and anything else
+  // such as a pipe receives a `hotcakey_action_event`. never blocks.
+  kActionWrite,
+  // sends a `hotcakey_action_event` to the unix datagram socket at `path`.
+  kActionSend,
+  // calls `symbol` of the shared library at `path` as a
+  // `hotcakey_action_callback`.
+  kActionCall,
+};
+
+struct Action {
+  ActionType type;
+  int fd = -1;
+  std::string path;
+  std::string symbol;
+  // event types firing the action. empty means both.
+  std::vector<EventType> types;
+};
+
+RegistrationResult Register(const std::vector<std::string>& keys,
+                            const Callback& listener);
+// `listener` may be empty if nothing but the action is needed.
+RegistrationResult Register(const std::vector<std::string>& keys,
+                            const Action& action, const Callback& listener);
+// registers a hotkey of the layer named `layer`. layers are sets of
+// hotkeys on top of the base layer (named ""), like the modes of vim.
+// only the hotkeys of the active layer are matched along with the base
+// layer, and they shadow base hotkeys of the same chord.
+RegistrationResult RegisterInLayer(const std::string& layer,
+                                   const std::vector<std::string>& keys,
+                                   const Callback& listener);
+// activates `layer`, or only the base layer if it is "". a layer without
+// hotkeys is fine. unlike the rest of the api, listeners may call it.
+Result SwitchLayer(const std::string& layer);
+std::string ActiveLayer();
+
+struct ComboOption {
+  // every key must be down within this many nanoseconds of the first one
+  std::int64_t window = 30000000;
+  // a key pressed in place of the combo such as "Escape", which hotkeys
+  // see and, while grabbing, other applications too. empty for none.
+  std::string key;
+};
+
+// registers keys pressed together such as "KeyJ" and "KeyK", like the
+// combos of keyboard firmwares. the keys are held back until the combo is
+// complete or the window elapses, and go on as usual if it is not.
+// `listener` gets a keydown when the combo completes and a keyup when the
+// first of its keys is released.
+//
+// NOTICE:
+// linux only, and not through hotcakeyd, since the keys are held back on
+// the input thread.
+RegistrationResult RegisterCombo(const std::vector<std::string>& keys,
+                                 const ComboOption& option,
+                                 const Callback& listener);
+
+RegistrationResult Subscribe(const Filter& filter, const Callback& listener);
+
+// an input device read by the backend, such as a keyboard or a usb macro
+// pad. ids and `phys` are what the kernel reports, e.g. "usb-...-2/input0".
+struct Device {
+  std::string path;
+  std::string name;
+  std::uint16_t vendor = 0;
+  std::uint16_t product = 0;
+  std::string phys;
+};
+
+// selects devices. empty strings and zero ids match any device.
+struct DeviceFilter {
+  std::string name;
+  std::uint16_t vendor = 0;
+  std::uint16_t product = 0;
+  std::string phys;
+
+  bool Matches(const Device& device) const {
+    return (name.empty() || name == device.name) &&
+           (vendor == 0 || vendor == device.vendor) &&
+           (product == 0 || product == device.product) &&
+           (phys.empty() || phys == device.phys);
+  }
+};
+
+// keyboards currently read, including ones plugged in after `Activate`.
+//
+// NOTICE:
+// only linux reads devices by itself, so only linux supports devices.
+std::vector<Device> Devices();
+// registers a hotkey whose key must come from a device selected by
+// `device`, so the same chord on other keyboards is left alone. devices
+// plugged in later are picked up as well. modifiers may be held on any
+// device.
+//
+// NOTICE:
+// linux only, and not through hotcakeyd, which owns the devices.
+RegistrationResult RegisterOnDevice(const DeviceFilter& device,
+                                    const std::vector<std::string>& keys,
+                                    const Callback& listener);
+// while grabbing, the key of a hotkey which consumes is not passed on to
+// other applications, along with its repeats and keyup. modifiers held
+// before it are already passed. hotkeys pass their keys by default.
+//
+// NOTICE:
+// the hotkeys of macos and windows always consume, so passing fails.
+Result SetConsume(Registration registration, bool consume);
+
+struct HotkeyOption {
+  // see `RegisterInLayer`
+  std::string layer;
+  // see `RegisterOnDevice`. unset for any device.
+  std::optional<DeviceFilter> device;
+  // see `SetConsume`. unset keeps the default of the platform.
+  std::optional<bool> consume;
 };
 
+// registers a hotkey set up by `option` before it is attached, so that no
+// key is matched with the defaults in between, as it would be by calling
+// `SetConsume` after `Register`.
 RegistrationResult Register(const std::vector<std::string>& keys,
-                            const std::function<void(Event)>& listener);
+                            const HotkeyOption& option,
+                            const Callback& listener);
+// while grabbing, `from` of grabbed keyboards becomes `to` before it is
+// matched and passed on. an empty `to` removes the remapping, and
+// `Inactivate` removes all of them.
+//
+// NOTICE:
+// linux only.
+Result Remap(const std::string& from, const std::string& to);
+// makes the listener of the binding at `index` of a keymap
+using KeymapListener = std::function<Callback(std::size_t index)>;
+// registers every binding of a keymap file compiled by `hotcakeyc` (see
+// `keymap.h`) at once under one lock. `registrations` receives one per
+// binding in the order of the file. if any binding fails, none stays
+// registered.
+//
+// NOTICE:
+// keymaps hold key codes of the backend, so only linux supports them.
+Result RegisterKeymap(const std::string& path, const KeymapListener& listener,
+                      std::vector<Registration>& registrations);
+// makes the listener of a binding of the action named `action`
+using ActionListener = std::function<Callback(const std::string& action)>;
+// registers a keymap file and keeps it registered while the file changes.
+// on every change, bindings are told apart by their chord, layer and
+// action, and only added and removed ones are (un)registered in one batch,
+// so the others never stop working. a broken file keeps the last good
+// keymap. unregistering the returned registration stops watching and
+// unregisters every binding.
+//
+// NOTICE:
+// `listener` is called on the watching thread with the api locked, so it
+// must not call this api.
+RegistrationResult WatchKeymap(const std::string& path,
+                               const ActionListener& listener);
+// once this returns, the listener is never called again.
+//
+// NOTICE:
+// listeners run on the input thread and may unregister any registration
+// including their own, but must not call anything else of this api except
+// `SwitchLayer`.
 Result Unregister(const Registration& registration);
 
+// stops dispatching events while keeping every registration, e.g. while
+// a settings dialog records a shortcut. keyups of keys pressed meanwhile
+// are swallowed too, while a hotkey fired before still gets its keyup. on
+// macos and windows the hotkeys are released to other applications until
+// `Resume`.
+Result Suspend();
+Result Resume();
+bool IsSuspended();
+
+using Snapshot = unsigned long;
+using SnapshotResult = std::pair<Result, Snapshot>;
+
+// detaches every hotkey and stream from dispatch at once and keeps them
+// aside as a snapshot. the registrations stay valid, so they can still be
+// unregistered, which drops them from the snapshot.
+SnapshotResult TakeSnapshot();
+// attaches the registrations of `snapshot` again, alongside the ones
+// registered since it was taken. a snapshot is restored only once, unless
+// some hotkeys fail to attach. they stay detached in the snapshot, which
+// can be restored again or unregistered, and kFailure is returned.
+Result Restore(Snapshot snapshot);
+
+// publishes every dispatched event to a shared memory ring named `name`,
+// so that other processes can read them with `ring::Reader`.
+Result Publish(const std::string& name, std::size_t capacity);
+Result Unpublish();
+// follows a ring published by another process. `listener` is called on a
+// dedicated reader thread until the registration is unregistered.
+RegistrationResult Follow(const std::string& name, const Callback& listener);
+
+// records raw key events of the input thread to a file at `path`, so that
+// a session can be replayed later without a keyboard. see `recording.h`.
+Result StartRecording(const std::string& path);
+Result StopRecording();
+
+enum ReplayPace {
+  // keeps the intervals between the recorded events
+  kReplayOriginal,
+  // feeds the events as fast as the input thread takes them
+  kReplayFastest,
+};
+
+struct ReplayReport {
+  std::size_t events = 0;
+  // listeners called back with the events while recording
+  std::size_t matches = 0;
+  std::int64_t elapsed = 0;  // nanoseconds
+};
+
+// feeds a recording through the same path as events from real devices.
+// returns once every event is handed to the input thread.
+Result Replay(const std::string& path, ReplayPace pace, ReplayReport& report);
+
+struct InjectedEvent {
+  std::string key;
+  EventType type;
+  // nanoseconds from the start of the injection, never decreasing
+  std::int64_t at = 0;
+};
+
+enum InjectTarget {
+  // a uinput keyboard named "hotcakey injector", which every application
+  // sees like a real one. hotcakey itself does too while active.
+  kInjectUinput,
+  // the synthetic device, like `synthetic::Emit`. only while active.
+  kInjectSynthetic,
+};
+
+struct InjectOption {
+  InjectTarget target = kInjectUinput;
+  // `kReplayFastest` ignores `at` and writes everything at once
+  ReplayPace pace = kReplayOriginal;
+};
+
+struct InjectReport {
+  std::size_t events = 0;
+  // calls of `write`. events due at the same time share one.
+  std::size_t writes = 0;
+  std::int64_t elapsed = 0;  // nanoseconds
+  // how far the latest write was behind its schedule, in nanoseconds
+  std::int64_t lateness = 0;
+};
+
+// writes `events` at their time with a timer, and returns once the last one
+// is written. injections are serialized, so their events never interleave.
+// NOTICE: the uinput keyboard is made on the first injection and kept
+// until the process exits, since applications need a moment to open it.
+Result Inject(const std::vector<InjectedEvent>& events,
+              const InjectOption& option, InjectReport& report);
+
+// a key state view is an array of `kKeyStateWords` 32 bit words which the
+// input thread keeps up to date with atomic stores.
+// the first word is a sequence counter which is odd while the view is being
+// updated, and the rest is a bitmap of pressed keys indexed by
+// `KeyStateIndexes`.
+constexpr std::size_t kKeyStateWords = 1 + 512 / 32;
+
+Result AttachKeyState(std::uint32_t* words, std::size_t length);
+Result DetachKeyState();
+// bit indexes of the physical keys of `key`. "Shift" has two, for example.
+std::vector<unsigned int> KeyStateIndexes(const std::string& key);
+
 inline std::string ToString(EventType type) {
   switch (type) {
     case kKeyDown:
@@ -46,6 +376,19 @@ inline std::string ToString(EventType type) {
   }
 }
 
+inline std::string ToString(SchedulingPolicy policy) {
+  switch (policy) {
+    case kSchedulingDefault:
+      return "default";
+    case kSchedulingFifo:
+      return "fifo";
+    case kSchedulingRoundRobin:
+      return "rr";
+  }
+
+  return "default";
+}
+
 }  // namespace hotcakey
 
 #endif  // HOTCAKEY_H_
@@ -0,0 +1,3487 @@
+#include "./hotcakey.h"
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <linux/input.h>
+#include <linux/uinput.h>
+#include <poll.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <sys/ioctl.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <climits>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <ctime>
+#include <iterator>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "./daemon.h"
+#include "./executor.h"
+#include "./fanout.h"
+#include "./filter.h"
+#include "./keymap.h"
+#include "./matcher.h"
+#include "./recording.h"
+#include "./registry.h"
+#include "./ring.h"
+#include "./scheduling.h"
+#include "./synthetic.h"
+#include "./trace.h"
+#include "./utils/logger.h"
+#include "./utils/strings.h"
+
+namespace {
+
+struct Listener {
+  hotcakey::Callback callback;
+  hotcakey::Chord chord;
+  bool stream;
+  std::unique_ptr<hotcakey::Executor> executor;
+  // unregistered by a listener while events are dispatched. it is removed
+  // once the dispatch is over, see `RetireListeners`.
+  bool isRetired = false;
+  // snapshot keeping the listener detached from dispatch, or 0
+  hotcakey::Snapshot snapshot = 0;
+  hotcakey::Layer layer = hotcakey::kBaseLayer;
+  // devices the key must come from, or null for any device
+  std::unique_ptr<hotcakey::DeviceFilter> device{};
+  // keeps the key from other applications while grabbing. see `SetConsume`.
+  bool consume = false;
+  // keys pressed together in place of `chord`. see `RegisterCombo`.
+  std::unique_ptr<hotcakey::Combo> combo{};
+};
+
+struct Stream {
+  hotcakey::Registration registration;
+  hotcakey::CompiledFilter filter;
+};
+
+// registrations detached by `hotcakey::TakeSnapshot`
+struct Stash {
+  std::vector<hotcakey::Registration> chords;
+  std::vector<Stream> streams;
+};
+
+struct Follower {
+  std::unique_ptr<hotcakey::ring::Reader> reader;
+  std::thread thread;
+  std::atomic<bool> isActive;
+};
+
+// a binding of a watched keymap
+struct Bound {
+  hotcakey::Chord chord;
+  hotcakey::Layer layer;
+  std::string action;
+  hotcakey::Registration registration;
+};
+
+// a keymap file kept registered by `hotcakey::WatchKeymap`. shared with
+// its thread, which may outlive the registration for a moment.
+struct KeymapWatch {
+  std::string path;
+  hotcakey::ActionListener listener;
+  // guarded by `mutex`
+  std::vector<Bound> bound;
+  std::atomic<bool> isActive{true};
+  int inotifyFd = -1;
+  // an eventfd written to stop the thread
+  int wakeFd = -1;
+  std::thread thread;
+
+  ~KeymapWatch() {
+    if (inotifyFd >= 0) close(inotifyFd);
+    if (wakeFd >= 0) close(wakeFd);
+  }
+};
+
+std::thread nativeThread;
+
+// why do we use `atomic<bool> instead of `bool with mutex`?
+// because this variable is read in the epoll loop,
+// we should not repeat to lock and release mutext for performance reason.
+std::atomic<bool> isActive(false);
+
+// listeners live in reusable slots, so registering and unregistering
+// do not allocate once the registry has grown. see `hotcakey::Registry`.
+hotcakey::Registry<Listener> listeners;
+
+hotcakey::Matcher matcher;
+
+// combos go before `matcher`. what they let go on is collected in
+// `comboOutputs`, which is only touched by the input thread.
+hotcakey::ComboMatcher combos;
+hotcakey::ComboMatcher::Outputs comboOutputs;
+
+// a timerfd in the epoll set which lets the keys held back by `combos` go
+// on when the window elapses. `armedDeadline` is what it is armed for.
+int comboTimerFd = -1;
+std::int64_t armedDeadline = 0;
+
+std::vector<Stream> streams;
+
+// a keyboard in the epoll set
+struct InputDevice {
+  hotcakey::Device info;
+  // the write end of a synthetic device, see `synthetic::AddDevice`
+  int writer = -1;
+  bool isGrabbed = false;
+};
+
+// keyboards keyed by their fd. they come and go on the input thread
+// while `hotcakey::Devices` reads them, so guarded by `mutex`.
+std::unordered_map<int, InputDevice> devices;
+int epollFd = -1;
+
+// an inotify fd in the epoll set, so keyboards plugged in later are
+// opened without rescanning /dev/input
+int hotplugFd = -1;
+
+// while grabbing, keyboards are read exclusively and whatever no hotkey
+// consumes is written to this uinput keyboard. see `ActivationOption::grab`.
+int passthroughFd = -1;
+constexpr const char* kPassthroughName = "hotcakey passthrough";
+
+// a pipe taking the place of the uinput keyboard in tests.
+// see `synthetic::SetPassthrough`.
+int passthroughOverride = -1;
+
+// set before the input thread starts and read only by it afterwards
+bool isGrabbing = false;
+
+// keys whose keydown was consumed. their repeats and keyup are consumed
+// as well. only touched by the input thread.
+hotcakey::KeyBitset consumed;
+
+// events going on to the passthrough, written at once by `FlushPassing`.
+// only touched by the input thread.
+input_event passing[128];
+std::size_t passingCount = 0;
+
+// keys of grabbed keyboards are replaced by `remaps[code] - 1` unless it
+// is 0. atomic, so the input thread reads them without locking.
+std::atomic<hotcakey::KeyCode> remaps[hotcakey::kKeyCodeCount];
+
+// the uinput keyboard of `Inject`, made on the first injection and kept
+// until the process exits. `injection` serializes the injections.
+int injectorFd = -1;
+constexpr const char* kInjectorName = "hotcakey injector";
+std::mutex injection;
+
+// key events written by one call of `write` while injecting. with a
+// SYN_REPORT each, they fit in PIPE_BUF for the synthetic device.
+constexpr std::size_t kInjectBatch = 64;
+static_assert(kInjectBatch * 2 * sizeof(input_event) <= PIPE_BUF);
+
+// a pipe to feed synthetic `input_event`s into the event loop.
+// it is watched in the same epoll set as the real devices,
+// so synthetic events go through exactly the same path.
+int syntheticFds[2] = {-1, -1};
+
+// an eventfd in the epoll set written by `Inactivate`, so the event loop
+// sleeps without a timeout and still stops immediately.
+int wakeFd = -1;
+
+// shared memory ring to fan out events to other processes.
+// see `hotcakey::Publish`.
+std::unique_ptr<hotcakey::ring::Writer> publisher;
+
+// raw key events are written here while recording.
+// see `hotcakey::StartRecording`.
+std::unique_ptr<hotcakey::recording::Writer> recorder;
+
+std::unordered_map<hotcakey::Registration, std::unique_ptr<Follower>>
+    followers;
+
+std::unordered_map<hotcakey::Registration, std::shared_ptr<KeymapWatch>>
+    watches;
+
+// connection to hotcakeyd. when connected, the daemon owns the devices
+// and matches chords, and we only read its event ring.
+hotcakey::daemon::Client daemonClient;
+
+// chords registered to hotcakeyd, one registration per unique chord.
+// the handle is the registration which hotcakeyd knows the chord by.
+hotcakey::Fanout<std::uint32_t, hotcakey::Registration> daemonChords;
+std::unordered_map<hotcakey::Registration, std::uint32_t> daemonHandles;
+
+// hotcakeyd matches every chord regardless of layers, so the layer is
+// chosen here. keyup goes to the layer which took the keydown.
+std::unordered_map<std::uint32_t, hotcakey::Layer> daemonFired;
+
+hotcakey::ActivationReport activationReport;
+
+// words shared with the caller. see `hotcakey::AttachKeyState`.
+std::atomic<std::uint32_t>* keyState = nullptr;
+
+static_assert(sizeof(std::atomic<std::uint32_t>) == sizeof(std::uint32_t),
+              "key state words must be plain 32 bit words");
+static_assert(hotcakey::kKeyStateWords - 1 == hotcakey::kKeyCodeCount / 32,
+              "key state bitmap must cover all key codes");
+
+std::mutex mutex;
+std::condition_variable cond;
+
+// serializes `Activate` and `Inactivate`, and keeps the devices open
+// while synthetic events are written to them.
+//
+// NOTICE:
+// never taken on the input thread, which `Inactivate` joins with it held.
+std::mutex lifecycle;
+
+// listeners are called on the input thread with `mutex` held, so the
+// api must not take it again there. see `Unregister`.
+thread_local bool isInputThread = false;
+
+// registrations unregistered by listeners during the current dispatch
+std::vector<hotcakey::Registration> retired;
+
+// events are not dispatched while suspended. see `hotcakey::Suspend`.
+std::atomic<bool> isSuspended(false);
+
+// keys whose keydown was swallowed while suspended. their keyup is
+// swallowed as well, even if it comes after `Resume`, while the keyup of
+// any other key is delivered even while suspended.
+hotcakey::KeyBitset swallowed;
+
+std::unordered_map<hotcakey::Snapshot, Stash> snapshots;
+hotcakey::Snapshot snapshotSequence = 0;
+
+// layers are numbered by name for the matcher. see `hotcakey::SwitchLayer`.
+std::unordered_map<std::string, hotcakey::Layer> layers{
+    {"", hotcakey::kBaseLayer}};
+std::vector<std::string> layerNames{""};
+
+constexpr unsigned long long int Hash(const char* str,
+                                      unsigned long long int hash = 0) {
+  return (*str == 0) ? hash : 101 * Hash(str + 1) + *str;
+}
+
+unsigned int MapLinuxKeyCode(const std::string& key) {
+  switch (Hash(key.c_str())) {
+    // modifiers key to ignore
+    case Hash("Control"):
+    case Hash("ControlRight"):
+    case Hash("ControlLeft"):
+    case Hash("Shift"):
+    case Hash("ShiftRight"):
+    case Hash("ShiftLeft"):
+    case Hash("Alt"):
+    case Hash("AltRight"):
+    case Hash("AltLeft"):
+    case Hash("Meta"):
+    case Hash("MetaRight"):
+    case Hash("MetaLeft"):
+      return UINT32_MAX;
+
+    case Hash("KeyA"):
+      return KEY_A;
+    case Hash("KeyB"):
+      return KEY_B;
+    case Hash("KeyC"):
+      return KEY_C;
+    case Hash("KeyD"):
+      return KEY_D;
+    case Hash("KeyE"):
+      return KEY_E;
+    case Hash("KeyF"):
+      return KEY_F;
+    case Hash("KeyG"):
+      return KEY_G;
+    case Hash("KeyH"):
+      return KEY_H;
+    case Hash("KeyI"):
+      return KEY_I;
+    case Hash("KeyJ"):
+      return KEY_J;
+    case Hash("KeyK"):
+      return KEY_K;
+    case Hash("KeyL"):
+      return KEY_L;
+    case Hash("KeyM"):
+      return KEY_M;
+    case Hash("KeyN"):
+      return KEY_N;
+    case Hash("KeyO"):
+      return KEY_O;
+    case Hash("KeyP"):
+      return KEY_P;
+    case Hash("KeyQ"):
+      return KEY_Q;
+    case Hash("KeyR"):
+      return KEY_R;
+    case Hash("KeyS"):
+      return KEY_S;
+    case Hash("KeyT"):
+      return KEY_T;
+    case Hash("KeyU"):
+      return KEY_U;
+    case Hash("KeyV"):
+      return KEY_V;
+    case Hash("KeyW"):
+      return KEY_W;
+    case Hash("KeyX"):
+      return KEY_X;
+    case Hash("KeyY"):
+      return KEY_Y;
+    case Hash("KeyZ"):
+      return KEY_Z;
+    case Hash("Digit1"):
+      return KEY_1;
+    case Hash("Digit2"):
+      return KEY_2;
+    case Hash("Digit3"):
+      return KEY_3;
+    case Hash("Digit4"):
+      return KEY_4;
+    case Hash("Digit5"):
+      return KEY_5;
+    case Hash("Digit6"):
+      return KEY_6;
+    case Hash("Digit7"):
+      return KEY_7;
+    case Hash("Digit8"):
+      return KEY_8;
+    case Hash("Digit9"):
+      return KEY_9;
+    case Hash("Digit0"):
+      return KEY_0;
+    case Hash("Minus"):
+      return KEY_MINUS;
+    case Hash("Equal"):
+      return KEY_EQUAL;
+    case Hash("BracketLeft"):
+      return KEY_LEFTBRACE;
+    case Hash("BracketRight"):
+      return KEY_RIGHTBRACE;
+    case Hash("Backslash"):
+      return KEY_BACKSLASH;
+    case Hash("Semicolon"):
+      return KEY_SEMICOLON;
+    case Hash("Quote"):
+      return KEY_APOSTROPHE;
+    case Hash("Backquote"):
+      return KEY_GRAVE;
+    case Hash("Comma"):
+      return KEY_COMMA;
+    case Hash("Period"):
+      return KEY_DOT;
+    case Hash("Slash"):
+      return KEY_SLASH;
+    case Hash("Enter"):
+      return KEY_ENTER;
+    case Hash("Escape"):
+      return KEY_ESC;
+    case Hash("Backspace"):
+      return KEY_BACKSPACE;
+    case Hash("Tab"):
+      return KEY_TAB;
+    case Hash("Space"):
+      return KEY_SPACE;
+    case Hash("CapsLock"):
+      return KEY_CAPSLOCK;
+    case Hash("F1"):
+      return KEY_F1;
+    case Hash("F2"):
+      return KEY_F2;
+    case Hash("F3"):
+      return KEY_F3;
+    case Hash("F4"):
+      return KEY_F4;
+    case Hash("F5"):
+      return KEY_F5;
+    case Hash("F6"):
+      return KEY_F6;
+    case Hash("F7"):
+      return KEY_F7;
+    case Hash("F8"):
+      return KEY_F8;
+    case Hash("F9"):
+      return KEY_F9;
+    case Hash("F10"):
+      return KEY_F10;
+    case Hash("F11"):
+      return KEY_F11;
+    case Hash("F12"):
+      return KEY_F12;
+    case Hash("F13"):
+      return KEY_F13;
+    case Hash("F14"):
+      return KEY_F14;
+    case Hash("F15"):
+      return KEY_F15;
+    case Hash("F16"):
+      return KEY_F16;
+    case Hash("F17"):
+      return KEY_F17;
+    case Hash("F18"):
+      return KEY_F18;
+    case Hash("F19"):
+      return KEY_F19;
+    case Hash("F20"):
+      return KEY_F20;
+    case Hash("F21"):
+      return KEY_F21;
+    case Hash("F22"):
+      return KEY_F22;
+    case Hash("F23"):
+      return KEY_F23;
+    case Hash("F24"):
+      return KEY_F24;
+    case Hash("PrintScreen"):
+      return KEY_SYSRQ;
+    case Hash("ScrollLock"):
+      return KEY_SCROLLLOCK;
+    case Hash("Pause"):
+      return KEY_PAUSE;
+    case Hash("Insert"):
+      return KEY_INSERT;
+    case Hash("Home"):
+      return KEY_HOME;
+    case Hash("PageUp"):
+      return KEY_PAGEUP;
+    case Hash("PageDown"):
+      return KEY_PAGEDOWN;
+    case Hash("Delete"):
+      return KEY_DELETE;
+    case Hash("End"):
+      return KEY_END;
+    case Hash("ArrowUp"):
+      return KEY_UP;
+    case Hash("ArrowDown"):
+      return KEY_DOWN;
+    case Hash("ArrowRight"):
+      return KEY_RIGHT;
+    case Hash("ArrowLeft"):
+      return KEY_LEFT;
+    case Hash("NumLock"):
+      return KEY_NUMLOCK;
+    case Hash("NumpadDivide"):
+      return KEY_KPSLASH;
+    case Hash("NumpadMultiply"):
+      return KEY_KPASTERISK;
+    case Hash("NumpadSubtract"):
+      return KEY_KPMINUS;
+    case Hash("NumpadAdd"):
+      return KEY_KPPLUS;
+    case Hash("NumpadEnter"):
+      return KEY_KPENTER;
+    case Hash("Numpad1"):
+      return KEY_KP1;
+    case Hash("Numpad2"):
+      return KEY_KP2;
+    case Hash("Numpad3"):
+      return KEY_KP3;
+    case Hash("Numpad4"):
+      return KEY_KP4;
+    case Hash("Numpad5"):
+      return KEY_KP5;
+    case Hash("Numpad6"):
+      return KEY_KP6;
+    case Hash("Numpad7"):
+      return KEY_KP7;
+    case Hash("Numpad8"):
+      return KEY_KP8;
+    case Hash("Numpad9"):
+      return KEY_KP9;
+    case Hash("Numpad0"):
+      return KEY_KP0;
+    case Hash("NumpadDecimal"):
+      return KEY_KPDOT;
+    case Hash("IntlBackslash"):
+      return KEY_102ND;
+    case Hash("ContextMenu"):
+      return KEY_COMPOSE;
+    case Hash("NumpadEqual"):
+      return KEY_KPEQUAL;
+    case Hash("Power"):
+      return KEY_POWER;
+    case Hash("Help"):
+      return KEY_HELP;
+    case Hash("Undo"):
+      return KEY_UNDO;
+    case Hash("Cut"):
+      return KEY_CUT;
+    case Hash("Copy"):
+      return KEY_COPY;
+    case Hash("Paste"):
+      return KEY_PASTE;
+    case Hash("AudioVolumeMute"):
+      return KEY_MUTE;
+    case Hash("AudioVolumeUp"):
+      return KEY_VOLUMEUP;
+    case Hash("AudioVolumeDown"):
+      return KEY_VOLUMEDOWN;
+    case Hash("NumpadComma"):
+      return KEY_KPCOMMA;
+    case Hash("IntlRo"):
+      return KEY_RO;
+    case Hash("KanaMode"):
+      return KEY_KATAKANAHIRAGANA;
+    case Hash("IntlYen"):
+      return KEY_YEN;
+    case Hash("Convert"):
+      return KEY_HENKAN;
+    case Hash("NonConvert"):
+      return KEY_MUHENKAN;
+    case Hash("Lang1"):
+      return KEY_HANGEUL;
+    case Hash("Lang2"):
+      return KEY_HANJA;
+    case Hash("Lang3"):
+      return KEY_KATAKANA;
+    case Hash("Lang4"):
+      return KEY_HIRAGANA;
+    case Hash("MediaTrackNext"):
+      return KEY_NEXTSONG;
+    case Hash("MediaTrackPrevious"):
+      return KEY_PREVIOUSSONG;
+    case Hash("MediaStop"):
+      return KEY_STOPCD;
+    case Hash("Eject"):
+      return KEY_EJECTCD;
+    case Hash("MediaPlayPause"):
+      return KEY_PLAYPAUSE;
+    case Hash("MediaSelect"):
+      return KEY_MEDIA;
+    case Hash("LaunchMail"):
+      return KEY_MAIL;
+    case Hash("LaunchApp2"):
+      return KEY_CALC;
+    case Hash("LaunchApp1"):
+      return KEY_COMPUTER;
+    case Hash("BrowserSearch"):
+      return KEY_SEARCH;
+    case Hash("BrowserHome"):
+      return KEY_HOMEPAGE;
+    case Hash("BrowserBack"):
+      return KEY_BACK;
+    case Hash("BrowserForward"):
+      return KEY_FORWARD;
+    case Hash("BrowserStop"):
+      return KEY_STOP;
+    case Hash("BrowserRefresh"):
+      return KEY_REFRESH;
+    case Hash("BrowserFavorites"):
+      return KEY_BOOKMARKS;
+    case Hash("Sleep"):
+      return KEY_SLEEP;
+    case Hash("WakeUp"):
+      return KEY_WAKEUP;
+    default:
+      return UINT32_MAX;
+  }
+}
+
+unsigned int MapLinuxModifierKey(const std::string& key) {
+  switch (Hash(key.c_str())) {
+    case Hash("Control"):
+      return hotcakey::kModifierControl;
+    case Hash("ControlRight"):
+      return hotcakey::kModifierControl;
+    case Hash("ControlLeft"):
+      return hotcakey::kModifierControl;
+    case Hash("Shift"):
+      return hotcakey::kModifierShift;
+    case Hash("ShiftRight"):
+      return hotcakey::kModifierShift;
+    case Hash("ShiftLeft"):
+      return hotcakey::kModifierShift;
+    case Hash("Alt"):
+      return hotcakey::kModifierAlt;
+    case Hash("AltRight"):
+      return hotcakey::kModifierAlt;
+    case Hash("AltLeft"):
+      return hotcakey::kModifierAlt;
+    case Hash("Meta"):
+      return hotcakey::kModifierMeta;
+    case Hash("MetaRight"):
+      return hotcakey::kModifierMeta;
+    case Hash("MetaLeft"):
+      return hotcakey::kModifierMeta;
+    default:
+      return UINT32_MAX;
+  }
+}
+
+// unlike `MapLinuxKeyCode`, modifiers are mapped to their physical keys.
+// generic modifiers such as "Control" are mapped to the left one.
+unsigned int MapLinuxPhysicalKey(const std::string& key) {
+  switch (Hash(key.c_str())) {
+    case Hash("Control"):
+    case Hash("ControlLeft"):
+      return KEY_LEFTCTRL;
+    case Hash("ControlRight"):
+      return KEY_RIGHTCTRL;
+    case Hash("Shift"):
+    case Hash("ShiftLeft"):
+      return KEY_LEFTSHIFT;
+    case Hash("ShiftRight"):
+      return KEY_RIGHTSHIFT;
+    case Hash("Alt"):
+    case Hash("AltLeft"):
+      return KEY_LEFTALT;
+    case Hash("AltRight"):
+      return KEY_RIGHTALT;
+    case Hash("Meta"):
+    case Hash("MetaLeft"):
+      return KEY_LEFTMETA;
+    case Hash("MetaRight"):
+      return KEY_RIGHTMETA;
+    default:
+      return MapLinuxKeyCode(key);
+  }
+}
+
+const char* ToCodeName(unsigned int code) {
+  switch (code) {
+    case KEY_A:
+      return "KeyA";
+    case KEY_B:
+      return "KeyB";
+    case KEY_C:
+      return "KeyC";
+    case KEY_D:
+      return "KeyD";
+    case KEY_E:
+      return "KeyE";
+    case KEY_F:
+      return "KeyF";
+    case KEY_G:
+      return "KeyG";
+    case KEY_H:
+      return "KeyH";
+    case KEY_I:
+      return "KeyI";
+    case KEY_J:
+      return "KeyJ";
+    case KEY_K:
+      return "KeyK";
+    case KEY_L:
+      return "KeyL";
+    case KEY_M:
+      return "KeyM";
+    case KEY_N:
+      return "KeyN";
+    case KEY_O:
+      return "KeyO";
+    case KEY_P:
+      return "KeyP";
+    case KEY_Q:
+      return "KeyQ";
+    case KEY_R:
+      return "KeyR";
+    case KEY_S:
+      return "KeyS";
+    case KEY_T:
+      return "KeyT";
+    case KEY_U:
+      return "KeyU";
+    case KEY_V:
+      return "KeyV";
+    case KEY_W:
+      return "KeyW";
+    case KEY_X:
+      return "KeyX";
+    case KEY_Y:
+      return "KeyY";
+    case KEY_Z:
+      return "KeyZ";
+    case KEY_1:
+      return "Digit1";
+    case KEY_2:
+      return "Digit2";
+    case KEY_3:
+      return "Digit3";
+    case KEY_4:
+      return "Digit4";
+    case KEY_5:
+      return "Digit5";
+    case KEY_6:
+      return "Digit6";
+    case KEY_7:
+      return "Digit7";
+    case KEY_8:
+      return "Digit8";
+    case KEY_9:
+      return "Digit9";
+    case KEY_0:
+      return "Digit0";
+    case KEY_MINUS:
+      return "Minus";
+    case KEY_EQUAL:
+      return "Equal";
+    case KEY_LEFTBRACE:
+      return "BracketLeft";
+    case KEY_RIGHTBRACE:
+      return "BracketRight";
+    case KEY_BACKSLASH:
+      return "Backslash";
+    case KEY_SEMICOLON:
+      return "Semicolon";
+    case KEY_APOSTROPHE:
+      return "Quote";
+    case KEY_GRAVE:
+      return "Backquote";
+    case KEY_COMMA:
+      return "Comma";
+    case KEY_DOT:
+      return "Period";
+    case KEY_SLASH:
+      return "Slash";
+    case KEY_ENTER:
+      return "Enter";
+    case KEY_ESC:
+      return "Escape";
+    case KEY_BACKSPACE:
+      return "Backspace";
+    case KEY_TAB:
+      return "Tab";
+    case KEY_SPACE:
+      return "Space";
+    case KEY_CAPSLOCK:
+      return "CapsLock";
+    case KEY_F1:
+      return "F1";
+    case KEY_F2:
+      return "F2";
+    case KEY_F3:
+      return "F3";
+    case KEY_F4:
+      return "F4";
+    case KEY_F5:
+      return "F5";
+    case KEY_F6:
+      return "F6";
+    case KEY_F7:
+      return "F7";
+    case KEY_F8:
+      return "F8";
+    case KEY_F9:
+      return "F9";
+    case KEY_F10:
+      return "F10";
+    case KEY_F11:
+      return "F11";
+    case KEY_F12:
+      return "F12";
+    case KEY_F13:
+      return "F13";
+    case KEY_F14:
+      return "F14";
+    case KEY_F15:
+      return "F15";
+    case KEY_F16:
+      return "F16";
+    case KEY_F17:
+      return "F17";
+    case KEY_F18:
+      return "F18";
+    case KEY_F19:
+      return "F19";
+    case KEY_F20:
+      return "F20";
+    case KEY_F21:
+      return "F21";
+    case KEY_F22:
+      return "F22";
+    case KEY_F23:
+      return "F23";
+    case KEY_F24:
+      return "F24";
+    case KEY_SYSRQ:
+      return "PrintScreen";
+    case KEY_SCROLLLOCK:
+      return "ScrollLock";
+    case KEY_PAUSE:
+      return "Pause";
+    case KEY_INSERT:
+      return "Insert";
+    case KEY_HOME:
+      return "Home";
+    case KEY_PAGEUP:
+      return "PageUp";
+    case KEY_PAGEDOWN:
+      return "PageDown";
+    case KEY_DELETE:
+      return "Delete";
+    case KEY_END:
+      return "End";
+    case KEY_UP:
+      return "ArrowUp";
+    case KEY_DOWN:
+      return "ArrowDown";
+    case KEY_RIGHT:
+      return "ArrowRight";
+    case KEY_LEFT:
+      return "ArrowLeft";
+    case KEY_NUMLOCK:
+      return "NumLock";
+    case KEY_KPSLASH:
+      return "NumpadDivide";
+    case KEY_KPASTERISK:
+      return "NumpadMultiply";
+    case KEY_KPMINUS:
+      return "NumpadSubtract";
+    case KEY_KPPLUS:
+      return "NumpadAdd";
+    case KEY_KPENTER:
+      return "NumpadEnter";
+    case KEY_KP1:
+      return "Numpad1";
+    case KEY_KP2:
+      return "Numpad2";
+    case KEY_KP3:
+      return "Numpad3";
+    case KEY_KP4:
+      return "Numpad4";
+    case KEY_KP5:
+      return "Numpad5";
+    case KEY_KP6:
+      return "Numpad6";
+    case KEY_KP7:
+      return "Numpad7";
+    case KEY_KP8:
+      return "Numpad8";
+    case KEY_KP9:
+      return "Numpad9";
+    case KEY_KP0:
+      return "Numpad0";
+    case KEY_KPDOT:
+      return "NumpadDecimal";
+    case KEY_102ND:
+      return "IntlBackslash";
+    case KEY_COMPOSE:
+      return "ContextMenu";
+    case KEY_KPEQUAL:
+      return "NumpadEqual";
+    case KEY_POWER:
+      return "Power";
+    case KEY_HELP:
+      return "Help";
+    case KEY_UNDO:
+      return "Undo";
+    case KEY_CUT:
+      return "Cut";
+    case KEY_COPY:
+      return "Copy";
+    case KEY_PASTE:
+      return "Paste";
+    case KEY_MUTE:
+      return "AudioVolumeMute";
+    case KEY_VOLUMEUP:
+      return "AudioVolumeUp";
+    case KEY_VOLUMEDOWN:
+      return "AudioVolumeDown";
+    case KEY_KPCOMMA:
+      return "NumpadComma";
+    case KEY_RO:
+      return "IntlRo";
+    case KEY_KATAKANAHIRAGANA:
+      return "KanaMode";
+    case KEY_YEN:
+      return "IntlYen";
+    case KEY_HENKAN:
+      return "Convert";
+    case KEY_MUHENKAN:
+      return "NonConvert";
+    case KEY_HANGEUL:
+      return "Lang1";
+    case KEY_HANJA:
+      return "Lang2";
+    case KEY_KATAKANA:
+      return "Lang3";
+    case KEY_HIRAGANA:
+      return "Lang4";
+    case KEY_NEXTSONG:
+      return "MediaTrackNext";
+    case KEY_PREVIOUSSONG:
+      return "MediaTrackPrevious";
+    case KEY_STOPCD:
+      return "MediaStop";
+    case KEY_EJECTCD:
+      return "Eject";
+    case KEY_PLAYPAUSE:
+      return "MediaPlayPause";
+    case KEY_MEDIA:
+      return "MediaSelect";
+    case KEY_MAIL:
+      return "LaunchMail";
+    case KEY_CALC:
+      return "LaunchApp2";
+    case KEY_COMPUTER:
+      return "LaunchApp1";
+    case KEY_SEARCH:
+      return "BrowserSearch";
+    case KEY_HOMEPAGE:
+      return "BrowserHome";
+    case KEY_BACK:
+      return "BrowserBack";
+    case KEY_FORWARD:
+      return "BrowserForward";
+    case KEY_STOP:
+      return "BrowserStop";
+    case KEY_REFRESH:
+      return "BrowserRefresh";
+    case KEY_BOOKMARKS:
+      return "BrowserFavorites";
+    case KEY_SLEEP:
+      return "Sleep";
+    case KEY_WAKEUP:
+      return "WakeUp";
+    case KEY_RIGHTCTRL:
+      return "ControlRight";
+    case KEY_LEFTCTRL:
+      return "ControlLeft";
+    case KEY_RIGHTSHIFT:
+      return "ShiftRight";
+    case KEY_LEFTSHIFT:
+      return "ShiftLeft";
+    case KEY_RIGHTALT:
+      return "AltRight";
+    case KEY_LEFTALT:
+      return "AltLeft";
+    case KEY_RIGHTMETA:
+      return "MetaRight";
+    case KEY_LEFTMETA:
+      return "MetaLeft";
+    default:
+      return nullptr;
+  }
+}
+
+unsigned int ToLinuxKey(const std::vector<std::string>& keys) {
+  for (auto& key : keys) {
+    auto code = MapLinuxKeyCode(key);
+
+    if (code != UINT32_MAX) {
+      return code;
+    }
+  }
+
+  return UINT32_MAX;
+}
+
+unsigned int ToLinuxModifiers(const std::vector<std::string>& keys) {
+  unsigned int modifier = 0;
+  for (auto& key : keys) {
+    auto candidate = MapLinuxModifierKey(key);
+
+    if (candidate != UINT32_MAX) {
+      modifier |= candidate;
+    }
+  }
+  return modifier;
+}
+
+// keys of `chord` in the form `Register` takes, to forward it to hotcakeyd
+std::vector<std::string> ToKeyNames(const hotcakey::Chord& chord) {
+  std::vector<std::string> keys;
+
+  if (chord.modifiers & hotcakey::kModifierControl) keys.push_back("Control");
+  if (chord.modifiers & hotcakey::kModifierShift) keys.push_back("Shift");
+  if (chord.modifiers & hotcakey::kModifierAlt) keys.push_back("Alt");
+  if (chord.modifiers & hotcakey::kModifierMeta) keys.push_back("Meta");
+
+  keys.push_back(ToCodeName(chord.key));
+
+  return keys;
+}
+
+std::uint32_t PackChord(const hotcakey::Chord& chord) {
+  return static_cast<std::uint32_t>(chord.key) << 8 | chord.modifiers;
+}
+
+// registers `chord` to hotcakeyd unless another listener already did
+//
+// NOTICE: must be called with `mutex` held
+bool ForwardChord(const hotcakey::Chord& chord,
+                  hotcakey::Registration registration) {
+  auto key = PackChord(chord);
+
+  if (!daemonChords.Add(key, registration)) return true;
+
+  if (!daemonClient.Register(registration, ToKeyNames(chord))) {
+    hotcakey::Registration handle;
+    daemonChords.Remove(key, registration, handle);
+    return false;
+  }
+
+  daemonChords.Find(key)->handle = registration;
+  daemonHandles[registration] = key;
+
+  return true;
+}
+
+// NOTICE: must be called with `mutex` held
+void UnforwardChord(const hotcakey::Chord& chord,
+                    hotcakey::Registration registration) {
+  hotcakey::Registration handle;
+
+  if (daemonChords.Remove(PackChord(chord), registration, handle)) {
+    daemonClient.Unregister(handle);
+    daemonHandles.erase(handle);
+  }
+}
+
+// puts the chord of `listener` where events are matched, hotcakeyd or
+// the matcher
+//
+// NOTICE: must be called with `mutex` held
+bool AttachChord(const Listener& listener,
+                 hotcakey::Registration registration) {
+  if (daemonClient.IsConnected()) {
+    if (listener.device) {
+      ERR("device hotkeys are not available through hotcakeyd");
+      return false;
+    }
+    if (listener.combo) {
+      ERR("combos are not available through hotcakeyd");
+      return false;
+    }
+    return ForwardChord(listener.chord, registration);
+  }
+  if (listener.combo) return combos.Add(*listener.combo, registration);
+  return matcher.Add(listener.chord, registration, listener.layer);
+}
+
+// NOTICE: must be called with `mutex` held
+void DetachChord(const Listener& listener,
+                 hotcakey::Registration registration) {
+  if (daemonClient.IsConnected()) {
+    UnforwardChord(listener.chord, registration);
+  } else if (listener.combo) {
+    combos.Remove(registration);
+  } else {
+    matcher.Remove(listener.chord, registration, listener.layer);
+  }
+}
+
+// NOTICE: must be called with `mutex` held
+hotcakey::Layer ToLayer(const std::string& name) {
+  auto it = layers.find(name);
+  if (it != layers.end()) return it->second;
+
+  auto layer = static_cast<hotcakey::Layer>(layerNames.size());
+  layers[name] = layer;
+  layerNames.push_back(name);
+
+  return layer;
+}
+
+// a keydown is swallowed while suspended, and a keyup is swallowed only if
+// its keydown was, so a chord fired before `Suspend` is still released
+//
+// NOTICE: must be called with `mutex` held
+bool Swallow(hotcakey::KeyCode code, bool pressed) {
+  if (code >= hotcakey::kKeyCodeCount) return false;
+
+  if (pressed) {
+    if (!isSuspended.load(std::memory_order_relaxed)) return false;
+    swallowed.Set(code);
+    return true;
+  }
+
+  if (!swallowed.Test(code)) return false;
+
+  swallowed.Reset(code);
+
+  return true;
+}
+
+bool AddFilterKey(hotcakey::KeyBitset& keys, const std::string& key) {
+  auto code = MapLinuxPhysicalKey(key);
+  if (code == UINT32_MAX) return false;
+
+  keys.Set(code);
+
+  // a generic modifier matches both left and right keys
+  switch (Hash(key.c_str())) {
+    case Hash("Control"):
+      keys.Set(KEY_RIGHTCTRL);
+      break;
+    case Hash("Shift"):
+      keys.Set(KEY_RIGHTSHIFT);
+      break;
+    case Hash("Alt"):
+      keys.Set(KEY_RIGHTALT);
+      break;
+    case Hash("Meta"):
+      keys.Set(KEY_RIGHTMETA);
+      break;
+  }
+
+  return true;
+}
+
+bool CompileFilter(const hotcakey::Filter& filter,
+                   hotcakey::CompiledFilter& compiled) {
+  if (filter.keys.empty()) {
+    compiled.keys.Fill();
+  }
+
+  for (auto& key : filter.keys) {
+    if (!AddFilterKey(compiled.keys, key)) {
+      ERR("cannot find a key code for key: " << key);
+      return false;
+    }
+  }
+
+  for (auto& key : filter.modifiers) {
+    auto modifier = MapLinuxModifierKey(key);
+
+    if (modifier == UINT32_MAX) {
+      ERR("not a modifier key: " << key);
+      return false;
+    }
+
+    compiled.requiredModifiers |= modifier;
+  }
+
+  if (filter.exact) {
+    compiled.forbiddenModifiers =
+        ~compiled.requiredModifiers & (hotcakey::kModifierCombinations - 1);
+  }
+
+  if (filter.types.empty()) {
+    compiled.types = (1 << hotcakey::kKeyDown) | (1 << hotcakey::kKeyUp);
+  }
+
+  for (auto type : filter.types) {
+    compiled.types |= 1 << type;
+  }
+
+  return true;
+}
+
+constexpr std::pair<hotcakey::KeyCode, hotcakey::Modifier> kModifierKeys[] = {
+    {KEY_LEFTCTRL, hotcakey::kModifierControl},
+    {KEY_RIGHTCTRL, hotcakey::kModifierControl},
+    {KEY_LEFTSHIFT, hotcakey::kModifierShift},
+    {KEY_RIGHTSHIFT, hotcakey::kModifierShift},
+    {KEY_LEFTALT, hotcakey::kModifierAlt},
+    {KEY_RIGHTALT, hotcakey::kModifierAlt},
+    {KEY_LEFTMETA, hotcakey::kModifierMeta},
+    {KEY_RIGHTMETA, hotcakey::kModifierMeta},
+};
+
+void SetupModifierKeys() {
+  for (auto [code, modifier] : kModifierKeys) {
+    matcher.SetModifierKey(code, modifier);
+  }
+}
+
+bool IsModifierKey(unsigned int code) {
+  for (auto& key : kModifierKeys) {
+    if (key.first == code) return true;
+  }
+  return false;
+}
+
+bool TestBit(const unsigned long* bits, unsigned int bit) {
+  constexpr auto width = sizeof(unsigned long) * 8;
+  return (bits[bit / width] >> (bit % width)) & 1;
+}
+
+// a device is treated as a keyboard when it reports keys below `BTN_MISC`.
+// mice and joysticks only report buttons, so they are skipped.
+bool IsKeyboard(int fd) {
+  constexpr auto width = sizeof(unsigned long) * 8;
+  unsigned long types[(EV_MAX + width) / width] = {};
+  unsigned long keys[(KEY_MAX + width) / width] = {};
+
+  if (ioctl(fd, EVIOCGBIT(0, sizeof(types)), types) < 0) return false;
+  if (!TestBit(types, EV_KEY)) return false;
+  if (ioctl(fd, EVIOCGBIT(EV_KEY, sizeof(keys)), keys) < 0) return false;
+
+  for (unsigned int code = KEY_ESC; code < BTN_MISC; code++) {
+    if (TestBit(keys, code)) return true;
+  }
+
+  return false;
+}
+
+std::string ReadDeviceString(int fd, unsigned long request) {
+  char buffer[256] = {};
+  if (ioctl(fd, request, buffer) < 0) return "";
+  return buffer;
+}
+
+// adds `fd` to the epoll set and the device registry
+bool WatchDevice(int fd, InputDevice device) {
+  epoll_event ev{};
+  ev.events = EPOLLIN;
+  ev.data.fd = fd;
+
+  if (epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &ev) != 0) {
+    ERR("failed to watch " << device.info.path << ": "
+                           << std::strerror(errno));
+    return false;
+  }
+
+  LOG("watch keyboard device: " << device.info.path << " ("
+                                << device.info.name << ")");
+
+  std::lock_guard<std::mutex> lock(mutex);
+  devices.emplace(fd, std::move(device));
+
+  return true;
+}
+
+// NOTICE: must be called with `mutex` held
+bool IsOpen(const std::string& path) {
+  for (auto& [fd, device] : devices) {
+    if (device.info.path == path) return true;
+  }
+  return false;
+}
+
+// opens `path` if it is a keyboard which is not open yet. a node which
+// udev has not given permissions yet is opened by its IN_ATTRIB later.
+void OpenDevice(const std::string& path) {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (IsOpen(path)) return;
+  }  // lock(mutex)
+
+  auto fd = open(path.c_str(), O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+
+  if (fd < 0) {
+    LOG("cannot open " << path << ": " << std::strerror(errno));
+    return;
+  }
+
+  if (!IsKeyboard(fd)) {
+    close(fd);
+    return;
+  }
+
+  // timestamp events with the clock of traces rather than wall time
+  int clock = CLOCK_MONOTONIC;
+  if (ioctl(fd, EVIOCSCLOCKID, &clock) != 0) {
+    LOG("cannot set clock of " << path << ": " << std::strerror(errno));
+  }
+
+  InputDevice device;
+  device.info.path = path;
+  device.info.name = ReadDeviceString(fd, EVIOCGNAME(255));
+  device.info.phys = ReadDeviceString(fd, EVIOCGPHYS(255));
+
+  // reading what we pass through would match every key twice
+  if (device.info.name == kPassthroughName) {
+    close(fd);
+    return;
+  }
+
+  if (isGrabbing) {
+    device.isGrabbed = ioctl(fd, EVIOCGRAB, 1) == 0;
+    if (!device.isGrabbed) {
+      WRN("cannot grab " << path << ": " << std::strerror(errno));
+    }
+  }
+
+  input_id id{};
+  if (ioctl(fd, EVIOCGID, &id) == 0) {
+    device.info.vendor = id.vendor;
+    device.info.product = id.product;
+  }
+
+  if (!WatchDevice(fd, std::move(device))) close(fd);
+}
+
+void OpenHotplug() {
+  hotplugFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+
+  if (hotplugFd < 0 ||
+      inotify_add_watch(hotplugFd, "/dev/input",
+                        IN_CREATE | IN_ATTRIB | IN_DELETE) < 0) {
+    // a missing /dev/input is reported by the scan
+    if (errno != ENOENT) {
+      WRN("cannot watch /dev/input for new devices: " << std::strerror(errno));
+    }
+    if (hotplugFd >= 0) close(hotplugFd);
+    hotplugFd = -1;
+    return;
+  }
+
+  epoll_event ev{};
+  ev.events = EPOLLIN;
+  ev.data.fd = hotplugFd;
+
+  if (epoll_ctl(epollFd, EPOLL_CTL_ADD, hotplugFd, &ev) != 0) {
+    WRN("cannot watch /dev/input for new devices: " << std::strerror(errno));
+    close(hotplugFd);
+    hotplugFd = -1;
+  }
+}
+
+void OpenDevices() {
+  // watched first, so nothing plugged in during the scan is missed
+  OpenHotplug();
+
+  auto dir = opendir("/dev/input");
+
+  if (dir == nullptr) {
+    WRN("cannot open /dev/input: " << std::strerror(errno));
+    return;
+  }
+
+  while (auto entry = readdir(dir)) {
+    if (std::strncmp(entry->d_name, "event", 5) != 0) continue;
+    OpenDevice(std::string("/dev/input/") + entry->d_name);
+  }
+
+  closedir(dir);
+
+  std::lock_guard<std::mutex> lock(mutex);
+
+  if (devices.empty()) {
+    WRN("no readable keyboard device found. "
+        "check permissions of /dev/input (e.g. the `input` group)");
+  }
+}
+
+// writes to a synthetic device, waiting while the pipe is full
+// NOTICE: `count` is kept within PIPE_BUF, so that the write is atomic and
+// EAGAIN means nothing was written.
+bool WriteSynthetic(int fd, const input_event* events, std::size_t count) {
+  auto size = static_cast<ssize_t>(sizeof(input_event) * count);
+
+  while (write(fd, events, size) != size) {
+    if (errno == EINTR) continue;
+
+    if (errno != EAGAIN) {
+      ERR("failed to emit synthetic event: " << std::strerror(errno));
+      return false;
+    }
+
+    // nobody else drains the pipe
+    if (isInputThread) {
+      ERR("synthetic device is full");
+      return false;
+    }
+
+    pollfd writable{fd, POLLOUT, 0};
+    poll(&writable, 1, 100);
+  }
+
+  return true;
+}
+
+bool WriteSynthetic(int fd, const input_event& event) {
+  return WriteSynthetic(fd, &event, 1);
+}
+
+bool WriteInjected(hotcakey::InjectTarget target, const input_event* events,
+                   std::size_t count) {
+  if (target == hotcakey::kInjectUinput) {
+    auto size = static_cast<ssize_t>(sizeof(input_event) * count);
+    if (write(injectorFd, events, size) != size) {
+      ERR("failed to inject events: " << std::strerror(errno));
+      return false;
+    }
+    return true;
+  }
+
+  std::lock_guard<std::mutex> serialized(lifecycle);
+
+  if (!isActive.load(std::memory_order_acquire)) {
+    ERR("cannot inject into the synthetic device while inactive");
+    return false;
+  }
+
+  if (daemonClient.IsConnected()) {
+    ERR("cannot inject through hotcakeyd");
+    return false;
+  }
+
+  return WriteSynthetic(syntheticFds[1], events, count);
+}
+
+bool OpenSyntheticDevice() {
+  if (pipe2(syntheticFds, O_NONBLOCK | O_CLOEXEC) != 0) {
+    ERR("failed to create synthetic device: " << std::strerror(errno));
+    return false;
+  }
+
+  epoll_event ev{};
+  ev.events = EPOLLIN;
+  ev.data.fd = syntheticFds[0];
+
+  if (epoll_ctl(epollFd, EPOLL_CTL_ADD, syntheticFds[0], &ev) != 0) {
+    ERR("failed to watch synthetic device: " << std::strerror(errno));
+    return false;
+  }
+
+  return true;
+}
+
+bool OpenWakeup() {
+  wakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+
+  if (wakeFd < 0) {
+    ERR("failed to create wakeup event: " << std::strerror(errno));
+    return false;
+  }
+
+  epoll_event ev{};
+  ev.events = EPOLLIN;
+  ev.data.fd = wakeFd;
+
+  if (epoll_ctl(epollFd, EPOLL_CTL_ADD, wakeFd, &ev) != 0) {
+    ERR("failed to watch wakeup event: " << std::strerror(errno));
+    return false;
+  }
+
+  return true;
+}
+
+bool OpenComboTimer() {
+  comboTimerFd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+
+  if (comboTimerFd < 0) {
+    ERR("failed to create combo timer: " << std::strerror(errno));
+    return false;
+  }
+
+  epoll_event ev{};
+  ev.events = EPOLLIN;
+  ev.data.fd = comboTimerFd;
+
+  if (epoll_ctl(epollFd, EPOLL_CTL_ADD, comboTimerFd, &ev) != 0) {
+    ERR("failed to watch combo timer: " << std::strerror(errno));
+    return false;
+  }
+
+  return true;
+}
+
+void Wake() {
+  std::uint64_t one = 1;
+  if (write(wakeFd, &one, sizeof(one)) < 0) {
+    ERR("failed to wake up event loop: " << std::strerror(errno));
+  }
+}
+
+// makes a uinput keyboard named `name`, or returns -1
+int CreateKeyboard(const char* name) {
+  auto fd = open("/dev/uinput", O_WRONLY | O_NONBLOCK | O_CLOEXEC);
+
+  if (fd < 0) {
+    WRN("cannot open /dev/uinput: " << std::strerror(errno));
+    return -1;
+  }
+
+  // everything a keyboard with a touchpad or a trackpoint may report.
+  // no EV_REP, since repeats of the grabbed keyboards are passed through.
+  ioctl(fd, UI_SET_EVBIT, EV_KEY);
+  ioctl(fd, UI_SET_EVBIT, EV_REL);
+  ioctl(fd, UI_SET_EVBIT, EV_MSC);
+  for (int code = 1; code < KEY_CNT; code++) {
+    ioctl(fd, UI_SET_KEYBIT, code);
+  }
+  for (int code = 0; code < REL_CNT; code++) {
+    ioctl(fd, UI_SET_RELBIT, code);
+  }
+  ioctl(fd, UI_SET_MSCBIT, MSC_SCAN);
+
+  uinput_setup setup{};
+  setup.id.bustype = BUS_VIRTUAL;
+  std::strncpy(setup.name, name, UINPUT_MAX_NAME_SIZE - 1);
+
+  if (ioctl(fd, UI_DEV_SETUP, &setup) < 0 || ioctl(fd, UI_DEV_CREATE) < 0) {
+    WRN("cannot create uinput keyboard: " << std::strerror(errno));
+    close(fd);
+    return -1;
+  }
+
+  return fd;
+}
+
+bool OpenPassthrough() {
+  if (passthroughOverride >= 0) {
+    passthroughFd = dup(passthroughOverride);
+    return passthroughFd >= 0;
+  }
+
+  passthroughFd = CreateKeyboard(kPassthroughName);
+
+  return passthroughFd >= 0;
+}
+
+void ClosePassthrough() {
+  if (passthroughFd < 0) return;
+
+  // the kernel releases keys still held on the uinput keyboard
+  if (passthroughOverride < 0) ioctl(passthroughFd, UI_DEV_DESTROY);
+
+  close(passthroughFd);
+  passthroughFd = -1;
+}
+
+void Pass(const input_event* events, std::size_t count) {
+  if (count == 0) return;
+
+  auto size = sizeof(input_event) * count;
+  if (write(passthroughFd, events, size) != static_cast<ssize_t>(size)) {
+    ERR("failed to pass events through: " << std::strerror(errno));
+  }
+}
+
+void FlushPassing() {
+  Pass(passing, passingCount);
+  passingCount = 0;
+}
+
+void PassLater(const input_event& event) {
+  if (passingCount == std::size(passing)) FlushPassing();
+  passing[passingCount++] = event;
+}
+
+// waits until udev makes the node of the uinput keyboard at `fd`, so that
+// applications can open it
+bool WaitForNode(int fd) {
+  char name[64] = {};
+
+  if (ioctl(fd, UI_GET_SYSNAME(sizeof(name) - 1), name) < 0) {
+    WRN("cannot get the name of uinput keyboard: " << std::strerror(errno));
+    return false;
+  }
+
+  auto directory = std::string("/sys/devices/virtual/input/") + name;
+
+  for (int i = 0; i < 100; i++) {
+    if (auto dir = opendir(directory.c_str())) {
+      std::string node;
+      while (auto entry = readdir(dir)) {
+        if (std::strncmp(entry->d_name, "event", 5) == 0) {
+          node = std::string("/dev/input/") + entry->d_name;
+        }
+      }
+      closedir(dir);
+
+      if (!node.empty() && access(node.c_str(), F_OK) == 0) return true;
+    }
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+
+  WRN("uinput keyboard did not show up in /dev/input: " << name);
+  return false;
+}
+
+void CloseDevices() {
+  for (auto& [fd, device] : devices) {
+    close(fd);
+    if (device.writer >= 0) close(device.writer);
+  }
+  devices.clear();
+
+  if (hotplugFd >= 0) close(hotplugFd);
+  hotplugFd = -1;
+
+  // after the devices, so they are never grabbed without a passthrough
+  ClosePassthrough();
+  isGrabbing = false;
+  consumed.Clear();
+
+  if (wakeFd >= 0) close(wakeFd);
+  wakeFd = -1;
+
+  if (comboTimerFd >= 0) close(comboTimerFd);
+  comboTimerFd = -1;
+  armedDeadline = 0;
+  passingCount = 0;
+
+  for (auto& fd : syntheticFds) {
+    if (fd >= 0) close(fd);
+    fd = -1;
+  }
+
+  if (epollFd >= 0) close(epollFd);
+  epollFd = -1;
+}
+
+std::uint32_t KeyStateWord(std::size_t index) {
+  auto word = matcher.State().Words()[index / 2];
+  return static_cast<std::uint32_t>(index % 2 == 0 ? word : word >> 32);
+}
+
+// writes bitmap words in [begin, end) with the seqlock protocol.
+// readers retry while the sequence is odd or changed during the read.
+void PublishKeyState(std::size_t begin, std::size_t end) {
+  if (keyState == nullptr) return;
+
+  auto sequence = keyState[0].load(std::memory_order_relaxed);
+  keyState[0].store(sequence + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+
+  for (auto i = begin; i < end; i++) {
+    keyState[1 + i].store(KeyStateWord(i), std::memory_order_relaxed);
+  }
+
+  keyState[0].store(sequence + 2, std::memory_order_release);
+}
+
+void PublishKeyState() { PublishKeyState(0, hotcakey::kKeyStateWords - 1); }
+
+// the device is gone (e.g. unplugged), or a synthetic one was removed
+//
+// NOTICE: must be called with `mutex` held
+void CloseDevice(int fd) {
+  auto it = devices.find(fd);
+  if (it == devices.end()) return;
+
+  LOG("stop watching device: " << it->second.info.path);
+
+  epoll_ctl(epollFd, EPOLL_CTL_DEL, fd, nullptr);
+  close(fd);
+  if (it->second.writer >= 0) close(it->second.writer);
+  devices.erase(it);
+
+  // keys held on the device are never released
+  matcher.ResetState();
+  combos.ResetState();
+  PublishKeyState();
+}
+
+// NOTICE: must be called with `mutex` held
+void Notify(hotcakey::Registration registration, const hotcakey::Event& event,
+            hotcakey::KeyCode code) {
+  hotcakey::trace::Record(hotcakey::trace::kMatched, event.trace);
+
+  auto listener = listeners.Find(registration);
+  if (listener->isRetired) return;
+
+  auto now = hotcakey::ring::Now();
+
+  // native actions first, they are what latency matters for
+  if (listener->executor) {
+    listener->executor->Fire(registration, event.type, now);
+  }
+
+  if (publisher) publisher->Write(registration, code, event.type, now);
+
+  if (listener->callback) listener->callback(event);
+}
+
+// NOTICE: must be called with `mutex` held
+void RemoveListener(hotcakey::Registration registration) {
+  auto listener = listeners.Find(registration);
+
+  if (listener == nullptr) return;
+
+  // detached, so it only has to leave its snapshot
+  if (listener->snapshot != 0) {
+    auto& stash = snapshots.at(listener->snapshot);
+
+    if (listener->stream) {
+      for (auto it = stash.streams.begin(); it != stash.streams.end(); ++it) {
+        if (it->registration == registration) {
+          stash.streams.erase(it);
+          break;
+        }
+      }
+    } else {
+      auto& chords = stash.chords;
+      chords.erase(std::remove(chords.begin(), chords.end(), registration),
+                   chords.end());
+    }
+  } else if (listener->stream) {
+    for (auto it = streams.begin(); it != streams.end(); ++it) {
+      if (it->registration == registration) {
+        streams.erase(it);
+        break;
+      }
+    }
+  } else {
+    DetachChord(*listener, registration);
+  }
+
+  listeners.Erase(registration);
+}
+
+// removes listeners unregistered during a dispatch. they cannot be removed
+// right away since the matcher and `streams` are being iterated, and the
+// listener itself may be running.
+//
+// NOTICE: must be called with `mutex` held
+void RetireListeners() {
+  if (retired.empty()) return;
+
+  for (auto registration : retired) RemoveListener(registration);
+  retired.clear();
+
+  LOG("hotkeys unregistered by listeners");
+}
+
+// a binding is the same across reloads if all of these are
+using BindingKey = std::tuple<hotcakey::KeyCode, std::uint8_t, hotcakey::Layer,
+                              std::string>;
+
+// registers the bindings of the keymap file which are not registered yet,
+// and then unregisters the ones which are gone, so a chord moving to
+// another action never leaves the os. returns false and keeps the current
+// bindings if the file is broken.
+//
+// NOTICE: must be called with `mutex` held
+bool ApplyKeymap(KeymapWatch& watch) {
+  auto reader = hotcakey::keymap::Reader::Open(watch.path);
+
+  if (!reader) {
+    return false;
+  }
+
+  std::multimap<BindingKey, hotcakey::Registration> gone;
+  for (auto& bound : watch.bound) {
+    gone.emplace(BindingKey(bound.chord.key, bound.chord.modifiers,
+                            bound.layer, bound.action),
+                 bound.registration);
+  }
+
+  std::vector<hotcakey::Layer> layerOf;
+  for (std::size_t i = 0; i < reader->LayerCount(); i++) {
+    layerOf.push_back(ToLayer(reader->LayerName(i)));
+  }
+
+  std::vector<Bound> next;
+  next.reserve(reader->Size());
+  std::size_t added = 0;
+
+  for (std::size_t i = 0; i < reader->Size(); i++) {
+    auto& binding = (*reader)[i];
+
+    Bound bound{{binding.key, binding.modifiers},
+                layerOf[binding.layer],
+                reader->ActionName(binding.action),
+                0};
+
+    auto it = gone.find(BindingKey(bound.chord.key, bound.chord.modifiers,
+                                   bound.layer, bound.action));
+
+    if (it != gone.end()) {
+      bound.registration = it->second;
+      gone.erase(it);
+      next.push_back(std::move(bound));
+      continue;
+    }
+
+    auto id = listeners.Insert(Listener{
+        .callback = watch.listener(bound.action),
+        .chord = bound.chord,
+        .stream = false,
+        .executor = nullptr,
+        .layer = bound.layer,
+    });
+
+    if (!AttachChord(*listeners.Find(id), id)) {
+      ERR("failed to register hotkey " << i << " of keymap");
+      listeners.Erase(id);
+      continue;
+    }
+
+    bound.registration = id;
+    next.push_back(std::move(bound));
+    added++;
+  }
+
+  for (auto& [key, registration] : gone) RemoveListener(registration);
+
+  LOG("keymap applied, " << added << " added and " << gone.size()
+                         << " removed: " << watch.path);
+
+  watch.bound = std::move(next);
+
+  return true;
+}
+
+void RunKeymapWatch(std::shared_ptr<KeymapWatch> watch, std::string name) {
+  LOG("keymap watch thread started");
+
+  pollfd fds[2] = {{watch->inotifyFd, POLLIN, 0}, {watch->wakeFd, POLLIN, 0}};
+  alignas(inotify_event) char buffer[4096];
+
+  while (watch->isActive.load(std::memory_order_acquire)) {
+    if (poll(fds, 2, -1) < 0) {
+      if (errno == EINTR) continue;
+      ERR("failed to wait for keymap changes: " << std::strerror(errno));
+      break;
+    }
+
+    if (fds[1].revents != 0) break;
+
+    auto length = read(watch->inotifyFd, buffer, sizeof(buffer));
+    if (length <= 0) continue;
+
+    // events of the directory, which other files share
+    auto isChanged = false;
+    for (auto p = buffer; p < buffer + length;) {
+      auto event = reinterpret_cast<const inotify_event*>(p);
+      if (event->len > 0 && name == event->name) isChanged = true;
+      p += sizeof(inotify_event) + event->len;
+    }
+
+    if (!isChanged) continue;
+
+    std::lock_guard<std::mutex> lock(mutex);
+
+    if (!watch->isActive.load(std::memory_order_acquire)) break;
+
+    if (!ApplyKeymap(*watch)) {
+      WRN("keep the current keymap: " << watch->path);
+    }
+  }
+
+  LOG("keymap watch thread stopped");
+}
+
+// unregisters the bindings of `watch` and tells its thread to stop.
+// a listener may do so too, and then its bindings are retired instead.
+//
+// NOTICE: must be called with `mutex` held
+void StopKeymapWatch(KeymapWatch& watch) {
+  watch.isActive.store(false, std::memory_order_release);
+
+  for (auto& bound : watch.bound) {
+    if (!isInputThread) {
+      RemoveListener(bound.registration);
+      continue;
+    }
+
+    auto listener = listeners.Find(bound.registration);
+
+    if (listener != nullptr && !listener->isRetired) {
+      listener->isRetired = true;
+      retired.push_back(bound.registration);
+    }
+  }
+
+  watch.bound.clear();
+
+  std::uint64_t one = 1;
+  if (write(watch.wakeFd, &one, sizeof(one)) < 0) {
+    ERR("failed to wake keymap watch: " << std::strerror(errno));
+  }
+}
+
+// waits for the thread stopped by `StopKeymapWatch`. the input thread
+// holds `mutex` which the thread may be waiting for, so it lets the thread
+// end on its own instead.
+//
+// NOTICE: must be called without `mutex` held, except on the input thread
+void JoinKeymapWatch(const std::shared_ptr<KeymapWatch>& watch) {
+  if (isInputThread) {
+    watch->thread.detach();
+    return;
+  }
+
+  watch->thread.join();
+}
+
+// a follower unregistered by its own listener, freed when its thread ends
+thread_local std::unique_ptr<Follower> orphan;
+
+void StopFollower(std::unique_ptr<Follower> follower) {
+  follower->isActive.store(false, std::memory_order_release);
+
+  if (follower->thread.get_id() == std::this_thread::get_id()) {
+    follower->thread.detach();
+    orphan = std::move(follower);
+    return;
+  }
+
+  follower->reader->Wake();
+  follower->thread.join();
+}
+
+hotcakey::Event Traced(hotcakey::Event event, std::uint64_t id) {
+  event.trace = id;
+  return event;
+}
+
+// devices report in CLOCK_MONOTONIC, see `OpenDevices`.
+// synthetic events carry no time, so they are received right now.
+std::int64_t ReceivedAt(const input_event& event) {
+  if (event.input_event_sec == 0 && event.input_event_usec == 0) {
+    return hotcakey::trace::Now();
+  }
+  return static_cast<std::int64_t>(event.input_event_sec) * 1000000000 +
+         static_cast<std::int64_t>(event.input_event_usec) * 1000;
+}
+
+// whether a hotkey bound to devices takes a key from the device `fd`
+//
+// NOTICE: must be called with `mutex` held
+bool IsFromDevice(const Listener& listener, int fd) {
+  if (!listener.device) return true;
+
+  auto it = devices.find(fd);
+  return it != devices.end() && listener.device->Matches(it->second.info);
+}
+
+// matches a key event and dispatches it. returns whether a grabbed event
+// goes on to other applications.
+//
+// NOTICE: must be called with `mutex` held
+bool MatchKeyEvent(const input_event& event, int fd, bool isGrabbed) {
+  auto id = hotcakey::trace::NextId();
+  if (id != 0) {
+    hotcakey::trace::Record(hotcakey::trace::kReceived, id, ReceivedAt(event));
+    hotcakey::trace::Record(hotcakey::trace::kHandled, id);
+  }
+
+  static const hotcakey::Matcher::Registrations none;
+
+  auto pressed = event.value == 1;
+  auto changed = matcher.State().Test(event.code) != pressed;
+  auto& matched =
+      pressed ? matcher.Press(event.code) : matcher.Release(event.code);
+
+  // the matcher keeps track of keys even while suspended, so that chords
+  // match right after `Resume`
+  auto isSwallowed = Swallow(event.code, pressed);
+  auto& registrations = isSwallowed ? none : matched;
+  auto isConsumed = false;
+  std::uint32_t notified = 0;
+
+  if (changed) PublishKeyState(event.code / 32, event.code / 32 + 1);
+
+  for (auto registration : registrations) {
+    auto listener = listeners.Find(registration);
+    if (!IsFromDevice(*listener, fd)) continue;
+
+    if (!listener->isRetired) notified++;
+    isConsumed = isConsumed || (listener->consume && !listener->isRetired);
+
+    if (pressed) {
+      LOG("callback listener with keydown");
+      Notify(registration,
+             Traced(hotcakey::Event(hotcakey::EventType::kKeyDown,
+                                    std::time(nullptr)),
+                    id),
+             event.code);
+    } else {
+      LOG("callback listener with keyup");
+      Notify(registration,
+             Traced(hotcakey::Event(hotcakey::EventType::kKeyUp,
+                                    std::time(nullptr)),
+                    id),
+             event.code);
+    }
+  }
+
+  // only listeners actually called back count as matches
+  if (recorder) {
+    recorder->Write({ReceivedAt(event), event.code,
+                     static_cast<std::uint8_t>(pressed ? hotcakey::kKeyDown
+                                                       : hotcakey::kKeyUp),
+                     0, notified});
+  }
+
+  if (changed && !isSwallowed && !streams.empty()) {
+    auto type = pressed ? hotcakey::EventType::kKeyDown
+                        : hotcakey::EventType::kKeyUp;
+    auto modifiers = matcher.Modifiers();
+
+    for (auto& stream : streams) {
+      if (!stream.filter.Matches(event.code, modifiers, type)) continue;
+
+      LOG("callback stream listener with " << hotcakey::ToString(type));
+      Notify(stream.registration,
+             Traced(hotcakey::Event(type, std::time(nullptr),
+                                    ToCodeName(event.code)),
+                    id),
+             event.code);
+    }
+  }
+
+  RetireListeners();
+
+  if (!isGrabbed) return true;
+
+  // the keyup goes where the keydown went
+  if (pressed && isConsumed) consumed.Set(event.code);
+  if (pressed) return !isConsumed;
+
+  auto wasConsumed = consumed.Test(event.code);
+  consumed.Reset(event.code);
+
+  return !wasConsumed;
+}
+
+// NOTICE: must be called with `mutex` held
+bool IsGrabbed(int fd) {
+  auto it = devices.find(fd);
+  return it != devices.end() && it->second.isGrabbed;
+}
+
+// dispatches what combos let go on, and arms the timer for the keys they
+// hold back
+//
+// NOTICE: must be called with `mutex` held
+void RunComboOutputs() {
+  for (auto& output : comboOutputs) {
+    auto& input = output.input;
+    auto type = input.pressed ? hotcakey::kKeyDown : hotcakey::kKeyUp;
+
+    if (output.registration != 0) {
+      if (isSuspended.load(std::memory_order_relaxed)) continue;
+
+      LOG("callback combo listener with " << hotcakey::ToString(type));
+      Notify(output.registration, hotcakey::Event(type, std::time(nullptr)),
+             input.code);
+      continue;
+    }
+
+    // held back keys keep the time they were pressed
+    input_event event{};
+    event.input_event_sec = input.time / 1000000000;
+    event.input_event_usec = input.time % 1000000000 / 1000;
+    event.type = EV_KEY;
+    event.code = input.code;
+    event.value = input.pressed ? 1 : 0;
+
+    auto isGrabbed = IsGrabbed(input.source);
+    if (MatchKeyEvent(event, input.source, isGrabbed) && isGrabbed) {
+      PassLater(event);
+    }
+  }
+
+  comboOutputs.clear();
+  RetireListeners();
+
+  auto deadline = combos.Deadline();
+  if (deadline == armedDeadline) return;
+
+  // zero disarms the timer
+  itimerspec spec{};
+  spec.it_value.tv_sec = static_cast<time_t>(deadline / 1000000000);
+  spec.it_value.tv_nsec = static_cast<long>(deadline % 1000000000);
+  timerfd_settime(comboTimerFd, TFD_TIMER_ABSTIME, &spec, nullptr);
+
+  armedDeadline = deadline;
+}
+
+// remaps a key event, and lets it through combos to the matcher. what
+// goes on to other applications is passed with `PassLater`.
+void HandleKeyEvent(input_event& event, int fd, bool isGrabbed) {
+  if (event.type != EV_KEY || event.code >= hotcakey::kKeyCodeCount) {
+    if (isGrabbed) PassLater(event);
+    return;
+  }
+
+  if (isGrabbed) {
+    auto remap = remaps[event.code].load(std::memory_order_relaxed);
+    if (remap != 0) event.code = remap - 1;
+  }
+
+  std::lock_guard<std::mutex> lock(mutex);
+
+  // value 2 means auto repeat. both macOS and windows backends
+  // do not report repeated keydown, so do we.
+  if (event.value == 2) {
+    if (isGrabbed && !consumed.Test(event.code) &&
+        !combos.Holds(event.code)) {
+      PassLater(event);
+    }
+    return;
+  }
+
+  if (combos.IsEmpty() && combos.Deadline() == 0) {
+    if (MatchKeyEvent(event, fd, isGrabbed) && isGrabbed) PassLater(event);
+    return;
+  }
+
+  combos.Feed({event.code, event.value == 1, ReceivedAt(event), fd},
+              comboOutputs);
+  RunComboOutputs();
+}
+
+void HandleComboTimer() {
+  std::uint64_t expirations;
+  if (read(comboTimerFd, &expirations, sizeof(expirations)) < 0) return;
+
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    armedDeadline = 0;
+    combos.Expire(hotcakey::ring::Now(), comboOutputs);
+    RunComboOutputs();
+  }  // lock(mutex)
+
+  FlushPassing();
+}
+
+void HandleDevice(int fd) {
+  input_event events[64];
+  auto isGrabbed = false;
+
+  if (isGrabbing) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = devices.find(fd);
+    isGrabbed = it != devices.end() && it->second.isGrabbed;
+  }  // lock(mutex)
+
+  while (true) {
+    auto size = read(fd, events, sizeof(events));
+
+    if (size < 0 && errno == EINTR) continue;
+    if (size < 0 && errno == EAGAIN) return;
+
+    // the device is gone (e.g. unplugged). a synthetic device reaches
+    // the end when it is removed.
+    if (size <= 0) {
+      if (size < 0) WRN("stop watching device: " << std::strerror(errno));
+
+      std::lock_guard<std::mutex> lock(mutex);
+
+      // the one synthetic device of `synthetic::Emit` never ends
+      if (devices.count(fd) == 0) return;
+
+      CloseDevice(fd);
+      return;
+    }
+
+    auto count = static_cast<std::size_t>(size) / sizeof(input_event);
+
+    for (std::size_t i = 0; i < count; i++) {
+      HandleKeyEvent(events[i], fd, isGrabbed);
+    }
+
+    // what goes on is written at once
+    FlushPassing();
+  }
+}
+
+void HandleHotplug() {
+  alignas(inotify_event) char buffer[4096];
+
+  while (true) {
+    auto length = read(hotplugFd, buffer, sizeof(buffer));
+
+    if (length < 0 && errno == EINTR) continue;
+    if (length <= 0) return;
+
+    for (auto p = buffer; p < buffer + length;) {
+      auto event = reinterpret_cast<const inotify_event*>(p);
+      p += sizeof(inotify_event) + event->len;
+
+      if (event->len == 0 || std::strncmp(event->name, "event", 5) != 0) {
+        continue;
+      }
+
+      auto path = std::string("/dev/input/") + event->name;
+
+      if ((event->mask & IN_DELETE) == 0) {
+        OpenDevice(path);
+        continue;
+      }
+
+      // usually read fails first, and the device is already closed
+      std::lock_guard<std::mutex> lock(mutex);
+      for (auto& [fd, device] : devices) {
+        if (device.info.path == path) {
+          CloseDevice(fd);
+          break;
+        }
+      }
+    }
+  }
+}
+
+void RunDeviceLoop() {
+  epoll_event events[16];
+
+  while (isActive.load(std::memory_order_acquire)) {
+    auto count = epoll_wait(epollFd, events, 16, -1);
+
+    if (count < 0) {
+      if (errno == EINTR) continue;
+      ERR("failed to wait input events: " << std::strerror(errno));
+      break;
+    }
+
+    for (int i = 0; i < count; i++) {
+      // left readable, `isActive` is already false
+      if (events[i].data.fd == wakeFd) continue;
+
+      if (events[i].data.fd == hotplugFd) {
+        HandleHotplug();
+      } else if (events[i].data.fd == comboTimerFd) {
+        HandleComboTimer();
+      } else {
+        HandleDevice(events[i].data.fd);
+      }
+    }
+  }
+}
+
+// the active layer shadows the base layer like `hotcakey::Matcher` does
+//
+// NOTICE: must be called with `mutex` held
+hotcakey::Layer ShadowingLayer(
+    const std::vector<hotcakey::Registration>& registrations) {
+  auto active = matcher.ActiveLayer();
+
+  if (active == hotcakey::kBaseLayer) return active;
+
+  for (auto registration : registrations) {
+    auto listener = listeners.Find(registration);
+    if (listener->layer == active && !listener->isRetired) return active;
+  }
+
+  return hotcakey::kBaseLayer;
+}
+
+void RunDaemonLoop() {
+  auto reader = daemonClient.Events();
+  hotcakey::ring::Record record;
+
+  while (isActive.load(std::memory_order_acquire)) {
+    reader->Wait(std::chrono::milliseconds(100));
+
+    while (reader->Read(record)) {
+      std::lock_guard<std::mutex> lock(mutex);
+
+      auto handle = daemonHandles.find(record.registration);
+
+      // unregistered while the event was in flight
+      if (handle == daemonHandles.end()) continue;
+
+      auto chord = daemonChords.Find(handle->second);
+
+      if (Swallow(record.code, record.type == hotcakey::kKeyDown)) continue;
+
+      auto layer = hotcakey::kBaseLayer;
+
+      if (record.type == hotcakey::kKeyDown) {
+        layer = ShadowingLayer(chord->registrations);
+        daemonFired[handle->second] = layer;
+      } else if (daemonFired.count(handle->second) != 0) {
+        layer = daemonFired[handle->second];
+        daemonFired.erase(handle->second);
+      }
+
+      // received when hotcakeyd read it from the device
+      auto id = hotcakey::trace::NextId();
+      if (id != 0) {
+        hotcakey::trace::Record(hotcakey::trace::kReceived, id,
+                                record.timestamp);
+        hotcakey::trace::Record(hotcakey::trace::kHandled, id);
+      }
+
+      // every listener of the chord shares the registration of hotcakeyd
+      for (auto registration : chord->registrations) {
+        if (listeners.Find(registration)->layer != layer) continue;
+
+        Notify(registration,
+               Traced(hotcakey::Event(record.type, std::time(nullptr)), id),
+               record.code);
+      }
+
+      RetireListeners();
+    }
+  }
+}
+
+// registrations made before activation
+//
+// NOTICE: must be called with `mutex` held
+void ForwardRegistrations() {
+  listeners.ForEach([](auto registration, const Listener& listener) {
+    // attached when its snapshot is restored
+    if (listener.snapshot != 0) return;
+
+    if (listener.stream) {
+      WRN("key event stream is not available through hotcakeyd");
+      return;
+    }
+
+    if (listener.device) {
+      WRN("device hotkeys are not available through hotcakeyd");
+      return;
+    }
+
+    if (listener.combo) {
+      WRN("combos are not available through hotcakeyd");
+      return;
+    }
+
+    if (!ForwardChord(listener.chord, registration)) {
+      ERR("failed to forward hotkey with id: " << registration);
+    }
+  });
+}
+
+}  // namespace
+
+namespace hotcakey {
+
+Result Activate(const ActivationOption& option) {
+  LOG("try to activate hotcakey");
+
+  // a listener is running, so it is active
+  if (isInputThread) return Result::kSuccess;
+
+  std::lock_guard<std::mutex> serialized(lifecycle);
+
+  if (isActive.load(std::memory_order_acquire)) {
+    LOG("already activated");
+    return Result::kSuccess;
+  }
+
+  epollFd = epoll_create1(EPOLL_CLOEXEC);
+
+  if (epollFd < 0) {
+    ERR("failed to create epoll instance: " << std::strerror(errno));
+    return Result::kFailure;
+  }
+
+  auto isConnected = false;
+
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    SetupModifierKeys();
+
+    // registrations racing with activation go either to hotcakeyd or to
+    // the matcher, never to both
+    isConnected =
+        daemon::IsEnabled() && daemonClient.Connect(daemon::SocketPath());
+
+    if (isConnected) {
+      LOG("use hotcakeyd instead of reading devices");
+      ForwardRegistrations();
+    }
+  }  // lock(mutex)
+
+  if (isConnected && option.grab) {
+    WRN("grabbing devices is not available through hotcakeyd");
+  }
+
+  if (!isConnected) {
+    if (!OpenWakeup() || !OpenSyntheticDevice() || !OpenComboTimer()) {
+      CloseDevices();
+      return Result::kFailure;
+    }
+
+    // never grab without a way to pass the keys on
+    if (option.grab) isGrabbing = OpenPassthrough();
+
+    OpenDevices();
+  }
+
+  {
+    std::unique_lock<std::mutex> lock(mutex);
+
+    nativeThread = std::thread([option] {
+      LOG("native thread started");
+
+      isInputThread = true;
+      trace::SetThreadName("hotcakey input");
+
+      auto report = scheduling::Apply(option);
+
+      report.grab = isGrabbing;
+      if (option.grab && !isGrabbing) {
+        report.warnings.push_back("devices are not grabbed");
+      }
+
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        activationReport = report;
+        isActive.store(true, std::memory_order_release);
+      }
+
+      cond.notify_one();
+
+      LOG("start event loop");
+
+      if (daemonClient.IsConnected()) {
+        RunDaemonLoop();
+      } else {
+        RunDeviceLoop();
+      }
+
+      scheduling::Release(report);
+
+      LOG("event loop stopped");
+    });
+
+    cond.wait(lock, [] { return isActive.load(std::memory_order_acquire); });
+  }  // lock(mutex)
+
+  LOG("event loop thread successfully started");
+
+  return Result::kSuccess;
+}
+
+ActivationReport GetActivationReport() {
+  std::lock_guard<std::mutex> lock(mutex);
+  return activationReport;
+}
+
+Result Inactivate() {
+  LOG("deactivate hotcakey");
+
+  if (isInputThread) {
+    ERR("cannot inactivate from a listener");
+    return kFailure;
+  }
+
+  std::lock_guard<std::mutex> serialized(lifecycle);
+
+  if (!isActive.load(std::memory_order_acquire)) {
+    LOG("do nothing since already inactive");
+    return kSuccess;
+  }
+
+  LOG("unregister all event listeners");
+
+  decltype(followers) stopping;
+  decltype(watches) unwatching;
+
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    stopping.swap(followers);
+    unwatching.swap(watches);
+
+    // the bindings go with the rest of the listeners below
+    for (auto& [key, watch] : unwatching) {
+      watch->bound.clear();
+      StopKeymapWatch(*watch);
+    }
+
+    retired.clear();
+    listeners.Clear();
+    snapshots.clear();
+    swallowed.Clear();
+    isSuspended.store(false, std::memory_order_relaxed);
+    daemonChords.Clear();
+    daemonHandles.clear();
+    daemonFired.clear();
+    streams.clear();
+    matcher.Clear();
+    matcher.ResetState();
+    combos.Clear();
+    PublishKeyState();
+
+    for (auto& remap : remaps) remap.store(0, std::memory_order_relaxed);
+  }  // lock(mutex)
+
+  for (auto& [key, follower] : stopping) StopFollower(std::move(follower));
+  for (auto& [key, watch] : unwatching) JoinKeymapWatch(watch);
+
+  isActive.store(false, std::memory_order_release);
+
+  if (daemonClient.IsConnected()) {
+    daemonClient.Events()->Wake();
+  } else {
+    Wake();
+  }
+
+  LOG("try to join event loop thread");
+
+  nativeThread.join();
+
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    // hotcakeyd drops our registrations when the connection is closed
+    daemonClient.Close();
+    CloseDevices();
+  }  // lock(mutex)
+
+  LOG("successfully shutdown");
+
+  return kSuccess;
+}
+
+namespace {
+
+RegistrationResult RegisterChord(
+    const std::vector<std::string>& keys, const std::string& layer,
+    std::unique_ptr<hotcakey::Executor> executor,
+    std::unique_ptr<DeviceFilter> device, bool consume,
+    const Callback& listener) {
+  LOG("register hotkey");
+
+  auto key = ToLinuxKey(keys);
+  auto modifier = ToLinuxModifiers(keys);
+
+  if (key == UINT32_MAX) {
+    ERR("cannot find a key code for keys: " << utils::Join(keys, ", "));
+    return {kFailure, -1};
+  }
+
+  LOG("key: " << key);
+  LOG("modifier: " << modifier);
+
+  if (isInputThread) {
+    ERR("cannot register a hotkey from a listener");
+    return {kFailure, -1};
+  }
+
+  Chord chord{static_cast<KeyCode>(key), static_cast<std::uint8_t>(modifier)};
+
+  std::lock_guard<std::mutex> lock(mutex);
+
+  auto id = listeners.Insert(Listener{
+      .callback = listener,
+      .chord = chord,
+      .stream = false,
+      .executor = std::move(executor),
+      .layer = ToLayer(layer),
+      .device = std::move(device),
+      .consume = consume,
+  });
+
+  if (!AttachChord(*listeners.Find(id), id)) {
+    ERR("failed to register hotkey");
+    listeners.Erase(id);
+    return {kFailure, -1};
+  }
+
+  LOG("hotkey registered with id: " << id);
+
+  return {kSuccess, id};
+}
+
+}  // namespace
+
+RegistrationResult Register(const std::vector<std::string>& keys,
+                            const Callback& listener) {
+  return RegisterChord(keys, "", nullptr, nullptr, false, listener);
+}
+
+RegistrationResult Register(const std::vector<std::string>& keys,
+                            const Action& action, const Callback& listener) {
+  auto executor = Executor::Prepare(action);
+
+  if (!executor) {
+    ERR("failed to prepare native action");
+    return {kFailure, -1};
+  }
+
+  return RegisterChord(keys, "", std::move(executor), nullptr, false,
+                       listener);
+}
+
+RegistrationResult RegisterInLayer(const std::string& layer,
+                                   const std::vector<std::string>& keys,
+                                   const Callback& listener) {
+  return RegisterChord(keys, layer, nullptr, nullptr, false, listener);
+}
+
+RegistrationResult Register(const std::vector<std::string>& keys,
+                            const HotkeyOption& option,
+                            const Callback& listener) {
+  std::unique_ptr<DeviceFilter> device;
+  if (option.device) device.reset(new DeviceFilter(*option.device));
+
+  return RegisterChord(keys, option.layer, nullptr, std::move(device),
+                       option.consume.value_or(false), listener);
+}
+
+std::vector<Device> Devices() {
+  std::lock_guard<std::mutex> lock(mutex);
+
+  std::vector<Device> found;
+  for (auto& [fd, device] : devices) found.push_back(device.info);
+
+  std::sort(found.begin(), found.end(), [](auto& a, auto& b) {
+    return a.path < b.path;
+  });
+
+  return found;
+}
+
+Result SetConsume(Registration registration, bool consume) {
+  std::unique_lock<std::mutex> lock(mutex, std::defer_lock);
+  if (!isInputThread) lock.lock();
+
+  auto listener = listeners.Find(registration);
+
+  if (listener == nullptr || listener->stream) {
+    ERR("no hotkey with id: " << registration);
+    return kFailure;
+  }
+
+  listener->consume = consume;
+
+  return kSuccess;
+}
+
+Result Remap(const std::string& from, const std::string& to) {
+  auto source = MapLinuxPhysicalKey(from);
+  auto target = to.empty() ? source : MapLinuxPhysicalKey(to);
+
+  if (source >= kKeyCodeCount || target >= kKeyCodeCount) {
+    ERR("cannot remap " << from << " to " << to);
+    return kFailure;
+  }
+
+  remaps[source].store(target == source ? 0 : target + 1,
+                       std::memory_order_relaxed);
+
+  LOG("remap " << from << " to " << (to.empty() ? from : to));
+
+  return kSuccess;
+}
+
+RegistrationResult RegisterOnDevice(const DeviceFilter& device,
+                                    const std::vector<std::string>& keys,
+                                    const Callback& listener) {
+  return RegisterChord(keys, "", nullptr,
+                       std::unique_ptr<DeviceFilter>(new DeviceFilter(device)),
+                       false, listener);
+}
+
+RegistrationResult RegisterCombo(const std::vector<std::string>& keys,
+                                 const ComboOption& option,
+                                 const Callback& listener) {
+  LOG("register combo");
+
+  if (isInputThread) {
+    ERR("cannot register a combo from a listener");
+    return {kFailure, -1};
+  }
+
+  auto combo = std::make_unique<Combo>();
+  combo->window = option.window;
+  combo->key = kNoKeyCode;
+
+  for (auto& key : keys) {
+    auto code = MapLinuxPhysicalKey(key);
+
+    if (code >= kKeyCodeCount || IsModifierKey(code)) {
+      ERR("cannot use key in a combo: " << key);
+      return {kFailure, -1};
+    }
+
+    combo->keys.Set(code);
+  }
+
+  if (!option.key.empty()) {
+    auto code = MapLinuxPhysicalKey(option.key);
+
+    if (code >= kKeyCodeCount) {
+      ERR("cannot find a key code for key: " << option.key);
+      return {kFailure, -1};
+    }
+
+    combo->key = code;
+  }
+
+  std::lock_guard<std::mutex> lock(mutex);
+
+  auto id = listeners.Insert(Listener{
+      .callback = listener,
+      .chord = {},
+      .stream = false,
+      .executor = nullptr,
+      .combo = std::move(combo),
+  });
+
+  if (!AttachChord(*listeners.Find(id), id)) {
+    ERR("failed to register combo of keys: " << utils::Join(keys, ", "));
+    listeners.Erase(id);
+    return {kFailure, -1};
+  }
+
+  LOG("combo registered with id: " << id);
+
+  return {kSuccess, id};
+}
+
+Result SwitchLayer(const std::string& layer) {
+  // a listener switching modes. `mutex` is already held by the dispatch,
+  // and the matcher hands out the registrations of the previous layer
+  // until the next key event.
+  if (isInputThread) {
+    matcher.SetLayer(ToLayer(layer));
+    return kSuccess;
+  }
+
+  std::lock_guard<std::mutex> lock(mutex);
+  matcher.SetLayer(ToLayer(layer));
+
+  LOG("layer switched to: " << layer);
+
+  return kSuccess;
+}
+
+std::string ActiveLayer() {
+  if (isInputThread) return layerNames[matcher.ActiveLayer()];
+
+  std::lock_guard<std::mutex> lock(mutex);
+  return layerNames[matcher.ActiveLayer()];
+}
+
+Result RegisterKeymap(const std::string& path, const KeymapListener& listener,
+                      std::vector<Registration>& registrations) {
+  registrations.clear();
+
+  if (isInputThread) {
+    ERR("cannot register a keymap from a listener");
+    return kFailure;
+  }
+
+  auto reader = keymap::Reader::Open(path);
+
+  if (!reader) {
+    return kFailure;
+  }
+
+  LOG("register " << reader->Size() << " hotkeys of keymap: " << path);
+
+  registrations.reserve(reader->Size());
+
+  std::lock_guard<std::mutex> lock(mutex);
+
+  // names are resolved once per layer, not once per binding
+  std::vector<Layer> layerOf;
+  for (std::size_t i = 0; i < reader->LayerCount(); i++) {
+    layerOf.push_back(ToLayer(reader->LayerName(i)));
+  }
+
+  for (std::size_t i = 0; i < reader->Size(); i++) {
+    auto& binding = (*reader)[i];
+
+    auto id = listeners.Insert(Listener{
+        .callback = listener(i),
+        .chord = {binding.key, binding.modifiers},
+        .stream = false,
+        .executor = nullptr,
+        .layer = layerOf[binding.layer],
+    });
+
+    if (!AttachChord(*listeners.Find(id), id)) {
+      ERR("failed to register hotkey " << i << " of keymap");
+      listeners.Erase(id);
+
+      for (auto registration : registrations) RemoveListener(registration);
+      registrations.clear();
+
+      return kFailure;
+    }
+
+    registrations.push_back(id);
+  }
+
+  LOG("keymap registered");
+
+  return kSuccess;
+}
+
+RegistrationResult WatchKeymap(const std::string& path,
+                               const ActionListener& listener) {
+  if (isInputThread) {
+    ERR("cannot watch a keymap from a listener");
+    return {kFailure, -1};
+  }
+
+  auto watch = std::make_shared<KeymapWatch>();
+  watch->path = path;
+  watch->listener = listener;
+
+  // editors and `keymap::Write` replace the file by a rename, which only
+  // shows up in the directory
+  auto slash = path.rfind('/');
+  auto directory = slash == std::string::npos ? std::string(".")
+                   : slash == 0               ? std::string("/")
+                                              : path.substr(0, slash);
+  auto name = slash == std::string::npos ? path : path.substr(slash + 1);
+
+  watch->inotifyFd = inotify_init1(IN_CLOEXEC | IN_NONBLOCK);
+  watch->wakeFd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+
+  if (watch->inotifyFd < 0 || watch->wakeFd < 0 ||
+      inotify_add_watch(watch->inotifyFd, directory.c_str(),
+                        IN_CLOSE_WRITE | IN_MOVED_TO) < 0) {
+    ERR("failed to watch keymap " << path << ": " << std::strerror(errno));
+    return {kFailure, -1};
+  }
+
+  std::lock_guard<std::mutex> lock(mutex);
+
+  if (!ApplyKeymap(*watch)) {
+    return {kFailure, -1};
+  }
+
+  auto id = listeners.Reserve();
+  watches[id] = watch;
+
+  // the thread takes the lock before applying anything
+  watch->thread = std::thread(RunKeymapWatch, watch, name);
+
+  LOG("keymap " << path << " watched with id: " << id);
+
+  return {kSuccess, id};
+}
+
+RegistrationResult Subscribe(const Filter& filter, const Callback& listener) {
+  LOG("subscribe key event stream");
+
+  if (isInputThread) {
+    ERR("cannot subscribe a stream from a listener");
+    return {kFailure, -1};
+  }
+
+  CompiledFilter compiled;
+
+  if (!CompileFilter(filter, compiled)) {
+    return {kFailure, -1};
+  }
+
+  std::lock_guard<std::mutex> lock(mutex);
+
+  if (daemonClient.IsConnected()) {
+    ERR("key event stream is not available through hotcakeyd");
+    return {kFailure, -1};
+  }
+
+  auto id = listeners.Insert(Listener{
+      .callback = listener,
+      .chord = {},
+      .stream = true,
+      .executor = nullptr,
+  });
+
+  streams.push_back({id, compiled});
+
+  LOG("stream subscribed with id: " << id);
+
+  return {kSuccess, id};
+}
+
+Result Unregister(const Registration& registration) {
+  // a listener unregistering itself or another one. `mutex` is already
+  // held by the dispatch, which removes it afterward.
+  if (isInputThread) {
+    auto listener = listeners.Find(registration);
+
+    if (listener != nullptr && !listener->isRetired) {
+      listener->isRetired = true;
+      retired.push_back(registration);
+    }
+
+    if (followers.count(registration) != 0) {
+      auto follower = std::move(followers.at(registration));
+      followers.erase(registration);
+      StopFollower(std::move(follower));
+    }
+
+    if (watches.count(registration) != 0) {
+      auto watch = watches.at(registration);
+      watches.erase(registration);
+      StopKeymapWatch(*watch);
+      JoinKeymapWatch(watch);
+    }
+
+    return kSuccess;
+  }
+
+  std::unique_lock<std::mutex> lock(mutex);
+
+  if (watches.count(registration) != 0) {
+    auto watch = watches.at(registration);
+    watches.erase(registration);
+    StopKeymapWatch(*watch);
+    lock.unlock();
+
+    JoinKeymapWatch(watch);
+
+    LOG("keymap watch unregistered");
+
+    return kSuccess;
+  }
+
+  if (followers.count(registration) != 0) {
+    auto follower = std::move(followers.at(registration));
+    followers.erase(registration);
+    lock.unlock();
+
+    // the reader thread does not take the lock, but joining it while
+    // holding the lock would stall the input thread for no reason
+    StopFollower(std::move(follower));
+
+    LOG("ring follower unregistered");
+
+    return kSuccess;
+  }
+
+  if (listeners.Find(registration) == nullptr) {
+    return kSuccess;
+  }
+
+  RemoveListener(registration);
+
+  LOG("hotkey unregistered");
+
+  return kSuccess;
+}
+
+Result Suspend() {
+  if (isInputThread) {
+    ERR("cannot suspend from a listener");
+    return kFailure;
+  }
+
+  std::lock_guard<std::mutex> lock(mutex);
+  isSuspended.store(true, std::memory_order_relaxed);
+
+  LOG("dispatch suspended");
+
+  return kSuccess;
+}
+
+Result Resume() {
+  if (isInputThread) {
+    ERR("cannot resume from a listener");
+    return kFailure;
+  }
+
+  std::lock_guard<std::mutex> lock(mutex);
+  isSuspended.store(false, std::memory_order_relaxed);
+
+  LOG("dispatch resumed");
+
+  return kSuccess;
+}
+
+bool IsSuspended() { return isSuspended.load(std::memory_order_relaxed); }
+
+SnapshotResult TakeSnapshot() {
+  if (isInputThread) {
+    ERR("cannot take a snapshot from a listener");
+    return {kFailure, 0};
+  }
+
+  std::lock_guard<std::mutex> lock(mutex);
+
+  auto id = ++snapshotSequence;
+  auto& stash = snapshots[id];
+
+  listeners.ForEach([id, &stash](auto registration, Listener& listener) {
+    if (listener.snapshot != 0) return;
+
+    listener.snapshot = id;
+
+    if (listener.stream) return;
+
+    DetachChord(listener, registration);
+    stash.chords.push_back(registration);
+  });
+
+  // filters are compiled already, so streams are kept as they are
+  stash.streams.swap(streams);
+
+  LOG("snapshot " << id << " taken with " << stash.chords.size()
+                  << " hotkeys and " << stash.streams.size() << " streams");
+
+  return {kSuccess, id};
+}
+
+Result Restore(Snapshot snapshot) {
+  if (isInputThread) {
+    ERR("cannot restore a snapshot from a listener");
+    return kFailure;
+  }
+
+  std::lock_guard<std::mutex> lock(mutex);
+
+  auto it = snapshots.find(snapshot);
+
+  if (it == snapshots.end()) {
+    ERR("unknown snapshot: " << snapshot);
+    return kFailure;
+  }
+
+  auto& stash = it->second;
+  std::vector<Registration> failed;
+
+  // a hotkey which cannot be attached stays detached in the snapshot
+  for (auto registration : stash.chords) {
+    auto listener = listeners.Find(registration);
+
+    if (!AttachChord(*listener, registration)) {
+      ERR("failed to restore hotkey with id: " << registration);
+      failed.push_back(registration);
+      continue;
+    }
+
+    listener->snapshot = 0;
+  }
+
+  for (auto& stream : stash.streams) {
+    listeners.Find(stream.registration)->snapshot = 0;
+    streams.push_back(std::move(stream));
+  }
+  stash.streams.clear();
+
+  if (!failed.empty()) {
+    stash.chords.swap(failed);
+    WRN("snapshot " << snapshot << " keeps " << stash.chords.size()
+                    << " hotkeys which failed to restore");
+    return kFailure;
+  }
+
+  snapshots.erase(it);
+
+  LOG("snapshot " << snapshot << " restored");
+
+  return kSuccess;
+}
+
+Result AttachKeyState(std::uint32_t* words, std::size_t length) {
+  if (words == nullptr || length < kKeyStateWords) {
+    ERR("key state view needs " << kKeyStateWords << " words");
+    return kFailure;
+  }
+
+  std::lock_guard<std::mutex> lock(mutex);
+
+  keyState = reinterpret_cast<std::atomic<std::uint32_t>*>(words);
+  keyState[0].store(0, std::memory_order_relaxed);
+  PublishKeyState();
+
+  LOG("key state view attached");
+
+  return kSuccess;
+}
+
+Result DetachKeyState() {
+  std::lock_guard<std::mutex> lock(mutex);
+  keyState = nullptr;
+
+  LOG("key state view detached");
+
+  return kSuccess;
+}
+
+std::vector<unsigned int> KeyStateIndexes(const std::string& key) {
+  KeyBitset keys;
+  if (!AddFilterKey(keys, key)) return {};
+
+  std::vector<unsigned int> indexes;
+  for (unsigned int code = 0; code < kKeyCodeCount; code++) {
+    if (keys.Test(code)) indexes.push_back(code);
+  }
+
+  return indexes;
+}
+
+Result Publish(const std::string& name, std::size_t capacity) {
+  auto writer = ring::Writer::Create(name, capacity);
+
+  if (!writer) {
+    return kFailure;
+  }
+
+  std::lock_guard<std::mutex> lock(mutex);
+  publisher = std::move(writer);
+
+  LOG("start publishing events to ring: " << name);
+
+  return kSuccess;
+}
+
+Result Unpublish() {
+  std::lock_guard<std::mutex> lock(mutex);
+  publisher.reset();
+
+  LOG("stop publishing events");
+
+  return kSuccess;
+}
+
+RegistrationResult Follow(const std::string& name, const Callback& listener) {
+  if (isInputThread) {
+    ERR("cannot follow a ring from a listener");
+    return {kFailure, -1};
+  }
+
+  auto reader = ring::Reader::Open(name);
+
+  if (!reader) {
+    return {kFailure, -1};
+  }
+
+  auto follower = std::make_unique<Follower>();
+  follower->reader = std::move(reader);
+  follower->isActive.store(true, std::memory_order_release);
+
+  auto raw = follower.get();
+  follower->thread = std::thread([raw, listener] {
+    LOG("ring follower thread started");
+
+    ring::Record record;
+
+    while (raw->isActive.load(std::memory_order_acquire)) {
+      raw->reader->Wait(std::chrono::milliseconds(100));
+
+      // stops right away if the listener unregistered the follower
+      while (raw->isActive.load(std::memory_order_acquire) &&
+             raw->reader->Read(record)) {
+        listener(hotcakey::Event(record.type, std::time(nullptr),
+                                 ToCodeName(record.code),
+                                 record.registration));
+      }
+    }
+
+    LOG("ring follower thread stopped");
+  });
+
+  std::lock_guard<std::mutex> lock(mutex);
+
+  auto id = listeners.Reserve();
+  followers[id] = std::move(follower);
+
+  LOG("ring " << name << " followed with id: " << id);
+
+  return {kSuccess, id};
+}
+
+Result StartRecording(const std::string& path) {
+  auto writer = recording::Writer::Create(path);
+
+  if (!writer) {
+    return kFailure;
+  }
+
+  std::lock_guard<std::mutex> lock(mutex);
+  recorder = std::move(writer);
+
+  LOG("start recording key events to: " << path);
+
+  return kSuccess;
+}
+
+Result StopRecording() {
+  std::lock_guard<std::mutex> lock(mutex);
+  recorder.reset();
+
+  LOG("stop recording key events");
+
+  return kSuccess;
+}
+
+Result Replay(const std::string& path, ReplayPace pace, ReplayReport& report) {
+  report = {};
+
+  if (isInputThread) {
+    ERR("cannot replay from a listener");
+    return kFailure;
+  }
+
+  auto reader = recording::Reader::Open(path);
+
+  if (!reader) {
+    return kFailure;
+  }
+
+  LOG("replay " << reader->Size() << " key events from: " << path);
+
+  auto start = ring::Now();
+
+  for (std::size_t i = 0; i < reader->Size(); i++) {
+    auto& record = (*reader)[i];
+
+    if (pace == kReplayOriginal) {
+      auto at = start + (record.timestamp - (*reader)[0].timestamp);
+      timespec ts{static_cast<time_t>(at / 1000000000),
+                  static_cast<long>(at % 1000000000)};
+      while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, nullptr) ==
+             EINTR) {
+      }
+    }
+
+    input_event event{};
+    event.type = EV_KEY;
+    event.code = record.code;
+    event.value = record.type == kKeyDown ? 1 : 0;
+
+    std::lock_guard<std::mutex> serialized(lifecycle);
+
+    if (!isActive.load(std::memory_order_acquire)) {
+      ERR("cannot replay while inactive");
+      return kFailure;
+    }
+
+    if (daemonClient.IsConnected()) {
+      ERR("cannot replay through hotcakeyd");
+      return kFailure;
+    }
+
+    if (!WriteSynthetic(syntheticFds[1], event)) {
+      return kFailure;
+    }
+
+    report.events++;
+    report.matches += record.matches;
+  }
+
+  report.elapsed = ring::Now() - start;
+
+  return kSuccess;
+}
+
+Result Inject(const std::vector<InjectedEvent>& events,
+              const InjectOption& option, InjectReport& report) {
+  report = {};
+
+  if (isInputThread) {
+    ERR("cannot inject from a listener");
+    return kFailure;
+  }
+
+  // a SYN_REPORT after every key, so each is a frame of its own
+  std::vector<input_event> frames(events.size() * 2);
+
+  for (std::size_t i = 0; i < events.size(); i++) {
+    auto code = MapLinuxPhysicalKey(events[i].key);
+
+    if (code == UINT32_MAX) {
+      ERR("cannot find a key code for key: " << events[i].key);
+      return kFailure;
+    }
+
+    if (i > 0 && events[i].at < events[i - 1].at) {
+      ERR("injected events must be in order of time");
+      return kFailure;
+    }
+
+    frames[i * 2].type = EV_KEY;
+    frames[i * 2].code = code;
+    frames[i * 2].value = events[i].type == kKeyDown ? 1 : 0;
+    frames[i * 2 + 1].type = EV_SYN;
+    frames[i * 2 + 1].code = SYN_REPORT;
+  }
+
+  std::lock_guard<std::mutex> serialized(injection);
+
+  if (option.target == kInjectUinput && injectorFd < 0) {
+    injectorFd = CreateKeyboard(kInjectorName);
+
+    if (injectorFd < 0) {
+      return kFailure;
+    }
+
+    WaitForNode(injectorFd);
+  }
+
+  auto timer = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC);
+
+  if (timer < 0) {
+    ERR("failed to create timer: " << std::strerror(errno));
+    return kFailure;
+  }
+
+  auto isPaced = option.pace == kReplayOriginal;
+  auto start = ring::Now();
+  auto result = kSuccess;
+
+  for (std::size_t i = 0; i < events.size();) {
+    auto due = isPaced ? start + events[i].at : start;
+
+    if (due > ring::Now()) {
+      itimerspec spec{};
+      spec.it_value.tv_sec = static_cast<time_t>(due / 1000000000);
+      spec.it_value.tv_nsec = static_cast<long>(due % 1000000000);
+      timerfd_settime(timer, TFD_TIMER_ABSTIME, &spec, nullptr);
+
+      std::uint64_t expirations;
+      while (read(timer, &expirations, sizeof(expirations)) < 0 &&
+             errno == EINTR) {
+      }
+    }
+
+    auto now = ring::Now();
+    if (isPaced) report.lateness = std::max(report.lateness, now - due);
+
+    // everything due by now goes in one write
+    auto first = i;
+    while (i < events.size() && i - first < kInjectBatch &&
+           (!isPaced || start + events[i].at <= now)) {
+      i++;
+    }
+
+    if (!WriteInjected(option.target, &frames[first * 2], (i - first) * 2)) {
+      result = kFailure;
+      break;
+    }
+
+    report.events += i - first;
+    report.writes++;
+  }
+
+  close(timer);
+  report.elapsed = ring::Now() - start;
+
+  return result;
+}
+
+}  // namespace hotcakey
+
+namespace hotcakey {
+namespace keymap {
+
+bool ToChord(const std::vector<std::string>& keys, Chord& chord) {
+  auto key = ToLinuxKey(keys);
+
+  if (key == UINT32_MAX) {
+    ERR("cannot find a key code for keys: " << utils::Join(keys, ", "));
+    return false;
+  }
+
+  chord = {static_cast<KeyCode>(key),
+           static_cast<std::uint8_t>(ToLinuxModifiers(keys))};
+
+  return true;
+}
+
+}  // namespace keymap
+}  // namespace hotcakey
+
+namespace hotcakey {
+namespace synthetic {
+
+Result Emit(const std::string& key, EventType type) {
+  // the input thread is the one `Inactivate` waits for, so the devices
+  // are open while it runs
+  std::unique_lock<std::mutex> serialized(lifecycle, std::defer_lock);
+  if (!isInputThread) serialized.lock();
+
+  if (!isActive.load(std::memory_order_acquire)) {
+    ERR("cannot emit synthetic event while inactive");
+    return kFailure;
+  }
+
+  if (daemonClient.IsConnected()) {
+    ERR("cannot emit synthetic event through hotcakeyd");
+    return kFailure;
+  }
+
+  auto code = MapLinuxPhysicalKey(key);
+
+  if (code == UINT32_MAX) {
+    ERR("cannot find a key code for key: " << key);
+    return kFailure;
+  }
+
+  input_event event{};
+  event.type = EV_KEY;
+  event.code = code;
+  event.value = type == kKeyDown ? 1 : 0;
+
+  return WriteSynthetic(syntheticFds[1], event) ? kSuccess : kFailure;
+}
+
+DeviceResult AddDevice(const Device& device) {
+  std::lock_guard<std::mutex> serialized(lifecycle);
+
+  if (!isActive.load(std::memory_order_acquire) ||
+      daemonClient.IsConnected()) {
+    ERR("cannot add synthetic device without reading devices");
+    return {kFailure, -1};
+  }
+
+  int fds[2];
+  if (pipe2(fds, O_NONBLOCK | O_CLOEXEC) != 0) {
+    ERR("failed to create synthetic device: " << std::strerror(errno));
+    return {kFailure, -1};
+  }
+
+  if (!WatchDevice(fds[0], InputDevice{device, fds[1], isGrabbing})) {
+    close(fds[0]);
+    close(fds[1]);
+    return {kFailure, -1};
+  }
+
+  return {kSuccess, fds[0]};
+}
+
+Result SetPassthrough(int fd) {
+  std::lock_guard<std::mutex> serialized(lifecycle);
+
+  if (isActive.load(std::memory_order_acquire)) {
+    ERR("cannot change the passthrough while active");
+    return kFailure;
+  }
+
+  passthroughOverride = fd;
+
+  return kSuccess;
+}
+
+Result RemoveDevice(int device) {
+  std::lock_guard<std::mutex> serialized(lifecycle);
+  std::lock_guard<std::mutex> lock(mutex);
+
+  auto it = devices.find(device);
+  if (it == devices.end() || it->second.writer < 0) {
+    ERR("no such synthetic device: " << device);
+    return kFailure;
+  }
+
+  // the input thread reads to the end and closes it like an unplugged one
+  close(it->second.writer);
+  it->second.writer = -1;
+
+  return kSuccess;
+}
+
+Result Emit(int device, const std::string& key, EventType type) {
+  std::unique_lock<std::mutex> serialized(lifecycle, std::defer_lock);
+  if (!isInputThread) serialized.lock();
+
+  auto code = MapLinuxPhysicalKey(key);
+
+  if (code == UINT32_MAX) {
+    ERR("cannot find a key code for key: " << key);
+    return kFailure;
+  }
+
+  int writer = -1;
+
+  {
+    std::unique_lock<std::mutex> lock(mutex, std::defer_lock);
+    if (!isInputThread) lock.lock();
+
+    auto it = devices.find(device);
+    if (it != devices.end()) writer = it->second.writer;
+  }  // lock(mutex)
+
+  if (writer < 0) {
+    ERR("no such synthetic device: " << device);
+    return kFailure;
+  }
+
+  input_event event{};
+  event.type = EV_KEY;
+  event.code = code;
+  event.value = type == kKeyDown ? 1 : 0;
+
+  return WriteSynthetic(writer, event) ? kSuccess : kFailure;
+}
+
+}  // namespace synthetic
+}  // namespace hotcakey
@@ -4,16 +4,21 @@
 #include <carbon/carbon.h>
 #include <pthread.h>
 
+#include <algorithm>
 #include <atomic>
 #include <condition_variable>
 #include <cstdint>
 #include <ctime>
+#include <memory>
 #include <mutex>
 #include <string>
 #include <thread>
 #include <unordered_map>
 #include <vector>
 
+#include "./fanout.h"
+#include "./scheduling.h"
+#include "./trace.h"
 #include "./utils/logger.h"
 #include "./utils/strings.h"
 
@@ -21,8 +26,15 @@ namespace {
 
 struct Listener {
   hotcakey::Registration registration;
-  std::function<void(hotcakey::Event)> callback;
-  EventHotKeyRef eventRef;
+  hotcakey::Callback callback;
+  // see `ToChordKey`
+  UInt32 chord;
+  // unregistered by a listener during the current dispatch
+  bool isRetired = false;
+  // snapshot keeping the listener detached from dispatch, or 0
+  hotcakey::Snapshot snapshot = 0;
+  // "" is the base layer
+  std::string layer;
 };
 
 std::thread nativeThread;
@@ -32,13 +44,180 @@ std::thread nativeThread;
 // we should not repeat to lock and release mutext for performance reason.
 std::atomic<bool> isActive(false);
 
-std::unordered_map<hotcakey::Registration, const Listener*> listeners;
+std::unordered_map<hotcakey::Registration, std::unique_ptr<Listener>>
+    listeners;
+
+// one carbon hotkey per unique chord, since registering the same chord
+// twice fails with a conflict. the chord key is also its hotkey id.
+// the handle is null while suspended or while the listeners of the chord
+// are in inactive layers.
+hotcakey::Fanout<UInt32, EventHotKeyRef> chords;
+
+// see `hotcakey::SwitchLayer`
+std::string activeLayer;
+
+// layer which took the keydown of each chord, to deliver its keyup
+std::unordered_map<UInt32, std::string> firedLayers;
+
+// hotkeys are released to other applications while suspended.
+// see `hotcakey::Suspend`.
+std::atomic<bool> isSuspended(false);
+
+// registrations detached by `hotcakey::TakeSnapshot`
+std::unordered_map<hotcakey::Snapshot, std::vector<hotcakey::Registration>>
+    snapshots;
+hotcakey::Snapshot snapshotSequence = 0;
 
 std::mutex mutex;
 std::condition_variable cond;
 
+// serializes `Activate` and `Inactivate`
+std::mutex lifecycle;
+
+// listeners are called on the event loop thread with `mutex` held,
+// so the api must not take it again there. see `Unregister`.
+thread_local bool isInputThread = false;
+
+// registrations unregistered by listeners during the current dispatch
+std::vector<hotcakey::Registration> retired;
+
+hotcakey::ActivationReport activationReport;
+
+// queue of the event loop thread. `Inactivate` posts a wake event there
+// so that the thread does not have to poll `isActive`.
+EventQueueRef eventQueue = nullptr;
+
+constexpr UInt32 kEventClassHotcakey = 0x6874636b;  // "htck"
+constexpr UInt32 kEventHotcakeyWake = 1;
+
 hotcakey::Registration eventHotKeyIdSequence = 0;
 
+// carbon modifiers are below 0x10000 and virtual keys below 0x80, so a
+// chord fits in the 32 bit id of a hotkey
+UInt32 ToChordKey(UInt32 key, UInt32 modifier) { return modifier << 16 | key; }
+
+// returns nullptr on failure
+EventHotKeyRef RegisterChordHotKey(UInt32 chord) {
+  UInt32 key = chord & 0xFFFF;
+  UInt32 modifier = chord >> 16;
+
+  EventHotKeyID hkeyID;
+  hkeyID.id = chord;
+  hkeyID.signature = key * modifier;
+
+  EventHotKeyRef eventRef = NULL;
+  OSStatus status = RegisterEventHotKey(
+      key, modifier, hkeyID, GetApplicationEventTarget(), 0, &eventRef);
+
+  if (status != noErr) {
+    // -9878 means conflict maybe
+    ERR("failed to register hotkey: " << status);
+    return nullptr;
+  }
+
+  return eventRef;
+}
+
+void UnregisterChordHotKey(EventHotKeyRef eventRef) {
+  auto status = UnregisterEventHotKey(eventRef);
+
+  if (status != noErr) {
+    ERR("failed to unregister hotkey with status: " << status);
+  }
+}
+
+bool IsInActiveLayer(const Listener& listener) {
+  return listener.layer.empty() || listener.layer == activeLayer;
+}
+
+// the active layer shadows the base layer
+//
+// NOTICE: must be called with `mutex` held
+std::string ShadowingLayer(const std::vector<hotcakey::Registration>& chord) {
+  if (activeLayer.empty()) return activeLayer;
+
+  for (auto registration : chord) {
+    auto& listener = listeners.at(registration);
+    if (listener->layer == activeLayer && !listener->isRetired) {
+      return activeLayer;
+    }
+  }
+
+  return "";
+}
+
+// the hotkey of a chord is registered to carbon only while it has a
+// listener in the base or the active layer, so that carbon sees only the
+// chords which actually changed when layers are switched.
+//
+// NOTICE: must be called with `mutex` held
+bool SyncChord(UInt32 chord,
+               hotcakey::Fanout<UInt32, EventHotKeyRef>::Entry& entry) {
+  auto isWanted = !isSuspended.load(std::memory_order_relaxed) &&
+                  std::any_of(entry.registrations.begin(),
+                              entry.registrations.end(), [](auto registration) {
+                                return IsInActiveLayer(
+                                    *listeners.at(registration));
+                              });
+
+  if (isWanted == (entry.handle != nullptr)) return true;
+
+  if (!isWanted) {
+    UnregisterChordHotKey(entry.handle);
+    entry.handle = nullptr;
+    return true;
+  }
+
+  entry.handle = RegisterChordHotKey(chord);
+
+  return entry.handle != nullptr;
+}
+
+// NOTICE: must be called with `mutex` held
+bool AttachListener(const Listener& listener) {
+  chords.Add(listener.chord, listener.registration);
+
+  if (!SyncChord(listener.chord, *chords.Find(listener.chord))) {
+    EventHotKeyRef eventRef = nullptr;
+    chords.Remove(listener.chord, listener.registration, eventRef);
+    return false;
+  }
+
+  return true;
+}
+
+// NOTICE: must be called with `mutex` held
+void DetachListener(const Listener& listener) {
+  EventHotKeyRef eventRef = nullptr;
+
+  if (chords.Remove(listener.chord, listener.registration, eventRef)) {
+    if (eventRef != nullptr) UnregisterChordHotKey(eventRef);
+    return;
+  }
+
+  auto entry = chords.Find(listener.chord);
+  if (entry != nullptr) SyncChord(listener.chord, *entry);
+}
+
+// NOTICE: must be called with `mutex` held
+void RemoveListener(hotcakey::Registration registration) {
+  auto it = listeners.find(registration);
+  if (it == listeners.end()) return;
+
+  auto& listener = *it->second;
+
+  // detached, so it only has to leave its snapshot
+  if (listener.snapshot != 0) {
+    auto& stash = snapshots.at(listener.snapshot);
+    stash.erase(std::remove(stash.begin(), stash.end(), registration),
+                stash.end());
+  } else {
+    DetachListener(listener);
+  }
+
+  listeners.erase(it);
+}
+
 OSStatus HandleKeyEvent(EventHandlerCallRef nextHandler, EventRef event,
                         void* data) {
   LOG("try to handle key event");
@@ -57,25 +236,60 @@ OSStatus HandleKeyEvent(EventHandlerCallRef nextHandler, EventRef event,
     return noErr;
   }
 
+  auto id = hotcakey::trace::NextId();
+  if (id != 0) {
+    // seconds since startup on the mach absolute clock, like steady_clock
+    hotcakey::trace::Record(
+        hotcakey::trace::kReceived, id,
+        static_cast<std::int64_t>(GetEventTime(event) * 1000000000));
+    hotcakey::trace::Record(hotcakey::trace::kHandled, id);
+  }
+
   EventHotKeyID eventHotKeyId;
   GetEventParameter(event, kEventParamDirectObject, typeEventHotKeyID, NULL,
                     sizeof(EventHotKeyID), NULL, &eventHotKeyId);
 
-  auto listener = listeners.at(eventHotKeyId.id);
+  std::lock_guard<std::mutex> lock(mutex);
+
+  auto chord = chords.Find(eventHotKeyId.id);
+
+  // unregistered while the event was in flight
+  if (chord == nullptr) return noErr;
+
+  auto type = kind == kEventHotKeyPressed ? hotcakey::EventType::kKeyDown
+                                          : hotcakey::EventType::kKeyUp;
+
+  hotcakey::Event notified(type, std::time(nullptr));
+  notified.trace = id;
+
+  // keyup goes to the layer which took the keydown
+  std::string layer;
+
+  if (type == hotcakey::kKeyDown) {
+    layer = ShadowingLayer(chord->registrations);
+    firedLayers[eventHotKeyId.id] = layer;
+  } else if (firedLayers.count(eventHotKeyId.id) != 0) {
+    layer = firedLayers[eventHotKeyId.id];
+    firedLayers.erase(eventHotKeyId.id);
+  }
+
+  // every listener of the chord shares the hotkey
+  for (auto registration : chord->registrations) {
+    auto& listener = listeners.at(registration);
+    if (listener->isRetired || listener->layer != layer) continue;
+
+    hotcakey::trace::Record(hotcakey::trace::kMatched, id);
+
+    LOG("callback listener with " << hotcakey::ToString(type));
 
-  switch (GetEventKind(event)) {
-    case kEventHotKeyPressed:
-      LOG("callback listener with keydown");
-      listener->callback(
-          hotcakey::Event(hotcakey::EventType::kKeyDown, std::time(nullptr)));
-      break;
-    case kEventHotKeyReleased:
-      LOG("callback listener with keyup");
-      listener->callback(
-          hotcakey::Event(hotcakey::EventType::kKeyUp, std::time(nullptr)));
-      break;
+    listener->callback(notified);
   }
 
+  // listeners may have unregistered themselves, which is only safe to
+  // remove once they returned
+  for (auto registration : retired) RemoveListener(registration);
+  retired.clear();
+
   return noErr;
 }
 
@@ -471,9 +685,14 @@ UInt32 ToCarbonModifiers(const std::vector<std::string>& keys) {
 
 namespace hotcakey {
 
-Result Activate() {
+Result Activate(const ActivationOption& option) {
   LOG("try to activate hotcakey");
 
+  // a listener is running, so it is active
+  if (isInputThread) return Result::kSuccess;
+
+  std::lock_guard<std::mutex> serialized(lifecycle);
+
   if (isActive.load(std::memory_order_acquire)) {
     LOG("already activated");
     return Result::kSuccess;
@@ -482,14 +701,25 @@ Result Activate() {
   {
     std::unique_lock<std::mutex> lock(mutex);
 
-    nativeThread = std::thread([] {
+    nativeThread = std::thread([option] {
       LOG("native thread started");
 
+      isInputThread = true;
+      trace::SetThreadName("hotcakey input");
+
+      auto report = scheduling::Apply(option);
+
+      if (option.grab) {
+        WRN("grabbing devices is not supported on this platform");
+        report.warnings.push_back("devices are not grabbed");
+      }
+
       auto status = InstallKeyEventHandler();
 
       if (status != noErr) {
         ERR("application event handler installation failed with status:"
             << status);
+        scheduling::Release(report);
         return;
       }
 
@@ -497,6 +727,8 @@ Result Activate() {
 
       {
         std::lock_guard<std::mutex> lock(mutex);
+        activationReport = report;
+        eventQueue = GetCurrentEventQueue();
         isActive.store(true, std::memory_order_release);
       }
 
@@ -507,31 +739,20 @@ Result Activate() {
       EventTargetRef target = GetApplicationEventTarget();
       while (isActive.load(std::memory_order_acquire)) {
         EventRef event;
-        if (ReceiveNextEvent(0, NULL, (kEventDurationSecond / 10), true,
-                             &event) == noErr) {
+        // the timeout is only a safety net, the wake event ends the wait
+        if (ReceiveNextEvent(0, NULL, kEventDurationSecond, true, &event) ==
+            noErr) {
           SendEventToEventTarget(event, target);
           ReleaseEvent(event);
         }
         pthread_testcancel();
       }
 
+      scheduling::Release(report);
+
       LOG("message loop stopped");
     });
 
-    pthread_attr_t hook_thread_attr;
-    pthread_attr_init(&hook_thread_attr);
-
-    int policy;
-    pthread_attr_getschedpolicy(&hook_thread_attr, &policy);
-
-    struct sched_param param;
-    param.sched_priority = sched_get_priority_max(policy);
-
-    if (pthread_setschedparam(nativeThread.native_handle(), SCHED_OTHER,
-                              &param) != 0) {
-      WRN("failed to set priority");
-    }
-
     cond.wait(lock, [] { return isActive.load(std::memory_order_acquire); });
   }  // lock(mutex)
 
@@ -540,9 +761,21 @@ Result Activate() {
   return Result::kSuccess;
 }
 
+ActivationReport GetActivationReport() {
+  std::lock_guard<std::mutex> lock(mutex);
+  return activationReport;
+}
+
 Result Inactivate() {
   LOG("deactivate hotcakey");
 
+  if (isInputThread) {
+    ERR("cannot inactivate from a listener");
+    return kFailure;
+  }
+
+  std::lock_guard<std::mutex> serialized(lifecycle);
+
   if (!isActive.load(std::memory_order_acquire)) {
     LOG("do nothing since already inactive");
     return kSuccess;
@@ -553,26 +786,41 @@ Result Inactivate() {
   {
     std::lock_guard<std::mutex> lock(mutex);
 
-    for (auto [key, value] : listeners) {
-      if (value->eventRef == nullptr) continue;
-      auto status = UnregisterEventHotKey(value->eventRef);
+    chords.ForEach([](UInt32 chord, auto& entry) {
+      // released already while suspended
+      if (entry.handle == nullptr) return;
+
+      auto status = UnregisterEventHotKey(entry.handle);
 
       if (status != noErr) {
-        ERR("failed to unregister listener with id: "
-            << value->registration << " and status: " << status);
-        continue;
+        ERR("failed to unregister hotkey with id: "
+            << chord << " and status: " << status);
+        return;
       }
 
-      delete value;
-
-      LOG("successfully unregister listener with id: " << value->registration);
-    }
+      LOG("successfully unregister hotkey with id: " << chord);
+    });
 
+    chords.Clear();
+    activeLayer.clear();
+    firedLayers.clear();
     listeners.clear();
+    retired.clear();
+    snapshots.clear();
+    isSuspended.store(false, std::memory_order_relaxed);
   }  // lock(mutex)
 
   isActive.store(false, std::memory_order_release);
 
+  EventRef wake;
+  if (CreateEvent(nullptr, kEventClassHotcakey, kEventHotcakeyWake, 0,
+                  kEventAttributeNone, &wake) == noErr) {
+    PostEventToQueue(eventQueue, wake, kEventPriorityHigh);
+    ReleaseEvent(wake);
+  } else {
+    ERR("failed to create wake event");
+  }
+
   LOG("try to join event target thread");
 
   nativeThread.join();
@@ -582,9 +830,14 @@ Result Inactivate() {
   return kSuccess;
 }
 
-RegistrationResult Register(
-    const std::vector<std::string>& keys,
-    const std::function<void(hotcakey::Event)>& listener) {
+RegistrationResult Register(const std::vector<std::string>& keys,
+                            const Callback& listener) {
+  return RegisterInLayer("", keys, listener);
+}
+
+RegistrationResult RegisterInLayer(const std::string& layer,
+                                   const std::vector<std::string>& keys,
+                                   const Callback& listener) {
   LOG("register hotkey");
 
   auto key = ToCarbonKey(keys);
@@ -603,60 +856,328 @@ RegistrationResult Register(
   LOG("key: " << key);
   LOG("modifier: " << modifier);
 
-  auto id = ++eventHotKeyIdSequence;
+  if (isInputThread) {
+    ERR("cannot register a hotkey from a listener");
+    return {kFailure, -1};
+  }
 
-  EventHotKeyID hkeyID;
-  hkeyID.id = id;
-  hkeyID.signature = key * modifier;
+  // held until the listener is stored, so the event of a new hotkey
+  // always finds it
+  std::lock_guard<std::mutex> lock(mutex);
 
-  EventHotKeyRef eventRef = NULL;
-  OSStatus status = RegisterEventHotKey(
-      key, modifier, hkeyID, GetApplicationEventTarget(), 0, &eventRef);
+  auto id = ++eventHotKeyIdSequence;
 
-  if (status != noErr) {
-    // -9878 means conflict maybe
-    ERR("failed to register hotkey: " << status);
+  listeners[id] = std::unique_ptr<Listener>(new Listener{
+      .registration = id,
+      .callback = listener,
+      .chord = ToChordKey(key, modifier),
+      .layer = layer,
+  });
+
+  if (!AttachListener(*listeners[id])) {
+    listeners.erase(id);
     return {kFailure, -1};
   }
 
-  {
-    std::lock_guard<std::mutex> lock(mutex);
-
-    listeners[id] = new Listener{
-        .registration = id,
-        .callback = listener,
-        .eventRef = eventRef,
-    };
-  }  // lock(mutex)
-
   LOG("hotkey registered with id: " << id);
 
   return {kSuccess, id};
 }
 
+RegistrationResult Register(const std::vector<std::string>& keys,
+                            const Action& action, const Callback& listener) {
+  ERR("native action is not supported on this platform");
+  return {kFailure, -1};
+}
+
+RegistrationResult Subscribe(const Filter& filter, const Callback& listener) {
+  // the hotkey api of this platform only reports registered chords,
+  // so there is no raw key event stream to filter.
+  ERR("key event stream is not supported on this platform");
+  return {kFailure, -1};
+}
+
 Result Unregister(const Registration& registration) {
+  // a listener unregistering itself or another one. `mutex` is already
+  // held by the dispatch, which removes it afterward.
+  if (isInputThread) {
+    auto it = listeners.find(registration);
+
+    if (it != listeners.end() && !it->second->isRetired) {
+      it->second->isRetired = true;
+      retired.push_back(registration);
+    }
+
+    return kSuccess;
+  }
+
+  std::lock_guard<std::mutex> lock(mutex);
+
   if (listeners.count(registration) == 0) {
     return kSuccess;
   }
 
-  auto listener = listeners.at(registration);
-  auto status = UnregisterEventHotKey(listener->eventRef);
+  RemoveListener(registration);
 
-  if (status != noErr) {
-    ERR("failed to unregister hotkey with status: " << status);
+  LOG("hotkey unregistered");
+
+  return kSuccess;
+}
+
+Result Suspend() {
+  if (isInputThread) {
+    ERR("cannot suspend from a listener");
     return kFailure;
   }
 
-  {
-    std::unique_lock<std::mutex> lock(mutex);
-    listeners.erase(registration);
-  }  // lock(mutex)
+  std::lock_guard<std::mutex> lock(mutex);
 
-  delete listener;
+  if (isSuspended.exchange(true, std::memory_order_relaxed)) return kSuccess;
 
-  LOG("hotkey unregistered");
+  chords.ForEach([](UInt32 chord, auto& entry) { SyncChord(chord, entry); });
+
+  LOG("hotkeys suspended");
+
+  return kSuccess;
+}
+
+Result Resume() {
+  if (isInputThread) {
+    ERR("cannot resume from a listener");
+    return kFailure;
+  }
+
+  std::lock_guard<std::mutex> lock(mutex);
+
+  if (!isSuspended.exchange(false, std::memory_order_relaxed)) {
+    return kSuccess;
+  }
+
+  auto result = kSuccess;
+
+  chords.ForEach([&result](UInt32 chord, auto& entry) {
+    if (!SyncChord(chord, entry)) result = kFailure;
+  });
+
+  LOG("hotkeys resumed");
+
+  return result;
+}
+
+bool IsSuspended() { return isSuspended.load(std::memory_order_relaxed); }
+
+namespace {
+
+// NOTICE: must be called with `mutex` held
+void SetLayer(const std::string& layer) {
+  if (layer == activeLayer) return;
+
+  auto previous = activeLayer;
+  activeLayer = layer;
+
+  // only chords of the two layers may change
+  for (auto& [registration, listener] : listeners) {
+    if (listener->layer.empty() || listener->snapshot != 0) continue;
+    if (listener->layer != previous && listener->layer != layer) continue;
+
+    SyncChord(listener->chord, *chords.Find(listener->chord));
+  }
+}
+
+}  // namespace
+
+Result SwitchLayer(const std::string& layer) {
+  // a listener switching modes. `mutex` is already held by the dispatch.
+  if (isInputThread) {
+    SetLayer(layer);
+    return kSuccess;
+  }
+
+  std::lock_guard<std::mutex> lock(mutex);
+  SetLayer(layer);
+
+  LOG("layer switched to: " << layer);
 
   return kSuccess;
 }
 
+std::string ActiveLayer() {
+  if (isInputThread) return activeLayer;
+
+  std::lock_guard<std::mutex> lock(mutex);
+  return activeLayer;
+}
+
+SnapshotResult TakeSnapshot() {
+  if (isInputThread) {
+    ERR("cannot take a snapshot from a listener");
+    return {kFailure, 0};
+  }
+
+  std::lock_guard<std::mutex> lock(mutex);
+
+  auto id = ++snapshotSequence;
+  auto& stash = snapshots[id];
+
+  for (auto& [registration, listener] : listeners) {
+    if (listener->snapshot != 0) continue;
+
+    DetachListener(*listener);
+    listener->snapshot = id;
+    stash.push_back(registration);
+  }
+
+  LOG("snapshot " << id << " taken with " << stash.size() << " hotkeys");
+
+  return {kSuccess, id};
+}
+
+Result Restore(Snapshot snapshot) {
+  if (isInputThread) {
+    ERR("cannot restore a snapshot from a listener");
+    return kFailure;
+  }
+
+  std::lock_guard<std::mutex> lock(mutex);
+
+  auto it = snapshots.find(snapshot);
+
+  if (it == snapshots.end()) {
+    ERR("unknown snapshot: " << snapshot);
+    return kFailure;
+  }
+
+  auto& stash = it->second;
+  std::vector<Registration> failed;
+
+  // a hotkey which cannot be attached stays detached in the snapshot
+  for (auto registration : stash) {
+    auto& listener = listeners.at(registration);
+
+    if (!AttachListener(*listener)) {
+      ERR("failed to restore hotkey with id: " << registration);
+      failed.push_back(registration);
+      continue;
+    }
+
+    listener->snapshot = 0;
+  }
+
+  if (!failed.empty()) {
+    stash.swap(failed);
+    WRN("snapshot " << snapshot << " keeps " << stash.size()
+                    << " hotkeys which failed to restore");
+    return kFailure;
+  }
+
+  snapshots.erase(it);
+
+  LOG("snapshot " << snapshot << " restored");
+
+  return kSuccess;
+}
+
+Result Publish(const std::string& name, std::size_t capacity) {
+  ERR("shared memory ring is not supported on this platform");
+  return kFailure;
+}
+
+Result Unpublish() { return kSuccess; }
+
+RegistrationResult Follow(const std::string& name, const Callback& listener) {
+  ERR("shared memory ring is not supported on this platform");
+  return {kFailure, -1};
+}
+
+Result StartRecording(const std::string& path) {
+  ERR("recording is not supported on this platform");
+  return kFailure;
+}
+
+Result StopRecording() { return kSuccess; }
+
+Result Replay(const std::string& path, ReplayPace pace, ReplayReport& report) {
+  ERR("replay is not supported on this platform");
+  return kFailure;
+}
+
+Result Inject(const std::vector<InjectedEvent>& events,
+              const InjectOption& option, InjectReport& report) {
+  report = {};
+  ERR("injection is not supported on this platform");
+  return kFailure;
+}
+
+Result RegisterKeymap(const std::string& path, const KeymapListener& listener,
+                      std::vector<Registration>& registrations) {
+  registrations.clear();
+  ERR("keymap is not supported on this platform");
+  return kFailure;
+}
+
+RegistrationResult WatchKeymap(const std::string& path,
+                               const ActionListener& listener) {
+  ERR("keymap is not supported on this platform");
+  return {kFailure, -1};
+}
+
+std::vector<Device> Devices() {
+  // the hotkey api of this platform does not tell devices apart
+  ERR("devices are not supported on this platform");
+  return {};
+}
+
+RegistrationResult RegisterOnDevice(const DeviceFilter& device,
+                                    const std::vector<std::string>& keys,
+                                    const Callback& listener) {
+  ERR("devices are not supported on this platform");
+  return {kFailure, -1};
+}
+
+RegistrationResult RegisterCombo(const std::vector<std::string>& keys,
+                                 const ComboOption& option,
+                                 const Callback& listener) {
+  ERR("combos are not supported on this platform");
+  return {kFailure, -1};
+}
+
+Result SetConsume(Registration registration, bool consume) {
+  // hotkeys of this platform never reach other applications
+  if (consume) return kSuccess;
+
+  ERR("passing hotkeys on is not supported on this platform");
+  return kFailure;
+}
+
+RegistrationResult Register(const std::vector<std::string>& keys,
+                            const HotkeyOption& option,
+                            const Callback& listener) {
+  if (option.device) return RegisterOnDevice(*option.device, keys, listener);
+
+  if (!option.consume.value_or(true)) {
+    ERR("passing hotkeys on is not supported on this platform");
+    return {kFailure, -1};
+  }
+
+  return RegisterInLayer(option.layer, keys, listener);
+}
+
+Result Remap(const std::string& from, const std::string& to) {
+  ERR("remapping is not supported on this platform");
+  return kFailure;
+}
+
+Result AttachKeyState(std::uint32_t* words, std::size_t length) {
+  // the hotkey api of this platform does not report other keys,
+  // so we cannot track the global key state.
+  ERR("key state view is not supported on this platform");
+  return kFailure;
+}
+
+Result DetachKeyState() { return kSuccess; }
+
+std::vector<unsigned int> KeyStateIndexes(const std::string& key) {
+  return {};
+}
+
 }  // namespace hotcakey
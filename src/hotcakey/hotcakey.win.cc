@@ -2,17 +2,22 @@
 
 #include <windows.h>
 
+#include <algorithm>
 #include <atomic>
 #include <condition_variable>
 #include <cstdint>
 #include <ctime>
 #include <functional>
+#include <memory>
 #include <mutex>
 #include <string>
 #include <thread>
 #include <unordered_map>
 #include <vector>
 
+#include "./fanout.h"
+#include "./scheduling.h"
+#include "./trace.h"
 #include "./utils/logger.h"
 #include "./utils/strings.h"
 
@@ -20,7 +25,15 @@ namespace {
 
 struct Listener {
   hotcakey::Registration registration;
-  std::function<void(hotcakey::Event)> callback;
+  hotcakey::Callback callback;
+  // see `ToChordKey`
+  int chord;
+  // unregistered by a listener during the current dispatch
+  bool isRetired = false;
+  // snapshot keeping the listener detached from dispatch, or 0
+  hotcakey::Snapshot snapshot = 0;
+  // "" is the base layer
+  std::string layer;
 };
 
 struct RegistrationRequest {
@@ -36,13 +49,209 @@ std::thread nativeThread;
 // we should not repeat to lock and release mutext for performance reason.
 std::atomic<bool> isActive(false);
 
-std::unordered_map<hotcakey::Registration, const Listener*> listeners;
+std::unordered_map<hotcakey::Registration, std::unique_ptr<Listener>>
+    listeners;
+
+// one hotkey per unique chord, whose id is the chord key. the handle is
+// true while the hotkey is registered to the os, which it is not while
+// suspended or while its listeners are in inactive layers.
+hotcakey::Fanout<int, bool> chords;
+
+// see `hotcakey::SwitchLayer`
+std::string activeLayer;
+
+// layer which took the keydown of each chord, to deliver its keyup
+std::unordered_map<int, std::string> firedLayers;
+
+// hotkeys are released to other applications while suspended.
+// see `hotcakey::Suspend`.
+std::atomic<bool> isSuspended(false);
+
+// registrations detached by `hotcakey::TakeSnapshot`
+std::unordered_map<hotcakey::Snapshot, std::vector<hotcakey::Registration>>
+    snapshots;
+hotcakey::Snapshot snapshotSequence = 0;
 
 std::vector<RegistrationRequest*> requests;
 
 std::mutex mutex;
 std::condition_variable cond;
 
+// serializes `Activate` and `Inactivate`
+std::mutex lifecycle;
+
+// id of the message loop thread, set by itself once its queue exists
+std::atomic<DWORD> threadId(0);
+
+// listeners are called on the message loop thread with `mutex` held,
+// so the api must not take it again there. see `Unregister`.
+thread_local bool isInputThread = false;
+
+// registrations unregistered by listeners during the current dispatch
+std::vector<hotcakey::Registration> retired;
+
+// hotkey ids of applications must be below 0xC000. modifiers but
+// MOD_NOREPEAT take 4 bits and virtual keys 8 bits, so a chord fits.
+int ToChordKey(UINT key, UINT modifier) {
+  return static_cast<int>((modifier & 0xF) << 8 | (key & 0xFF));
+}
+
+// asks the message loop thread, which owns the hotkeys, to register or
+// unregister the hotkey of `chord`
+bool PostHotKey(int chord, bool isRegistering) {
+  UINT key = chord & 0xFF;
+  UINT modifier = (chord >> 8 & 0xF) | MOD_NOREPEAT;
+
+  // already on the message loop thread
+  if (isInputThread) {
+    auto ok = isRegistering ? RegisterHotKey(NULL, chord, modifier, key)
+                            : UnregisterHotKey(NULL, chord);
+    if (!ok) ERR("failed to set hotkey: " << GetLastError());
+    return ok;
+  }
+
+  auto tid = threadId.load(std::memory_order_acquire);
+
+  // NOTICE: small hack!
+  // we use the WM_SETHOTKEY message as setting or removing global hotkey
+  // event apart from [its original
+  // usage](https://docs.microsoft.com/en-us/windows/win32/inputdev/wm-sethotkey)
+  auto ok = PostThreadMessage(tid, WM_SETHOTKEY, chord,
+                              isRegistering ? MAKELONG(modifier, key) : 0);
+
+  if (!ok) {
+    ERR("failed to post thread message: " << GetLastError())
+  }
+
+  return ok;
+}
+
+bool IsInActiveLayer(const Listener& listener) {
+  return listener.layer.empty() || listener.layer == activeLayer;
+}
+
+// the active layer shadows the base layer
+//
+// NOTICE: must be called with `mutex` held
+std::string ShadowingLayer(const std::vector<hotcakey::Registration>& chord) {
+  if (activeLayer.empty()) return activeLayer;
+
+  for (auto registration : chord) {
+    auto& listener = listeners.at(registration);
+    if (listener->layer == activeLayer && !listener->isRetired) {
+      return activeLayer;
+    }
+  }
+
+  return "";
+}
+
+// the hotkey of a chord is registered to the os only while it has a
+// listener in the base or the active layer, so that the os sees only the
+// chords which actually changed when layers are switched.
+//
+// NOTICE: must be called with `mutex` held
+bool SyncChord(int chord, hotcakey::Fanout<int, bool>::Entry& entry) {
+  auto isWanted = !isSuspended.load(std::memory_order_relaxed) &&
+                  std::any_of(entry.registrations.begin(),
+                              entry.registrations.end(), [](auto registration) {
+                                return IsInActiveLayer(
+                                    *listeners.at(registration));
+                              });
+
+  if (isWanted == entry.handle) return true;
+
+  if (!PostHotKey(chord, isWanted)) return false;
+
+  entry.handle = isWanted;
+
+  return true;
+}
+
+// NOTICE: must be called with `mutex` held
+bool AttachListener(const Listener& listener) {
+  chords.Add(listener.chord, listener.registration);
+
+  if (!SyncChord(listener.chord, *chords.Find(listener.chord))) {
+    auto handle = false;
+    chords.Remove(listener.chord, listener.registration, handle);
+    return false;
+  }
+
+  return true;
+}
+
+// NOTICE: must be called with `mutex` held
+void DetachListener(const Listener& listener) {
+  auto handle = false;
+
+  if (chords.Remove(listener.chord, listener.registration, handle)) {
+    if (handle) PostHotKey(listener.chord, false);
+    return;
+  }
+
+  auto entry = chords.Find(listener.chord);
+  if (entry != nullptr) SyncChord(listener.chord, *entry);
+}
+
+// NOTICE: must be called with `mutex` held
+void RemoveListener(hotcakey::Registration registration) {
+  auto it = listeners.find(registration);
+  if (it == listeners.end()) return;
+
+  auto& listener = *it->second;
+
+  // detached, so it only has to leave its snapshot
+  if (listener.snapshot != 0) {
+    auto& stash = snapshots.at(listener.snapshot);
+    stash.erase(std::remove(stash.begin(), stash.end(), registration),
+                stash.end());
+  } else {
+    DetachListener(listener);
+  }
+
+  listeners.erase(it);
+}
+
+// calls every listener of `chord`. returns false if there is none left.
+//
+// NOTICE: must be called on the message loop thread with `mutex` held
+bool NotifyChord(int chord, hotcakey::EventType type, std::uint64_t traced) {
+  auto entry = chords.Find(chord);
+  if (entry == nullptr) return false;
+
+  hotcakey::Event event(type, std::time(nullptr));
+  event.trace = traced;
+
+  // keyup goes to the layer which took the keydown
+  std::string layer;
+
+  if (type == hotcakey::kKeyDown) {
+    layer = ShadowingLayer(entry->registrations);
+    firedLayers[chord] = layer;
+  } else if (firedLayers.count(chord) != 0) {
+    layer = firedLayers[chord];
+    firedLayers.erase(chord);
+  }
+
+  for (auto registration : entry->registrations) {
+    auto& listener = listeners.at(registration);
+    if (listener->isRetired || listener->layer != layer) continue;
+
+    hotcakey::trace::Record(hotcakey::trace::kMatched, traced);
+    listener->callback(event);
+  }
+
+  // listeners may have unregistered themselves, which is only safe to
+  // remove once they returned
+  for (auto registration : retired) RemoveListener(registration);
+  retired.clear();
+
+  return true;
+}
+
+hotcakey::ActivationReport activationReport;
+
 hotcakey::Registration eventHotKeyIdSequence = 0;
 
 constexpr unsigned long long int Hash(const char* str,
@@ -581,9 +790,14 @@ UINT ToWinModifiers(const std::vector<std::string>& keys) {
 
 namespace hotcakey {
 
-Result Activate() {
+Result Activate(const ActivationOption& option) {
   LOG("try to activate hotcakey");
 
+  // a listener is running, so it is active
+  if (isInputThread) return Result::kSuccess;
+
+  std::lock_guard<std::mutex> serialized(lifecycle);
+
   if (isActive.load(std::memory_order_acquire)) {
     LOG("already activated");
     return Result::kSuccess;
@@ -592,11 +806,30 @@ Result Activate() {
   {
     std::unique_lock<std::mutex> lock(mutex);
 
-    nativeThread = std::thread([] {
+    nativeThread = std::thread([option] {
       LOG("native thread started");
 
+      isInputThread = true;
+      trace::SetThreadName("hotcakey input");
+
+      auto report = scheduling::Apply(option);
+
+      if (option.grab) {
+        WRN("grabbing devices is not supported on this platform");
+        report.warnings.push_back("devices are not grabbed");
+      }
+
+      MSG msg;
+
+      // NOTICE:
+      // the message queue of a thread is created on its first call to
+      // user32, and PostThreadMessage fails until then.
+      PeekMessage(&msg, NULL, WM_USER, WM_USER, PM_NOREMOVE);
+
       {
         std::lock_guard<std::mutex> lock(mutex);
+        activationReport = report;
+        threadId.store(GetCurrentThreadId(), std::memory_order_release);
         isActive.store(true, std::memory_order_release);
       }
 
@@ -604,9 +837,11 @@ Result Activate() {
 
       LOG("start message loop");
 
-      MSG msg;
-
       while (isActive.load(std::memory_order_acquire)) {
+        // sleeps until a message is posted. `Inactivate` wakes us up
+        // with WM_QUIT, so there is no polling.
+        WaitMessage();
+
         while (PeekMessage(&msg, NULL, 0, 0, PM_REMOVE) != 0) {
           auto id = (int)msg.wParam;
           auto modifiers = (UINT)LOWORD(msg.lParam);
@@ -634,12 +869,20 @@ Result Activate() {
               break;
             }
             case WM_HOTKEY: {
+              // the message time is in milliseconds on another clock,
+              // so the message is received when it is handled
+              auto traced = trace::NextId();
+              trace::Record(trace::kReceived, traced);
+              trace::Record(trace::kHandled, traced);
+
               // notify keydown event
               {
                 std::lock_guard<std::mutex> lock(mutex);
-                auto listener = listeners.at(id);
-                listener->callback(hotcakey::Event(
-                    hotcakey::EventType::kKeyDown, std::time(nullptr)));
+
+                // unregistered while the message was in flight
+                if (!NotifyChord(id, hotcakey::EventType::kKeyDown, traced)) {
+                  break;
+                }
               }  // lock(mutex)
 
               // observe keyup event
@@ -651,11 +894,13 @@ Result Activate() {
               observer.join();
 
               // notify keyup event
+              traced = trace::NextId();
+              trace::Record(trace::kReceived, traced);
+              trace::Record(trace::kHandled, traced);
+
               {
                 std::lock_guard<std::mutex> lock(mutex);
-                auto listener = listeners.at(id);
-                listener->callback(hotcakey::Event(hotcakey::EventType::kKeyUp,
-                                                   std::time(nullptr)));
+                NotifyChord(id, hotcakey::EventType::kKeyUp, traced);
               }  // lock(mutex)
 
               break;
@@ -666,6 +911,8 @@ Result Activate() {
         }
       }
 
+      scheduling::Release(report);
+
       LOG("message loop stopped");
     });
 
@@ -677,9 +924,21 @@ Result Activate() {
   return Result::kSuccess;
 }
 
+ActivationReport GetActivationReport() {
+  std::lock_guard<std::mutex> lock(mutex);
+  return activationReport;
+}
+
 Result Inactivate() {
   LOG("deactivate hotcakey");
 
+  if (isInputThread) {
+    ERR("cannot inactivate from a listener");
+    return kFailure;
+  }
+
+  std::lock_guard<std::mutex> serialized(lifecycle);
+
   if (!isActive.load(std::memory_order_acquire)) {
     LOG("do nothing since already inactive");
     return kSuccess;
@@ -687,22 +946,22 @@ Result Inactivate() {
 
   LOG("unregister all event listeners");
 
-  auto tid = GetThreadId(nativeThread.native_handle());
+  auto tid = threadId.load(std::memory_order_acquire);
 
   {
     std::lock_guard<std::mutex> lock(mutex);
 
-    for (auto [key, value] : listeners) {
-      auto ok = PostThreadMessage(tid, WM_SETHOTKEY, key, 0);
-
-      if (!ok) {
-        ERR("failed to post thread message: " << GetLastError())
-      }
-
-      delete value;
-    }
+    chords.ForEach([](int chord, auto& entry) {
+      if (entry.handle) PostHotKey(chord, false);
+    });
 
+    chords.Clear();
+    activeLayer.clear();
+    firedLayers.clear();
     listeners.clear();
+    retired.clear();
+    snapshots.clear();
+    isSuspended.store(false, std::memory_order_relaxed);
   }  // lock(mutex)
 
   isActive.store(false, std::memory_order_release);
@@ -716,15 +975,21 @@ Result Inactivate() {
   LOG("try to join event target thread");
 
   nativeThread.join();
+  threadId.store(0, std::memory_order_release);
 
   LOG("successfully shutdown");
 
   return kSuccess;
 }
 
-RegistrationResult Register(
-    const std::vector<std::string>& keys,
-    const std::function<void(hotcakey::Event)>& listener) {
+RegistrationResult Register(const std::vector<std::string>& keys,
+                            const Callback& listener) {
+  return RegisterInLayer("", keys, listener);
+}
+
+RegistrationResult RegisterInLayer(const std::string& layer,
+                                   const std::vector<std::string>& keys,
+                                   const Callback& listener) {
   LOG("register hotkey");
 
   UINT key = ToWinKey(keys);
@@ -733,59 +998,329 @@ RegistrationResult Register(
   LOG("key: " << key);
   LOG("modifier: " << modifier);
 
-  auto id = ++eventHotKeyIdSequence;
+  if (isInputThread) {
+    ERR("cannot register a hotkey from a listener");
+    return {kFailure, -1};
+  }
 
-  auto tid = GetThreadId(nativeThread.native_handle());
+  std::lock_guard<std::mutex> lock(mutex);
 
-  // NOTICE: small hack!
-  // we use the WM_SETHOTKEY message as setting or removing global hotkey event
-  // apart from [its original
-  // usage](https://docs.microsoft.com/en-us/windows/win32/inputdev/wm-sethotkey)
-  auto ok = PostThreadMessage(tid, WM_SETHOTKEY, id, MAKELONG(modifier, key));
+  auto id = ++eventHotKeyIdSequence;
 
-  if (!ok) {
-    ERR("failed to post thread message: " << GetLastError())
+  // stored before the hotkey exists, so its first message finds it
+  listeners[id] = std::unique_ptr<Listener>(new Listener{
+      id,
+      listener,
+      ToChordKey(key, modifier),
+      false,
+      0,
+      layer,
+  });
+
+  if (!AttachListener(*listeners[id])) {
+    listeners.erase(id);
     return {kFailure, -1};
   }
 
-  {
-    std::lock_guard<std::mutex> lock(mutex);
-
-    listeners[id] = new Listener{
-        id,
-        listener,
-    };
-  }  // lock(mutex)
-
   LOG("hotkey registered with id: " << id);
 
   return {kSuccess, id};
 }
 
+RegistrationResult Register(const std::vector<std::string>& keys,
+                            const Action& action, const Callback& listener) {
+  ERR("native action is not supported on this platform");
+  return {kFailure, -1};
+}
+
+RegistrationResult Subscribe(const Filter& filter, const Callback& listener) {
+  // the hotkey api of this platform only reports registered chords,
+  // so there is no raw key event stream to filter.
+  ERR("key event stream is not supported on this platform");
+  return {kFailure, -1};
+}
+
 Result Unregister(const Registration& registration) {
+  // a listener unregistering itself or another one. `mutex` is already
+  // held by the dispatch, which removes it afterward.
+  if (isInputThread) {
+    auto it = listeners.find(registration);
+
+    if (it != listeners.end() && !it->second->isRetired) {
+      it->second->isRetired = true;
+      retired.push_back(registration);
+    }
+
+    return kSuccess;
+  }
+
+  std::lock_guard<std::mutex> lock(mutex);
+
   if (listeners.count(registration) == 0) {
     return kSuccess;
   }
 
-  auto listener = listeners.at(registration);
-  auto tid = GetThreadId(nativeThread.native_handle());
-  auto ok = PostThreadMessage(tid, WM_SETHOTKEY, listener->registration, 0);
+  RemoveListener(registration);
 
-  if (!ok) {
-    ERR("failed to post thread message: " << GetLastError())
+  LOG("hotkey unregistered");
+
+  return kSuccess;
+}
+
+Result Suspend() {
+  if (isInputThread) {
+    ERR("cannot suspend from a listener");
     return kFailure;
   }
 
-  {
-    std::unique_lock<std::mutex> lock(mutex);
-    listeners.erase(registration);
-  }  // lock(mutex)
+  std::lock_guard<std::mutex> lock(mutex);
 
-  delete listener;
+  if (isSuspended.exchange(true, std::memory_order_relaxed)) return kSuccess;
 
-  LOG("hotkey unregistered");
+  chords.ForEach([](int chord, auto& entry) { SyncChord(chord, entry); });
+
+  LOG("hotkeys suspended");
+
+  return kSuccess;
+}
+
+Result Resume() {
+  if (isInputThread) {
+    ERR("cannot resume from a listener");
+    return kFailure;
+  }
+
+  std::lock_guard<std::mutex> lock(mutex);
+
+  if (!isSuspended.exchange(false, std::memory_order_relaxed)) {
+    return kSuccess;
+  }
+
+  auto result = kSuccess;
+
+  chords.ForEach([&result](int chord, auto& entry) {
+    if (!SyncChord(chord, entry)) result = kFailure;
+  });
+
+  LOG("hotkeys resumed");
+
+  return result;
+}
+
+bool IsSuspended() { return isSuspended.load(std::memory_order_relaxed); }
+
+namespace {
+
+// NOTICE: must be called with `mutex` held
+void SetLayer(const std::string& layer) {
+  if (layer == activeLayer) return;
+
+  auto previous = activeLayer;
+  activeLayer = layer;
+
+  // only chords of the two layers may change
+  for (auto& [registration, listener] : listeners) {
+    if (listener->layer.empty() || listener->snapshot != 0) continue;
+    if (listener->layer != previous && listener->layer != layer) continue;
+
+    SyncChord(listener->chord, *chords.Find(listener->chord));
+  }
+}
+
+}  // namespace
+
+Result SwitchLayer(const std::string& layer) {
+  // a listener switching modes. `mutex` is already held by the dispatch.
+  if (isInputThread) {
+    SetLayer(layer);
+    return kSuccess;
+  }
+
+  std::lock_guard<std::mutex> lock(mutex);
+  SetLayer(layer);
+
+  LOG("layer switched to: " << layer);
+
+  return kSuccess;
+}
+
+std::string ActiveLayer() {
+  if (isInputThread) return activeLayer;
+
+  std::lock_guard<std::mutex> lock(mutex);
+  return activeLayer;
+}
+
+SnapshotResult TakeSnapshot() {
+  if (isInputThread) {
+    ERR("cannot take a snapshot from a listener");
+    return {kFailure, 0};
+  }
+
+  std::lock_guard<std::mutex> lock(mutex);
+
+  auto id = ++snapshotSequence;
+  auto& stash = snapshots[id];
+
+  for (auto& [registration, listener] : listeners) {
+    if (listener->snapshot != 0) continue;
+
+    DetachListener(*listener);
+    listener->snapshot = id;
+    stash.push_back(registration);
+  }
+
+  LOG("snapshot " << id << " taken with " << stash.size() << " hotkeys");
+
+  return {kSuccess, id};
+}
+
+Result Restore(Snapshot snapshot) {
+  if (isInputThread) {
+    ERR("cannot restore a snapshot from a listener");
+    return kFailure;
+  }
+
+  std::lock_guard<std::mutex> lock(mutex);
+
+  auto it = snapshots.find(snapshot);
+
+  if (it == snapshots.end()) {
+    ERR("unknown snapshot: " << snapshot);
+    return kFailure;
+  }
+
+  auto& stash = it->second;
+  std::vector<Registration> failed;
+
+  // a hotkey which cannot be attached stays detached in the snapshot
+  for (auto registration : stash) {
+    auto& listener = listeners.at(registration);
+
+    if (!AttachListener(*listener)) {
+      ERR("failed to restore hotkey with id: " << registration);
+      failed.push_back(registration);
+      continue;
+    }
+
+    listener->snapshot = 0;
+  }
+
+  if (!failed.empty()) {
+    stash.swap(failed);
+    WRN("snapshot " << snapshot << " keeps " << stash.size()
+                    << " hotkeys which failed to restore");
+    return kFailure;
+  }
+
+  snapshots.erase(it);
+
+  LOG("snapshot " << snapshot << " restored");
 
   return kSuccess;
 }
 
+Result Publish(const std::string& name, std::size_t capacity) {
+  ERR("shared memory ring is not supported on this platform");
+  return kFailure;
+}
+
+Result Unpublish() { return kSuccess; }
+
+RegistrationResult Follow(const std::string& name, const Callback& listener) {
+  ERR("shared memory ring is not supported on this platform");
+  return {kFailure, -1};
+}
+
+Result StartRecording(const std::string& path) {
+  ERR("recording is not supported on this platform");
+  return kFailure;
+}
+
+Result StopRecording() { return kSuccess; }
+
+Result Replay(const std::string& path, ReplayPace pace, ReplayReport& report) {
+  ERR("replay is not supported on this platform");
+  return kFailure;
+}
+
+Result Inject(const std::vector<InjectedEvent>& events,
+              const InjectOption& option, InjectReport& report) {
+  report = {};
+  ERR("injection is not supported on this platform");
+  return kFailure;
+}
+
+Result RegisterKeymap(const std::string& path, const KeymapListener& listener,
+                      std::vector<Registration>& registrations) {
+  registrations.clear();
+  ERR("keymap is not supported on this platform");
+  return kFailure;
+}
+
+RegistrationResult WatchKeymap(const std::string& path,
+                               const ActionListener& listener) {
+  ERR("keymap is not supported on this platform");
+  return {kFailure, -1};
+}
+
+std::vector<Device> Devices() {
+  // the hotkey api of this platform does not tell devices apart
+  ERR("devices are not supported on this platform");
+  return {};
+}
+
+RegistrationResult RegisterOnDevice(const DeviceFilter& device,
+                                    const std::vector<std::string>& keys,
+                                    const Callback& listener) {
+  ERR("devices are not supported on this platform");
+  return {kFailure, -1};
+}
+
+RegistrationResult RegisterCombo(const std::vector<std::string>& keys,
+                                 const ComboOption& option,
+                                 const Callback& listener) {
+  ERR("combos are not supported on this platform");
+  return {kFailure, -1};
+}
+
+Result SetConsume(Registration registration, bool consume) {
+  // hotkeys of this platform never reach other applications
+  if (consume) return kSuccess;
+
+  ERR("passing hotkeys on is not supported on this platform");
+  return kFailure;
+}
+
+RegistrationResult Register(const std::vector<std::string>& keys,
+                            const HotkeyOption& option,
+                            const Callback& listener) {
+  if (option.device) return RegisterOnDevice(*option.device, keys, listener);
+
+  if (!option.consume.value_or(true)) {
+    ERR("passing hotkeys on is not supported on this platform");
+    return {kFailure, -1};
+  }
+
+  return RegisterInLayer(option.layer, keys, listener);
+}
+
+Result Remap(const std::string& from, const std::string& to) {
+  ERR("remapping is not supported on this platform");
+  return kFailure;
+}
+
+Result AttachKeyState(std::uint32_t* words, std::size_t length) {
+  // the hotkey api of this platform does not report other keys,
+  // so we cannot track the global key state.
+  ERR("key state view is not supported on this platform");
+  return kFailure;
+}
+
+Result DetachKeyState() { return kSuccess; }
+
+std::vector<unsigned int> KeyStateIndexes(const std::string& key) {
+  return {};
+}
+
 }  // namespace hotcakey
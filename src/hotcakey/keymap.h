@@ -0,0 +1,87 @@
+#ifndef HOTCAKEY_KEYMAP_H_
+#define HOTCAKEY_KEYMAP_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "./hotcakey.h"
+#include "./matcher.h"
+
+namespace hotcakey {
+namespace keymap {
+
+// a hotkey of a compiled keymap, already resolved to the chord of the
+// backend so that loading it takes no string processing.
+//
+// a keymap file is a 32 byte header, the bindings as is, and then the
+// layer names followed by the action names as nul terminated strings.
+// layer 0 is always the base "". it is compiled from json by `hotcakeyc`,
+// see README.
+struct Binding {
+  // key code of the backend (evdev on linux)
+  std::uint16_t key;
+  // `Modifier` mask
+  std::uint8_t modifiers;
+  std::uint8_t reserved;
+  // index into the layer names
+  std::uint32_t layer;
+  // index into the action names
+  std::uint32_t action;
+};
+
+static_assert(sizeof(Binding) == 12, "bindings must be packed");
+
+// writes a keymap file. `layers` must start with the base layer "".
+// the file is replaced by a rename, so a watcher never sees half of it.
+bool Write(const std::string& path, const std::vector<Binding>& bindings,
+           const std::vector<std::string>& layers,
+           const std::vector<std::string>& actions);
+
+// resolves `keys` in the form `Register` takes to a chord of the backend.
+// implemented by the backend, since it owns the key tables.
+bool ToChord(const std::vector<std::string>& keys, Chord& chord);
+
+// a keymap file mapped read only. every binding is validated once on open,
+// so the bindings can be trusted afterwards.
+class Reader {
+ public:
+  static std::unique_ptr<Reader> Open(const std::string& path);
+
+  ~Reader();
+
+  std::size_t Size() const { return size; }
+  const Binding& operator[](std::size_t i) const { return bindings[i]; }
+
+  std::size_t LayerCount() const { return layers.size(); }
+  const char* LayerName(std::size_t i) const { return layers[i]; }
+
+  std::size_t ActionCount() const { return actions.size(); }
+  const char* ActionName(std::size_t i) const { return actions[i]; }
+
+ private:
+  Reader(void* memory, std::size_t length, const Binding* bindings,
+         std::size_t size, std::vector<const char*> layers,
+         std::vector<const char*> actions)
+      : memory(memory),
+        length(length),
+        bindings(bindings),
+        size(size),
+        layers(std::move(layers)),
+        actions(std::move(actions)) {}
+
+  void* memory;
+  std::size_t length;
+  const Binding* bindings;
+  std::size_t size;
+  // point into the mapped names
+  std::vector<const char*> layers;
+  std::vector<const char*> actions;
+};
+
+}  // namespace keymap
+}  // namespace hotcakey
+
+#endif  // HOTCAKEY_KEYMAP_H_
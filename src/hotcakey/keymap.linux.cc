@@ -0,0 +1,199 @@
+#include "./keymap.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+
+#include "./utils/logger.h"
+
+namespace {
+
+constexpr std::uint32_t kMagic = 0x6d6b6b68;  // "hkkm"
+constexpr std::uint32_t kVersion = 2;
+
+struct Header {
+  std::uint32_t magic;
+  std::uint32_t version;
+  std::uint32_t bindingSize;
+  std::uint32_t count;
+  std::uint32_t layerCount;
+  std::uint32_t actionCount;
+  std::uint32_t namesSize;
+  std::uint32_t reserved;
+};
+
+static_assert(sizeof(Header) == 32, "header must be packed");
+
+bool WriteAll(int fd, const void* data, std::size_t size) {
+  auto bytes = static_cast<const char*>(data);
+
+  while (size > 0) {
+    auto written = write(fd, bytes, size);
+
+    if (written < 0) {
+      if (errno == EINTR) continue;
+      ERR("failed to write keymap: " << std::strerror(errno));
+      return false;
+    }
+
+    bytes += written;
+    size -= written;
+  }
+
+  return true;
+}
+
+// splits the name table into `layers` and `actions`. false unless it
+// holds exactly as many names as the header says.
+bool ReadNames(const char* names, const Header& header,
+               std::vector<const char*>& layers,
+               std::vector<const char*>& actions) {
+  std::size_t offset = 0;
+
+  while (offset < header.namesSize) {
+    auto end = static_cast<const char*>(
+        std::memchr(names + offset, '\0', header.namesSize - offset));
+    if (end == nullptr) return false;
+
+    if (layers.size() < header.layerCount) {
+      layers.push_back(names + offset);
+    } else {
+      actions.push_back(names + offset);
+    }
+
+    offset = end - names + 1;
+  }
+
+  return layers.size() == header.layerCount && !layers.empty() &&
+         layers[0][0] == '\0' && actions.size() == header.actionCount;
+}
+
+}  // namespace
+
+namespace hotcakey {
+namespace keymap {
+
+bool Write(const std::string& path, const std::vector<Binding>& bindings,
+           const std::vector<std::string>& layers,
+           const std::vector<std::string>& actions) {
+  if (layers.empty() || !layers[0].empty()) {
+    ERR("the first layer of a keymap must be the base layer");
+    return false;
+  }
+
+  std::string names;
+  for (auto& layer : layers) names.append(layer.c_str(), layer.size() + 1);
+  for (auto& action : actions) {
+    names.append(action.c_str(), action.size() + 1);
+  }
+
+  Header header{kMagic,
+                kVersion,
+                sizeof(Binding),
+                static_cast<std::uint32_t>(bindings.size()),
+                static_cast<std::uint32_t>(layers.size()),
+                static_cast<std::uint32_t>(actions.size()),
+                static_cast<std::uint32_t>(names.size()),
+                0};
+
+  auto temporary = path + ".tmp";
+  auto fd =
+      open(temporary.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+
+  if (fd < 0) {
+    ERR("failed to create keymap " << path << ": " << std::strerror(errno));
+    return false;
+  }
+
+  auto ok = WriteAll(fd, &header, sizeof(header)) &&
+            WriteAll(fd, bindings.data(), sizeof(Binding) * bindings.size()) &&
+            WriteAll(fd, names.data(), names.size());
+
+  close(fd);
+
+  if (ok && rename(temporary.c_str(), path.c_str()) != 0) {
+    ERR("failed to replace keymap " << path << ": " << std::strerror(errno));
+    ok = false;
+  }
+
+  if (!ok) unlink(temporary.c_str());
+
+  return ok;
+}
+
+std::unique_ptr<Reader> Reader::Open(const std::string& path) {
+  auto fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+
+  if (fd < 0) {
+    ERR("failed to open keymap " << path << ": " << std::strerror(errno));
+    return nullptr;
+  }
+
+  struct stat st;
+  if (fstat(fd, &st) != 0 || st.st_size < (off_t)sizeof(Header)) {
+    ERR("not a keymap: " << path);
+    close(fd);
+    return nullptr;
+  }
+
+  auto length = static_cast<std::size_t>(st.st_size);
+  auto memory = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+
+  if (memory == MAP_FAILED) {
+    ERR("failed to map keymap: " << std::strerror(errno));
+    return nullptr;
+  }
+
+  auto header = static_cast<const Header*>(memory);
+  auto fail = [&](const char* reason) {
+    ERR(reason << ": " << path);
+    munmap(memory, length);
+    return nullptr;
+  };
+
+  if (header->magic != kMagic || header->version != kVersion ||
+      header->bindingSize != sizeof(Binding)) {
+    return fail("unsupported keymap");
+  }
+
+  auto size = static_cast<std::size_t>(header->count);
+  auto namesAt = sizeof(Header) + sizeof(Binding) * size;
+
+  if (namesAt + header->namesSize != length) {
+    return fail("truncated keymap");
+  }
+
+  auto bytes = static_cast<const char*>(memory);
+  std::vector<const char*> layers;
+  std::vector<const char*> actions;
+
+  if (!ReadNames(bytes + namesAt, *header, layers, actions)) {
+    return fail("broken names of keymap");
+  }
+
+  auto bindings = reinterpret_cast<const Binding*>(bytes + sizeof(Header));
+
+  for (std::size_t i = 0; i < size; i++) {
+    auto& binding = bindings[i];
+    if (binding.key >= kKeyCodeCount ||
+        binding.modifiers >= kModifierCombinations ||
+        binding.layer >= layers.size() || binding.action >= actions.size()) {
+      return fail("broken binding of keymap");
+    }
+  }
+
+  return std::unique_ptr<Reader>(
+      new Reader(memory, length, bindings, size, std::move(layers),
+                 std::move(actions)));
+}
+
+Reader::~Reader() { munmap(memory, length); }
+
+}  // namespace keymap
+}  // namespace hotcakey
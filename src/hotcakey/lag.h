@@ -0,0 +1,54 @@
+#ifndef HOTCAKEY_LAG_H_
+#define HOTCAKEY_LAG_H_
+
+#include <cstddef>
+
+namespace hotcakey {
+
+// `Lag` keeps track of how late events reach the main thread, and decides
+// whether a stall is reported and whether an event is too old to deliver.
+//
+// NOTICE:
+// `Lag` is not thread safe. the addon only touches it on the main thread.
+struct Lag {
+  // milliseconds. 0 disables stall warnings.
+  double threshold = 0;
+  // milliseconds. events older than this are dropped. 0 keeps every event.
+  double maxAge = 0;
+  double last = 0;
+  double max = 0;
+  std::size_t stalls = 0;
+  std::size_t dropped = 0;
+  bool isStalled = false;
+
+  // records an event delivered `ms` late. `stalled` is set only for the
+  // first event of a stall, so a stall is reported once until the lag
+  // goes below the threshold again. returns false if the event is too old.
+  bool Admit(double ms, bool& stalled) {
+    last = ms;
+    if (ms > max) max = ms;
+
+    stalled = false;
+
+    if (threshold > 0 && ms >= threshold) {
+      if (!isStalled) {
+        isStalled = true;
+        stalls++;
+        stalled = true;
+      }
+    } else {
+      isStalled = false;
+    }
+
+    if (maxAge > 0 && ms > maxAge) {
+      dropped++;
+      return false;
+    }
+
+    return true;
+  }
+};
+
+}  // namespace hotcakey
+
+#endif  // HOTCAKEY_LAG_H_
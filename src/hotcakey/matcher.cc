@@ -0,0 +1,403 @@
+#include "./matcher.h"
+
+#include <algorithm>
+
+namespace {
+
+const hotcakey::Matcher::Registrations kNoRegistrations;
+
+std::size_t ModifierIndex(hotcakey::Modifier modifier) {
+  switch (modifier) {
+    case hotcakey::kModifierControl:
+      return 0;
+    case hotcakey::kModifierShift:
+      return 1;
+    case hotcakey::kModifierAlt:
+      return 2;
+    case hotcakey::kModifierMeta:
+      return 3;
+    default:
+      return SIZE_MAX;
+  }
+}
+
+}  // namespace
+
+namespace hotcakey {
+
+Matcher::Matcher() : tables(1) {
+  tables[kBaseLayer] = std::make_unique<Table>();
+  fired.fill(kNotFired);
+}
+
+void Matcher::SetModifierKey(KeyCode code, Modifier modifier) {
+  auto index = ModifierIndex(modifier);
+  if (code >= kKeyCodeCount || index == SIZE_MAX) return;
+
+  modifierKeys[index].Set(code);
+  allModifierKeys.Set(code);
+}
+
+bool Matcher::Add(const Chord& chord, Registration registration,
+                  Layer layer) {
+  if (chord.key >= kKeyCodeCount) return false;
+  if (chord.modifiers >= kModifierCombinations) return false;
+  if (allModifierKeys.Test(chord.key)) return false;
+
+  if (layer >= tables.size()) tables.resize(layer + 1);
+
+  auto& table = tables[layer];
+  if (!table) table = std::make_unique<Table>();
+
+  // the active layer got its first chord
+  if (layer == activeLayer) active = table.get();
+
+  auto& bucket = (*table)[chord.key];
+  if (!bucket) bucket = std::make_unique<Bucket>();
+
+  (*bucket)[chord.modifiers].push_back(registration);
+
+  return true;
+}
+
+bool Matcher::Remove(const Chord& chord, Registration registration,
+                     Layer layer) {
+  auto registrations = Find(FindTable(layer), chord);
+  if (registrations == nullptr) return false;
+
+  auto it =
+      std::find(registrations->begin(), registrations->end(), registration);
+  if (it == registrations->end()) return false;
+
+  registrations->erase(it);
+
+  return true;
+}
+
+void Matcher::Clear() {
+  tables.resize(1);
+  for (auto& bucket : *tables[kBaseLayer]) bucket.reset();
+
+  active = nullptr;
+  activeLayer = kBaseLayer;
+  fired.fill(kNotFired);
+}
+
+void Matcher::SetLayer(Layer layer) {
+  activeLayer = layer;
+  active = layer == kBaseLayer ? nullptr : FindTable(layer);
+}
+
+const Matcher::Registrations& Matcher::Press(KeyCode code) {
+  if (code >= kKeyCodeCount) return kNoRegistrations;
+
+  // auto repeat or a duplicated event from another device
+  if (state.Test(code)) return kNoRegistrations;
+
+  state.Set(code);
+
+  if (allModifierKeys.Test(code)) {
+    UpdateModifiers();
+    return kNoRegistrations;
+  }
+
+  // the active layer shadows the base layer
+  auto layer = activeLayer;
+  auto registrations = Find(active, {code, modifiers});
+
+  if (registrations == nullptr || registrations->empty()) {
+    layer = kBaseLayer;
+    registrations = Find(tables[kBaseLayer].get(), {code, modifiers});
+  }
+
+  if (registrations == nullptr || registrations->empty()) {
+    return kNoRegistrations;
+  }
+
+  fired[code] = modifiers;
+  firedLayers[code] = layer;
+
+  return *registrations;
+}
+
+const Matcher::Registrations& Matcher::Release(KeyCode code) {
+  if (code >= kKeyCodeCount) return kNoRegistrations;
+  if (!state.Test(code)) return kNoRegistrations;
+
+  state.Reset(code);
+
+  if (allModifierKeys.Test(code)) {
+    UpdateModifiers();
+    return kNoRegistrations;
+  }
+
+  auto held = fired[code];
+  if (held == kNotFired) return kNoRegistrations;
+
+  fired[code] = kNotFired;
+
+  auto registrations = Find(FindTable(firedLayers[code]), {code, held});
+  return registrations == nullptr ? kNoRegistrations : *registrations;
+}
+
+void Matcher::ResetState() {
+  state.Clear();
+  modifiers = kModifierNone;
+  fired.fill(kNotFired);
+}
+
+void Matcher::UpdateModifiers() {
+  std::uint8_t next = kModifierNone;
+  for (std::size_t i = 0; i < modifierKeys.size(); i++) {
+    if (state.Intersects(modifierKeys[i])) next |= 1 << i;
+  }
+  modifiers = next;
+}
+
+Matcher::Table* Matcher::FindTable(Layer layer) {
+  return layer < tables.size() ? tables[layer].get() : nullptr;
+}
+
+Matcher::Registrations* Matcher::Find(Table* table, const Chord& chord) {
+  if (table == nullptr) return nullptr;
+  if (chord.key >= kKeyCodeCount) return nullptr;
+  if (chord.modifiers >= kModifierCombinations) return nullptr;
+
+  auto& bucket = (*table)[chord.key];
+  if (!bucket) return nullptr;
+
+  return &(*bucket)[chord.modifiers];
+}
+
+bool ComboMatcher::Add(const Combo& combo, Registration registration) {
+  if (combo.key > kNoKeyCode) return false;
+  if (combo.window <= 0) return false;
+
+  // a combo of one key is just a hotkey
+  std::size_t count = 0;
+  for (auto word : combo.keys.Words()) count += __builtin_popcountll(word);
+  if (count < 2) return false;
+
+  entries.push_back({combo, registration});
+
+  for (std::size_t code = 0; code < kKeyCodeCount; code++) {
+    if (combo.keys.Test(code)) comboKeys.Set(code);
+  }
+
+  return true;
+}
+
+bool ComboMatcher::Remove(Registration registration) {
+  auto it = std::find_if(entries.begin(), entries.end(), [&](auto& entry) {
+    return entry.registration == registration;
+  });
+  if (it == entries.end()) return false;
+
+  entries.erase(it);
+
+  comboKeys.Clear();
+  for (auto& entry : entries) {
+    for (std::size_t code = 0; code < kKeyCodeCount; code++) {
+      if (entry.combo.keys.Test(code)) comboKeys.Set(code);
+    }
+  }
+
+  // a fired combo is released without it
+  for (auto& combo : fired) {
+    auto& registrations = combo.registrations;
+    registrations.erase(
+        std::remove(registrations.begin(), registrations.end(), registration),
+        registrations.end());
+  }
+
+  return true;
+}
+
+void ComboMatcher::Clear() {
+  entries.clear();
+  comboKeys.Clear();
+  ResetState();
+}
+
+void ComboMatcher::Feed(const Input& input, Outputs& outputs) {
+  if (input.code >= kKeyCodeCount) return;
+
+  if (input.pressed) {
+    if (!held.empty()) {
+      if (Extends(input)) {
+        held.push_back(input);
+        heldKeys.Set(input.code);
+        UpdateDeadline();
+
+        // nothing bigger can complete any more
+        if (deadline == 0) Fire(input, outputs);
+
+        return;
+      }
+
+      Flush(outputs);
+    }
+
+    if (comboKeys.Test(input.code) && !Holds(input.code)) {
+      held.push_back(input);
+      heldKeys.Set(input.code);
+      UpdateDeadline();
+      return;
+    }
+
+    outputs.push_back({input, 0});
+    return;
+  }
+
+  // tapped faster than the window, so the combo fires right away
+  if (heldKeys.Test(input.code)) {
+    if (IsComplete()) {
+      Fire(input, outputs);
+    } else {
+      Flush(outputs);
+    }
+  }
+
+  for (auto it = fired.begin(); it != fired.end(); ++it) {
+    if (!it->keys.Test(input.code)) continue;
+
+    Release(*it, input, outputs);
+    it->keys.Reset(input.code);
+    if (it->keys.IsEmpty()) fired.erase(it);
+
+    return;
+  }
+
+  // what was pressed before goes on before the keyup
+  Flush(outputs);
+  outputs.push_back({input, 0});
+}
+
+void ComboMatcher::Expire(std::int64_t now, Outputs& outputs) {
+  if (held.empty() || now < deadline) return;
+
+  if (IsComplete()) {
+    auto last = held.back();
+    last.time = now;
+    Fire(last, outputs);
+  } else {
+    Flush(outputs);
+  }
+}
+
+bool ComboMatcher::Holds(KeyCode code) const {
+  if (code >= kKeyCodeCount) return false;
+  if (heldKeys.Test(code)) return true;
+
+  for (auto& combo : fired) {
+    if (combo.keys.Test(code)) return true;
+  }
+
+  return false;
+}
+
+void ComboMatcher::ResetState() {
+  held.clear();
+  heldKeys.Clear();
+  deadline = 0;
+  fired.clear();
+}
+
+bool ComboMatcher::Extends(const Input& input) const {
+  if (!comboKeys.Test(input.code) || Holds(input.code)) return false;
+
+  auto keys = heldKeys;
+  keys.Set(input.code);
+
+  for (auto& entry : entries) {
+    if (entry.combo.keys.Contains(keys) &&
+        input.time - held.front().time <= entry.combo.window) {
+      return true;
+    }
+  }
+
+  return false;
+}
+
+// whether the held keys are exactly a combo, pressed within its window
+bool ComboMatcher::IsComplete() const {
+  if (held.empty()) return false;
+
+  auto span = held.back().time - held.front().time;
+
+  for (auto& entry : entries) {
+    if (entry.combo.keys == heldKeys && span <= entry.combo.window) {
+      return true;
+    }
+  }
+
+  return false;
+}
+
+// the held keys wait until the longest window of the bigger combos which
+// they may still become, or 0 if there is none
+void ComboMatcher::UpdateDeadline() {
+  deadline = 0;
+
+  for (auto& entry : entries) {
+    if (entry.combo.keys == heldKeys) continue;
+    if (!entry.combo.keys.Contains(heldKeys)) continue;
+
+    auto end = held.front().time + entry.combo.window;
+    if (end >= held.back().time) deadline = std::max(deadline, end);
+  }
+}
+
+void ComboMatcher::Fire(const Input& input, Outputs& outputs) {
+  auto span = held.back().time - held.front().time;
+
+  Fired combo{heldKeys, kNoKeyCode, held.front().source, {}, true};
+
+  for (auto& entry : entries) {
+    if (!(entry.combo.keys == heldKeys) || span > entry.combo.window) continue;
+
+    combo.registrations.push_back(entry.registration);
+    if (combo.key == kNoKeyCode) combo.key = entry.combo.key;
+  }
+
+  for (auto registration : combo.registrations) {
+    outputs.push_back({{input.code, true, input.time, combo.source},
+                       registration});
+  }
+
+  if (combo.key != kNoKeyCode) {
+    outputs.push_back({{combo.key, true, input.time, combo.source}, 0});
+  }
+
+  fired.push_back(std::move(combo));
+
+  held.clear();
+  heldKeys.Clear();
+  deadline = 0;
+}
+
+void ComboMatcher::Release(Fired& combo, const Input& input,
+                           Outputs& outputs) {
+  if (!combo.isPressed) return;
+
+  combo.isPressed = false;
+
+  for (auto registration : combo.registrations) {
+    outputs.push_back({{input.code, false, input.time, combo.source},
+                       registration});
+  }
+
+  if (combo.key != kNoKeyCode) {
+    outputs.push_back({{combo.key, false, input.time, combo.source}, 0});
+  }
+}
+
+void ComboMatcher::Flush(Outputs& outputs) {
+  for (auto& input : held) outputs.push_back({input, 0});
+
+  held.clear();
+  heldKeys.Clear();
+  deadline = 0;
+}
+
+}  // namespace hotcakey
@@ -0,0 +1,255 @@
+#ifndef HOTCAKEY_MATCHER_H_
+#define HOTCAKEY_MATCHER_H_
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "./hotcakey.h"
+
+namespace hotcakey {
+
+// raw key code reported by a low-level input backend (e.g. evdev on linux).
+using KeyCode = std::uint16_t;
+
+constexpr std::size_t kKeyCodeCount = 512;
+
+enum Modifier : std::uint8_t {
+  kModifierNone = 0,
+  kModifierControl = 1 << 0,
+  kModifierShift = 1 << 1,
+  kModifierAlt = 1 << 2,
+  kModifierMeta = 1 << 3,
+};
+
+constexpr std::size_t kModifierCombinations = 16;
+
+struct Chord {
+  KeyCode key;
+  std::uint8_t modifiers;
+};
+
+// a layer is a set of chords on top of the base layer, like a mode of vim.
+// layers are numbered densely by their owner.
+using Layer = std::uint32_t;
+
+constexpr Layer kBaseLayer = 0;
+
+// fixed size bitset of pressed keys.
+// all operations work on whole 64 bit words so that the compiler can
+// vectorize them and the cost does not depend on how many keys are pressed.
+class KeyBitset {
+ public:
+  static constexpr std::size_t kWords = kKeyCodeCount / 64;
+
+  void Set(KeyCode code) { words[code >> 6] |= Bit(code); }
+  void Reset(KeyCode code) { words[code >> 6] &= ~Bit(code); }
+  bool Test(KeyCode code) const { return (words[code >> 6] & Bit(code)) != 0; }
+
+  void Clear() { words.fill(0); }
+  void Fill() { words.fill(~0ULL); }
+
+  bool Intersects(const KeyBitset& other) const {
+    std::uint64_t acc = 0;
+    for (std::size_t i = 0; i < kWords; i++) acc |= words[i] & other.words[i];
+    return acc != 0;
+  }
+
+  bool Contains(const KeyBitset& other) const {
+    std::uint64_t acc = 0;
+    for (std::size_t i = 0; i < kWords; i++) acc |= other.words[i] & ~words[i];
+    return acc == 0;
+  }
+
+  bool IsEmpty() const {
+    std::uint64_t acc = 0;
+    for (std::size_t i = 0; i < kWords; i++) acc |= words[i];
+    return acc == 0;
+  }
+
+  bool operator==(const KeyBitset& other) const {
+    return words == other.words;
+  }
+
+  const std::array<std::uint64_t, kWords>& Words() const { return words; }
+
+ private:
+  static std::uint64_t Bit(KeyCode code) { return 1ULL << (code & 63); }
+
+  std::array<std::uint64_t, kWords> words{};
+};
+
+// `Matcher` decides which registered chords fire for a raw key event.
+//
+// registrations are indexed by trigger key and modifier combination, so
+// a key event costs one table lookup no matter how many chords are
+// registered. left and right modifiers are folded into one `Modifier`
+// like the macOS and windows backends do.
+//
+// chords of the active layer shadow the ones of the base layer, and each
+// layer has its own table, so switching layers is a pointer store no
+// matter how many chords they have.
+//
+// NOTICE:
+// `Matcher` is not thread safe. the owner must serialize calls.
+class Matcher {
+ public:
+  using Registrations = std::vector<Registration>;
+
+  Matcher();
+
+  // tells the matcher that `code` is a physical key of `modifier`.
+  void SetModifierKey(KeyCode code, Modifier modifier);
+
+  bool Add(const Chord& chord, Registration registration,
+           Layer layer = kBaseLayer);
+  bool Remove(const Chord& chord, Registration registration,
+              Layer layer = kBaseLayer);
+  // forgets every chord and goes back to the base layer.
+  void Clear();
+
+  // matches `layer` on top of the base layer from the next key event.
+  // keyup is still delivered to the layer which fired the keydown.
+  void SetLayer(Layer layer);
+  Layer ActiveLayer() const { return activeLayer; }
+
+  // feed a key event and get the registrations to notify.
+  // the returned reference is valid until the next call to the matcher.
+  const Registrations& Press(KeyCode code);
+  const Registrations& Release(KeyCode code);
+
+  // forget pressed keys, e.g. after the input device is lost.
+  void ResetState();
+
+  const KeyBitset& State() const { return state; }
+  std::uint8_t Modifiers() const { return modifiers; }
+
+ private:
+  using Bucket = std::array<Registrations, kModifierCombinations>;
+  using Table = std::array<std::unique_ptr<Bucket>, kKeyCodeCount>;
+
+  static constexpr std::uint8_t kNotFired = 0xFF;
+
+  void UpdateModifiers();
+  Table* FindTable(Layer layer);
+  Registrations* Find(Table* table, const Chord& chord);
+
+  // indexed by layer, allocated when a layer gets its first chord
+  std::vector<std::unique_ptr<Table>> tables;
+  // table of the active layer, or nullptr while only the base is active
+  Table* active = nullptr;
+  Layer activeLayer = kBaseLayer;
+  std::array<KeyBitset, 4> modifierKeys;
+  KeyBitset allModifierKeys;
+  KeyBitset state;
+  std::uint8_t modifiers = kModifierNone;
+
+  // modifiers which were held when each key fired its keydown.
+  // keyup is delivered to the same chord even if a modifier is
+  // released before the trigger key.
+  std::array<std::uint8_t, kKeyCodeCount> fired;
+  std::array<Layer, kKeyCodeCount> firedLayers;
+};
+
+// keys pressed together within a window, like the combos of keyboard
+// firmwares. see `ComboMatcher`.
+struct Combo {
+  KeyBitset keys;
+  std::int64_t window;  // nanoseconds
+  // a key the combo stands for, or `kNoKeyCode`
+  KeyCode key;
+};
+
+constexpr KeyCode kNoKeyCode = kKeyCodeCount;
+
+// `ComboMatcher` finds combos in key events before `Matcher` sees them.
+//
+// a keydown of a combo key is held back while some combo may still
+// complete, and the held keys go on in order as soon as none can, e.g.
+// the window elapsed or another key was pressed. so typing over combo
+// keys only delays them by the window. a complete combo waits for combos
+// of more keys until their window elapses too.
+//
+// the keys of a fired combo never go on. the combo is released with the
+// first of its keys.
+//
+// NOTICE:
+// `ComboMatcher` is not thread safe. the owner must serialize calls.
+class ComboMatcher {
+ public:
+  struct Input {
+    KeyCode code;
+    bool pressed;
+    std::int64_t time;  // monotonic nanoseconds
+    // where the key came from, such as a device
+    int source;
+  };
+
+  // a key event going on to `Matcher`, or a keydown or keyup of the combo
+  // of `registration` if it is not 0. `code` of a combo is the key which
+  // completed it.
+  struct Output {
+    Input input;
+    Registration registration;
+  };
+
+  using Outputs = std::vector<Output>;
+
+  bool Add(const Combo& combo, Registration registration);
+  bool Remove(Registration registration);
+  // forgets every combo and the keys held back.
+  void Clear();
+  bool IsEmpty() const { return entries.empty(); }
+
+  // feed a key event and get what goes on appended to `outputs`.
+  void Feed(const Input& input, Outputs& outputs);
+  // lets the held keys go on, or fires their combo, if the window elapsed
+  // by `now`.
+  void Expire(std::int64_t now, Outputs& outputs);
+  // when `Expire` has something to do, or 0 while no key is held back
+  std::int64_t Deadline() const { return deadline; }
+
+  // whether `code` is held back or belongs to a fired combo, so that its
+  // repeats do not go on either.
+  bool Holds(KeyCode code) const;
+
+  // forget held keys and fired combos, e.g. after the input device is lost.
+  // the held keys are dropped.
+  void ResetState();
+
+ private:
+  struct Entry {
+    Combo combo;
+    Registration registration;
+  };
+
+  // a fired combo whose keys are not all released yet
+  struct Fired {
+    KeyBitset keys;
+    KeyCode key;
+    int source;
+    std::vector<Registration> registrations;
+    bool isPressed;
+  };
+
+  bool Extends(const Input& input) const;
+  bool IsComplete() const;
+  void UpdateDeadline();
+  void Fire(const Input& input, Outputs& outputs);
+  void Release(Fired& fired, const Input& input, Outputs& outputs);
+  void Flush(Outputs& outputs);
+
+  std::vector<Entry> entries;
+  KeyBitset comboKeys;
+  // keydowns held back, in the order they were pressed
+  std::vector<Input> held;
+  KeyBitset heldKeys;
+  std::int64_t deadline = 0;
+  std::vector<Fired> fired;
+};
+
+}  // namespace hotcakey
+
+#endif  // HOTCAKEY_MATCHER_H_
@@ -0,0 +1,86 @@
+#ifndef HOTCAKEY_QUEUE_H_
+#define HOTCAKEY_QUEUE_H_
+
+#include <cstddef>
+#include <mutex>
+#include <vector>
+
+#include "./hotcakey.h"
+
+namespace hotcakey {
+
+// what `EventQueue` does with an event pushed while it is full
+enum OverflowPolicy {
+  // discards the oldest queued event to make room
+  kDropOldest,
+  // discards the pushed event
+  kDropNewest,
+};
+
+// `EventQueue` is a bounded queue of events between the input thread and
+// a consumer which may be busy, e.g. the node.js main thread.
+//
+// pushing never blocks nor allocates. instead of waking the consumer for
+// every event, `Push` tells the producer to wake it only when the
+// consumer has drained the queue since the last wake up.
+class EventQueue {
+ public:
+  EventQueue(std::size_t capacity, OverflowPolicy policy)
+      : events(capacity == 0 ? 1 : capacity, Event(kKeyDown, 0)),
+        policy(policy) {}
+
+  // returns true if the consumer must be woken up
+  bool Push(const Event& event) {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    if (size == events.size()) {
+      dropped++;
+      if (policy == kDropNewest) return false;
+      head = (head + 1) % events.size();
+      size--;
+    }
+
+    events[(head + size) % events.size()] = event;
+    size++;
+
+    if (isWoken) return false;
+    isWoken = true;
+
+    return true;
+  }
+
+  // returns false if empty. the next push wakes the consumer again.
+  bool Pop(Event& event) {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    if (size == 0) {
+      isWoken = false;
+      return false;
+    }
+
+    event = events[head];
+    head = (head + 1) % events.size();
+    size--;
+
+    return true;
+  }
+
+  // number of events discarded by the overflow policy so far
+  std::size_t Dropped() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return dropped;
+  }
+
+ private:
+  std::mutex mutex;
+  std::vector<Event> events;
+  OverflowPolicy policy;
+  std::size_t head = 0;
+  std::size_t size = 0;
+  std::size_t dropped = 0;
+  bool isWoken = false;
+};
+
+}  // namespace hotcakey
+
+#endif  // HOTCAKEY_QUEUE_H_
@@ -0,0 +1,81 @@
+#ifndef HOTCAKEY_RECORDING_H_
+#define HOTCAKEY_RECORDING_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include "./hotcakey.h"
+
+namespace hotcakey {
+namespace recording {
+
+// a raw key event as the input thread saw it.
+//
+// a recording file is a 16 byte header followed by these records as is,
+// so it can be mapped and read without parsing.
+struct Record {
+  // CLOCK_MONOTONIC in nanoseconds
+  std::int64_t timestamp;
+  // key code of the backend (evdev on linux)
+  std::uint16_t code;
+  // `EventType`
+  std::uint8_t type;
+  std::uint8_t reserved;
+  // number of listeners called back with the event
+  std::uint32_t matches;
+};
+
+static_assert(sizeof(Record) == 16, "records must be packed");
+
+// appends records to a recording file. records are buffered and written
+// in pages, so writing one costs no system call most of the time.
+//
+// NOTICE:
+// buffered records are lost if the process dies before `Flush`.
+class Writer {
+ public:
+  // creates (or truncates) the file at `path`. returns nullptr on failure.
+  static std::unique_ptr<Writer> Create(const std::string& path);
+
+  ~Writer();
+
+  void Write(const Record& record);
+  bool Flush();
+
+ private:
+  static constexpr std::size_t kBufferSize = 256;
+
+  explicit Writer(int fd) : fd(fd) {}
+
+  int fd;
+  Record buffer[kBufferSize];
+  std::size_t buffered = 0;
+};
+
+// a recording file mapped read only
+class Reader {
+ public:
+  static std::unique_ptr<Reader> Open(const std::string& path);
+
+  ~Reader();
+
+  std::size_t Size() const { return size; }
+  const Record& operator[](std::size_t i) const { return records[i]; }
+
+ private:
+  Reader(void* memory, std::size_t length, const Record* records,
+         std::size_t size)
+      : memory(memory), length(length), records(records), size(size) {}
+
+  void* memory;
+  std::size_t length;
+  const Record* records;
+  std::size_t size;
+};
+
+}  // namespace recording
+}  // namespace hotcakey
+
+#endif  // HOTCAKEY_RECORDING_H_
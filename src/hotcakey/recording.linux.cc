@@ -0,0 +1,132 @@
+#include "./recording.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+
+#include "./utils/logger.h"
+
+namespace {
+
+constexpr std::uint32_t kMagic = 0x72636b68;  // "hkcr"
+constexpr std::uint32_t kVersion = 1;
+
+struct Header {
+  std::uint32_t magic;
+  std::uint32_t version;
+  std::uint32_t recordSize;
+  std::uint32_t reserved;
+};
+
+static_assert(sizeof(Header) == 16, "header must be packed");
+
+bool WriteAll(int fd, const void* data, std::size_t size) {
+  auto bytes = static_cast<const char*>(data);
+
+  while (size > 0) {
+    auto written = write(fd, bytes, size);
+
+    if (written < 0) {
+      if (errno == EINTR) continue;
+      ERR("failed to write recording: " << std::strerror(errno));
+      return false;
+    }
+
+    bytes += written;
+    size -= written;
+  }
+
+  return true;
+}
+
+}  // namespace
+
+namespace hotcakey {
+namespace recording {
+
+std::unique_ptr<Writer> Writer::Create(const std::string& path) {
+  auto fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+
+  if (fd < 0) {
+    ERR("failed to create recording " << path << ": " << std::strerror(errno));
+    return nullptr;
+  }
+
+  Header header{kMagic, kVersion, sizeof(Record), 0};
+
+  if (!WriteAll(fd, &header, sizeof(header))) {
+    close(fd);
+    return nullptr;
+  }
+
+  return std::unique_ptr<Writer>(new Writer(fd));
+}
+
+Writer::~Writer() {
+  Flush();
+  close(fd);
+}
+
+void Writer::Write(const Record& record) {
+  buffer[buffered++] = record;
+  if (buffered == kBufferSize) Flush();
+}
+
+bool Writer::Flush() {
+  if (buffered == 0) return true;
+
+  auto ok = WriteAll(fd, buffer, sizeof(Record) * buffered);
+  buffered = 0;
+
+  return ok;
+}
+
+std::unique_ptr<Reader> Reader::Open(const std::string& path) {
+  auto fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+
+  if (fd < 0) {
+    ERR("failed to open recording " << path << ": " << std::strerror(errno));
+    return nullptr;
+  }
+
+  struct stat st;
+  if (fstat(fd, &st) != 0 || st.st_size < (off_t)sizeof(Header)) {
+    ERR("not a recording: " << path);
+    close(fd);
+    return nullptr;
+  }
+
+  auto length = static_cast<std::size_t>(st.st_size);
+  auto memory = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+
+  if (memory == MAP_FAILED) {
+    ERR("failed to map recording: " << std::strerror(errno));
+    return nullptr;
+  }
+
+  auto header = static_cast<const Header*>(memory);
+
+  if (header->magic != kMagic || header->version != kVersion ||
+      header->recordSize != sizeof(Record)) {
+    ERR("unsupported recording: " << path);
+    munmap(memory, length);
+    return nullptr;
+  }
+
+  // a partial record at the end is what a crash leaves behind
+  auto size = (length - sizeof(Header)) / sizeof(Record);
+  auto records = reinterpret_cast<const Record*>(static_cast<char*>(memory) +
+                                                 sizeof(Header));
+
+  return std::unique_ptr<Reader>(new Reader(memory, length, records, size));
+}
+
+Reader::~Reader() { munmap(memory, length); }
+
+}  // namespace recording
+}  // namespace hotcakey
@@ -0,0 +1,115 @@
+#ifndef HOTCAKEY_REGISTRY_H_
+#define HOTCAKEY_REGISTRY_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <utility>
+#include <vector>
+
+#include "./hotcakey.h"
+
+namespace hotcakey {
+
+// `Registry` stores values keyed by `Registration` in reusable slots.
+//
+// an id is a slot index with a serial number in the upper bits, so a
+// lookup is an index and a compare, and a stale id never finds the value
+// which reused its slot. freed slots are linked into a free list and the
+// slot vector only grows, so once it has grown to the peak number of
+// registrations, inserting and erasing never allocate.
+//
+// NOTICE:
+// `Registry` is not thread safe. the owner must serialize calls.
+template <typename T>
+class Registry {
+ public:
+  static constexpr unsigned int kSlotBits = 20;
+
+  // inserts `value` and returns its id, which is never 0
+  Registration Insert(T value) {
+    std::uint32_t slot;
+
+    if (freeSlot != kNoSlot) {
+      slot = freeSlot;
+      freeSlot = slots[slot].next;
+    } else {
+      slot = static_cast<std::uint32_t>(slots.size());
+      slots.emplace_back();
+    }
+
+    auto& s = slots[slot];
+    s.id = NextId(slot);
+    s.value.emplace(std::move(value));
+
+    return s.id;
+  }
+
+  T* Find(Registration id) {
+    auto slot = id & kSlotMask;
+    if (slot >= slots.size()) return nullptr;
+
+    auto& s = slots[slot];
+    if (s.id != id || !s.value) return nullptr;
+
+    return &*s.value;
+  }
+
+  bool Erase(Registration id) {
+    if (Find(id) == nullptr) return false;
+
+    auto slot = static_cast<std::uint32_t>(id & kSlotMask);
+    auto& s = slots[slot];
+    s.value.reset();
+    s.id = 0;
+    s.next = freeSlot;
+    freeSlot = slot;
+
+    return true;
+  }
+
+  void Clear() {
+    for (std::uint32_t slot = 0; slot < slots.size(); slot++) {
+      auto& s = slots[slot];
+      if (!s.value) continue;
+
+      s.value.reset();
+      s.id = 0;
+      s.next = freeSlot;
+      freeSlot = slot;
+    }
+  }
+
+  // an id which never collides with inserted values, for registrations
+  // kept outside of the registry
+  Registration Reserve() { return NextId(kSlotMask); }
+
+  template <typename F>
+  void ForEach(F&& f) {
+    for (auto& s : slots) {
+      if (s.value) f(s.id, *s.value);
+    }
+  }
+
+ private:
+  static constexpr Registration kSlotMask = (1UL << kSlotBits) - 1;
+  static constexpr std::uint32_t kNoSlot = UINT32_MAX;
+
+  struct Slot {
+    Registration id = 0;
+    std::uint32_t next = kNoSlot;
+    std::optional<T> value;
+  };
+
+  Registration NextId(Registration slot) {
+    return (++serial << kSlotBits) | slot;
+  }
+
+  std::vector<Slot> slots;
+  std::uint32_t freeSlot = kNoSlot;
+  Registration serial = 0;
+};
+
+}  // namespace hotcakey
+
+#endif  // HOTCAKEY_REGISTRY_H_
@@ -0,0 +1,128 @@
+#ifndef HOTCAKEY_RING_H_
+#define HOTCAKEY_RING_H_
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include "./hotcakey.h"
+
+namespace hotcakey {
+namespace ring {
+
+// an event published to a shared memory ring.
+struct Record {
+  std::uint64_t sequence;
+  // steady clock (CLOCK_MONOTONIC on linux) in nanoseconds,
+  // which is comparable across processes on the same machine.
+  std::int64_t timestamp;
+  Registration registration;
+  std::uint16_t code;
+  EventType type;
+};
+
+struct Header;
+struct Slot;
+struct Signal;
+
+// single producer side of a named shared memory ring.
+//
+// the ring is a broadcast buffer: every reader sees every record, and a
+// slow reader loses the oldest records instead of blocking the writer.
+//
+// records live in memory readers map read only. the futex word readers
+// sleep on and their count live in a separate signal page, the only
+// memory readers write. the writer never trusts either to index the ring.
+class Writer {
+ public:
+  // creates (or replaces) a ring named `name`. `capacity` is rounded up to
+  // a power of two. returns nullptr on failure.
+  static std::unique_ptr<Writer> Create(const std::string& name,
+                                        std::size_t capacity);
+
+  // creates a ring without a name. share it by passing `Fd()` and
+  // `SignalFd()` to another process, e.g. over a unix domain socket.
+  //
+  // NOTICE:
+  // both are sealed against resizing, and `Fd()` against writing, so an
+  // untrusted reader can neither corrupt records nor crash the writer.
+  static std::unique_ptr<Writer> CreateAnonymous(std::size_t capacity);
+
+  ~Writer();
+
+  void Write(Registration registration, std::uint16_t code, EventType type,
+             std::int64_t timestamp);
+
+  const std::string& Name() const { return name; }
+
+  // read only file descriptor of the records of an anonymous ring. -1 for
+  // a named ring.
+  int Fd() const { return fd; }
+  // file descriptor of the signal page of an anonymous ring. -1 for a
+  // named ring.
+  int SignalFd() const { return signalFd; }
+
+ private:
+  Writer(const std::string& name, int fd, int signalFd, void* memory,
+         std::size_t size, Signal* signal, std::size_t capacity);
+
+  std::string name;
+  int fd;
+  int signalFd;
+  void* memory;
+  std::size_t size;
+  Header* header;
+  Slot* slots;
+  Signal* signal;
+  // kept out of the shared memory, which readers may not be trusted with
+  std::size_t capacity;
+  std::uint64_t head = 0;
+};
+
+// consumer side of a ring, usable from any process.
+class Reader {
+ public:
+  static std::unique_ptr<Reader> Open(const std::string& name);
+
+  // attaches to a ring shared by file descriptors, see
+  // `Writer::CreateAnonymous`. takes ownership of both.
+  static std::unique_ptr<Reader> Attach(int fd, int signalFd);
+
+  ~Reader();
+
+  // reads the next record if available.
+  bool Read(Record& record);
+
+  // blocks until a new record may be available or `timeout` passes.
+  // returns immediately if there are unread records.
+  void Wait(std::chrono::milliseconds timeout);
+
+  // wakes up every reader blocked in `Wait` on this ring.
+  void Wake();
+
+  // number of records overwritten before this reader could read them.
+  std::uint64_t Lost() const { return lost; }
+
+ private:
+  Reader(void* memory, std::size_t size, Signal* signal,
+         std::size_t capacity);
+
+  void* memory;
+  std::size_t size;
+  Header* header;
+  Slot* slots;
+  Signal* signal;
+  // checked once on attaching, so the writer cannot change it afterward
+  std::size_t capacity;
+  std::uint64_t cursor;
+  std::uint64_t lost = 0;
+};
+
+std::int64_t Now();
+
+}  // namespace ring
+}  // namespace hotcakey
+
+#endif  // HOTCAKEY_RING_H_
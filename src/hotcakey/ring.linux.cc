@@ -0,0 +1,460 @@
+#include "./ring.h"
+
+#include <fcntl.h>
+#include <linux/futex.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <new>
+#include <string>
+
+#include "./utils/logger.h"
+
+namespace hotcakey {
+namespace ring {
+
+constexpr std::uint32_t kMagic = 0x686f7463;  // "hotc"
+constexpr std::uint32_t kVersion = 2;
+
+struct Header {
+  std::atomic<std::uint32_t> magic;
+  std::uint32_t version;
+  std::uint32_t capacity;
+  std::uint32_t slotSize;
+  // sequence number of the latest record. the first record is 1.
+  alignas(64) std::atomic<std::uint64_t> head;
+};
+
+// `sequence` is 2n - 1 while record n is being written and 2n once it is
+// complete, so readers can detect torn and overwritten slots.
+struct Slot {
+  std::atomic<std::uint64_t> sequence;
+  std::atomic<std::int64_t> timestamp;
+  std::atomic<std::uint64_t> registration;
+  std::atomic<std::uint32_t> payload;
+};
+
+// written by readers too, so the writer only bumps and wakes it
+struct Signal {
+  // futex word bumped on every write
+  std::atomic<std::uint32_t> signal;
+  std::atomic<std::uint32_t> waiters;
+};
+
+static_assert(std::atomic<std::uint64_t>::is_always_lock_free,
+              "shared memory atomics must be lock free");
+static_assert(std::atomic<std::uint32_t>::is_always_lock_free,
+              "shared memory atomics must be lock free");
+
+}  // namespace ring
+}  // namespace hotcakey
+
+namespace {
+
+using hotcakey::ring::Header;
+using hotcakey::ring::Signal;
+using hotcakey::ring::Slot;
+
+constexpr std::size_t kMinCapacity = 16;
+constexpr std::size_t kMaxCapacity = 1 << 20;
+
+// linux 5.1, missing from older headers
+#ifndef F_SEAL_FUTURE_WRITE
+#define F_SEAL_FUTURE_WRITE 0x0010
+#endif
+
+std::string ShmName(const std::string& name) { return "/hotcakey." + name; }
+
+std::string SignalName(const std::string& name) {
+  return ShmName(name) + ".signal";
+}
+
+std::size_t ShmSize(std::size_t capacity) {
+  return sizeof(Header) + sizeof(Slot) * capacity;
+}
+
+std::size_t RoundUpCapacity(std::size_t capacity) {
+  std::size_t rounded = kMinCapacity;
+  while (rounded < capacity && rounded < kMaxCapacity) rounded <<= 1;
+  return rounded;
+}
+
+Slot* Slots(void* memory) {
+  return reinterpret_cast<Slot*>(static_cast<char*>(memory) + sizeof(Header));
+}
+
+// sizes `fd` for `capacity` records, maps it and initializes the ring.
+void* MapNewRing(int fd, std::size_t capacity) {
+  auto size = ShmSize(capacity);
+
+  if (ftruncate(fd, size) != 0) {
+    ERR("failed to resize ring: " << std::strerror(errno));
+    return nullptr;
+  }
+
+  auto memory = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+
+  if (memory == MAP_FAILED) {
+    ERR("failed to map ring: " << std::strerror(errno));
+    return nullptr;
+  }
+
+  auto header = new (memory) Header();
+  header->version = hotcakey::ring::kVersion;
+  header->capacity = capacity;
+  header->slotSize = sizeof(Slot);
+
+  auto slots = Slots(memory);
+  for (std::size_t i = 0; i < capacity; i++) new (&slots[i]) Slot();
+
+  // readers check the magic last, so publish it after everything else
+  header->magic.store(hotcakey::ring::kMagic, std::memory_order_release);
+
+  return memory;
+}
+
+// sizes `fd` for the signal page and maps it
+Signal* MapNewSignal(int fd) {
+  if (ftruncate(fd, sizeof(Signal)) != 0) {
+    ERR("failed to resize ring signal: " << std::strerror(errno));
+    return nullptr;
+  }
+
+  auto memory = mmap(nullptr, sizeof(Signal), PROT_READ | PROT_WRITE,
+                     MAP_SHARED, fd, 0);
+
+  if (memory == MAP_FAILED) {
+    ERR("failed to map ring signal: " << std::strerror(errno));
+    return nullptr;
+  }
+
+  return new (memory) Signal();
+}
+
+Signal* MapSignal(int fd) {
+  struct stat st;
+  if (fstat(fd, &st) != 0 || st.st_size != (off_t)sizeof(Signal)) {
+    ERR("ring signal is broken");
+    return nullptr;
+  }
+
+  auto memory = mmap(nullptr, sizeof(Signal), PROT_READ | PROT_WRITE,
+                     MAP_SHARED, fd, 0);
+
+  if (memory == MAP_FAILED) {
+    ERR("failed to map ring signal: " << std::strerror(errno));
+    return nullptr;
+  }
+
+  return static_cast<Signal*>(memory);
+}
+
+// reopens `fd` read only. the seals keep it from being reopened writable
+// through /proc again.
+int ReopenReadOnly(int fd) {
+  auto path = "/proc/self/fd/" + std::to_string(fd);
+  return open(path.c_str(), O_RDONLY | O_CLOEXEC);
+}
+
+// NOTICE:
+// no FUTEX_PRIVATE_FLAG since waiters live in other processes.
+void FutexWait(std::atomic<std::uint32_t>* word, std::uint32_t expected,
+               std::chrono::milliseconds timeout) {
+  timespec ts;
+  ts.tv_sec = timeout.count() / 1000;
+  ts.tv_nsec = (timeout.count() % 1000) * 1000000;
+  syscall(SYS_futex, reinterpret_cast<std::uint32_t*>(word), FUTEX_WAIT,
+          expected, &ts, nullptr, 0);
+}
+
+void FutexWake(std::atomic<std::uint32_t>* word) {
+  syscall(SYS_futex, reinterpret_cast<std::uint32_t*>(word), FUTEX_WAKE,
+          INT32_MAX, nullptr, nullptr, 0);
+}
+
+}  // namespace
+
+namespace hotcakey {
+namespace ring {
+
+std::unique_ptr<Writer> Writer::Create(const std::string& name,
+                                       std::size_t capacity) {
+  auto shmName = ShmName(name);
+  auto signalName = SignalName(name);
+
+  // a ring left behind by a crashed writer
+  shm_unlink(shmName.c_str());
+  shm_unlink(signalName.c_str());
+
+  auto fd = shm_open(shmName.c_str(), O_CREAT | O_EXCL | O_RDWR | O_CLOEXEC,
+                     S_IRUSR | S_IWUSR);
+  auto signalFd =
+      shm_open(signalName.c_str(), O_CREAT | O_EXCL | O_RDWR | O_CLOEXEC,
+               S_IRUSR | S_IWUSR);
+
+  if (fd < 0 || signalFd < 0) {
+    ERR("failed to create ring " << shmName << ": " << std::strerror(errno));
+    if (fd >= 0) close(fd);
+    if (signalFd >= 0) close(signalFd);
+    shm_unlink(shmName.c_str());
+    shm_unlink(signalName.c_str());
+    return nullptr;
+  }
+
+  capacity = RoundUpCapacity(capacity);
+  auto size = ShmSize(capacity);
+  auto memory = MapNewRing(fd, capacity);
+  auto signal = MapNewSignal(signalFd);
+  close(fd);
+  close(signalFd);
+
+  if (memory == nullptr || signal == nullptr) {
+    if (memory != nullptr) munmap(memory, size);
+    if (signal != nullptr) munmap(signal, sizeof(Signal));
+    shm_unlink(shmName.c_str());
+    shm_unlink(signalName.c_str());
+    return nullptr;
+  }
+
+  LOG("ring " << shmName << " created with capacity: " << capacity);
+
+  return std::unique_ptr<Writer>(
+      new Writer(name, -1, -1, memory, size, signal, capacity));
+}
+
+std::unique_ptr<Writer> Writer::CreateAnonymous(std::size_t capacity) {
+  auto fd = memfd_create("hotcakey-ring", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+  auto signalFd =
+      memfd_create("hotcakey-ring-signal", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+
+  if (fd < 0 || signalFd < 0) {
+    ERR("failed to create anonymous ring: " << std::strerror(errno));
+    if (fd >= 0) close(fd);
+    if (signalFd >= 0) close(signalFd);
+    return nullptr;
+  }
+
+  capacity = RoundUpCapacity(capacity);
+  auto size = ShmSize(capacity);
+  auto memory = MapNewRing(fd, capacity);
+  auto signal = MapNewSignal(signalFd);
+  auto readOnlyFd = -1;
+
+  // our own mappings stay writable, while no one else can write records,
+  // and nobody can shrink what we map
+  constexpr int kSizeSeals = F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_SEAL;
+
+  if (memory != nullptr && signal != nullptr &&
+      fcntl(fd, F_ADD_SEALS, kSizeSeals | F_SEAL_FUTURE_WRITE) == 0 &&
+      fcntl(signalFd, F_ADD_SEALS, kSizeSeals) == 0) {
+    readOnlyFd = ReopenReadOnly(fd);
+  } else {
+    ERR("failed to seal anonymous ring: " << std::strerror(errno));
+  }
+
+  close(fd);
+
+  if (readOnlyFd < 0) {
+    if (memory != nullptr) munmap(memory, size);
+    if (signal != nullptr) munmap(signal, sizeof(Signal));
+    close(signalFd);
+    return nullptr;
+  }
+
+  LOG("anonymous ring created with capacity: " << capacity);
+
+  return std::unique_ptr<Writer>(
+      new Writer("", readOnlyFd, signalFd, memory, size, signal, capacity));
+}
+
+Writer::Writer(const std::string& name, int fd, int signalFd, void* memory,
+               std::size_t size, Signal* signal, std::size_t capacity)
+    : name(name),
+      fd(fd),
+      signalFd(signalFd),
+      memory(memory),
+      size(size),
+      header(static_cast<Header*>(memory)),
+      slots(Slots(memory)),
+      signal(signal),
+      capacity(capacity) {}
+
+Writer::~Writer() {
+  munmap(memory, size);
+  munmap(signal, sizeof(Signal));
+
+  // readers keep their mappings, only the name goes away
+  if (fd >= 0) {
+    close(fd);
+    close(signalFd);
+  } else {
+    shm_unlink(ShmName(name).c_str());
+    shm_unlink(SignalName(name).c_str());
+  }
+}
+
+void Writer::Write(Registration registration, std::uint16_t code,
+                   EventType type, std::int64_t timestamp) {
+  auto sequence = ++head;
+  auto& slot = slots[(sequence - 1) & (capacity - 1)];
+
+  slot.sequence.store(sequence * 2 - 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+
+  slot.timestamp.store(timestamp, std::memory_order_relaxed);
+  slot.registration.store(registration, std::memory_order_relaxed);
+  slot.payload.store(code | static_cast<std::uint32_t>(type) << 16,
+                     std::memory_order_relaxed);
+
+  slot.sequence.store(sequence * 2, std::memory_order_release);
+  header->head.store(sequence, std::memory_order_seq_cst);
+  signal->signal.fetch_add(1, std::memory_order_seq_cst);
+
+  // skip the syscall while nobody sleeps
+  if (signal->waiters.load(std::memory_order_seq_cst) > 0) {
+    FutexWake(&signal->signal);
+  }
+}
+
+std::unique_ptr<Reader> Reader::Open(const std::string& name) {
+  auto shmName = ShmName(name);
+  auto fd = shm_open(shmName.c_str(), O_RDONLY | O_CLOEXEC, 0);
+
+  if (fd < 0) {
+    ERR("failed to open ring " << shmName << ": " << std::strerror(errno));
+    return nullptr;
+  }
+
+  auto signalFd = shm_open(SignalName(name).c_str(), O_RDWR | O_CLOEXEC, 0);
+
+  if (signalFd < 0) {
+    ERR("failed to open ring " << shmName << ": " << std::strerror(errno));
+    close(fd);
+    return nullptr;
+  }
+
+  return Attach(fd, signalFd);
+}
+
+std::unique_ptr<Reader> Reader::Attach(int fd, int signalFd) {
+  auto signal = MapSignal(signalFd);
+  close(signalFd);
+
+  struct stat st;
+  if (signal == nullptr || fstat(fd, &st) != 0 ||
+      st.st_size < (off_t)sizeof(Header)) {
+    ERR("ring is broken");
+    if (signal != nullptr) munmap(signal, sizeof(Signal));
+    close(fd);
+    return nullptr;
+  }
+
+  auto size = static_cast<std::size_t>(st.st_size);
+  auto memory = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+
+  if (memory == MAP_FAILED) {
+    ERR("failed to map ring: " << std::strerror(errno));
+    munmap(signal, sizeof(Signal));
+    return nullptr;
+  }
+
+  auto header = static_cast<Header*>(memory);
+  auto capacity = header->capacity;
+
+  if (header->magic.load(std::memory_order_acquire) != kMagic ||
+      header->version != kVersion || header->slotSize != sizeof(Slot) ||
+      capacity == 0 || (capacity & (capacity - 1)) != 0 ||
+      ShmSize(capacity) != size) {
+    ERR("ring is not compatible");
+    munmap(memory, size);
+    munmap(signal, sizeof(Signal));
+    return nullptr;
+  }
+
+  return std::unique_ptr<Reader>(new Reader(memory, size, signal, capacity));
+}
+
+Reader::Reader(void* memory, std::size_t size, Signal* signal,
+               std::size_t capacity)
+    : memory(memory),
+      size(size),
+      header(static_cast<Header*>(memory)),
+      slots(Slots(memory)),
+      signal(signal),
+      capacity(capacity),
+      cursor(header->head.load(std::memory_order_acquire)) {}
+
+Reader::~Reader() {
+  munmap(memory, size);
+  munmap(signal, sizeof(Signal));
+}
+
+bool Reader::Read(Record& record) {
+  while (true) {
+    auto next = cursor + 1;
+    auto& slot = slots[(next - 1) & (capacity - 1)];
+    auto sequence = slot.sequence.load(std::memory_order_acquire);
+
+    // not written yet, or being written
+    if (sequence < next * 2) return false;
+
+    if (sequence == next * 2) {
+      record.sequence = next;
+      record.timestamp = slot.timestamp.load(std::memory_order_relaxed);
+      record.registration = slot.registration.load(std::memory_order_relaxed);
+      auto payload = slot.payload.load(std::memory_order_relaxed);
+      record.code = payload & 0xFFFF;
+      record.type = static_cast<EventType>(payload >> 16);
+
+      std::atomic_thread_fence(std::memory_order_acquire);
+
+      if (slot.sequence.load(std::memory_order_relaxed) == sequence) {
+        cursor = next;
+        return true;
+      }
+    }
+
+    // the writer lapped us. skip to the oldest record still in the ring.
+    auto head = header->head.load(std::memory_order_acquire);
+    auto oldest = head > capacity ? head - capacity + 1 : 1;
+    if (oldest <= next) oldest = next + 1;
+
+    lost += oldest - next;
+    cursor = oldest - 1;
+  }
+}
+
+void Reader::Wait(std::chrono::milliseconds timeout) {
+  auto current = signal->signal.load(std::memory_order_seq_cst);
+
+  if (header->head.load(std::memory_order_seq_cst) > cursor) return;
+
+  signal->waiters.fetch_add(1, std::memory_order_seq_cst);
+
+  if (header->head.load(std::memory_order_seq_cst) <= cursor) {
+    FutexWait(&signal->signal, current, timeout);
+  }
+
+  signal->waiters.fetch_sub(1, std::memory_order_seq_cst);
+}
+
+void Reader::Wake() {
+  signal->signal.fetch_add(1, std::memory_order_seq_cst);
+  FutexWake(&signal->signal);
+}
+
+std::int64_t Now() {
+  timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return static_cast<std::int64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+}
+
+}  // namespace ring
+}  // namespace hotcakey
@@ -0,0 +1,20 @@
+#ifndef HOTCAKEY_SCHEDULING_H_
+#define HOTCAKEY_SCHEDULING_H_
+
+#include "./hotcakey.h"
+
+namespace hotcakey {
+namespace scheduling {
+
+// applies `option` to the calling thread, which must be the input thread.
+// never fails: anything not permitted or not supported ends up as a
+// warning of the report instead.
+ActivationReport Apply(const ActivationOption& option);
+
+// unlocks memory locked by `Apply`. call it on the same thread.
+void Release(const ActivationReport& report);
+
+}  // namespace scheduling
+}  // namespace hotcakey
+
+#endif  // HOTCAKEY_SCHEDULING_H_
@@ -0,0 +1,169 @@
+#include "./scheduling.h"
+
+#include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+#include "./utils/logger.h"
+
+namespace {
+
+void Warn(hotcakey::ActivationReport& report, const std::string& warning) {
+  WRN(warning);
+  report.warnings.push_back(warning);
+}
+
+// the input thread never recurses deeply, so locking the whole stack
+// would only eat RLIMIT_MEMLOCK
+constexpr std::size_t kLockedStackSize = 256 * 1024;
+
+// the topmost `kLockedStackSize` bytes of the stack, which grows down
+bool GetStack(void*& address, std::size_t& size) {
+  pthread_attr_t attr;
+  if (pthread_getattr_np(pthread_self(), &attr) != 0) return false;
+  auto ok = pthread_attr_getstack(&attr, &address, &size) == 0;
+  pthread_attr_destroy(&attr);
+  if (!ok) return false;
+
+  if (size > kLockedStackSize) {
+    address = static_cast<char*>(address) + size - kLockedStackSize;
+    size = kLockedStackSize;
+  }
+
+  return true;
+}
+
+void ApplyAffinity(const hotcakey::ActivationOption& option,
+                   hotcakey::ActivationReport& report) {
+  if (option.cpus.empty()) return;
+
+  cpu_set_t set;
+  CPU_ZERO(&set);
+
+  for (auto cpu : option.cpus) {
+    if (cpu < 0 || cpu >= CPU_SETSIZE) {
+      Warn(report, "ignored invalid cpu: " + std::to_string(cpu));
+      continue;
+    }
+    CPU_SET(cpu, &set);
+  }
+
+  if (CPU_COUNT(&set) == 0) return;
+
+  if (sched_setaffinity(0, sizeof(set), &set) != 0) {
+    Warn(report, std::string("failed to set cpu affinity: ") +
+                     std::strerror(errno));
+    return;
+  }
+
+  for (auto cpu : option.cpus) {
+    if (cpu >= 0 && cpu < CPU_SETSIZE) report.cpus.push_back(cpu);
+  }
+}
+
+bool ApplyRealtime(const hotcakey::ActivationOption& option,
+                   hotcakey::ActivationReport& report) {
+  auto policy = option.policy == hotcakey::kSchedulingFifo ? SCHED_FIFO
+                                                           : SCHED_RR;
+
+  sched_param param{};
+  param.sched_priority =
+      std::clamp(option.priority, sched_get_priority_min(policy),
+                 sched_get_priority_max(policy));
+
+  // NOTICE:
+  // pid 0 of sched_setscheduler means the calling thread, not the process.
+  if (sched_setscheduler(0, policy, &param) != 0) {
+    Warn(report, "cannot use " + hotcakey::ToString(option.policy) +
+                     " scheduling: " + std::strerror(errno) +
+                     ". fall back to the default policy");
+    return false;
+  }
+
+  report.policy = option.policy;
+  report.priority = param.sched_priority;
+
+  return true;
+}
+
+void ApplyNice(const hotcakey::ActivationOption& option,
+               hotcakey::ActivationReport& report) {
+  if (option.nice == 0) return;
+
+  // the nice value is per thread on linux
+  auto tid = static_cast<id_t>(syscall(SYS_gettid));
+
+  if (setpriority(PRIO_PROCESS, tid, option.nice) != 0) {
+    Warn(report, "failed to set nice " + std::to_string(option.nice) + ": " +
+                     std::strerror(errno));
+    return;
+  }
+
+  report.nice = option.nice;
+}
+
+void ApplyMemoryLock(const hotcakey::ActivationOption& option,
+                     hotcakey::ActivationReport& report) {
+  if (!option.lockMemory) return;
+
+  // mlockall would pin the whole host process (e.g. the node.js heap),
+  // so only the hot part of the input thread stack is locked.
+  void* address;
+  std::size_t size;
+
+  if (!GetStack(address, size)) {
+    Warn(report, "cannot find the stack of the input thread");
+    return;
+  }
+
+  if (mlock(address, size) != 0) {
+    Warn(report, std::string("failed to lock memory: ") +
+                     std::strerror(errno));
+    return;
+  }
+
+  report.lockMemory = true;
+}
+
+}  // namespace
+
+namespace hotcakey {
+namespace scheduling {
+
+ActivationReport Apply(const ActivationOption& option) {
+  ActivationReport report;
+
+  ApplyAffinity(option, report);
+
+  if (option.policy == kSchedulingDefault || !ApplyRealtime(option, report)) {
+    ApplyNice(option, report);
+  }
+
+  ApplyMemoryLock(option, report);
+
+  LOG("input thread scheduling: " << ToString(report.policy)
+                                  << ", priority: " << report.priority
+                                  << ", nice: " << report.nice
+                                  << ", cpus: " << report.cpus.size()
+                                  << ", memory locked: " << report.lockMemory);
+
+  return report;
+}
+
+void Release(const ActivationReport& report) {
+  if (!report.lockMemory) return;
+
+  void* address;
+  std::size_t size;
+  if (GetStack(address, size)) munlock(address, size);
+}
+
+}  // namespace scheduling
+}  // namespace hotcakey
@@ -0,0 +1,95 @@
+#include "./scheduling.h"
+
+#include <pthread.h>
+#include <sys/mman.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+#include "./utils/logger.h"
+
+namespace {
+
+void Warn(hotcakey::ActivationReport& report, const std::string& warning) {
+  WRN(warning);
+  report.warnings.push_back(warning);
+}
+
+constexpr std::size_t kLockedStackSize = 256 * 1024;
+
+// the topmost `kLockedStackSize` bytes of the stack. NOTICE: the stack
+// address of darwin is the highest address.
+void GetStack(void*& address, std::size_t& size) {
+  size = std::min(pthread_get_stacksize_np(pthread_self()), kLockedStackSize);
+  address = static_cast<char*>(pthread_get_stackaddr_np(pthread_self())) - size;
+}
+
+}  // namespace
+
+namespace hotcakey {
+namespace scheduling {
+
+ActivationReport Apply(const ActivationOption& option) {
+  ActivationReport report;
+
+  if (!option.cpus.empty()) {
+    // thread affinity policy of darwin is only a hint for cache sharing
+    Warn(report, "cpu affinity is not supported on this platform");
+  }
+
+  auto realtime = false;
+
+  if (option.policy != kSchedulingDefault) {
+    auto policy = option.policy == kSchedulingFifo ? SCHED_FIFO : SCHED_RR;
+
+    sched_param param{};
+    param.sched_priority =
+        std::clamp(option.priority, sched_get_priority_min(policy),
+                   sched_get_priority_max(policy));
+
+    auto error = pthread_setschedparam(pthread_self(), policy, &param);
+
+    if (error == 0) {
+      report.policy = option.policy;
+      report.priority = param.sched_priority;
+      realtime = true;
+    } else {
+      Warn(report, "cannot use " + ToString(option.policy) +
+                       " scheduling: " + std::strerror(error));
+    }
+  }
+
+  if (!realtime && option.nice != 0) {
+    // darwin has no per thread nice value, and renicing the whole
+    // process would affect the host application too.
+    Warn(report, "nice is not supported on this platform");
+  }
+
+  if (option.lockMemory) {
+    void* address;
+    std::size_t size;
+    GetStack(address, size);
+
+    if (mlock(address, size) == 0) {
+      report.lockMemory = true;
+    } else {
+      Warn(report, std::string("failed to lock memory: ") +
+                       std::strerror(errno));
+    }
+  }
+
+  return report;
+}
+
+void Release(const ActivationReport& report) {
+  if (!report.lockMemory) return;
+
+  void* address;
+  std::size_t size;
+  GetStack(address, size);
+  munlock(address, size);
+}
+
+}  // namespace scheduling
+}  // namespace hotcakey
@@ -0,0 +1,110 @@
+#include "./scheduling.h"
+
+#include <windows.h>
+
+#include "./utils/logger.h"
+
+namespace {
+
+void Warn(hotcakey::ActivationReport& report, const std::string& warning) {
+  WRN(warning);
+  report.warnings.push_back(warning);
+}
+
+// maps a unix nice value to the nearest thread priority
+int ToThreadPriority(int nice) {
+  if (nice <= -10) return THREAD_PRIORITY_HIGHEST;
+  if (nice < 0) return THREAD_PRIORITY_ABOVE_NORMAL;
+  if (nice >= 10) return THREAD_PRIORITY_LOWEST;
+  if (nice > 0) return THREAD_PRIORITY_BELOW_NORMAL;
+  return THREAD_PRIORITY_NORMAL;
+}
+
+// the committed part of the stack. the rest is only reserved and
+// cannot be locked.
+bool GetStack(void*& address, std::size_t& size) {
+  MEMORY_BASIC_INFORMATION info;
+  if (VirtualQuery(&info, &info, sizeof(info)) == 0) return false;
+  address = info.BaseAddress;
+  size = info.RegionSize;
+  return info.State == MEM_COMMIT;
+}
+
+}  // namespace
+
+namespace hotcakey {
+namespace scheduling {
+
+ActivationReport Apply(const ActivationOption& option) {
+  ActivationReport report;
+  auto thread = GetCurrentThread();
+
+  if (!option.cpus.empty()) {
+    DWORD_PTR mask = 0;
+
+    for (auto cpu : option.cpus) {
+      if (cpu < 0 || cpu >= static_cast<int>(sizeof(DWORD_PTR) * 8)) {
+        Warn(report, "ignored invalid cpu: " + std::to_string(cpu));
+        continue;
+      }
+      mask |= static_cast<DWORD_PTR>(1) << cpu;
+      report.cpus.push_back(cpu);
+    }
+
+    if (mask != 0 && SetThreadAffinityMask(thread, mask) == 0) {
+      Warn(report, "failed to set cpu affinity with error: " +
+                       std::to_string(GetLastError()));
+      report.cpus.clear();
+    }
+  }
+
+  auto realtime = false;
+
+  if (option.policy != kSchedulingDefault) {
+    // windows has no realtime policy per thread. time critical is the
+    // closest, and fifo and round robin are treated the same.
+    if (SetThreadPriority(thread, THREAD_PRIORITY_TIME_CRITICAL)) {
+      report.policy = option.policy;
+      report.priority = THREAD_PRIORITY_TIME_CRITICAL;
+      realtime = true;
+    } else {
+      Warn(report, "cannot use " + ToString(option.policy) +
+                       " scheduling with error: " +
+                       std::to_string(GetLastError()));
+    }
+  }
+
+  if (!realtime && option.nice != 0) {
+    if (SetThreadPriority(thread, ToThreadPriority(option.nice))) {
+      report.nice = option.nice;
+    } else {
+      Warn(report, "failed to set thread priority with error: " +
+                       std::to_string(GetLastError()));
+    }
+  }
+
+  if (option.lockMemory) {
+    void* address;
+    std::size_t size;
+
+    if (GetStack(address, size) && VirtualLock(address, size)) {
+      report.lockMemory = true;
+    } else {
+      Warn(report, "failed to lock memory with error: " +
+                       std::to_string(GetLastError()));
+    }
+  }
+
+  return report;
+}
+
+void Release(const ActivationReport& report) {
+  if (!report.lockMemory) return;
+
+  void* address;
+  std::size_t size;
+  if (GetStack(address, size)) VirtualUnlock(address, size);
+}
+
+}  // namespace scheduling
+}  // namespace hotcakey
@@ -0,0 +1,41 @@
+#ifndef HOTCAKEY_SYNTHETIC_H_
+#define HOTCAKEY_SYNTHETIC_H_
+
+#include <string>
+#include <utility>
+
+#include "./hotcakey.h"
+
+namespace hotcakey {
+namespace synthetic {
+
+// feeds a fake key event into the input thread of an activated backend.
+// the event goes through the same matching and dispatch path as events
+// from real devices, so tests can run without a keyboard.
+//
+// NOTICE:
+// only the linux backend supports synthetic events, and not while it
+// talks to hotcakeyd.
+Result Emit(const std::string& key, EventType type);
+
+using DeviceResult = std::pair<Result, int>;
+
+// plugs in a fake keyboard described by `device`. it goes through the
+// same device registry as real ones, so `RegisterOnDevice` and
+// `Devices` see it. returns a handle for `Emit` and `RemoveDevice`.
+DeviceResult AddDevice(const Device& device);
+// unplugs the fake keyboard. events emitted before are still read.
+Result RemoveDevice(int device);
+// feeds a fake key event from the fake keyboard `device`
+Result Emit(int device, const std::string& key, EventType type);
+
+// passes the events of grabbed keyboards on to `fd`, such as a pipe,
+// instead of a uinput keyboard, so grabbing works without /dev/uinput.
+// fake keyboards added while grabbing are grabbed. -1 goes back to
+// uinput. only while inactive.
+Result SetPassthrough(int fd);
+
+}  // namespace synthetic
+}  // namespace hotcakey
+
+#endif  // HOTCAKEY_SYNTHETIC_H_
@@ -0,0 +1,253 @@
+#include "./trace.h"
+
+#if defined(_WIN32)
+#include <process.h>
+#include <windows.h>
+#elif defined(__APPLE__)
+#include <pthread.h>
+#include <unistd.h>
+#else
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <vector>
+
+namespace {
+
+struct Record {
+  std::int64_t timestamp;
+  std::uint64_t id;
+  hotcakey::trace::Stage stage;
+};
+
+// written only by its own thread. `size` is published with release
+// ordering, so `Dump` reads a consistent prefix while recording goes on.
+// `dropped` is counted only once `size` reached the capacity, so `Dump`
+// loads it first.
+struct Buffer {
+  std::vector<Record> records;
+  std::atomic<std::size_t> size{0};
+  std::atomic<std::size_t> dropped{0};
+  std::uint64_t tid;
+  std::string name;
+};
+
+std::atomic<bool> isEnabled(false);
+std::atomic<std::uint64_t> sequence(0);
+std::atomic<std::uint32_t> generation(0);
+
+std::mutex mutex;
+std::size_t capacity = 0;
+std::vector<std::shared_ptr<Buffer>> buffers;
+
+// NOTICE:
+// a thread keeps its own reference, so a buffer of a previous session
+// stays valid until the thread notices the new generation.
+thread_local std::shared_ptr<Buffer> localBuffer;
+thread_local std::uint32_t localGeneration = 0;
+thread_local const char* threadName = nullptr;
+
+std::uint64_t ThreadId() {
+#if defined(_WIN32)
+  return GetCurrentThreadId();
+#elif defined(__APPLE__)
+  std::uint64_t tid = 0;
+  pthread_threadid_np(nullptr, &tid);
+  return tid;
+#else
+  return static_cast<std::uint64_t>(syscall(SYS_gettid));
+#endif
+}
+
+int ProcessId() {
+#if defined(_WIN32)
+  return _getpid();
+#else
+  return getpid();
+#endif
+}
+
+Buffer* LocalBuffer() {
+  auto current = generation.load(std::memory_order_acquire);
+  if (localBuffer && localGeneration == current) return localBuffer.get();
+
+  auto buffer = std::make_shared<Buffer>();
+  buffer->tid = ThreadId();
+  buffer->name = threadName != nullptr ? threadName : "";
+
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    buffer->records.resize(capacity);
+    buffers.push_back(buffer);
+  }  // lock(mutex)
+
+  localBuffer = buffer;
+  localGeneration = current;
+
+  return buffer.get();
+}
+
+const char* ToName(hotcakey::trace::Stage stage) {
+  switch (stage) {
+    case hotcakey::trace::kReceived:
+      return "received";
+    case hotcakey::trace::kHandled:
+      return "handled";
+    case hotcakey::trace::kMatched:
+      return "matched";
+    case hotcakey::trace::kEnqueued:
+      return "enqueued";
+    case hotcakey::trace::kInvoked:
+    case hotcakey::trace::kReturned:
+      return "listener";
+  }
+  return "unknown";
+}
+
+// thread names are given by callers, so quotes, backslashes and control
+// characters are escaped for json
+std::string Escape(const std::string& text) {
+  std::stringstream escaped;
+
+  for (unsigned char c : text) {
+    if (c == '"' || c == '\\') {
+      escaped << '\\' << c;
+    } else if (c < 0x20) {
+      const char* digits = "0123456789abcdef";
+      escaped << "\\u00" << digits[c >> 4] << digits[c & 0xf];
+    } else {
+      escaped << c;
+    }
+  }
+
+  return escaped.str();
+}
+
+// microseconds with sub microsecond precision, as chrome expects
+double ToMicroseconds(std::int64_t nanoseconds) { return nanoseconds / 1000.0; }
+
+}  // namespace
+
+namespace hotcakey {
+namespace trace {
+
+void Start(std::size_t size) {
+  std::lock_guard<std::mutex> lock(mutex);
+
+  capacity = size;
+  buffers.clear();
+  generation.fetch_add(1, std::memory_order_acq_rel);
+  isEnabled.store(true, std::memory_order_release);
+}
+
+void Stop() { isEnabled.store(false, std::memory_order_release); }
+
+bool IsEnabled() { return isEnabled.load(std::memory_order_relaxed); }
+
+std::uint64_t NextId() {
+  if (!IsEnabled()) return 0;
+  return sequence.fetch_add(1, std::memory_order_relaxed) + 1;
+}
+
+std::int64_t Now() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+void Record(Stage stage, std::uint64_t id, std::int64_t timestamp) {
+  if (!IsEnabled() || id == 0) return;
+
+  auto buffer = LocalBuffer();
+  auto size = buffer->size.load(std::memory_order_relaxed);
+
+  if (size == buffer->records.size()) {
+    buffer->dropped.fetch_add(1, std::memory_order_release);
+    return;
+  }
+
+  buffer->records[size] = {timestamp, id, stage};
+  buffer->size.store(size + 1, std::memory_order_release);
+}
+
+void SetThreadName(const char* name) { threadName = name; }
+
+std::string Dump() {
+  std::lock_guard<std::mutex> lock(mutex);
+
+  auto pid = ProcessId();
+  std::stringstream json;
+  auto first = true;
+
+  auto separate = [&] {
+    if (!first) json << ",\n";
+    first = false;
+  };
+
+  json << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n";
+
+  for (auto& buffer : buffers) {
+    auto dropped = buffer->dropped.load(std::memory_order_acquire);
+    auto size = buffer->size.load(std::memory_order_acquire);
+
+    separate();
+    json << "{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":" << pid
+         << ",\"tid\":" << buffer->tid << ",\"args\":{\"name\":\""
+         << (buffer->name.empty() ? "hotcakey" : Escape(buffer->name))
+         << "\"}}";
+
+    for (std::size_t i = 0; i < size; i++) {
+      auto& record = buffer->records[i];
+
+      // the listener is a slice, and the other stages are instants.
+      // flow events join the stages of one event across threads.
+      const char* phase = "i";
+      if (record.stage == kInvoked) phase = "B";
+      if (record.stage == kReturned) phase = "E";
+
+      separate();
+      json << "{\"ph\":\"" << phase << "\",\"name\":\"" << ToName(record.stage)
+           << "\",\"cat\":\"hotcakey\",\"pid\":" << pid
+           << ",\"tid\":" << buffer->tid << ",\"ts\":" << std::fixed
+           << ToMicroseconds(record.timestamp)
+           << (record.stage < kInvoked ? ",\"s\":\"t\"" : "")
+           << ",\"args\":{\"event\":" << record.id << "}}";
+
+      if (record.stage == kReturned) continue;
+
+      const char* flow = record.stage == kReceived ? "s"
+                         : record.stage == kInvoked ? "f"
+                                                    : "t";
+
+      separate();
+      json << "{\"ph\":\"" << flow
+           << "\",\"name\":\"event\",\"cat\":\"hotcakey\",\"id\":" << record.id
+           << ",\"pid\":" << pid << ",\"tid\":" << buffer->tid
+           << ",\"ts\":" << ToMicroseconds(record.timestamp)
+           << (record.stage == kInvoked ? ",\"bp\":\"e\"" : "") << "}";
+    }
+
+    if (dropped != 0) {
+      separate();
+      json << "{\"ph\":\"i\",\"name\":\"dropped " << dropped
+           << " records\",\"cat\":\"hotcakey\",\"s\":\"t\",\"pid\":" << pid
+           << ",\"tid\":" << buffer->tid << ",\"ts\":"
+           << ToMicroseconds(size == 0 ? 0
+                                       : buffer->records[size - 1].timestamp)
+           << "}";
+    }
+  }
+
+  json << "\n]}\n";
+
+  return json.str();
+}
+
+}  // namespace trace
+}  // namespace hotcakey
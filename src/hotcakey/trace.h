@@ -0,0 +1,52 @@
+#ifndef HOTCAKEY_TRACE_H_
+#define HOTCAKEY_TRACE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace hotcakey {
+namespace trace {
+
+// stages an event goes through from the os to a javascript listener
+enum Stage : std::uint8_t {
+  // the os reported the key event
+  kReceived,
+  // the backend started handling it (e.g. `HandleKeyEvent` or `WM_HOTKEY`)
+  kHandled,
+  // a listener was looked up for it
+  kMatched,
+  // it was queued for the javascript main thread
+  kEnqueued,
+  // the javascript listener was called, and returned
+  kInvoked,
+  kReturned,
+};
+
+// starts recording into fresh buffers of `capacity` records per thread.
+// records beyond the capacity are dropped.
+void Start(std::size_t capacity);
+void Stop();
+bool IsEnabled();
+
+// an id tying the stages of one event together. 0 while not tracing.
+std::uint64_t NextId();
+
+// monotonic nanoseconds, the clock chrome and electron trace with
+std::int64_t Now();
+
+// records `stage` of event `id` into the buffer of the calling thread.
+// lock free except when the thread records for the first time.
+void Record(Stage stage, std::uint64_t id, std::int64_t timestamp = Now());
+
+// names the calling thread in the trace
+void SetThreadName(const char* name);
+
+// chrome trace event json of everything recorded since `Start`, which
+// can be loaded into perfetto or chrome://tracing.
+std::string Dump();
+
+}  // namespace trace
+}  // namespace hotcakey
+
+#endif  // HOTCAKEY_TRACE_H_
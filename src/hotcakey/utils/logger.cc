@@ -15,6 +15,8 @@ void SetVerbose(bool verbose) {
   isVerbose.store(verbose, std::memory_order_release);
 }
 
+bool IsVerbose() { return isVerbose.load(std::memory_order_relaxed); }
+
 void Log(const std::string& msg) {
   if (isVerbose.load(std::memory_order_acquire)) {
     std::cout << msg << std::endl;
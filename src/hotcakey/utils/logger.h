@@ -5,8 +5,10 @@
 #include <sstream>
 #include <string>
 
+// the message is not even formatted unless verbose, so that debug logs
+// cost nothing (and never allocate) on the input thread
 #define LOG(msg)                                                           \
-  {                                                                        \
+  if (hotcakey::utils::IsVerbose()) {                                      \
     std::stringstream buffer;                                              \
     buffer << "[hotcakey:dbg] " << msg << " (" __FILE__ << ":" << __LINE__ \
            << ")";                                                         \
@@ -33,6 +35,7 @@ namespace hotcakey {
 namespace utils {
 
 void SetVerbose(const bool isVerbose);
+bool IsVerbose();
 void Log(const std::string& msg);
 void Wrn(const std::string& msg);
 void Err(const std::string& msg);
@@ -1,18 +1,16 @@
 #include "./strings.h"
 
-#include <algorithm>
-
 namespace hotcakey {
 namespace utils {
 
 std::vector<std::string> Split(const std::string& s, char delim) {
   std::vector<std::string> elems;
-  std::stringstream ss(s);
-  std::string item;
-  while (getline(ss, item, delim)) {
-    if (!item.empty()) {
-      elems.push_back(item);
-    }
+  std::string::size_type begin = 0;
+  while (begin < s.size()) {
+    auto end = s.find(delim, begin);
+    if (end == std::string::npos) end = s.size();
+    if (end > begin) elems.emplace_back(s, begin, end - begin);
+    begin = end + 1;
   }
   return elems;
 }
@@ -29,11 +27,5 @@ std::string Join(const std::vector<std::string>& v, const char* delim) {
   return s;
 }
 
-std::string ToLower(const std::string& v) {
-  auto s = std::string(v);
-  std::transform(s.begin(), s.end(), s.begin(), ::tolower);
-  return s;
-}
-
 }  // namespace utils
 }  // namespace hotcakey
@@ -0,0 +1,242 @@
+#include "./compiler.h"
+
+#include <cstddef>
+#include <unordered_map>
+
+namespace {
+
+// nesting of values skipped by `Parser::Skip`, which recurses per level
+constexpr std::size_t kMaxDepth = 64;
+
+// just enough json for keymaps. it reads the document once, and keeps
+// the first error.
+class Parser {
+ public:
+  explicit Parser(const std::string& json) : json(json) {}
+
+  bool Fail(const std::string& message) {
+    if (error.empty()) {
+      error = message + " at offset " + std::to_string(offset);
+    }
+    return false;
+  }
+
+  const std::string& Error() const { return error; }
+
+  void SkipSpaces() {
+    while (offset < json.size() &&
+           (json[offset] == ' ' || json[offset] == '\t' ||
+            json[offset] == '\n' || json[offset] == '\r')) {
+      offset++;
+    }
+  }
+
+  bool Peek(char c) {
+    SkipSpaces();
+    return offset < json.size() && json[offset] == c;
+  }
+
+  bool Expect(char c) {
+    if (!Peek(c)) return Fail(std::string("expected '") + c + "'");
+    offset++;
+    return true;
+  }
+
+  bool IsEnd() {
+    SkipSpaces();
+    return offset == json.size();
+  }
+
+  bool String(std::string& value) {
+    if (!Expect('"')) return false;
+
+    value.clear();
+
+    while (offset < json.size()) {
+      auto c = json[offset++];
+
+      if (c == '"') return true;
+      if (c != '\\') {
+        value.push_back(c);
+        continue;
+      }
+
+      if (offset == json.size()) break;
+
+      switch (json[offset++]) {
+        case '"':
+          value.push_back('"');
+          break;
+        case '\\':
+          value.push_back('\\');
+          break;
+        case '/':
+          value.push_back('/');
+          break;
+        case 'n':
+          value.push_back('\n');
+          break;
+        case 't':
+          value.push_back('\t');
+          break;
+        default:
+          // key names are ascii, so \u and friends are never needed
+          return Fail("unsupported escape");
+      }
+    }
+
+    return Fail("unterminated string");
+  }
+
+  // calls `f(key)` for each member, which must consume the value
+  template <typename F>
+  bool Object(F f) {
+    if (!Expect('{')) return false;
+    if (Peek('}')) return Expect('}');
+
+    do {
+      std::string key;
+      if (!String(key) || !Expect(':') || !f(key)) return false;
+    } while (Peek(',') && Expect(','));
+
+    return Expect('}');
+  }
+
+  // calls `f()` for each element, which must consume it
+  template <typename F>
+  bool Array(F f) {
+    if (!Expect('[')) return false;
+    if (Peek(']')) return Expect(']');
+
+    do {
+      if (!f()) return false;
+    } while (Peek(',') && Expect(','));
+
+    return Expect(']');
+  }
+
+  // consumes any value
+  bool Skip() {
+    SkipSpaces();
+
+    if (offset == json.size()) return Fail("unexpected end");
+
+    switch (json[offset]) {
+      case '{':
+        return Nest([this] {
+          return Object([this](const std::string&) { return Skip(); });
+        });
+      case '[':
+        return Nest([this] { return Array([this] { return Skip(); }); });
+      case '"': {
+        std::string ignored;
+        return String(ignored);
+      }
+      default:
+        // numbers, true, false and null
+        auto begin = offset;
+        while (offset < json.size() && json[offset] != ',' &&
+               json[offset] != '}' && json[offset] != ']' &&
+               json[offset] != ' ' && json[offset] != '\n' &&
+               json[offset] != '\r' && json[offset] != '\t') {
+          offset++;
+        }
+        return offset != begin || Fail("unexpected character");
+    }
+  }
+
+ private:
+  // a deeply nested document would overflow the stack otherwise
+  template <typename F>
+  bool Nest(F f) {
+    if (depth == kMaxDepth) return Fail("too deeply nested");
+
+    depth++;
+    auto ok = f();
+    depth--;
+
+    return ok;
+  }
+
+  const std::string& json;
+  std::size_t offset = 0;
+  std::size_t depth = 0;
+  std::string error;
+};
+
+}  // namespace
+
+namespace hotcakeyc {
+
+bool Compile(const std::string& json, Keymap& keymap, std::string& error) {
+  keymap = {};
+
+  Parser parser(json);
+  std::unordered_map<std::string, std::uint32_t> layers{{"", 0}};
+  std::unordered_map<std::string, std::uint32_t> actions;
+
+  // index of `name` in `names`, added if new
+  auto intern = [](std::unordered_map<std::string, std::uint32_t>& indexes,
+                   std::vector<std::string>& names, const std::string& name) {
+    auto it = indexes.find(name);
+    if (it != indexes.end()) return it->second;
+
+    auto index = static_cast<std::uint32_t>(names.size());
+    indexes.emplace(name, index);
+    names.push_back(name);
+
+    return index;
+  };
+
+  auto binding = [&] {
+    std::vector<std::string> keys;
+    std::string layer;
+    std::string action;
+
+    auto ok = parser.Object([&](const std::string& key) {
+      if (key == "keys") {
+        return parser.Array([&] {
+          keys.emplace_back();
+          return parser.String(keys.back());
+        });
+      }
+      if (key == "layer") return parser.String(layer);
+      if (key == "action") return parser.String(action);
+      return parser.Skip();
+    });
+
+    if (!ok) return false;
+
+    hotcakey::Chord chord;
+    if (keys.empty() || !hotcakey::keymap::ToChord(keys, chord)) {
+      return parser.Fail("binding " + std::to_string(keymap.bindings.size()) +
+                         " has no valid key");
+    }
+
+    // listeners of watched keymaps are bound by it
+    if (action.empty()) {
+      return parser.Fail("binding " + std::to_string(keymap.bindings.size()) +
+                         " has no action");
+    }
+
+    keymap.bindings.push_back(
+        {chord.key, chord.modifiers, 0,
+         intern(layers, keymap.layers, layer),
+         intern(actions, keymap.actions, action)});
+
+    return true;
+  };
+
+  auto ok = parser.Object([&](const std::string& key) {
+    if (key == "bindings") return parser.Array(binding);
+    return parser.Skip();
+  });
+
+  if (ok && !parser.IsEnd()) parser.Fail("trailing characters");
+
+  error = parser.Error();
+
+  return error.empty();
+}
+
+}  // namespace hotcakeyc
@@ -0,0 +1,31 @@
+#ifndef HOTCAKEYC_COMPILER_H_
+#define HOTCAKEYC_COMPILER_H_
+
+#include <string>
+#include <vector>
+
+#include "../hotcakey/keymap.h"
+
+namespace hotcakeyc {
+
+// a keymap ready to be written with `hotcakey::keymap::Write`
+struct Keymap {
+  std::vector<hotcakey::keymap::Binding> bindings;
+  // starts with the base layer ""
+  std::vector<std::string> layers{""};
+  std::vector<std::string> actions;
+};
+
+// compiles a keymap written in json such as
+//
+//   {"bindings": [{"keys": ["Control", "KeyS"], "action": "save"},
+//                 {"keys": ["KeyJ"], "layer": "vim", "action": "down"}]}
+//
+// into `keymap`. every binding needs `keys` and a non empty `action`, while
+// `layer` defaults to the base layer. unknown fields are ignored unless
+// nested too deeply. on failure, `error` tells what is wrong and where.
+bool Compile(const std::string& json, Keymap& keymap, std::string& error);
+
+}  // namespace hotcakeyc
+
+#endif  // HOTCAKEYC_COMPILER_H_
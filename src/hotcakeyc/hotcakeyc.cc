@@ -0,0 +1,51 @@
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+#include "../hotcakey/keymap.h"
+#include "./compiler.h"
+
+namespace {
+
+void Usage() {
+  std::cerr << "usage: hotcakeyc <keymap.json> <keymap.hkkm>" << std::endl;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  if (argc != 3) {
+    Usage();
+    return 2;
+  }
+
+  std::ifstream input(argv[1]);
+
+  if (!input) {
+    std::cerr << "cannot read " << argv[1] << std::endl;
+    return 1;
+  }
+
+  std::stringstream json;
+  json << input.rdbuf();
+
+  hotcakeyc::Keymap keymap;
+  std::string error;
+
+  if (!hotcakeyc::Compile(json.str(), keymap, error)) {
+    std::cerr << argv[1] << ": " << error << std::endl;
+    return 1;
+  }
+
+  if (!hotcakey::keymap::Write(argv[2], keymap.bindings, keymap.layers,
+                               keymap.actions)) {
+    return 1;
+  }
+
+  std::cout << keymap.bindings.size() << " bindings in "
+            << keymap.layers.size() << " layers compiled to " << argv[2]
+            << std::endl;
+
+  return 0;
+}
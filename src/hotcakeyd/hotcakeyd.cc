@@ -0,0 +1,46 @@
+#include <csignal>
+#include <cstring>
+#include <iostream>
+#include <string>
+
+#include "../hotcakey/daemon.h"
+#include "../hotcakey/hotcakey.h"
+#include "./server.h"
+
+namespace {
+
+void Usage() {
+  std::cerr << "usage: hotcakeyd [--socket <path>]" << std::endl;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  auto path = hotcakey::daemon::SocketPath();
+
+  for (int i = 1; i < argc; i++) {
+    if (std::strcmp(argv[i], "--socket") == 0 && i + 1 < argc) {
+      path = argv[++i];
+    } else {
+      Usage();
+      return 2;
+    }
+  }
+
+  std::signal(SIGINT, [](int) { hotcakeyd::Stop(); });
+  std::signal(SIGTERM, [](int) { hotcakeyd::Stop(); });
+
+  // hotcakeyd is the one reading devices
+  hotcakey::daemon::SetEnabled(false);
+
+  if (hotcakey::Activate() != hotcakey::kSuccess) {
+    std::cerr << "failed to activate hotcakey" << std::endl;
+    return 1;
+  }
+
+  auto served = hotcakeyd::Serve(path);
+
+  hotcakey::Inactivate();
+
+  return served ? 0 : 1;
+}
@@ -0,0 +1,277 @@
+#include "./server.h"
+
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include "../hotcakey/hotcakey.h"
+#include "../hotcakey/keymap.h"
+#include "../hotcakey/ring.h"
+#include "../hotcakey/utils/logger.h"
+#include "../hotcakey/utils/strings.h"
+
+namespace {
+
+constexpr std::size_t kRingCapacity = 1024;
+
+struct Client {
+  int fd;
+  std::unique_ptr<hotcakey::ring::Writer> events;
+  // registration ids of the client to ours
+  std::unordered_map<hotcakey::Registration, hotcakey::Registration>
+      registrations;
+  std::string buffer;
+};
+
+int stopFd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+
+bool SendLine(int fd, const std::string& line) {
+  auto message = line + "\n";
+  return send(fd, message.data(), message.size(), MSG_NOSIGNAL) ==
+         static_cast<ssize_t>(message.size());
+}
+
+// sends the records and the signal page of a ring in one message
+bool SendRing(int socket, const hotcakey::ring::Writer& ring) {
+  int fds[2] = {ring.Fd(), ring.SignalFd()};
+  char byte = 0;
+  iovec iov{&byte, 1};
+
+  char control[CMSG_SPACE(sizeof(fds))] = {};
+
+  msghdr message{};
+  message.msg_iov = &iov;
+  message.msg_iovlen = 1;
+  message.msg_control = control;
+  message.msg_controllen = sizeof(control);
+
+  auto cmsg = CMSG_FIRSTHDR(&message);
+  cmsg->cmsg_level = SOL_SOCKET;
+  cmsg->cmsg_type = SCM_RIGHTS;
+  cmsg->cmsg_len = CMSG_LEN(sizeof(fds));
+  std::memcpy(CMSG_DATA(cmsg), fds, sizeof(fds));
+
+  return sendmsg(socket, &message, MSG_NOSIGNAL) == 1;
+}
+
+bool ParseId(const std::string& word, hotcakey::Registration& id) {
+  char* end = nullptr;
+  id = std::strtoul(word.c_str(), &end, 10);
+  return end != nullptr && *end == 0 && id != 0;
+}
+
+bool HandleRegister(Client& client, const std::vector<std::string>& words) {
+  hotcakey::Registration id;
+  if (words.size() < 3 || !ParseId(words[1], id)) return false;
+  if (client.registrations.count(id) != 0) return false;
+
+  auto events = client.events.get();
+  auto keys = std::vector<std::string>(words.begin() + 2, words.end());
+
+  // clients keep track of swallowed keys and publish events by the key
+  hotcakey::Chord chord;
+  if (!hotcakey::keymap::ToChord(keys, chord)) return false;
+
+  // called on the input thread, which is the only writer of the ring
+  auto [result, registration] = hotcakey::Register(
+      keys, [events, id, key = chord.key](const hotcakey::Event& event) {
+        events->Write(id, key, event.type, hotcakey::ring::Now());
+      });
+
+  if (result != hotcakey::kSuccess) return false;
+
+  client.registrations[id] = registration;
+
+  return true;
+}
+
+bool HandleUnregister(Client& client, const std::vector<std::string>& words) {
+  hotcakey::Registration id;
+  if (words.size() != 2 || !ParseId(words[1], id)) return false;
+  if (client.registrations.count(id) == 0) return false;
+
+  auto result = hotcakey::Unregister(client.registrations.at(id));
+  client.registrations.erase(id);
+
+  return result == hotcakey::kSuccess;
+}
+
+bool HandleRequest(Client& client, const std::string& line) {
+  LOG("request from client " << client.fd << ": " << line);
+
+  auto words = hotcakey::utils::Split(line, ' ');
+  if (words.empty()) return false;
+
+  if (words[0] == "register") return HandleRegister(client, words);
+  if (words[0] == "unregister") return HandleUnregister(client, words);
+
+  return false;
+}
+
+std::unique_ptr<Client> Accept(int listener) {
+  auto fd = accept4(listener, nullptr, nullptr, SOCK_CLOEXEC);
+
+  if (fd < 0) {
+    ERR("failed to accept client: " << std::strerror(errno));
+    return nullptr;
+  }
+
+  auto events = hotcakey::ring::Writer::CreateAnonymous(kRingCapacity);
+
+  if (!events || !SendRing(fd, *events)) {
+    ERR("failed to share event ring with client");
+    close(fd);
+    return nullptr;
+  }
+
+  LOG("client " << fd << " connected");
+
+  return std::unique_ptr<Client>(new Client{fd, std::move(events), {}, ""});
+}
+
+// returns false when the client is gone
+bool Receive(Client& client) {
+  char data[1024];
+  auto size = recv(client.fd, data, sizeof(data), 0);
+
+  if (size < 0 && (errno == EINTR || errno == EAGAIN)) return true;
+  if (size <= 0) return false;
+
+  client.buffer.append(data, size);
+
+  std::size_t newline;
+  while ((newline = client.buffer.find('\n')) != std::string::npos) {
+    auto line = client.buffer.substr(0, newline);
+    client.buffer.erase(0, newline + 1);
+
+    if (!SendLine(client.fd, HandleRequest(client, line) ? "ok" : "error")) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+void Disconnect(Client& client) {
+  // after `Unregister` returns, the input thread never calls the listener,
+  // so the ring can be released safely.
+  for (auto [id, registration] : client.registrations) {
+    hotcakey::Unregister(registration);
+  }
+
+  close(client.fd);
+
+  LOG("client " << client.fd << " disconnected");
+}
+
+// NOTICE:
+// the socket is bound to a temporary path and renamed once it listens with
+// its final mode, so clients never find a socket which refuses them.
+int Listen(const std::string& path) {
+  auto binding = path + ".new";
+
+  sockaddr_un address{};
+  address.sun_family = AF_UNIX;
+
+  if (binding.size() >= sizeof(address.sun_path)) {
+    ERR("too long socket path: " << path);
+    return -1;
+  }
+
+  std::strncpy(address.sun_path, binding.c_str(),
+               sizeof(address.sun_path) - 1);
+
+  auto fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+
+  if (fd < 0) {
+    ERR("failed to create socket: " << std::strerror(errno));
+    return -1;
+  }
+
+  unlink(binding.c_str());
+
+  // clients are users in the group owning the socket directory
+  if (bind(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 ||
+      listen(fd, 16) != 0 ||
+      chmod(binding.c_str(), S_IRUSR | S_IWUSR | S_IRGRP | S_IWGRP) != 0 ||
+      rename(binding.c_str(), path.c_str()) != 0) {
+    ERR("failed to listen on " << path << ": " << std::strerror(errno));
+    unlink(binding.c_str());
+    close(fd);
+    return -1;
+  }
+
+  return fd;
+}
+
+}  // namespace
+
+namespace hotcakeyd {
+
+bool Serve(const std::string& path) {
+  auto listener = Listen(path);
+  if (listener < 0) return false;
+
+  LOG("hotcakeyd listening on " << path);
+
+  std::vector<std::unique_ptr<Client>> clients;
+  std::vector<pollfd> fds;
+
+  while (true) {
+    fds.clear();
+    fds.push_back({stopFd, POLLIN, 0});
+    fds.push_back({listener, POLLIN, 0});
+    for (auto& client : clients) fds.push_back({client->fd, POLLIN, 0});
+
+    if (poll(fds.data(), fds.size(), -1) < 0) {
+      if (errno == EINTR) continue;
+      ERR("failed to poll clients: " << std::strerror(errno));
+      break;
+    }
+
+    if (fds[0].revents != 0) break;
+
+    // iterate backwards since disconnected clients are erased
+    for (auto i = clients.size(); i-- > 0;) {
+      if (fds[i + 2].revents == 0) continue;
+      if (Receive(*clients[i])) continue;
+
+      Disconnect(*clients[i]);
+      clients.erase(clients.begin() + i);
+    }
+
+    if (fds[1].revents != 0) {
+      auto client = Accept(listener);
+      if (client) clients.push_back(std::move(client));
+    }
+  }
+
+  for (auto& client : clients) Disconnect(*client);
+
+  close(listener);
+  unlink(path.c_str());
+
+  LOG("hotcakeyd stopped");
+
+  return true;
+}
+
+void Stop() {
+  std::uint64_t one = 1;
+  auto written = write(stopFd, &one, sizeof(one));
+  (void)written;
+}
+
+}  // namespace hotcakeyd
@@ -0,0 +1,20 @@
+#ifndef HOTCAKEYD_SERVER_H_
+#define HOTCAKEYD_SERVER_H_
+
+#include <string>
+
+namespace hotcakeyd {
+
+// accepts clients on a unix domain socket at `path` and serves them until
+// `Stop` is called. hotcakey must be activated by the caller, with the
+// daemon client disabled so that it reads the devices directly.
+//
+// see `hotcakey::daemon::Client` for the protocol.
+bool Serve(const std::string& path);
+
+// async signal safe
+void Stop();
+
+}  // namespace hotcakeyd
+
+#endif  // HOTCAKEYD_SERVER_H_
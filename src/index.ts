@@ -181,13 +181,181 @@ const codes = [
  */
 export type Code = typeof codes[number]
 
-export type Option = { verbose: boolean }
-export type Unsubscribe = () => void
-export type HotKeyEvent = { type: 'keydown' | 'keyup'; time: number }
+export type Modifier = 'Control' | 'Shift' | 'Alt' | 'Meta'
+export type EventType = 'keydown' | 'keyup'
+
+/**
+ * `Option` of `activate`. besides `verbose`, options tune the native input
+ * thread. each one is best effort, see `activationReport` for what was applied.
+ *
+ * - `policy`: scheduling policy. `fifo` and `rr` are realtime policies which
+ *   usually need privileges, and fall back to `nice` if not permitted.
+ * - `priority`: realtime priority for `fifo` and `rr`.
+ * - `nice`: nice value with the default policy. negative values need privileges.
+ * - `cpus`: cpus the input thread may run on.
+ * - `lockMemory`: locks the stack of the input thread in memory.
+ * - `grab`: reads keyboards exclusively and passes the keys which no hotkey
+ *   consumes on through a uinput keyboard, see `ConsumeOption` and `remap`.
+ *   linux only, and needs write access to `/dev/uinput`.
+ * - `stall`: how to handle events delayed by a busy main thread, see `StallOption`.
+ */
+export type Option = {
+  verbose: boolean
+  policy?: SchedulingPolicy
+  priority?: number
+  nice?: number
+  cpus?: number[]
+  lockMemory?: boolean
+  grab?: boolean
+  stall?: StallOption
+}
+
+/**
+ * `StallOption` watches the lag from the input thread enqueuing an event
+ * to its listener being called on the main thread.
+ *
+ * - `threshold`: milliseconds of lag to report a stall to `onStall` listeners.
+ * - `maxAge`: milliseconds after which an event is dropped instead of
+ *   delivered, so that hotkeys the user already gave up on do not fire.
+ */
+export type StallOption = { threshold?: number; maxAge?: number }
+export type Stall = { lag: number; pending: number }
+
+/**
+ * `DeliveryStats` of events sent to listeners. lags are in milliseconds.
+ */
+export type DeliveryStats = {
+  pending: number
+  lag: number
+  maxLag: number
+  stalls: number
+  dropped: number
+}
+export type ReplayPace = 'original' | 'fastest'
+export type ReplayOption = { pace: ReplayPace }
+export type ReplayReport = {
+  events: number
+  /** listeners called back with the events while recording */
+  matches: number
+  /** milliseconds */
+  elapsed: number
+}
+/**
+ * `at` is milliseconds from the start of the injection. omitted, the event
+ * goes with the previous one.
+ */
+export type InjectedEvent = { code: Code; type: EventType; at?: number }
+/**
+ * 'uinput' is a virtual keyboard every application sees, and 'synthetic'
+ * is the in-process device of `emit`, which needs `activate`.
+ */
+export type InjectTarget = 'uinput' | 'synthetic'
+export type InjectOption = {
+  /** 'original' keeps `at`, and 'fastest' writes everything at once */
+  timing?: ReplayPace
+  target?: InjectTarget
+}
+export type InjectReport = {
+  events: number
+  /** events due at the same time share one write */
+  writes: number
+  /** milliseconds */
+  elapsed: number
+  /** how far the latest write was behind its schedule, in milliseconds */
+  lateness: number
+}
+export type SchedulingPolicy = 'default' | 'fifo' | 'rr'
+export type ActivationReport = {
+  policy: SchedulingPolicy
+  priority: number
+  nice: number
+  cpus: number[]
+  lockMemory: boolean
+  grab: boolean
+  warnings: string[]
+}
+export type Unsubscribe = {
+  (): void
+  // identifies the binding in `origin` of events followed from a ring
+  readonly registration: number
+}
+export type HotKeyEvent = { type: EventType; time: number; code?: Code; origin?: number }
 export type ErrorEvent = { type: 'error'; code: string; time: number }
 export type Event = HotKeyEvent | ErrorEvent
 export type Listener = (event: Event) => void
 
+/**
+ * `eventTypeCodes` maps event types to the numbers passed to a `PositionalListener`.
+ */
+export const eventTypeCodes = { keydown: 0, keyup: 1 } as const
+export type EventTypeCode = typeof eventTypeCodes[EventType]
+
+/**
+ * `PositionalListener` receives an event as plain arguments, so no object is
+ * created per event. `registration` is the one of the returned `Unsubscribe`,
+ * or `origin` for followed events. `code` is only set for streams and followers.
+ */
+export type PositionalListener = (type: EventTypeCode, time: number, registration: number, code?: Code) => void
+
+/**
+ * `Delivery` decides how events are handed to a listener.
+ *
+ * - `object`: a new event object per event. the default.
+ * - `reuse`: one event object per listener, overwritten by every event.
+ *   the listener must copy what it keeps.
+ * - `positional`: no object at all, see `PositionalListener`.
+ *
+ * under sustained key repeat, `reuse` and `positional` keep the garbage
+ * collector quiet in busy processes such as the electron main process.
+ */
+export type Delivery = 'object' | 'reuse' | 'positional'
+export type ListenOption = { delivery?: Exclude<Delivery, 'positional'> }
+export type PositionalOption = { delivery: 'positional' }
+
+/**
+ * `layer` of `register`. hotkeys of a layer are only matched while the layer
+ * is active, see `switchLayer`. the base layer is `''`, the default.
+ */
+export type LayerOption = { layer?: string }
+
+/**
+ * `Device` is a keyboard read by hotcakey, such as a usb macro pad.
+ * `vendor` and `product` are usb ids, and `phys` is the physical path
+ * reported by the kernel.
+ */
+export type Device = { path: string; name: string; vendor: number; product: number; phys: string }
+
+/**
+ * `device` of `register` binds the hotkey to keys of matching devices only,
+ * so the same chord on other keyboards is left alone. omitted fields match
+ * any device. a device hotkey is always in the base layer.
+ * currently only supported on linux.
+ */
+export type DeviceOption = { device?: Partial<Omit<Device, 'path'>> }
+
+/**
+ * `consume` of `register` keeps the key of the hotkey, its repeats and its
+ * keyup from other applications while keyboards are grabbed, see `grab` of
+ * `Option`. keys are passed on by default on linux, and always consumed
+ * on macos and windows.
+ */
+export type ConsumeOption = { consume?: boolean }
+
+/**
+ * `Filter` selects raw key events for `subscribe`.
+ *
+ * - `keys`: keys to receive. all keys if omitted.
+ * - `modifiers`: modifiers which must be held.
+ * - `exact`: if true, no other modifiers may be held.
+ * - `types`: event types to receive. all types if omitted.
+ */
+export type Filter = {
+  keys?: Code[]
+  modifiers?: Modifier[]
+  exact?: boolean
+  types?: EventType[]
+}
+
 const addon = bindings('hotcakey')
 const defaultOption: Option = { verbose: false }
 
@@ -202,21 +370,566 @@ export function inactivate(): Promise<void> {
   return addon.inactivate()
 }
 
-export function register(codes: Code[], listener: Listener): Unsubscribe {
+const stallListeners = new Set<(stall: Stall) => void>()
+
+/**
+ * listen to stalls of the main thread. `listener` is called once when the
+ * lag of delivered events exceeds `stall.threshold` of `activate`, and
+ * again only after the lag went back under the threshold.
+ */
+export function onStall(listener: (stall: Stall) => void): () => void {
+  check(!!listener, 'missing stall listener')
+
+  if (stallListeners.size === 0) {
+    addon.onStall((stall: Stall) => stallListeners.forEach((listener) => listener(stall)))
+  }
+
+  stallListeners.add(listener)
+
+  return () => {
+    stallListeners.delete(listener)
+    if (stallListeners.size === 0) addon.onStall()
+  }
+}
+
+export function deliveryStats(): DeliveryStats {
+  return addon.deliveryStats()
+}
+
+/**
+ * start recording when each event reaches each stage, from the os to the
+ * end of its javascript listener. `capacity` is the number of records kept
+ * per thread, and the rest is dropped.
+ */
+export function startTracing(option: { capacity?: number } = {}): void {
+  addon.startTracing(option.capacity ?? 65536)
+}
+
+/**
+ * stop recording and get the trace in the chrome trace event format,
+ * which perfetto and chrome://tracing can load.
+ */
+export function stopTracing(): string {
+  return addon.stopTracing()
+}
+
+/**
+ * start recording every raw key event seen by the input thread to a
+ * binary file at `path`. currently only supported on linux.
+ */
+export function startRecording(path: string): void {
+  check(!!path, 'missing recording path')
+  addon.startRecording(path)
+}
+
+export function stopRecording(): void {
+  addon.stopRecording()
+}
+
+const defaultReplayOption: ReplayOption = { pace: 'original' }
+
+/**
+ * feed a recording through the input thread as if the keys were pressed
+ * again. registered listeners are called as usual, so a recording can
+ * reproduce a bug or measure throughput without a keyboard.
+ * currently only supported on linux.
+ */
+export function replay(path: string, option: ReplayOption = defaultReplayOption): Promise<ReplayReport> {
+  check(!!path, 'missing recording path')
+  check(['original', 'fastest'].includes(option.pace), `${option.pace} is not a type of ReplayPace`)
+  return addon.replay(path, option.pace)
+}
+
+/**
+ * write key events with a timer, e.g. to drive ui tests or macros.
+ * the events due at the same time are written at once, so thousands of
+ * events per second are fine. the first injection into uinput makes the
+ * virtual keyboard, which takes a moment. currently only supported on linux.
+ */
+export function inject(sequence: InjectedEvent[], option: InjectOption = {}): Promise<InjectReport> {
+  const timing = option.timing ?? 'original'
+  const target = option.target ?? 'uinput'
+  check(['original', 'fastest'].includes(timing), `${timing} is not a type of ReplayPace`)
+  check(['uinput', 'synthetic'].includes(target), `${target} is not a type of InjectTarget`)
+
+  let at = 0
+  const events = sequence.map((event) => {
+    check(isCode(event.code), `${event.code} is not a type of Code`)
+    check(event.type === 'keydown' || event.type === 'keyup', `${event.type} is not a type of EventType`)
+    check(event.at === undefined || event.at >= at, 'injected events must be in order of time')
+    at = event.at ?? at
+    return { code: event.code, type: event.type, at }
+  })
+
+  return addon.inject(events, timing, target)
+}
+
+/**
+ * what was actually applied to the input thread by the last `activate`.
+ */
+export function activationReport(): ActivationReport {
+  return addon.activationReport()
+}
+
+export function register(
+  codes: Code[],
+  listener: Listener,
+  option?: ListenOption & LayerOption & DeviceOption & ConsumeOption
+): Unsubscribe
+export function register(
+  codes: Code[],
+  listener: PositionalListener,
+  option: PositionalOption & LayerOption & DeviceOption & ConsumeOption
+): Unsubscribe
+export function register(
+  codes: Code[],
+  listener: Listener | PositionalListener,
+  option?: (ListenOption | PositionalOption) & LayerOption & DeviceOption & ConsumeOption
+): Unsubscribe {
   check(codes && codes.length > 0, 'missing shortcut keys to register')
   check(!!listener, 'missing hotkey listener')
 
   log('codes to register:', codes)
 
   check(codes.every(isCode), `some key is not a type of Code`)
+  check(!(option?.device && option.layer), 'a device hotkey cannot be in a layer')
+  checkDelivery(option)
 
-  return addon.register(codes, listener)
+  return addon.register(codes, listener, option)
+}
+
+/**
+ * `EventsOption` of `events`.
+ *
+ * - `capacity`: number of events buffered natively while the consumer is busy.
+ * - `overflow`: what to discard once the buffer is full. `drop-oldest` keeps
+ *   the latest events, and `drop-newest` keeps the earliest ones.
+ */
+export type EventsOption = { capacity?: number; overflow?: Overflow }
+export type Overflow = 'drop-oldest' | 'drop-newest'
+
+/**
+ * `EventStream` is an async iterator of hotkey events. breaking out of the
+ * loop or calling `close` unregisters the hotkey.
+ */
+export type EventStream = AsyncIterableIterator<HotKeyEvent> & {
+  // number of events discarded by the overflow policy so far
+  readonly dropped: number
+  close(): void
+}
+
+const defaultEventsOption: EventsOption = { capacity: 256, overflow: 'drop-oldest' }
+
+/**
+ * iterate hotkey events with `for await`.
+ *
+ * events are buffered in a bounded native queue until the consumer asks
+ * for the next one, so a slow consumer never blocks the input thread.
+ */
+export function events(codes: Code[], option: EventsOption = defaultEventsOption): EventStream {
+  check(codes && codes.length > 0, 'missing shortcut keys to iterate')
+
+  log('codes to iterate:', codes)
+
+  check(codes.every(isCode), `some key is not a type of Code`)
+  const overflow = option.overflow ?? 'drop-oldest'
+  check(['drop-oldest', 'drop-newest'].includes(overflow), `${overflow} is not a type of Overflow`)
+
+  let wake: (() => void) | undefined
+  let closed = false
+
+  const native = addon.events(codes, option, () => {
+    const resolve = wake
+    wake = undefined
+    resolve?.()
+  })
+
+  check(!!native, 'cannot register event stream')
+
+  const close = () => {
+    if (closed) return
+    closed = true
+    native()
+    wake?.()
+  }
+
+  const stream: EventStream = {
+    async next(): Promise<IteratorResult<HotKeyEvent>> {
+      for (;;) {
+        if (closed) return { done: true, value: undefined }
+
+        const event = native.read()
+        if (event) return { done: false, value: event }
+
+        // the native side wakes us only after it saw the queue drained
+        await new Promise<void>((resolve) => (wake = resolve))
+      }
+    },
+    async return(): Promise<IteratorResult<HotKeyEvent>> {
+      close()
+      return { done: true, value: undefined }
+    },
+    [Symbol.asyncIterator]() {
+      return stream
+    },
+    get dropped() {
+      return native.dropped()
+    },
+    close,
+  }
+
+  return stream
+}
+
+/**
+ * `Action` is executed natively on the input thread as soon as the chord
+ * matches, without waiting for the node.js main thread.
+ *
+ * - `write`: writes to `fd`. an eventfd is incremented by one, and a pipe
+ *   receives a 24 byte `hotcakey_action_event` (see src/hotcakey/action.h).
+ * - `send`: sends a `hotcakey_action_event` to the unix datagram socket at `path`.
+ * - `call`: calls `symbol` of the shared library at `path`.
+ * - `types`: event types firing the action. all types if omitted.
+ */
+export type Action = (
+  | { type: 'write'; fd: number }
+  | { type: 'send'; path: string }
+  | { type: 'call'; path: string; symbol: string }
+) & { types?: EventType[] }
+
+/**
+ * register a hotkey with a native `action`. `listener` is optional and
+ * is notified asynchronously after the action ran.
+ * currently only supported on linux.
+ */
+export function registerAction(
+  codes: Code[],
+  action: Action,
+  listener?: Listener,
+  option?: ListenOption
+): Unsubscribe
+export function registerAction(
+  codes: Code[],
+  action: Action,
+  listener: PositionalListener,
+  option: PositionalOption
+): Unsubscribe
+export function registerAction(
+  codes: Code[],
+  action: Action,
+  listener?: Listener | PositionalListener,
+  option?: ListenOption | PositionalOption
+): Unsubscribe {
+  check(codes && codes.length > 0, 'missing shortcut keys to register')
+  check(!!action, 'missing native action')
+
+  log('codes to register with action:', codes, action)
+
+  check(codes.every(isCode), `some key is not a type of Code`)
+  check((action.types ?? []).every(isEventType), `some type is not a type of EventType`)
+  checkDelivery(option)
+
+  return addon.registerAction(codes, action, listener, option)
+}
+
+/**
+ * `ComboOption` of `combo`.
+ *
+ * - `window`: milliseconds within which every key must be down. 30 by default.
+ * - `key`: a key pressed in place of the combo, e.g. `'Escape'`. hotkeys see
+ *   it, and so do other applications while keyboards are grabbed.
+ */
+export type ComboOption = { window?: number; key?: Code }
+
+/**
+ * register keys pressed together such as `['KeyJ', 'KeyK']`, like the combos
+ * of keyboard firmwares. the keys are held back on the native input thread
+ * until the combo completes or the window elapses, and go on as usual if it
+ * does not. the listener gets a keydown when the combo completes and a keyup
+ * when the first of its keys is released. currently only supported on linux.
+ */
+export function combo(codes: Code[], listener: Listener, option?: ListenOption & ComboOption): Unsubscribe
+export function combo(codes: Code[], listener: PositionalListener, option: PositionalOption & ComboOption): Unsubscribe
+export function combo(
+  codes: Code[],
+  listener: Listener | PositionalListener,
+  option?: (ListenOption | PositionalOption) & ComboOption
+): Unsubscribe {
+  check(codes && codes.length > 1, 'a combo needs two keys or more')
+  check(!!listener, 'missing combo listener')
+
+  log('codes to register as a combo:', codes)
+
+  check(codes.every(isCode), `some key is not a type of Code`)
+  check(option?.key === undefined || isCode(option.key), `${option?.key} is not a type of Code`)
+  check(option?.window === undefined || option.window > 0, 'window of a combo must be positive')
+  checkDelivery(option)
+
+  return addon.registerCombo(codes, listener, option)
+}
+
+/**
+ * subscribe a stream of raw key events selected by `filter`.
+ *
+ * the filter is evaluated on the native input thread, so only matching
+ * events reach the listener. currently only supported on linux.
+ */
+export function subscribe(filter: Filter, listener: Listener, option?: ListenOption): Unsubscribe
+export function subscribe(filter: Filter, listener: PositionalListener, option: PositionalOption): Unsubscribe
+export function subscribe(
+  filter: Filter,
+  listener: Listener | PositionalListener,
+  option?: ListenOption | PositionalOption
+): Unsubscribe {
+  check(!!filter, 'missing filter to subscribe')
+  check(!!listener, 'missing stream listener')
+
+  log('filter to subscribe:', filter)
+
+  check((filter.keys ?? []).every(isCode), `some key is not a type of Code`)
+  check((filter.modifiers ?? []).every(isModifier), `some modifier is not a type of Modifier`)
+  check((filter.types ?? []).every(isEventType), `some type is not a type of EventType`)
+  checkDelivery(option)
+
+  return addon.subscribe(filter, listener, option)
+}
+
+/**
+ * activate the hotkeys of `layer` on top of the base layer, like switching
+ * modes of vim. they shadow base hotkeys of the same chord. only chords
+ * whose state actually changes are touched, so switching is cheap however
+ * many hotkeys the layers have. `switchLayer()` goes back to the base.
+ */
+export function switchLayer(layer = ''): void {
+  addon.switchLayer(layer)
+}
+
+export function activeLayer(): string {
+  return addon.activeLayer()
+}
+
+/**
+ * stop calling listeners while keeping every registration, e.g. while a
+ * settings dialog records a shortcut or a fullscreen game runs. on macos
+ * and windows the hotkeys are released to other applications meanwhile.
+ */
+export function suspend(): void {
+  addon.suspend()
+}
+
+export function resume(): void {
+  addon.resume()
+}
+
+export function isSuspended(): boolean {
+  return addon.isSuspended()
+}
+
+/**
+ * `Snapshot` identifies registrations set aside by `snapshot`.
+ */
+export type Snapshot = number & { readonly __snapshot: unique symbol }
+
+/**
+ * detach every registration at once and keep it aside. the unsubscribe
+ * functions stay valid, and unsubscribing drops the registration from the
+ * snapshot. `restore` brings the rest back alongside the registrations made
+ * since, in one native call. registrations which cannot be brought back
+ * stay in the snapshot, and `restore` throws.
+ */
+export function snapshot(): Snapshot {
+  return addon.snapshot()
+}
+
+export function restore(snapshot: Snapshot): void {
+  check(typeof snapshot === 'number', 'missing snapshot to restore')
+  addon.restore(snapshot)
+}
+
+/**
+ * `KeymapListener` is called with the index of the binding in the keymap
+ * json, so no object is created per event.
+ */
+export type KeymapListener = (binding: number, type: EventTypeCode, time: number) => void
+
+/**
+ * register every binding of a keymap compiled by `hotcakeyc` at once.
+ * the file is mapped and registered in one batch natively, so a large
+ * keymap costs neither a call nor a string per binding at startup.
+ * the returned function unregisters the whole keymap.
+ * currently only supported on linux.
+ */
+export function loadKeymap(path: string, listener: KeymapListener): () => void {
+  check(!!path, 'missing keymap path')
+  check(!!listener, 'missing keymap listener')
+
+  const unsubscribe = addon.loadKeymap(path, listener)
+  check(!!unsubscribe, `cannot load keymap: ${path}`)
+
+  return unsubscribe
+}
+
+/**
+ * `ActionListener` is called with the `action` of the binding in the keymap json.
+ */
+export type ActionListener = (action: string, type: EventTypeCode, time: number) => void
+
+/**
+ * register a keymap compiled by `hotcakeyc` and keep it registered while
+ * the file changes. on every change only added and removed bindings are
+ * (un)registered, so the other shortcuts never stop working, and a broken
+ * file keeps the last good keymap. currently only supported on linux.
+ */
+export function watchKeymap(path: string, listener: ActionListener): Unsubscribe {
+  check(!!path, 'missing keymap path')
+  check(!!listener, 'missing keymap listener')
+
+  const unsubscribe = addon.watchKeymap(path, listener)
+  check(!!unsubscribe, `cannot watch keymap: ${path}`)
+
+  return unsubscribe
+}
+
+export type PublishOption = { capacity: number }
+
+const defaultPublishOption: PublishOption = { capacity: 1024 }
+
+/**
+ * publish every hotkey event of this process to a shared memory ring
+ * named `name`, so that other processes can `follow` it without IPC.
+ * currently only supported on linux.
+ */
+export function publish(name: string, option: PublishOption = defaultPublishOption): void {
+  check(!!name, 'missing ring name to publish')
+  addon.publish(name, option.capacity)
+}
+
+export function unpublish(): void {
+  addon.unpublish()
+}
+
+/**
+ * follow a ring published by another process.
+ * `origin` of each event is the registration in the publishing process.
+ */
+export function follow(name: string, listener: Listener, option?: ListenOption): Unsubscribe
+export function follow(name: string, listener: PositionalListener, option: PositionalOption): Unsubscribe
+export function follow(
+  name: string,
+  listener: Listener | PositionalListener,
+  option?: ListenOption | PositionalOption
+): Unsubscribe {
+  check(!!name, 'missing ring name to follow')
+  check(!!listener, 'missing ring listener')
+  checkDelivery(option)
+  return addon.follow(name, listener, option)
+}
+
+/**
+ * `KeyState` is a live view of the global key state.
+ *
+ * the native input thread writes the state into `buffer` directly,
+ * so reading it costs no native call. `buffer` can be posted to workers.
+ */
+export type KeyState = {
+  buffer: SharedArrayBuffer
+  isPressed(code: Code): boolean
+}
+
+let keyStateView: KeyState | undefined
+
+/**
+ * get the live key state view. currently only supported on linux.
+ */
+export function keyState(): KeyState {
+  if (keyStateView) return keyStateView
+
+  const buffer = new SharedArrayBuffer(addon.keyStateWords * Int32Array.BYTES_PER_ELEMENT)
+  const words = new Int32Array(buffer)
+  const indexes = new Map<Code, number[]>()
+
+  addon.attachKeyState(words)
+
+  const isPressed = (code: Code): boolean => {
+    let bits = indexes.get(code)
+    if (!bits) {
+      check(isCode(code), `${code} is not a type of Code`)
+      bits = addon.keyStateIndexes(code) as number[]
+      indexes.set(code, bits)
+    }
+
+    // word 0 is a sequence counter. it is odd while the input thread is
+    // writing, so retry until we read a consistent snapshot.
+    for (;;) {
+      const sequence = Atomics.load(words, 0)
+      if (sequence & 1) continue
+
+      let pressed = false
+      for (const bit of bits) {
+        pressed = pressed || ((Atomics.load(words, 1 + (bit >>> 5)) >>> (bit & 31)) & 1) === 1
+      }
+
+      if (Atomics.load(words, 0) === sequence) return pressed
+    }
+  }
+
+  keyStateView = { buffer, isPressed }
+
+  return keyStateView
+}
+
+/**
+ * remap `from` of grabbed keyboards to `to` before hotkeys are matched and
+ * keys are passed on, e.g. `remap('CapsLock', 'Escape')`. omitting `to`
+ * removes the remapping. needs `grab` of `Option`. currently only
+ * supported on linux.
+ */
+export function remap(from: Code, to?: Code): void {
+  check(isCode(from) && (to === undefined || isCode(to)), 'some key is not a type of Code')
+  check(addon.remap(from, to ?? ''), `cannot remap ${from}`)
+}
+
+/**
+ * list the keyboards currently read, including ones plugged in after
+ * `activate`. currently only supported on linux.
+ */
+export function devices(): Device[] {
+  return addon.devices()
+}
+
+/**
+ * parse an accelerator string such as `'Ctrl+Shift+/'` or `'CmdOrCtrl+K'`
+ * into the codes `register` takes, e.g. `['Control', 'Shift', 'Slash']`.
+ * names are case insensitive and common aliases (Ctrl, Cmd, Option, Esc,
+ * Up, Plus, ...) and symbols are accepted. `CmdOrCtrl` is Meta on macos
+ * and Control elsewhere. it is parsed natively without any allocation.
+ */
+export function parseAccelerator(accelerator: string): Code[] {
+  check(typeof accelerator === 'string', 'missing accelerator to parse')
+
+  const codes = addon.parseAccelerator(accelerator)
+  check(!!codes, `${accelerator} is not a valid accelerator`)
+
+  return codes
+}
+
+function isModifier(suspect: Modifier): boolean {
+  return ['Control', 'Shift', 'Alt', 'Meta'].includes(suspect)
+}
+
+function isEventType(suspect: EventType): boolean {
+  return ['keydown', 'keyup'].includes(suspect)
 }
 
 function isCode(suspect: Code): boolean {
   return codes.includes(suspect)
 }
 
+function checkDelivery(option?: { delivery?: Delivery }) {
+  const delivery = option?.delivery ?? 'object'
+  check(['object', 'reuse', 'positional'].includes(delivery), `${delivery} is not a type of Delivery`)
+}
+
 //
 // utilities
 //
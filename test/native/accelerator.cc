@@ -0,0 +1,149 @@
+#include <atomic>
+#include <cstdlib>
+#include <iterator>
+#include <new>
+#include <random>
+#include <string>
+#include <string_view>
+
+#include "../../src/hotcakey/accelerator.h"
+#include "./test.h"
+
+namespace {
+
+namespace accelerator = hotcakey::accelerator;
+
+std::atomic<bool> isCounting(false);
+std::atomic<std::size_t> allocations(0);
+
+void* Allocate(std::size_t size) {
+  if (isCounting.load(std::memory_order_relaxed)) allocations++;
+
+  auto p = std::malloc(size == 0 ? 1 : size);
+  if (p == nullptr) throw std::bad_alloc();
+
+  return p;
+}
+
+// "Control+Shift+KeyK" of a parsed accelerator
+std::string Format(accelerator::Packed packed) {
+  const char* names[4];
+  auto count =
+      accelerator::ModifierNames(accelerator::ModifiersOf(packed), names);
+
+  std::string formatted;
+  for (std::size_t i = 0; i < count; i++) {
+    formatted += names[i];
+    formatted += "+";
+  }
+
+  return formatted + accelerator::CodeOf(packed);
+}
+
+bool Is(std::string_view accelerator, const char* expected) {
+  auto packed = accelerator::Parse(accelerator);
+  return packed != accelerator::kInvalid && Format(packed) == expected;
+}
+
+}  // namespace
+
+void* operator new(std::size_t size) { return Allocate(size); }
+void* operator new[](std::size_t size) { return Allocate(size); }
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::size_t) noexcept { std::free(p); }
+
+int main() {
+  hotcakey::test::Run("codes and aliases are parsed", [] {
+    EXPECT(Is("KeyK", "KeyK"));
+    EXPECT(Is("Control+Shift+KeyK", "Control+Shift+KeyK"));
+    EXPECT(Is("ctrl+shift+k", "Control+Shift+KeyK"));
+    EXPECT(Is("Shift+Ctrl+K", "Control+Shift+KeyK"));
+    EXPECT(Is("Option+Cmd+1", "Alt+Meta+Digit1"));
+    EXPECT(Is("Super+Esc", "Meta+Escape"));
+    EXPECT(Is("Alt+Up", "Alt+ArrowUp"));
+    EXPECT(Is("F12", "F12"));
+    EXPECT(Is("num5", "Numpad5"));
+    EXPECT(Is(" Ctrl + Return ", "Control+Enter"));
+  });
+
+  hotcakey::test::Run("symbols are parsed", [] {
+    EXPECT(Is("Ctrl+Shift+/", "Control+Shift+Slash"));
+    EXPECT(Is("Ctrl+,", "Control+Comma"));
+    EXPECT(Is("Ctrl+\\", "Control+Backslash"));
+    EXPECT(Is("Ctrl+-", "Control+Minus"));
+    EXPECT(Is("Ctrl++", "Control+Shift+Equal"));
+    EXPECT(Is("Ctrl+Plus", "Control+Shift+Equal"));
+    EXPECT(Is("+", "Shift+Equal"));
+  });
+
+  hotcakey::test::Run("CmdOrCtrl follows the platform", [] {
+#if defined(__APPLE__)
+    EXPECT(Is("CmdOrCtrl+K", "Meta+KeyK"));
+#else
+    EXPECT(Is("CmdOrCtrl+K", "Control+KeyK"));
+    EXPECT(Is("CommandOrControl+Shift+Z", "Control+Shift+KeyZ"));
+#endif
+  });
+
+  hotcakey::test::Run("broken accelerators are invalid", [] {
+    for (auto broken :
+         {"", " ", "Ctrl+", "Ctrl", "Ctrl+Shift", "Ctrl++K", "K+L",
+          "Ctrl+Foo", "Ctrl K", "Ctrl+K+", "++", "Ctrl+\xff", "KeyKK"}) {
+      EXPECT(accelerator::Parse(broken) == accelerator::kInvalid);
+    }
+  });
+
+  hotcakey::test::Run("parsing does not allocate", [] {
+    allocations.store(0);
+    isCounting.store(true);
+    auto packed = accelerator::Parse("CommandOrControl+Shift+Option+PgDn");
+    isCounting.store(false);
+
+    EXPECT(packed != accelerator::kInvalid);
+    EXPECT(allocations.load() == 0);
+  });
+
+  hotcakey::test::Run("random accelerators never break the parser", [] {
+    const char* tokens[] = {"Ctrl", "shift", "ALT", "Cmd", "CmdOrCtrl", "K",
+                            "KeyK", "Digit0", "/", "+", "=", "Plus", "Esc",
+                            "NumpadAdd", "F24", "Foo", "", " ", "\t", "\xff"};
+
+    std::mt19937 random(20261019);
+    std::size_t valid = 0;
+
+    for (int round = 0; round < 200000; round++) {
+      std::string input;
+
+      if (round % 2 == 0) {
+        // arbitrary bytes
+        auto length = random() % 24;
+        for (std::size_t i = 0; i < length; i++) {
+          input.push_back(static_cast<char>(random() % 256));
+        }
+      } else {
+        // plausible tokens joined by '+' and spaces
+        auto count = random() % 6;
+        for (std::size_t i = 0; i < count; i++) {
+          if (i > 0) input += random() % 4 == 0 ? " + " : "+";
+          input += tokens[random() % std::size(tokens)];
+        }
+      }
+
+      auto packed = accelerator::Parse(input);
+      if (packed == accelerator::kInvalid) continue;
+
+      // whatever is valid names a known code and round-trips
+      EXPECT(accelerator::CodeOf(packed) != nullptr);
+      EXPECT(accelerator::Parse(Format(packed)) == packed);
+      valid++;
+    }
+
+    EXPECT(valid > 0);
+  });
+
+  std::cout << "🎉 all accelerator tests passed" << std::endl;
+
+  return 0;
+}
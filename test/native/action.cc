@@ -0,0 +1,213 @@
+#include <dlfcn.h>
+#include <fcntl.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+#include "../../src/hotcakey/action.h"
+#include "../../src/hotcakey/daemon.h"
+#include "../../src/hotcakey/hotcakey.h"
+#include "../../src/hotcakey/synthetic.h"
+#include "./test.h"
+
+namespace {
+
+void Tap(const std::string& key) {
+  EXPECT(hotcakey::synthetic::Emit(key, hotcakey::kKeyDown) ==
+         hotcakey::kSuccess);
+  EXPECT(hotcakey::synthetic::Emit(key, hotcakey::kKeyUp) ==
+         hotcakey::kSuccess);
+}
+
+bool ReadEvent(int fd, hotcakey_action_event& event) {
+  return hotcakey::test::WaitFor(
+      [&] { return read(fd, &event, sizeof(event)) == sizeof(event); });
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  EXPECT(argc == 2);
+
+  hotcakey::daemon::SetEnabled(false);
+
+  EXPECT(hotcakey::Activate() == hotcakey::kSuccess);
+
+  hotcakey::test::Run("eventfd is incremented without a listener", [] {
+    auto fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+
+    hotcakey::Action action;
+    action.type = hotcakey::kActionWrite;
+    action.fd = fd;
+    action.types = {hotcakey::kKeyDown};
+
+    auto [result, registration] =
+        hotcakey::Register({"Alt", "KeyM"}, action, nullptr);
+    EXPECT(result == hotcakey::kSuccess);
+
+    hotcakey::synthetic::Emit("AltLeft", hotcakey::kKeyDown);
+    Tap("KeyM");
+    Tap("KeyM");
+    hotcakey::synthetic::Emit("AltLeft", hotcakey::kKeyUp);
+
+    std::uint64_t total = 0;
+    EXPECT(hotcakey::test::WaitFor([&] {
+      std::uint64_t value;
+      if (read(fd, &value, sizeof(value)) == sizeof(value)) total += value;
+      return total == 2;
+    }));
+
+    EXPECT(hotcakey::Unregister(registration) == hotcakey::kSuccess);
+    close(fd);
+  });
+
+  hotcakey::test::Run("pipe receives events before the listener", [] {
+    int fds[2];
+    EXPECT(pipe2(fds, O_NONBLOCK | O_CLOEXEC) == 0);
+
+    hotcakey::Action action;
+    action.type = hotcakey::kActionWrite;
+    action.fd = fds[1];
+
+    std::atomic<bool> written(false);
+
+    auto [result, registration] = hotcakey::Register(
+        {"F14"}, action, [&](const hotcakey::Event& event) {
+          hotcakey_action_event message;
+          if (event.type == hotcakey::kKeyDown &&
+              read(fds[0], &message, sizeof(message)) == sizeof(message)) {
+            written = message.type == HOTCAKEY_ACTION_KEYDOWN;
+          }
+        });
+    EXPECT(result == hotcakey::kSuccess);
+
+    Tap("F14");
+
+    hotcakey_action_event event;
+    EXPECT(ReadEvent(fds[0], event));
+    EXPECT(event.registration == registration);
+    EXPECT(event.type == HOTCAKEY_ACTION_KEYUP);
+    EXPECT(event.timestamp > 0);
+    EXPECT(written);
+
+    EXPECT(hotcakey::Unregister(registration) == hotcakey::kSuccess);
+    close(fds[0]);
+    close(fds[1]);
+  });
+
+  hotcakey::test::Run("full pipe never blocks the input thread", [] {
+    int fds[2];
+    EXPECT(pipe2(fds, O_CLOEXEC) == 0);
+    fcntl(fds[1], F_SETPIPE_SZ, 4096);
+
+    hotcakey::Action action;
+    action.type = hotcakey::kActionWrite;
+    action.fd = fds[1];
+
+    auto [result, registration] =
+        hotcakey::Register({"F15"}, action, nullptr);
+    EXPECT(result == hotcakey::kSuccess);
+
+    // the caller's descriptor stays blocking
+    EXPECT((fcntl(fds[1], F_GETFL) & O_NONBLOCK) == 0);
+
+    std::atomic<int> markers(0);
+    auto [markerResult, marker] = hotcakey::Register(
+        {"F24"}, [&](const hotcakey::Event&) { markers++; });
+    EXPECT(markerResult == hotcakey::kSuccess);
+
+    for (int i = 0; i < 500; i++) Tap("F15");
+    Tap("F24");
+
+    EXPECT(hotcakey::test::WaitFor([&] { return markers == 2; }));
+
+    EXPECT(hotcakey::Unregister(registration) == hotcakey::kSuccess);
+    EXPECT(hotcakey::Unregister(marker) == hotcakey::kSuccess);
+    close(fds[0]);
+    close(fds[1]);
+  });
+
+  hotcakey::test::Run("datagram socket receives events", [] {
+    auto path = "/tmp/hotcakey-action-" + std::to_string(getpid()) + ".sock";
+
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    std::strncpy(address.sun_path, path.c_str(), sizeof(address.sun_path) - 1);
+
+    auto fd = socket(AF_UNIX, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    EXPECT(bind(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) ==
+           0);
+
+    hotcakey::Action action;
+    action.type = hotcakey::kActionSend;
+    action.path = path;
+    action.types = {hotcakey::kKeyUp};
+
+    auto [result, registration] =
+        hotcakey::Register({"F16"}, action, nullptr);
+    EXPECT(result == hotcakey::kSuccess);
+
+    Tap("F16");
+
+    hotcakey_action_event event;
+    EXPECT(ReadEvent(fd, event));
+    EXPECT(event.registration == registration);
+    EXPECT(event.type == HOTCAKEY_ACTION_KEYUP);
+
+    EXPECT(hotcakey::Unregister(registration) == hotcakey::kSuccess);
+    close(fd);
+    unlink(path.c_str());
+  });
+
+  hotcakey::test::Run("shared library callback is called", [&] {
+    hotcakey::Action action;
+    action.type = hotcakey::kActionCall;
+    action.path = argv[1];
+    action.symbol = "count_action";
+
+    auto [result, registration] =
+        hotcakey::Register({"F17"}, action, nullptr);
+    EXPECT(result == hotcakey::kSuccess);
+
+    // shares the instance loaded by the action
+    auto library = dlopen(argv[1], RTLD_NOW);
+    EXPECT(library != nullptr);
+    auto count = reinterpret_cast<int (*)()>(dlsym(library, "action_count"));
+    auto last = reinterpret_cast<std::uint64_t (*)()>(
+        dlsym(library, "action_registration"));
+
+    Tap("F17");
+
+    EXPECT(hotcakey::test::WaitFor([&] { return count() == 2; }));
+    EXPECT(last() == registration);
+
+    EXPECT(hotcakey::Unregister(registration) == hotcakey::kSuccess);
+    dlclose(library);
+  });
+
+  hotcakey::test::Run("invalid actions are rejected", [] {
+    hotcakey::Action missingFd;
+    missingFd.type = hotcakey::kActionWrite;
+    EXPECT(hotcakey::Register({"F18"}, missingFd, nullptr).first ==
+           hotcakey::kFailure);
+
+    hotcakey::Action missingSymbol;
+    missingSymbol.type = hotcakey::kActionCall;
+    missingSymbol.path = "libc.so.6";
+    missingSymbol.symbol = "hotcakey_no_such_symbol";
+    EXPECT(hotcakey::Register({"F18"}, missingSymbol, nullptr).first ==
+           hotcakey::kFailure);
+  });
+
+  EXPECT(hotcakey::Inactivate() == hotcakey::kSuccess);
+
+  std::cout << "🎉 all action tests passed" << std::endl;
+
+  return 0;
+}
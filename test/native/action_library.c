@@ -0,0 +1,15 @@
+#include "../../src/hotcakey/action.h"
+
+/* loaded by the call action test */
+
+static int count = 0;
+static uint64_t last = 0;
+
+void count_action(const hotcakey_action_event* event) {
+  count++;
+  last = event->registration;
+}
+
+int action_count(void) { return count; }
+
+uint64_t action_registration(void) { return last; }
@@ -0,0 +1,140 @@
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#include <string>
+#include <vector>
+
+#include "../../src/hotcakey/daemon.h"
+#include "../../src/hotcakey/hotcakey.h"
+#include "../../src/hotcakey/synthetic.h"
+#include "./test.h"
+
+namespace {
+
+std::atomic<bool> isCounting(false);
+std::atomic<std::size_t> allocations(0);
+
+// counts allocations of every thread, the input thread included
+void* Allocate(std::size_t size) {
+  if (isCounting.load(std::memory_order_relaxed)) allocations++;
+
+  auto p = std::malloc(size == 0 ? 1 : size);
+  if (p == nullptr) throw std::bad_alloc();
+
+  return p;
+}
+
+template <typename F>
+std::size_t CountAllocations(F&& f) {
+  allocations.store(0);
+  isCounting.store(true);
+  f();
+  isCounting.store(false);
+  return allocations.load();
+}
+
+}  // namespace
+
+void* operator new(std::size_t size) { return Allocate(size); }
+void* operator new[](std::size_t size) { return Allocate(size); }
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::size_t) noexcept { std::free(p); }
+
+int main() {
+  hotcakey::daemon::SetEnabled(false);
+
+  hotcakey::test::Run("registration churn does not allocate", [] {
+    EXPECT(hotcakey::Activate() == hotcakey::kSuccess);
+
+    std::vector<std::string> keys = {"Control", "Shift", "KeyK"};
+    hotcakey::Filter filter;
+    filter.types = {hotcakey::kKeyDown};
+
+    int a = 0, b = 0, c = 0;
+    auto listener = [&a, &b, &c](const hotcakey::Event&) { a += b + c; };
+
+    // grow the registry, the matcher and the streams once
+    auto churn = [&] {
+      auto [result, registration] = hotcakey::Register(keys, listener);
+      EXPECT(result == hotcakey::kSuccess);
+      auto [streamed, stream] = hotcakey::Subscribe(filter, listener);
+      EXPECT(streamed == hotcakey::kSuccess);
+      EXPECT(hotcakey::Unregister(registration) == hotcakey::kSuccess);
+      EXPECT(hotcakey::Unregister(stream) == hotcakey::kSuccess);
+    };
+
+    churn();
+
+    auto count = CountAllocations([&] {
+      for (int i = 0; i < 1000; i++) churn();
+    });
+
+    std::cout << "   allocations: " << count << std::endl;
+    EXPECT(count == 0);
+
+    hotcakey::Inactivate();
+  });
+
+  hotcakey::test::Run("dispatch does not allocate", [] {
+    EXPECT(hotcakey::Activate() == hotcakey::kSuccess);
+
+    std::atomic<int> downs(0);
+    std::atomic<int> ups(0);
+
+    auto [result, registration] =
+        hotcakey::Register({"F13"}, [&](const hotcakey::Event& event) {
+          (event.type == hotcakey::kKeyDown ? downs : ups)++;
+        });
+    EXPECT(result == hotcakey::kSuccess);
+
+    auto press = [&](int times) {
+      hotcakey::synthetic::Emit("F13", hotcakey::kKeyDown);
+      hotcakey::synthetic::Emit("F13", hotcakey::kKeyUp);
+      return hotcakey::test::WaitFor([&] { return ups == times; });
+    };
+
+    EXPECT(press(1));
+
+    auto count = CountAllocations([&] {
+      for (int i = 2; i <= 200; i++) EXPECT(press(i));
+    });
+
+    std::cout << "   allocations: " << count << std::endl;
+    EXPECT(count == 0);
+    EXPECT(downs == 200);
+
+    hotcakey::Unregister(registration);
+    hotcakey::Inactivate();
+  });
+
+  hotcakey::test::Run("stale registrations do not hit reused slots", [] {
+    EXPECT(hotcakey::Activate() == hotcakey::kSuccess);
+
+    std::atomic<int> fired(0);
+
+    auto [first, stale] =
+        hotcakey::Register({"F14"}, [](const hotcakey::Event&) {});
+    EXPECT(first == hotcakey::kSuccess);
+    EXPECT(hotcakey::Unregister(stale) == hotcakey::kSuccess);
+
+    auto [second, registration] = hotcakey::Register(
+        {"F14"}, [&](const hotcakey::Event&) { fired++; });
+    EXPECT(second == hotcakey::kSuccess);
+    EXPECT(registration != stale);
+
+    // unregistering twice is a no-op, even after the slot was reused
+    EXPECT(hotcakey::Unregister(stale) == hotcakey::kSuccess);
+
+    hotcakey::synthetic::Emit("F14", hotcakey::kKeyDown);
+    hotcakey::synthetic::Emit("F14", hotcakey::kKeyUp);
+    EXPECT(hotcakey::test::WaitFor([&] { return fired == 2; }));
+
+    hotcakey::Inactivate();
+  });
+
+  std::cout << "🎉 all allocation tests passed" << std::endl;
+
+  return 0;
+}
@@ -0,0 +1,281 @@
+#include <fcntl.h>
+#include <linux/input.h>
+#include <poll.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../../src/hotcakey/daemon.h"
+#include "../../src/hotcakey/hotcakey.h"
+#include "../../src/hotcakey/synthetic.h"
+#include "./test.h"
+
+namespace {
+
+// events seen so far, as "+KeyA" for keydown and "-KeyA" for keyup
+class Seen {
+ public:
+  hotcakey::Callback Listener(const std::string& name = "") {
+    return [this, name](const hotcakey::Event& event) {
+      std::lock_guard<std::mutex> lock(mutex);
+      events.push_back((event.type == hotcakey::kKeyDown ? "+" : "-") +
+                       (event.code ? std::string(event.code) : name));
+    };
+  }
+
+  std::vector<std::string> Events() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return events;
+  }
+
+  bool Is(const std::vector<std::string>& expected) {
+    return hotcakey::test::WaitFor([&] { return Events() == expected; });
+  }
+
+ private:
+  std::mutex mutex;
+  std::vector<std::string> events;
+};
+
+void Down(const std::string& key) {
+  hotcakey::synthetic::Emit(key, hotcakey::kKeyDown);
+}
+
+void Up(const std::string& key) {
+  hotcakey::synthetic::Emit(key, hotcakey::kKeyUp);
+}
+
+void Sleep(int milliseconds) {
+  std::this_thread::sleep_for(std::chrono::milliseconds(milliseconds));
+}
+
+hotcakey::ComboOption Window(int milliseconds) {
+  hotcakey::ComboOption option;
+  option.window = milliseconds * 1000000LL;
+  return option;
+}
+
+}  // namespace
+
+int main() {
+  hotcakey::daemon::SetEnabled(false);
+
+  hotcakey::test::Run("keys pressed together fire the combo", [] {
+    EXPECT(hotcakey::Activate() == hotcakey::kSuccess);
+
+    Seen seen;
+    EXPECT(hotcakey::RegisterCombo({"KeyJ", "KeyK"}, Window(30),
+                                   seen.Listener("JK")).first ==
+           hotcakey::kSuccess);
+    EXPECT(hotcakey::Subscribe({}, seen.Listener()).first ==
+           hotcakey::kSuccess);
+
+    Down("KeyJ");
+    Down("KeyK");
+    EXPECT(seen.Is({"+JK"}));
+
+    // released with the first key, and the rest never goes on
+    Up("KeyK");
+    Up("KeyJ");
+    EXPECT(seen.Is({"+JK", "-JK"}));
+
+    // tapped within the window
+    Down("KeyK");
+    Down("KeyJ");
+    Up("KeyJ");
+    Up("KeyK");
+    EXPECT(seen.Is({"+JK", "-JK", "+JK", "-JK"}));
+
+    EXPECT(hotcakey::Inactivate() == hotcakey::kSuccess);
+  });
+
+  hotcakey::test::Run("keys go on when no combo completes", [] {
+    EXPECT(hotcakey::Activate() == hotcakey::kSuccess);
+
+    Seen seen;
+    EXPECT(hotcakey::RegisterCombo({"KeyJ", "KeyK"}, Window(30),
+                                   seen.Listener("JK")).first ==
+           hotcakey::kSuccess);
+    EXPECT(hotcakey::Subscribe({}, seen.Listener()).first ==
+           hotcakey::kSuccess);
+
+    std::atomic<int> calls(0);
+    EXPECT(hotcakey::Register({"KeyJ"}, [&](const hotcakey::Event&) {
+             calls++;
+           }).first == hotcakey::kSuccess);
+
+    // the window elapses while held
+    auto start = std::chrono::steady_clock::now();
+    Down("KeyJ");
+    EXPECT(hotcakey::test::WaitFor([&] { return calls == 1; }));
+    EXPECT(std::chrono::steady_clock::now() - start >=
+           std::chrono::milliseconds(30));
+    Up("KeyJ");
+    EXPECT(seen.Is({"+KeyJ", "-KeyJ"}));
+
+    // another key lets it go right away, in order
+    Down("KeyJ");
+    Down("KeyL");
+    Up("KeyL");
+    Up("KeyJ");
+    EXPECT(seen.Is({"+KeyJ", "-KeyJ", "+KeyJ", "+KeyL", "-KeyL", "-KeyJ"}));
+
+    // released before the other key
+    Down("KeyK");
+    Up("KeyK");
+    EXPECT(seen.Is({"+KeyJ", "-KeyJ", "+KeyJ", "+KeyL", "-KeyL", "-KeyJ",
+                    "+KeyK", "-KeyK"}));
+
+    // the other key after the window
+    Down("KeyJ");
+    Sleep(60);
+    Down("KeyK");
+    Up("KeyJ");
+    Up("KeyK");
+    EXPECT(seen.Is({"+KeyJ", "-KeyJ", "+KeyJ", "+KeyL", "-KeyL", "-KeyJ",
+                    "+KeyK", "-KeyK", "+KeyJ", "+KeyK", "-KeyJ", "-KeyK"}));
+    EXPECT(calls == 6);
+
+    EXPECT(hotcakey::Inactivate() == hotcakey::kSuccess);
+  });
+
+  hotcakey::test::Run("bigger combos wait for their window", [] {
+    EXPECT(hotcakey::Activate() == hotcakey::kSuccess);
+
+    Seen seen;
+    EXPECT(hotcakey::RegisterCombo({"KeyJ", "KeyK"}, Window(30),
+                                   seen.Listener("JK")).first ==
+           hotcakey::kSuccess);
+    EXPECT(hotcakey::RegisterCombo({"KeyJ", "KeyK", "KeyL"}, Window(30),
+                                   seen.Listener("JKL")).first ==
+           hotcakey::kSuccess);
+
+    Down("KeyJ");
+    Down("KeyK");
+    Down("KeyL");
+    Up("KeyJ");
+    Up("KeyK");
+    Up("KeyL");
+    EXPECT(seen.Is({"+JKL", "-JKL"}));
+
+    // the smaller one fires once the bigger one cannot complete
+    Down("KeyJ");
+    Down("KeyK");
+    Sleep(60);
+    EXPECT(seen.Is({"+JKL", "-JKL", "+JK"}));
+    Up("KeyJ");
+    Up("KeyK");
+    EXPECT(seen.Is({"+JKL", "-JKL", "+JK", "-JK"}));
+
+    EXPECT(hotcakey::Inactivate() == hotcakey::kSuccess);
+  });
+
+  hotcakey::test::Run("a combo stands for its key", [] {
+    int passthrough[2];
+    EXPECT(pipe2(passthrough, O_NONBLOCK | O_CLOEXEC) == 0);
+    EXPECT(hotcakey::synthetic::SetPassthrough(passthrough[1]) ==
+           hotcakey::kSuccess);
+
+    hotcakey::ActivationOption grab;
+    grab.grab = true;
+    EXPECT(hotcakey::Activate(grab) == hotcakey::kSuccess);
+
+    auto [added, keyboard] =
+        hotcakey::synthetic::AddDevice({"", "Keyboard", 0, 0, ""});
+    EXPECT(added == hotcakey::kSuccess);
+
+    std::atomic<int> escapes(0);
+    EXPECT(hotcakey::Register({"Escape"}, [&](const hotcakey::Event&) {
+             escapes++;
+           }).first == hotcakey::kSuccess);
+
+    auto option = Window(30);
+    option.key = "Escape";
+    EXPECT(hotcakey::RegisterCombo({"KeyJ", "KeyK"}, option, nullptr).first ==
+           hotcakey::kSuccess);
+
+    hotcakey::synthetic::Emit(keyboard, "KeyJ", hotcakey::kKeyDown);
+    hotcakey::synthetic::Emit(keyboard, "KeyK", hotcakey::kKeyDown);
+    hotcakey::synthetic::Emit(keyboard, "KeyJ", hotcakey::kKeyUp);
+    hotcakey::synthetic::Emit(keyboard, "KeyK", hotcakey::kKeyUp);
+    hotcakey::synthetic::Emit(keyboard, "KeyA", hotcakey::kKeyDown);
+    hotcakey::synthetic::Emit(keyboard, "KeyA", hotcakey::kKeyUp);
+    EXPECT(hotcakey::test::WaitFor([&] { return escapes == 2; }));
+
+    std::vector<std::string> passed;
+    input_event events[16];
+    pollfd readable{passthrough[0], POLLIN, 0};
+    while (poll(&readable, 1, 50) > 0) {
+      auto size = read(passthrough[0], events, sizeof(events));
+      if (size <= 0) break;
+
+      for (std::size_t i = 0; i < size / sizeof(input_event); i++) {
+        if (events[i].type != EV_KEY) continue;
+        passed.push_back((events[i].value ? "+" : "-") +
+                         std::to_string(events[i].code));
+      }
+    }
+
+    auto down = [](unsigned int code) { return "+" + std::to_string(code); };
+    auto up = [](unsigned int code) { return "-" + std::to_string(code); };
+    EXPECT((passed == std::vector<std::string>{down(KEY_ESC), up(KEY_ESC),
+                                               down(KEY_A), up(KEY_A)}));
+
+    EXPECT(hotcakey::Inactivate() == hotcakey::kSuccess);
+    EXPECT(hotcakey::synthetic::SetPassthrough(-1) == hotcakey::kSuccess);
+    close(passthrough[0]);
+    close(passthrough[1]);
+  });
+
+  hotcakey::test::Run("combos are unregistered while fired", [] {
+    EXPECT(hotcakey::Activate() == hotcakey::kSuccess);
+
+    Seen seen;
+    auto [result, registration] =
+        hotcakey::RegisterCombo({"KeyJ", "KeyK"}, Window(30),
+                                seen.Listener("JK"));
+    EXPECT(result == hotcakey::kSuccess);
+    EXPECT(hotcakey::Subscribe({}, seen.Listener()).first ==
+           hotcakey::kSuccess);
+
+    Down("KeyJ");
+    Down("KeyK");
+    EXPECT(seen.Is({"+JK"}));
+
+    EXPECT(hotcakey::Unregister(registration) == hotcakey::kSuccess);
+    Up("KeyJ");
+    Up("KeyK");
+    Down("KeyJ");
+    Up("KeyJ");
+    EXPECT(seen.Is({"+JK", "+KeyJ", "-KeyJ"}));
+
+    EXPECT(hotcakey::Inactivate() == hotcakey::kSuccess);
+  });
+
+  hotcakey::test::Run("broken combos are rejected", [] {
+    auto noop = [](const hotcakey::Event&) {};
+    auto option = Window(30);
+
+    EXPECT(hotcakey::RegisterCombo({"KeyJ"}, option, noop).first ==
+           hotcakey::kFailure);
+    EXPECT(hotcakey::RegisterCombo({"ShiftLeft", "KeyJ"}, option, noop)
+               .first == hotcakey::kFailure);
+    EXPECT(hotcakey::RegisterCombo({"KeyJ", "NoSuchKey"}, option, noop)
+               .first == hotcakey::kFailure);
+    EXPECT(hotcakey::RegisterCombo({"KeyJ", "KeyK"}, Window(0), noop).first ==
+           hotcakey::kFailure);
+
+    option.key = "NoSuchKey";
+    EXPECT(hotcakey::RegisterCombo({"KeyJ", "KeyK"}, option, noop).first ==
+           hotcakey::kFailure);
+  });
+
+  std::cout << "🎉 all combo tests passed" << std::endl;
+
+  return 0;
+}
@@ -0,0 +1,31 @@
+// compiles a native test or bench against the linux core.
+//
+// the arguments are passed to c++ as they are, followed by the sources of
+// `linux_core_sources` in binding.gyp, so the list lives in one place.
+//
+//   node test/native/compile.js -g -o build/test/filter test/native/filter.cc
+
+const { spawnSync } = require('child_process')
+const fs = require('fs')
+const path = require('path')
+
+const root = path.join(__dirname, '..', '..')
+
+// gyp files are json plus comments
+const gyp = fs
+  .readFileSync(path.join(root, 'binding.gyp'), 'utf8')
+  .replace(/^\s*#.*$/gm, '')
+const sources = JSON.parse(gyp).variables.linux_core_sources
+
+const args = process.argv.slice(2)
+const output = args.indexOf('-o')
+if (output >= 0 && output + 1 < args.length) {
+  fs.mkdirSync(path.dirname(path.resolve(root, args[output + 1])), { recursive: true })
+}
+
+const cc = spawnSync('c++', ['-std=c++17', ...args, ...sources, '-lpthread', '-lrt', '-ldl'], {
+  cwd: root,
+  stdio: 'inherit',
+})
+
+process.exit(cc.status === null ? 1 : cc.status)
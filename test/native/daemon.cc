@@ -0,0 +1,437 @@
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+
+#include "../../src/hotcakey/daemon.h"
+#include "../../src/hotcakey/hotcakey.h"
+#include "../../src/hotcakey/ring.h"
+#include "../../src/hotcakey/synthetic.h"
+#include "../../src/hotcakeyd/server.h"
+#include "./test.h"
+#include "./uinput.h"
+
+namespace {
+
+// a key typed into hotcakeyd. clients have no request for it, so the
+// daemon reads them from a pipe and emits them into its synthetic input.
+struct Typed {
+  char key[32];
+  hotcakey::EventType type;
+};
+
+int typing[2] = {-1, -1};
+
+std::string SocketPath() {
+  return "/tmp/hotcakey-test-" + std::to_string(getpid()) + ".sock";
+}
+
+void Type(const std::string& key, hotcakey::EventType type) {
+  Typed typed{};
+  std::strncpy(typed.key, key.c_str(), sizeof(typed.key) - 1);
+  typed.type = type;
+
+  EXPECT(write(typing[1], &typed, sizeof(typed)) ==
+         static_cast<ssize_t>(sizeof(typed)));
+}
+
+// connects to hotcakeyd without `daemon::Client`, the way a hostile
+// client would, and receives the records and the signal page of its ring.
+int ConnectRaw(const std::string& path, int (&fds)[2]) {
+  sockaddr_un address{};
+  address.sun_family = AF_UNIX;
+  std::strncpy(address.sun_path, path.c_str(), sizeof(address.sun_path) - 1);
+
+  auto fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  EXPECT(fd >= 0);
+  EXPECT(connect(fd, reinterpret_cast<sockaddr*>(&address),
+                 sizeof(address)) == 0);
+
+  char byte;
+  iovec iov{&byte, 1};
+  char control[CMSG_SPACE(sizeof(fds))] = {};
+
+  msghdr message{};
+  message.msg_iov = &iov;
+  message.msg_iovlen = 1;
+  message.msg_control = control;
+  message.msg_controllen = sizeof(control);
+
+  EXPECT(recvmsg(fd, &message, MSG_CMSG_CLOEXEC) == 1);
+
+  auto cmsg = CMSG_FIRSTHDR(&message);
+  EXPECT(cmsg != nullptr && cmsg->cmsg_type == SCM_RIGHTS &&
+         cmsg->cmsg_len == CMSG_LEN(sizeof(fds)));
+  std::memcpy(fds, CMSG_DATA(cmsg), sizeof(fds));
+
+  return fd;
+}
+
+std::string RequestRaw(int fd, const std::string& line) {
+  auto message = line + "\n";
+  EXPECT(write(fd, message.data(), message.size()) ==
+         static_cast<ssize_t>(message.size()));
+
+  std::string response;
+  char ch;
+  while (read(fd, &ch, 1) == 1 && ch != '\n') response += ch;
+
+  return response;
+}
+
+// runs hotcakeyd in a child process on the synthetic backend
+pid_t StartDaemon(const std::string& path) {
+  EXPECT(pipe2(typing, O_CLOEXEC) == 0);
+
+  auto pid = fork();
+
+  if (pid == 0) {
+    close(typing[1]);
+    signal(SIGTERM, [](int) { hotcakeyd::Stop(); });
+    hotcakey::daemon::SetEnabled(false);
+    if (hotcakey::Activate() != hotcakey::kSuccess) std::_Exit(1);
+
+    std::thread([] {
+      Typed typed;
+      while (read(typing[0], &typed, sizeof(typed)) == sizeof(typed)) {
+        hotcakey::synthetic::Emit(typed.key, typed.type);
+      }
+    }).detach();
+
+    auto served = hotcakeyd::Serve(path);
+    hotcakey::Inactivate();
+    std::_Exit(served ? 0 : 1);
+  }
+
+  close(typing[0]);
+
+  struct stat st;
+  EXPECT(hotcakey::test::WaitFor(
+      [&] { return stat(path.c_str(), &st) == 0; },
+      std::chrono::milliseconds(3000)));
+
+  return pid;
+}
+
+}  // namespace
+
+int main() {
+  auto path = SocketPath();
+  auto daemon = StartDaemon(path);
+
+  setenv("HOTCAKEY_SOCKET", path.c_str(), 1);
+
+  hotcakey::test::Run("clients receive chords matched by hotcakeyd", [] {
+    EXPECT(hotcakey::Activate() == hotcakey::kSuccess);
+
+    std::atomic<int> downs(0);
+    std::atomic<int> ups(0);
+
+    auto [result, registration] = hotcakey::Register(
+        {"Control", "KeyD"}, [&](const hotcakey::Event& event) {
+          (event.type == hotcakey::kKeyDown ? downs : ups)++;
+        });
+    EXPECT(result == hotcakey::kSuccess);
+
+    Type("ControlLeft", hotcakey::kKeyDown);
+    Type("KeyD", hotcakey::kKeyDown);
+    Type("KeyD", hotcakey::kKeyUp);
+    Type("ControlLeft", hotcakey::kKeyUp);
+
+    EXPECT(hotcakey::test::WaitFor([&] { return ups == 1; }));
+    EXPECT(downs == 1);
+
+    EXPECT(hotcakey::Unregister(registration) == hotcakey::kSuccess);
+
+    Type("ControlLeft", hotcakey::kKeyDown);
+    Type("KeyD", hotcakey::kKeyDown);
+    Type("KeyD", hotcakey::kKeyUp);
+    Type("ControlLeft", hotcakey::kKeyUp);
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    EXPECT(downs == 1);
+
+    hotcakey::Inactivate();
+  });
+
+  hotcakey::test::Run("listeners of a chord share one registration", [] {
+    EXPECT(hotcakey::Activate() == hotcakey::kSuccess);
+
+    std::atomic<int> first(0);
+    std::atomic<int> second(0);
+
+    auto a = hotcakey::Register(
+        {"Shift", "Control", "KeyG"},
+        [&](const hotcakey::Event&) { first++; });
+    auto b = hotcakey::Register(
+        {"Control", "Shift", "KeyG"},
+        [&](const hotcakey::Event&) { second++; });
+    EXPECT(a.first == hotcakey::kSuccess && b.first == hotcakey::kSuccess);
+
+    auto press = [] {
+      Type("ControlLeft", hotcakey::kKeyDown);
+      Type("ShiftLeft", hotcakey::kKeyDown);
+      Type("KeyG", hotcakey::kKeyDown);
+      Type("KeyG", hotcakey::kKeyUp);
+      Type("ShiftLeft", hotcakey::kKeyUp);
+      Type("ControlLeft", hotcakey::kKeyUp);
+    };
+
+    press();
+    EXPECT(hotcakey::test::WaitFor([&] { return first == 2 && second == 2; }));
+
+    // the other listener keeps the registration of hotcakeyd alive
+    EXPECT(hotcakey::Unregister(a.second) == hotcakey::kSuccess);
+
+    press();
+    EXPECT(hotcakey::test::WaitFor([&] { return second == 4; }));
+    EXPECT(first == 2);
+
+    EXPECT(hotcakey::Unregister(b.second) == hotcakey::kSuccess);
+
+    hotcakey::Inactivate();
+  });
+
+  hotcakey::test::Run("layers are chosen after hotcakeyd matched", [] {
+    EXPECT(hotcakey::Activate() == hotcakey::kSuccess);
+
+    std::atomic<int> base(0);
+    std::atomic<int> layered(0);
+
+    EXPECT(hotcakey::Register({"F19"}, [&](const hotcakey::Event&) {
+             base++;
+           }).first == hotcakey::kSuccess);
+    EXPECT(hotcakey::RegisterInLayer("normal", {"F19"},
+                                     [&](const hotcakey::Event&) {
+                                       layered++;
+                                     })
+               .first == hotcakey::kSuccess);
+
+    EXPECT(hotcakey::SwitchLayer("normal") == hotcakey::kSuccess);
+    Type("F19", hotcakey::kKeyDown);
+    Type("F19", hotcakey::kKeyUp);
+    EXPECT(hotcakey::test::WaitFor([&] { return layered == 2; }));
+
+    EXPECT(hotcakey::SwitchLayer("") == hotcakey::kSuccess);
+    Type("F19", hotcakey::kKeyDown);
+    Type("F19", hotcakey::kKeyUp);
+    EXPECT(hotcakey::test::WaitFor([&] { return base == 2; }));
+    EXPECT(layered == 2);
+
+    hotcakey::Inactivate();
+  });
+
+  hotcakey::test::Run("streams are not served by hotcakeyd", [] {
+    EXPECT(hotcakey::Activate() == hotcakey::kSuccess);
+
+    auto [result, registration] =
+        hotcakey::Subscribe({}, [](const hotcakey::Event&) {});
+    EXPECT(result == hotcakey::kFailure);
+
+    hotcakey::Inactivate();
+  });
+
+  hotcakey::test::Run("registrations are released on disconnect", [] {
+    std::atomic<int> fired(0);
+
+    for (int i = 0; i < 2; i++) {
+      EXPECT(hotcakey::Activate() == hotcakey::kSuccess);
+
+      // hotcakeyd forgot the registrations of the previous connection
+      auto [result, registration] = hotcakey::Register(
+          {"F20"}, [&](const hotcakey::Event&) { fired++; });
+      EXPECT(result == hotcakey::kSuccess);
+
+      Type("F20", hotcakey::kKeyDown);
+      Type("F20", hotcakey::kKeyUp);
+      EXPECT(hotcakey::test::WaitFor([&] { return fired == (i + 1) * 2; }));
+
+      hotcakey::Inactivate();
+    }
+  });
+
+  hotcakey::test::Run("hotkeys failed to restore stay in the snapshot", [] {
+    std::atomic<int> kept(0);
+    std::atomic<int> device(0);
+
+    // set aside before hotcakeyd, which does not serve device hotkeys
+    auto k = hotcakey::Register(
+        {"F16"}, [&](const hotcakey::Event&) { kept++; });
+    auto d = hotcakey::RegisterOnDevice(
+        {"Macro Pad", 0, 0, ""}, {"F17"},
+        [&](const hotcakey::Event&) { device++; });
+    EXPECT(k.first == hotcakey::kSuccess && d.first == hotcakey::kSuccess);
+
+    auto [result, snapshot] = hotcakey::TakeSnapshot();
+    EXPECT(result == hotcakey::kSuccess);
+
+    EXPECT(hotcakey::Activate() == hotcakey::kSuccess);
+    EXPECT(hotcakey::Restore(snapshot) == hotcakey::kFailure);
+
+    Type("F16", hotcakey::kKeyDown);
+    Type("F16", hotcakey::kKeyUp);
+    EXPECT(hotcakey::test::WaitFor([&] { return kept == 2; }));
+
+    // the failed one can still be dropped, and then the snapshot restores
+    EXPECT(hotcakey::Unregister(d.second) == hotcakey::kSuccess);
+    EXPECT(hotcakey::Restore(snapshot) == hotcakey::kSuccess);
+    EXPECT(hotcakey::Restore(snapshot) == hotcakey::kFailure);
+
+    Type("F16", hotcakey::kKeyDown);
+    Type("F16", hotcakey::kKeyUp);
+    EXPECT(hotcakey::test::WaitFor([&] { return kept == 4; }));
+    EXPECT(device == 0);
+
+    hotcakey::Inactivate();
+  });
+
+  hotcakey::test::Run("clients cannot type into hotcakeyd", [] {
+    EXPECT(hotcakey::Activate() == hotcakey::kSuccess);
+
+    std::atomic<int> fired(0);
+    EXPECT(hotcakey::Register({"F18"}, [&](const hotcakey::Event&) {
+             fired++;
+           }).first == hotcakey::kSuccess);
+
+    EXPECT(hotcakey::synthetic::Emit("F18", hotcakey::kKeyDown) ==
+           hotcakey::kFailure);
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    EXPECT(fired == 0);
+
+    hotcakey::Inactivate();
+  });
+
+  hotcakey::test::Run("events keep the key code of the chord", [] {
+    auto name = "daemon-" + std::to_string(getpid());
+
+    EXPECT(hotcakey::Activate() == hotcakey::kSuccess);
+    EXPECT(hotcakey::Publish(name, 64) == hotcakey::kSuccess);
+
+    auto reader = hotcakey::ring::Reader::Open(name);
+    EXPECT(reader != nullptr);
+
+    std::atomic<int> fired(0);
+    EXPECT(hotcakey::Register({"Alt", "KeyX"}, [&](const hotcakey::Event&) {
+             fired++;
+           }).first == hotcakey::kSuccess);
+
+    Type("AltLeft", hotcakey::kKeyDown);
+    Type("KeyX", hotcakey::kKeyDown);
+    Type("KeyX", hotcakey::kKeyUp);
+    Type("AltLeft", hotcakey::kKeyUp);
+    EXPECT(hotcakey::test::WaitFor([&] { return fired == 2; }));
+
+    hotcakey::ring::Record record;
+    EXPECT(reader->Read(record));
+    EXPECT(record.code == KEY_X && record.type == hotcakey::kKeyDown);
+    EXPECT(reader->Read(record));
+    EXPECT(record.code == KEY_X && record.type == hotcakey::kKeyUp);
+
+    EXPECT(hotcakey::Unpublish() == hotcakey::kSuccess);
+    hotcakey::Inactivate();
+  });
+
+  hotcakey::test::Run("clients cannot scribble over their ring", [&path] {
+    int fds[2];
+    auto fd = ConnectRaw(path, fds);
+
+    struct stat st;
+    EXPECT(fstat(fds[0], &st) == 0);
+    auto size = static_cast<std::size_t>(st.st_size);
+
+    // the records can only be mapped read only
+    EXPECT(mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fds[0],
+                0) == MAP_FAILED);
+    EXPECT(ftruncate(fds[0], 0) != 0);
+
+    // not even when reopened writable through /proc
+    auto reopened = open(("/proc/self/fd/" + std::to_string(fds[0])).c_str(),
+                         O_RDWR | O_CLOEXEC);
+    if (reopened >= 0) {
+      EXPECT(mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED,
+                  reopened, 0) == MAP_FAILED);
+      EXPECT(write(reopened, "garbage", 7) < 0);
+      EXPECT(ftruncate(reopened, 0) != 0);
+      close(reopened);
+    }
+
+    // the signal page is writable, but cannot be resized under hotcakeyd
+    EXPECT(fstat(fds[1], &st) == 0);
+    auto signalSize = static_cast<std::size_t>(st.st_size);
+    EXPECT(ftruncate(fds[1], 0) != 0);
+    EXPECT(ftruncate(fds[1], 1 << 20) != 0);
+
+    auto signal = mmap(nullptr, signalSize, PROT_READ | PROT_WRITE,
+                       MAP_SHARED, fds[1], 0);
+    EXPECT(signal != MAP_FAILED);
+    std::memset(signal, 0xff, signalSize);
+    munmap(signal, signalSize);
+
+    // hotcakeyd keeps writing sane records in spite of the garbage
+    auto reader = hotcakey::ring::Reader::Attach(dup(fds[0]), dup(fds[1]));
+    EXPECT(reader != nullptr);
+    EXPECT(RequestRaw(fd, "register 7 KeyQ") == "ok");
+
+    Type("KeyQ", hotcakey::kKeyDown);
+    Type("KeyQ", hotcakey::kKeyUp);
+
+    hotcakey::ring::Record record;
+    EXPECT(hotcakey::test::WaitFor([&] { return reader->Read(record); }));
+    EXPECT(record.registration == 7 && record.code == KEY_Q &&
+           record.type == hotcakey::kKeyDown);
+    EXPECT(hotcakey::test::WaitFor([&] { return reader->Read(record); }));
+    EXPECT(record.code == KEY_Q && record.type == hotcakey::kKeyUp);
+
+    close(fds[0]);
+    close(fds[1]);
+    close(fd);
+  });
+
+  hotcakey::test::Run("hotcakeyd reads keyboards in /dev/input", [] {
+    if (!hotcakey::test::VirtualKeyboard::IsAvailable()) {
+      std::cout << "⏭️  skipped since /dev/uinput is not writable"
+                << std::endl;
+      return;
+    }
+
+    EXPECT(hotcakey::Activate() == hotcakey::kSuccess);
+
+    std::atomic<int> fired(0);
+    EXPECT(hotcakey::Register({"F21"}, [&](const hotcakey::Event&) {
+             fired++;
+           }).first == hotcakey::kSuccess);
+
+    // hotcakeyd picks the keyboard up once udev made its node
+    hotcakey::test::VirtualKeyboard keyboard;
+    EXPECT(keyboard.Create("hotcakey test keyboard", 0, 0));
+    EXPECT(hotcakey::test::WaitFor(
+        [&] {
+          keyboard.Press(KEY_F21);
+          std::this_thread::sleep_for(std::chrono::milliseconds(10));
+          return fired > 0;
+        },
+        std::chrono::milliseconds(5000)));
+
+    hotcakey::Inactivate();
+  });
+
+  kill(daemon, SIGTERM);
+
+  int status;
+  EXPECT(waitpid(daemon, &status, 0) == daemon);
+  EXPECT(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+
+  std::cout << "🎉 all daemon tests passed" << std::endl;
+
+  return 0;
+}
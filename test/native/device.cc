@@ -0,0 +1,141 @@
+#include <atomic>
+#include <string>
+
+#include "../../src/hotcakey/daemon.h"
+#include "../../src/hotcakey/hotcakey.h"
+#include "../../src/hotcakey/synthetic.h"
+#include "./test.h"
+#include "./uinput.h"
+
+namespace {
+
+using hotcakey::test::Counter;
+using hotcakey::test::Press;
+
+bool HasDevice(const std::string& name) {
+  for (auto& device : hotcakey::Devices()) {
+    if (device.name == name) return true;
+  }
+  return false;
+}
+
+}  // namespace
+
+int main() {
+  hotcakey::daemon::SetEnabled(false);
+
+  hotcakey::test::Run("device hotkeys only take keys of their device", [] {
+    EXPECT(hotcakey::Activate() == hotcakey::kSuccess);
+
+    auto [added, pad] =
+        hotcakey::synthetic::AddDevice({"", "Macro Pad", 0x1209, 0x0001, ""});
+    auto [other, keyboard] =
+        hotcakey::synthetic::AddDevice({"", "Keyboard", 0x046d, 0xc31c, ""});
+    EXPECT(added == hotcakey::kSuccess && other == hotcakey::kSuccess);
+    EXPECT(HasDevice("Macro Pad") && HasDevice("Keyboard"));
+
+    std::atomic<int> byName(0);
+    std::atomic<int> byId(0);
+    std::atomic<int> any(0);
+
+    hotcakey::DeviceFilter name;
+    name.name = "Macro Pad";
+    hotcakey::DeviceFilter id;
+    id.vendor = 0x1209;
+    id.product = 0x0001;
+
+    EXPECT(hotcakey::RegisterOnDevice(name, {"F13"}, Counter(byName)).first ==
+           hotcakey::kSuccess);
+    EXPECT(hotcakey::RegisterOnDevice(id, {"F13"}, Counter(byId)).first ==
+           hotcakey::kSuccess);
+    EXPECT(hotcakey::Register({"F13"}, Counter(any)).first ==
+           hotcakey::kSuccess);
+
+    // the main keyboard only reaches the hotkey of any device
+    Press(keyboard, "F13");
+    EXPECT(hotcakey::test::WaitFor([&] { return any == 2; }));
+    EXPECT(byName == 0 && byId == 0);
+
+    Press(pad, "F13");
+    EXPECT(hotcakey::test::WaitFor(
+        [&] { return any == 4 && byName == 2 && byId == 2; }));
+
+    // unplugged, and plugged in again
+    EXPECT(hotcakey::synthetic::RemoveDevice(pad) == hotcakey::kSuccess);
+    EXPECT(hotcakey::test::WaitFor([] { return !HasDevice("Macro Pad"); }));
+
+    auto [readded, again] =
+        hotcakey::synthetic::AddDevice({"", "Macro Pad", 0x1209, 0x0001, ""});
+    EXPECT(readded == hotcakey::kSuccess);
+
+    Press(again, "F13");
+    EXPECT(hotcakey::test::WaitFor([&] { return byName == 4 && byId == 4; }));
+
+    EXPECT(hotcakey::Inactivate() == hotcakey::kSuccess);
+    EXPECT(hotcakey::Devices().empty());
+  });
+
+  hotcakey::test::Run("keyboards plugged in later are picked up", [] {
+    if (!hotcakey::test::VirtualKeyboard::IsAvailable()) {
+      std::cout << "⏭️  skipped since /dev/uinput is not writable"
+                << std::endl;
+      return;
+    }
+
+    EXPECT(hotcakey::Activate() == hotcakey::kSuccess);
+
+    std::atomic<int> calls(0);
+    hotcakey::DeviceFilter pad;
+    pad.name = "hotcakey test pad";
+
+    EXPECT(hotcakey::RegisterOnDevice(pad, {"F14"}, Counter(calls)).first ==
+           hotcakey::kSuccess);
+
+    {
+      hotcakey::test::VirtualKeyboard keyboard;
+      EXPECT(keyboard.Create("hotcakey test pad", 0x1209, 0x0002));
+      EXPECT(hotcakey::test::WaitFor(
+          [] { return HasDevice("hotcakey test pad"); },
+          std::chrono::milliseconds(5000)));
+
+      keyboard.Press(KEY_F14);
+      EXPECT(hotcakey::test::WaitFor([&] { return calls == 2; }));
+    }
+
+    EXPECT(hotcakey::test::WaitFor(
+        [] { return !HasDevice("hotcakey test pad"); },
+        std::chrono::milliseconds(5000)));
+
+    EXPECT(hotcakey::Inactivate() == hotcakey::kSuccess);
+  });
+
+  hotcakey::test::Run("device hotkeys registered before activation work",
+                      [] {
+    std::atomic<int> calls(0);
+    hotcakey::DeviceFilter pad;
+    pad.name = "Macro Pad";
+
+    auto [result, registration] =
+        hotcakey::RegisterOnDevice(pad, {"F15"}, Counter(calls));
+    EXPECT(result == hotcakey::kSuccess);
+
+    EXPECT(hotcakey::Activate() == hotcakey::kSuccess);
+
+    auto [added, device] =
+        hotcakey::synthetic::AddDevice({"", "Macro Pad", 0, 0, ""});
+    EXPECT(added == hotcakey::kSuccess);
+
+    // keys without a device never reach it
+    hotcakey::synthetic::Emit("F15", hotcakey::kKeyDown);
+    hotcakey::synthetic::Emit("F15", hotcakey::kKeyUp);
+    Press(device, "F15");
+    EXPECT(hotcakey::test::WaitFor([&] { return calls == 2; }));
+
+    EXPECT(hotcakey::Unregister(registration) == hotcakey::kSuccess);
+    EXPECT(hotcakey::Inactivate() == hotcakey::kSuccess);
+  });
+
+  std::cout << "🎉 all device tests passed" << std::endl;
+
+  return 0;
+}
@@ -0,0 +1,79 @@
+#include "../../src/hotcakey/fanout.h"
+
+#include <cstddef>
+#include <cstdint>
+
+#include "./test.h"
+
+namespace {
+
+using Fanout = hotcakey::Fanout<std::uint32_t, int>;
+
+}  // namespace
+
+int main() {
+  hotcakey::test::Run("only the first listener of a chord registers it", [] {
+    Fanout fanout;
+
+    EXPECT(fanout.Add(1, 10));
+    fanout.Find(1)->handle = 42;
+
+    EXPECT(!fanout.Add(1, 11));
+    EXPECT(!fanout.Add(1, 12));
+    EXPECT(fanout.Add(2, 13));
+
+    EXPECT(fanout.Size() == 2);
+    EXPECT(fanout.Find(1)->registrations.size() == 3);
+    EXPECT(fanout.Find(3) == nullptr);
+  });
+
+  hotcakey::test::Run("only the last listener of a chord unregisters it", [] {
+    Fanout fanout;
+    int handle = 0;
+
+    fanout.Add(1, 10);
+    fanout.Find(1)->handle = 42;
+    fanout.Add(1, 11);
+
+    EXPECT(!fanout.Remove(1, 10, handle));
+    EXPECT(handle == 0);
+    EXPECT(fanout.Find(1)->registrations.size() == 1);
+
+    EXPECT(fanout.Remove(1, 11, handle));
+    EXPECT(handle == 42);
+    EXPECT(fanout.Find(1) == nullptr);
+    EXPECT(fanout.Size() == 0);
+  });
+
+  hotcakey::test::Run("removing unknown listeners does nothing", [] {
+    Fanout fanout;
+    int handle = 0;
+
+    EXPECT(!fanout.Remove(1, 10, handle));
+
+    fanout.Add(1, 10);
+    EXPECT(!fanout.Remove(1, 11, handle));
+    EXPECT(!fanout.Remove(2, 10, handle));
+    EXPECT(fanout.Size() == 1);
+  });
+
+  hotcakey::test::Run("listeners are notified in registration order", [] {
+    Fanout fanout;
+
+    for (int i = 0; i < 100; i++) fanout.Add(1, i);
+
+    auto& registrations = fanout.Find(1)->registrations;
+    for (std::size_t i = 0; i < 100; i++) EXPECT(registrations[i] == i);
+
+    int chords = 0;
+    fanout.ForEach([&chords](std::uint32_t, Fanout::Entry&) { chords++; });
+    EXPECT(chords == 1);
+
+    fanout.Clear();
+    EXPECT(fanout.Size() == 0);
+  });
+
+  std::cout << "🎉 all fanout tests passed" << std::endl;
+
+  return 0;
+}
@@ -0,0 +1,224 @@
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "../../src/hotcakey/daemon.h"
+#include "../../src/hotcakey/hotcakey.h"
+#include "../../src/hotcakey/synthetic.h"
+#include "./test.h"
+
+namespace {
+
+struct Received {
+  hotcakey::EventType type;
+  std::string code;
+};
+
+class Recorder {
+ public:
+  std::function<void(hotcakey::Event)> Listener() {
+    return [this](const hotcakey::Event& event) {
+      std::lock_guard<std::mutex> lock(mutex);
+      events.push_back({event.type, event.code ? event.code : ""});
+    };
+  }
+
+  std::vector<Received> Events() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return events;
+  }
+
+  std::size_t Size() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return events.size();
+  }
+
+ private:
+  std::mutex mutex;
+  std::vector<Received> events;
+};
+
+void Tap(const std::string& key) {
+  EXPECT(hotcakey::synthetic::Emit(key, hotcakey::kKeyDown) ==
+         hotcakey::kSuccess);
+  EXPECT(hotcakey::synthetic::Emit(key, hotcakey::kKeyUp) ==
+         hotcakey::kSuccess);
+}
+
+void Press(const std::string& key) {
+  EXPECT(hotcakey::synthetic::Emit(key, hotcakey::kKeyDown) ==
+         hotcakey::kSuccess);
+}
+
+void Release(const std::string& key) {
+  EXPECT(hotcakey::synthetic::Emit(key, hotcakey::kKeyUp) ==
+         hotcakey::kSuccess);
+}
+
+// every test ends with this marker so we know all preceding synthetic
+// events have been processed by the input thread.
+void Sync(Recorder& marker, std::size_t expected) {
+  Tap("F24");
+  EXPECT(hotcakey::test::WaitFor([&] { return marker.Size() >= expected; }));
+}
+
+}  // namespace
+
+int main() {
+  // streams are not served by hotcakeyd
+  hotcakey::daemon::SetEnabled(false);
+
+  EXPECT(hotcakey::Activate() == hotcakey::kSuccess);
+
+  Recorder marker;
+  hotcakey::Filter markerFilter;
+  markerFilter.keys = {"F24"};
+  markerFilter.types = {hotcakey::kKeyUp};
+  auto [markerResult, markerRegistration] =
+      hotcakey::Subscribe(markerFilter, marker.Listener());
+  EXPECT(markerResult == hotcakey::kSuccess);
+
+  std::size_t markers = 0;
+
+  hotcakey::test::Run("all keys with control held", [&] {
+    Recorder recorder;
+    hotcakey::Filter filter;
+    filter.modifiers = {"Control"};
+    auto [result, registration] =
+        hotcakey::Subscribe(filter, recorder.Listener());
+    EXPECT(result == hotcakey::kSuccess);
+
+    Tap("KeyA");
+    Press("ControlLeft");
+    Tap("KeyB");
+    Tap("Digit1");
+    Release("ControlLeft");
+    Tap("KeyC");
+
+    Sync(marker, ++markers);
+
+    auto events = recorder.Events();
+    // ControlLeft keydown itself is seen with control held
+    EXPECT(events.size() == 5);
+    EXPECT(events[0].code == "ControlLeft");
+    EXPECT(events[1].code == "KeyB" && events[1].type == hotcakey::kKeyDown);
+    EXPECT(events[2].code == "KeyB" && events[2].type == hotcakey::kKeyUp);
+    EXPECT(events[3].code == "Digit1");
+    EXPECT(events[4].code == "Digit1");
+
+    EXPECT(hotcakey::Unregister(registration) == hotcakey::kSuccess);
+  });
+
+  hotcakey::test::Run("function keys keydown only", [&] {
+    Recorder recorder;
+    hotcakey::Filter filter;
+    filter.keys = {"F1", "F2", "F3", "F4", "F5", "F6",
+                   "F7", "F8", "F9", "F10", "F11", "F12"};
+    filter.types = {hotcakey::kKeyDown};
+    auto [result, registration] =
+        hotcakey::Subscribe(filter, recorder.Listener());
+    EXPECT(result == hotcakey::kSuccess);
+
+    Tap("F1");
+    Tap("KeyF");
+    Tap("F12");
+    Press("ShiftLeft");
+    Tap("F5");
+    Release("ShiftLeft");
+
+    Sync(marker, ++markers);
+
+    auto events = recorder.Events();
+    EXPECT(events.size() == 3);
+    EXPECT(events[0].code == "F1" && events[0].type == hotcakey::kKeyDown);
+    EXPECT(events[1].code == "F12");
+    EXPECT(events[2].code == "F5");
+
+    EXPECT(hotcakey::Unregister(registration) == hotcakey::kSuccess);
+  });
+
+  hotcakey::test::Run("exact modifiers", [&] {
+    Recorder recorder;
+    hotcakey::Filter filter;
+    filter.keys = {"KeyK"};
+    filter.modifiers = {"Control", "Shift"};
+    filter.exact = true;
+    filter.types = {hotcakey::kKeyDown};
+    auto [result, registration] =
+        hotcakey::Subscribe(filter, recorder.Listener());
+    EXPECT(result == hotcakey::kSuccess);
+
+    Press("ControlRight");
+    Press("ShiftLeft");
+    Tap("KeyK");
+    Press("AltLeft");
+    Tap("KeyK");
+    Release("AltLeft");
+    Release("ShiftLeft");
+    Tap("KeyK");
+    Release("ControlRight");
+
+    Sync(marker, ++markers);
+
+    EXPECT(recorder.Size() == 1);
+
+    EXPECT(hotcakey::Unregister(registration) == hotcakey::kSuccess);
+  });
+
+  hotcakey::test::Run("chords and streams coexist", [&] {
+    std::atomic<int> chords(0);
+    Recorder recorder;
+    hotcakey::Filter filter;
+    filter.keys = {"KeyP"};
+    auto [streamResult, stream] =
+        hotcakey::Subscribe(filter, recorder.Listener());
+    auto [chordResult, chord] =
+        hotcakey::Register({"Control", "KeyP"},
+                           [&](const hotcakey::Event&) { chords++; });
+    EXPECT(streamResult == hotcakey::kSuccess);
+    EXPECT(chordResult == hotcakey::kSuccess);
+
+    Press("ControlLeft");
+    Tap("KeyP");
+    Release("ControlLeft");
+    Tap("KeyP");
+
+    Sync(marker, ++markers);
+
+    EXPECT(chords == 2);
+    EXPECT(recorder.Size() == 4);
+
+    EXPECT(hotcakey::Unregister(stream) == hotcakey::kSuccess);
+    EXPECT(hotcakey::Unregister(chord) == hotcakey::kSuccess);
+  });
+
+  hotcakey::test::Run("unsubscribed stream receives nothing", [&] {
+    Recorder recorder;
+    hotcakey::Filter filter;
+    auto [result, registration] =
+        hotcakey::Subscribe(filter, recorder.Listener());
+    EXPECT(result == hotcakey::kSuccess);
+    EXPECT(hotcakey::Unregister(registration) == hotcakey::kSuccess);
+
+    Tap("KeyZ");
+    Sync(marker, ++markers);
+
+    EXPECT(recorder.Size() == 0);
+  });
+
+  hotcakey::test::Run("invalid filter is rejected", [&] {
+    Recorder recorder;
+    hotcakey::Filter filter;
+    filter.modifiers = {"KeyA"};
+    auto [result, registration] =
+        hotcakey::Subscribe(filter, recorder.Listener());
+    EXPECT(result == hotcakey::kFailure);
+  });
+
+  EXPECT(hotcakey::Inactivate() == hotcakey::kSuccess);
+
+  std::cout << "🎉 all filter tests passed" << std::endl;
+
+  return 0;
+}
@@ -0,0 +1,175 @@
+#include <fcntl.h>
+#include <linux/input.h>
+#include <poll.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <string>
+#include <vector>
+
+#include "../../src/hotcakey/daemon.h"
+#include "../../src/hotcakey/hotcakey.h"
+#include "../../src/hotcakey/synthetic.h"
+#include "./test.h"
+
+namespace {
+
+int passthrough[2] = {-1, -1};
+
+using hotcakey::test::Counter;
+using hotcakey::test::Press;
+
+// key events passed through so far, as "+code" for keydown and "-code"
+// for keyup
+std::vector<std::string> Passed() {
+  std::vector<std::string> passed;
+  input_event events[16];
+
+  pollfd readable{passthrough[0], POLLIN, 0};
+  while (poll(&readable, 1, 50) > 0) {
+    auto size = read(passthrough[0], events, sizeof(events));
+    if (size <= 0) break;
+
+    for (std::size_t i = 0; i < size / sizeof(input_event); i++) {
+      if (events[i].type != EV_KEY) continue;
+      passed.push_back((events[i].value ? "+" : "-") +
+                       std::to_string(events[i].code));
+    }
+  }
+
+  return passed;
+}
+
+std::string Down(unsigned int code) { return "+" + std::to_string(code); }
+std::string Up(unsigned int code) { return "-" + std::to_string(code); }
+
+int Activate() {
+  hotcakey::ActivationOption option;
+  option.grab = true;
+
+  EXPECT(hotcakey::Activate(option) == hotcakey::kSuccess);
+  EXPECT(hotcakey::GetActivationReport().grab);
+
+  auto [added, keyboard] =
+      hotcakey::synthetic::AddDevice({"", "Keyboard", 0, 0, ""});
+  EXPECT(added == hotcakey::kSuccess);
+
+  return keyboard;
+}
+
+}  // namespace
+
+int main() {
+  hotcakey::daemon::SetEnabled(false);
+
+  EXPECT(pipe2(passthrough, O_NONBLOCK | O_CLOEXEC) == 0);
+  EXPECT(hotcakey::synthetic::SetPassthrough(passthrough[1]) ==
+         hotcakey::kSuccess);
+
+  hotcakey::test::Run("consumed keys are not passed through", [] {
+    auto keyboard = Activate();
+
+    std::atomic<int> consumed(0);
+    std::atomic<int> passed(0);
+
+    auto [result, registration] =
+        hotcakey::Register({"F13"}, Counter(consumed));
+    EXPECT(result == hotcakey::kSuccess);
+    EXPECT(hotcakey::SetConsume(registration, true) == hotcakey::kSuccess);
+    EXPECT(hotcakey::Register({"F14"}, Counter(passed)).first ==
+           hotcakey::kSuccess);
+
+    Press(keyboard, "F13");
+    Press(keyboard, "F14");
+    Press(keyboard, "KeyA");
+    EXPECT(hotcakey::test::WaitFor([&] { return consumed == 2 && passed == 2; }));
+    EXPECT((Passed() == std::vector<std::string>{Down(KEY_F14), Up(KEY_F14),
+                                                 Down(KEY_A), Up(KEY_A)}));
+
+    EXPECT(hotcakey::Inactivate() == hotcakey::kSuccess);
+  });
+
+  hotcakey::test::Run("hotkeys consume from registration with the option",
+                      [] {
+    auto keyboard = Activate();
+
+    std::atomic<int> consumed(0);
+
+    hotcakey::HotkeyOption option;
+    option.device = hotcakey::DeviceFilter{"Keyboard", 0, 0, ""};
+    option.consume = true;
+    EXPECT(hotcakey::Register({"F15"}, option, Counter(consumed)).first ==
+           hotcakey::kSuccess);
+
+    Press(keyboard, "F15");
+    EXPECT(hotcakey::test::WaitFor([&] { return consumed == 2; }));
+    EXPECT(Passed().empty());
+
+    EXPECT(hotcakey::Inactivate() == hotcakey::kSuccess);
+  });
+
+  hotcakey::test::Run("modifiers held before a consumed key are passed",
+                      [] {
+    auto keyboard = Activate();
+
+    std::atomic<int> calls(0);
+    auto [result, registration] =
+        hotcakey::Register({"Control", "KeyK"}, Counter(calls));
+    EXPECT(hotcakey::SetConsume(registration, true) == hotcakey::kSuccess);
+
+    hotcakey::synthetic::Emit(keyboard, "ControlLeft", hotcakey::kKeyDown);
+    Press(keyboard, "KeyK");
+    hotcakey::synthetic::Emit(keyboard, "ControlLeft", hotcakey::kKeyUp);
+    // without control it is just a key
+    Press(keyboard, "KeyK");
+
+    EXPECT(hotcakey::test::WaitFor([&] { return calls == 2; }));
+    EXPECT((Passed() ==
+            std::vector<std::string>{Down(KEY_LEFTCTRL), Up(KEY_LEFTCTRL),
+                                     Down(KEY_K), Up(KEY_K)}));
+
+    EXPECT(hotcakey::Inactivate() == hotcakey::kSuccess);
+  });
+
+  hotcakey::test::Run("remapped keys are matched and passed as remapped",
+                      [] {
+    auto keyboard = Activate();
+
+    std::atomic<int> escapes(0);
+    EXPECT(hotcakey::Register({"Escape"}, Counter(escapes)).first ==
+           hotcakey::kSuccess);
+    EXPECT(hotcakey::Remap("CapsLock", "Escape") == hotcakey::kSuccess);
+
+    Press(keyboard, "CapsLock");
+    EXPECT(hotcakey::test::WaitFor([&] { return escapes == 2; }));
+    EXPECT((Passed() == std::vector<std::string>{Down(KEY_ESC), Up(KEY_ESC)}));
+
+    EXPECT(hotcakey::Remap("CapsLock", "") == hotcakey::kSuccess);
+    Press(keyboard, "CapsLock");
+    EXPECT((Passed() ==
+            std::vector<std::string>{Down(KEY_CAPSLOCK), Up(KEY_CAPSLOCK)}));
+
+    EXPECT(hotcakey::Inactivate() == hotcakey::kSuccess);
+  });
+
+  hotcakey::test::Run("keys without a device are never passed", [] {
+    Activate();
+
+    std::atomic<int> calls(0);
+    EXPECT(hotcakey::Register({"F15"}, Counter(calls)).first ==
+           hotcakey::kSuccess);
+
+    hotcakey::synthetic::Emit("F15", hotcakey::kKeyDown);
+    hotcakey::synthetic::Emit("F15", hotcakey::kKeyUp);
+    EXPECT(hotcakey::test::WaitFor([&] { return calls == 2; }));
+    EXPECT(Passed().empty());
+
+    EXPECT(hotcakey::Inactivate() == hotcakey::kSuccess);
+  });
+
+  EXPECT(hotcakey::synthetic::SetPassthrough(-1) == hotcakey::kSuccess);
+
+  std::cout << "🎉 all grab tests passed" << std::endl;
+
+  return 0;
+}
@@ -0,0 +1,179 @@
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "../../src/hotcakey/daemon.h"
+#include "../../src/hotcakey/hotcakey.h"
+#include "./test.h"
+#include "./uinput.h"
+
+namespace {
+
+constexpr std::int64_t kMillisecond = 1000000;
+
+// keys streamed so far, as "+KeyA" for keydown and "-KeyA" for keyup
+class Streamed {
+ public:
+  hotcakey::Callback Listener() {
+    return [this](const hotcakey::Event& event) {
+      std::lock_guard<std::mutex> lock(mutex);
+      keys.push_back((event.type == hotcakey::kKeyDown ? "+" : "-") +
+                     std::string(event.code));
+    };
+  }
+
+  std::size_t Size() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return keys.size();
+  }
+
+  std::vector<std::string> Keys() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return keys;
+  }
+
+ private:
+  std::mutex mutex;
+  std::vector<std::string> keys;
+};
+
+std::vector<hotcakey::InjectedEvent> Typing(const std::string& key,
+                                            std::size_t times,
+                                            std::int64_t interval) {
+  std::vector<hotcakey::InjectedEvent> events;
+
+  for (std::size_t i = 0; i < times; i++) {
+    auto at = static_cast<std::int64_t>(i) * interval;
+    events.push_back({key, hotcakey::kKeyDown, at});
+    events.push_back({key, hotcakey::kKeyUp, at});
+  }
+
+  return events;
+}
+
+}  // namespace
+
+int main() {
+  hotcakey::daemon::SetEnabled(false);
+
+  hotcakey::InjectOption synthetic;
+  synthetic.target = hotcakey::kInjectSynthetic;
+
+  hotcakey::test::Run("injected events keep their timing", [&] {
+    EXPECT(hotcakey::Activate() == hotcakey::kSuccess);
+
+    Streamed streamed;
+    EXPECT(hotcakey::Subscribe({}, streamed.Listener()).first ==
+           hotcakey::kSuccess);
+
+    std::vector<hotcakey::InjectedEvent> events = {
+        {"ShiftLeft", hotcakey::kKeyDown, 0},
+        {"KeyA", hotcakey::kKeyDown, 0},
+        {"KeyA", hotcakey::kKeyUp, 20 * kMillisecond},
+        {"ShiftLeft", hotcakey::kKeyUp, 40 * kMillisecond},
+    };
+
+    hotcakey::InjectReport report;
+    EXPECT(hotcakey::Inject(events, synthetic, report) == hotcakey::kSuccess);
+    EXPECT(report.events == 4);
+    // the first two are due at once
+    EXPECT(report.writes == 3);
+    EXPECT(report.elapsed >= 40 * kMillisecond);
+    EXPECT(report.elapsed < 90 * kMillisecond);
+    EXPECT(report.lateness < 50 * kMillisecond);
+
+    EXPECT(hotcakey::test::WaitFor([&] { return streamed.Size() == 4; }));
+    EXPECT((streamed.Keys() ==
+            std::vector<std::string>{"+ShiftLeft", "+KeyA", "-KeyA",
+                                     "-ShiftLeft"}));
+
+    EXPECT(hotcakey::Inactivate() == hotcakey::kSuccess);
+  });
+
+  hotcakey::test::Run("thousands of events are batched", [&] {
+    EXPECT(hotcakey::Activate() == hotcakey::kSuccess);
+
+    std::atomic<int> calls(0);
+    EXPECT(hotcakey::Register({"F13"}, [&](const hotcakey::Event&) {
+             calls++;
+           }).first == hotcakey::kSuccess);
+
+    auto option = synthetic;
+    option.pace = hotcakey::kReplayFastest;
+
+    hotcakey::InjectReport report;
+    EXPECT(hotcakey::Inject(Typing("F13", 5000, kMillisecond), option,
+                            report) == hotcakey::kSuccess);
+    EXPECT(report.events == 10000);
+    EXPECT(report.writes <= 10000 / 64 + 1);
+    EXPECT(hotcakey::test::WaitFor([&] { return calls == 10000; }));
+
+    // paced at 5000 events per second
+    EXPECT(hotcakey::Inject(Typing("F13", 500, 200000), synthetic, report) ==
+           hotcakey::kSuccess);
+    EXPECT(report.events == 1000);
+    EXPECT(report.elapsed >= 499 * 200000);
+    EXPECT(hotcakey::test::WaitFor([&] { return calls == 11000; }));
+
+    EXPECT(hotcakey::Inactivate() == hotcakey::kSuccess);
+  });
+
+  hotcakey::test::Run("broken sequences are rejected", [&] {
+    EXPECT(hotcakey::Activate() == hotcakey::kSuccess);
+
+    hotcakey::InjectReport report;
+    EXPECT(hotcakey::Inject({{"NoSuchKey", hotcakey::kKeyDown, 0}}, synthetic,
+                            report) == hotcakey::kFailure);
+    EXPECT(hotcakey::Inject({{"KeyA", hotcakey::kKeyDown, kMillisecond},
+                             {"KeyA", hotcakey::kKeyUp, 0}},
+                            synthetic, report) == hotcakey::kFailure);
+    EXPECT(report.events == 0);
+
+    EXPECT(hotcakey::Inactivate() == hotcakey::kSuccess);
+
+    // the synthetic device is gone
+    EXPECT(hotcakey::Inject(Typing("KeyA", 1, 0), synthetic, report) ==
+           hotcakey::kFailure);
+  });
+
+  hotcakey::test::Run("injected keys come through uinput", [] {
+    if (!hotcakey::test::VirtualKeyboard::IsAvailable()) {
+      std::cout << "⏭️  skipped since /dev/uinput is not writable"
+                << std::endl;
+      return;
+    }
+
+    EXPECT(hotcakey::Activate() == hotcakey::kSuccess);
+
+    std::atomic<int> calls(0);
+    hotcakey::DeviceFilter injector;
+    injector.name = "hotcakey injector";
+    EXPECT(hotcakey::RegisterOnDevice(injector, {"F14"},
+                                      [&](const hotcakey::Event&) {
+                                        calls++;
+                                      }).first == hotcakey::kSuccess);
+
+    // the first injection makes the keyboard
+    hotcakey::InjectReport report;
+    EXPECT(hotcakey::Inject({}, {}, report) == hotcakey::kSuccess);
+    EXPECT(hotcakey::test::WaitFor(
+        [] {
+          for (auto& device : hotcakey::Devices()) {
+            if (device.name == "hotcakey injector") return true;
+          }
+          return false;
+        },
+        std::chrono::milliseconds(5000)));
+
+    EXPECT(hotcakey::Inject(Typing("F14", 100, kMillisecond), {}, report) ==
+           hotcakey::kSuccess);
+    EXPECT(hotcakey::test::WaitFor([&] { return calls == 200; }));
+
+    EXPECT(hotcakey::Inactivate() == hotcakey::kSuccess);
+  });
+
+  std::cout << "🎉 all inject tests passed" << std::endl;
+
+  return 0;
+}
@@ -0,0 +1,272 @@
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../../src/hotcakey/daemon.h"
+#include "../../src/hotcakey/hotcakey.h"
+#include "../../src/hotcakey/keymap.h"
+#include "../../src/hotcakey/synthetic.h"
+#include "../../src/hotcakeyc/compiler.h"
+#include "./test.h"
+
+namespace {
+
+std::string TemporaryPath() {
+  return "/tmp/hotcakey-keymap-" + std::to_string(getpid()) + ".hkkm";
+}
+
+const char* const kKeymap = R"({
+  "name": "example",
+  "bindings": [
+    {"keys": ["Control", "KeyA"], "action": "select"},
+    {"keys": ["KeyJ"], "layer": "vim", "action": "down",
+     "comment": {"ignored": [1, true]}},
+    {"keys": ["Shift", "Control", "KeyB"], "action": "bold"}
+  ]
+})";
+
+// listeners of a watched keymap, counted per action
+struct Actions {
+  std::map<std::string, std::atomic<int>> made;
+  std::map<std::string, std::atomic<int>> fired;
+
+  Actions() {
+    for (auto action : {"save", "open", "quit"}) {
+      made[action];
+      fired[action];
+    }
+  }
+
+  hotcakey::ActionListener ToListener() {
+    return [this](const std::string& action) -> hotcakey::Callback {
+      made.at(action)++;
+      return [this, action](const hotcakey::Event& event) {
+        if (event.type == hotcakey::kKeyDown) fired.at(action)++;
+      };
+    };
+  }
+};
+
+void Press(const char* modifier, const char* key) {
+  hotcakey::synthetic::Emit(modifier, hotcakey::kKeyDown);
+  hotcakey::synthetic::Emit(key, hotcakey::kKeyDown);
+  hotcakey::synthetic::Emit(key, hotcakey::kKeyUp);
+  hotcakey::synthetic::Emit(modifier, hotcakey::kKeyUp);
+}
+
+bool CompileTo(const std::string& path, const char* json) {
+  hotcakeyc::Keymap keymap;
+  std::string error;
+
+  if (!hotcakeyc::Compile(json, keymap, error)) return false;
+
+  return hotcakey::keymap::Write(path, keymap.bindings, keymap.layers,
+                                 keymap.actions);
+}
+
+}  // namespace
+
+int main() {
+  hotcakey::daemon::SetEnabled(false);
+
+  auto path = TemporaryPath();
+
+  hotcakey::test::Run("json is compiled to chords and layers", [] {
+    hotcakeyc::Keymap keymap;
+    std::string error;
+
+    EXPECT(hotcakeyc::Compile(kKeymap, keymap, error));
+    EXPECT(error.empty());
+    EXPECT(keymap.bindings.size() == 3);
+    EXPECT(keymap.layers.size() == 2);
+    EXPECT(keymap.layers[1] == "vim");
+
+    hotcakey::Chord chord;
+    EXPECT(hotcakey::keymap::ToChord({"Control", "Shift", "KeyB"}, chord));
+    EXPECT(keymap.bindings[2].key == chord.key);
+    EXPECT(keymap.bindings[2].modifiers == chord.modifiers);
+    EXPECT(keymap.bindings[1].layer == 1);
+    EXPECT(keymap.bindings[0].layer == 0);
+  });
+
+  hotcakey::test::Run("broken json is rejected with a reason", [] {
+    hotcakeyc::Keymap keymap;
+    std::string error;
+
+    EXPECT(!hotcakeyc::Compile(R"({"bindings": [{"keys": ["KeyA"]},]})",
+                               keymap, error));
+    EXPECT(!error.empty());
+    EXPECT(!hotcakeyc::Compile(R"({"bindings": [{"keys": ["Nope"]}]})",
+                               keymap, error));
+    EXPECT(error.find("binding 0") != std::string::npos);
+    EXPECT(!hotcakeyc::Compile(R"({"bindings": []} x)", keymap, error));
+
+    EXPECT(!hotcakeyc::Compile(R"({"bindings": [{"keys": ["KeyA"]}]})",
+                               keymap, error));
+    EXPECT(error.find("binding 0 has no action") != std::string::npos);
+    EXPECT(!hotcakeyc::Compile(
+        R"({"bindings": [{"keys": ["KeyA"], "action": ""}]})", keymap,
+        error));
+    EXPECT(error.find("binding 0 has no action") != std::string::npos);
+
+    // nesting too deep for the stack is refused before it gets there
+    auto deep = std::string(R"({"x": )") + std::string(100000, '[') +
+                std::string(100000, ']') + R"(, "bindings": []})";
+    EXPECT(!hotcakeyc::Compile(deep, keymap, error));
+    EXPECT(error.find("too deeply nested") != std::string::npos);
+
+    auto shallow = std::string(R"({"x": )") + std::string(32, '[') +
+                   std::string(32, ']') + R"(, "bindings": []})";
+    EXPECT(hotcakeyc::Compile(shallow, keymap, error));
+  });
+
+  hotcakey::test::Run("a keymap registers every binding at once", [&] {
+    EXPECT(CompileTo(path, kKeymap));
+    EXPECT(hotcakey::Activate() == hotcakey::kSuccess);
+
+    std::atomic<int> fired[3] = {};
+
+    std::vector<hotcakey::Registration> registrations;
+    EXPECT(hotcakey::RegisterKeymap(
+               path,
+               [&](std::size_t index) -> hotcakey::Callback {
+                 return [&fired, index](const hotcakey::Event& event) {
+                   if (event.type == hotcakey::kKeyDown) fired[index]++;
+                 };
+               },
+               registrations) == hotcakey::kSuccess);
+    EXPECT(registrations.size() == 3);
+
+    hotcakey::synthetic::Emit("ControlLeft", hotcakey::kKeyDown);
+    hotcakey::synthetic::Emit("KeyA", hotcakey::kKeyDown);
+    hotcakey::synthetic::Emit("KeyA", hotcakey::kKeyUp);
+    hotcakey::synthetic::Emit("ControlLeft", hotcakey::kKeyUp);
+    EXPECT(hotcakey::test::WaitFor([&] { return fired[0] == 1; }));
+
+    // the binding of a layer waits for its layer
+    hotcakey::synthetic::Emit("KeyJ", hotcakey::kKeyDown);
+    hotcakey::synthetic::Emit("KeyJ", hotcakey::kKeyUp);
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    EXPECT(fired[1] == 0);
+
+    EXPECT(hotcakey::SwitchLayer("vim") == hotcakey::kSuccess);
+    hotcakey::synthetic::Emit("KeyJ", hotcakey::kKeyDown);
+    hotcakey::synthetic::Emit("KeyJ", hotcakey::kKeyUp);
+    EXPECT(hotcakey::test::WaitFor([&] { return fired[1] == 1; }));
+
+    EXPECT(fired[2] == 0);
+
+    for (auto registration : registrations) {
+      EXPECT(hotcakey::Unregister(registration) == hotcakey::kSuccess);
+    }
+
+    hotcakey::Inactivate();
+  });
+
+  hotcakey::test::Run("a broken keymap registers nothing", [&] {
+    EXPECT(CompileTo(path, kKeymap));
+
+    // cut in the middle of the bindings
+    EXPECT(truncate(path.c_str(), 40) == 0);
+
+    EXPECT(hotcakey::Activate() == hotcakey::kSuccess);
+
+    std::vector<hotcakey::Registration> registrations;
+    EXPECT(hotcakey::RegisterKeymap(
+               path,
+               [](std::size_t) -> hotcakey::Callback {
+                 return [](const hotcakey::Event&) {};
+               },
+               registrations) == hotcakey::kFailure);
+    EXPECT(registrations.empty());
+
+    EXPECT(hotcakey::RegisterKeymap(
+               "/nonexistent/keymap.hkkm",
+               [](std::size_t) -> hotcakey::Callback { return nullptr; },
+               registrations) == hotcakey::kFailure);
+
+    hotcakey::Inactivate();
+  });
+
+  hotcakey::test::Run("a watched keymap applies only the difference", [&] {
+    EXPECT(CompileTo(path, R"({"bindings": [
+      {"keys": ["Control", "KeyS"], "action": "save"},
+      {"keys": ["Control", "KeyO"], "action": "open"}
+    ]})"));
+    EXPECT(hotcakey::Activate() == hotcakey::kSuccess);
+
+    Actions actions;
+    auto [result, watch] = hotcakey::WatchKeymap(path, actions.ToListener());
+    EXPECT(result == hotcakey::kSuccess);
+    EXPECT(actions.made.at("save") == 1);
+    EXPECT(actions.made.at("open") == 1);
+
+    // open moves to another chord, and quit is added
+    EXPECT(CompileTo(path, R"({"bindings": [
+      {"keys": ["Control", "KeyS"], "action": "save"},
+      {"keys": ["Control", "KeyP"], "action": "open"},
+      {"keys": ["Control", "KeyQ"], "action": "quit"}
+    ]})"));
+    EXPECT(hotcakey::test::WaitFor([&] { return actions.made.at("quit") == 1; }));
+    EXPECT(actions.made.at("save") == 1);
+    EXPECT(actions.made.at("open") == 2);
+
+    Press("ControlLeft", "KeyO");
+    Press("ControlLeft", "KeyS");
+    Press("ControlLeft", "KeyP");
+    EXPECT(hotcakey::test::WaitFor([&] {
+      return actions.fired.at("save") == 1 && actions.fired.at("open") == 1;
+    }));
+
+    // a broken file keeps the last good keymap
+    {
+      auto temporary = path + ".tmp";
+      auto fd = open(temporary.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+      EXPECT(write(fd, "broken", 6) == 6);
+      close(fd);
+      EXPECT(rename(temporary.c_str(), path.c_str()) == 0);
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+
+    Press("ControlLeft", "KeyQ");
+    EXPECT(hotcakey::test::WaitFor([&] { return actions.fired.at("quit") == 1; }));
+
+    // no binding is left once unregistered
+    EXPECT(hotcakey::Unregister(watch) == hotcakey::kSuccess);
+    Press("ControlLeft", "KeyS");
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    EXPECT(actions.fired.at("save") == 1);
+
+    hotcakey::Inactivate();
+  });
+
+  hotcakey::test::Run("a watch ends with inactivation", [&] {
+    EXPECT(CompileTo(path, R"({"bindings": [
+      {"keys": ["Control", "KeyS"], "action": "save"}
+    ]})"));
+    EXPECT(hotcakey::Activate() == hotcakey::kSuccess);
+
+    Actions actions;
+    EXPECT(hotcakey::WatchKeymap(path, actions.ToListener()).first ==
+           hotcakey::kSuccess);
+    EXPECT(hotcakey::Inactivate() == hotcakey::kSuccess);
+
+    // nothing is applied after the watch ended
+    EXPECT(CompileTo(path, R"({"bindings": [
+      {"keys": ["Control", "KeyQ"], "action": "quit"}
+    ]})"));
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    EXPECT(actions.made.at("quit") == 0);
+  });
+
+  unlink(path.c_str());
+
+  std::cout << "🎉 all keymap tests passed" << std::endl;
+
+  return 0;
+}
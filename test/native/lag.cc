@@ -0,0 +1,70 @@
+#include "../../src/hotcakey/lag.h"
+
+#include "./test.h"
+
+int main() {
+  hotcakey::test::Run("a stall is reported once until the lag recovers", [] {
+    hotcakey::Lag lag;
+    lag.threshold = 100;
+
+    bool stalled;
+    EXPECT(lag.Admit(50, stalled) && !stalled);
+    EXPECT(lag.Admit(100, stalled) && stalled);
+    EXPECT(lag.Admit(300, stalled) && !stalled);
+    EXPECT(lag.Admit(150, stalled) && !stalled);
+    EXPECT(lag.stalls == 1);
+    EXPECT(lag.isStalled);
+
+    EXPECT(lag.Admit(10, stalled) && !stalled);
+    EXPECT(!lag.isStalled);
+    EXPECT(lag.Admit(120, stalled) && stalled);
+    EXPECT(lag.stalls == 2);
+
+    EXPECT(lag.last == 120);
+    EXPECT(lag.max == 300);
+    EXPECT(lag.dropped == 0);
+  });
+
+  hotcakey::test::Run("events older than the max age are dropped", [] {
+    hotcakey::Lag lag;
+    lag.maxAge = 200;
+
+    bool stalled;
+    EXPECT(lag.Admit(200, stalled));
+    EXPECT(!lag.Admit(201, stalled));
+    EXPECT(!lag.Admit(1000, stalled));
+    EXPECT(lag.Admit(0, stalled));
+    EXPECT(lag.dropped == 2);
+
+    // without a threshold nothing is a stall
+    EXPECT(lag.stalls == 0 && !stalled);
+  });
+
+  hotcakey::test::Run("a dropped event can start a stall", [] {
+    hotcakey::Lag lag;
+    lag.threshold = 100;
+    lag.maxAge = 200;
+
+    bool stalled;
+    EXPECT(!lag.Admit(500, stalled) && stalled);
+    EXPECT(lag.stalls == 1 && lag.dropped == 1);
+  });
+
+  hotcakey::test::Run("defaults keep every event without stalls", [] {
+    hotcakey::Lag lag;
+    lag.threshold = 100;
+    lag.maxAge = 200;
+
+    bool stalled;
+    lag.Admit(500, stalled);
+
+    // as `activate` does for every activation
+    lag = hotcakey::Lag();
+    EXPECT(lag.Admit(1e6, stalled) && !stalled);
+    EXPECT(lag.stalls == 0 && lag.dropped == 0);
+  });
+
+  std::cout << "🎉 all lag tests passed" << std::endl;
+
+  return 0;
+}
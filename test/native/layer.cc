@@ -0,0 +1,138 @@
+#include <atomic>
+#include <string>
+
+#include "../../src/hotcakey/daemon.h"
+#include "../../src/hotcakey/hotcakey.h"
+#include "../../src/hotcakey/synthetic.h"
+#include "./test.h"
+
+namespace {
+
+using hotcakey::test::Counter;
+using hotcakey::test::Press;
+
+}  // namespace
+
+int main() {
+  hotcakey::daemon::SetEnabled(false);
+
+  hotcakey::test::Run("only the active layer is matched", [] {
+    EXPECT(hotcakey::Activate() == hotcakey::kSuccess);
+
+    std::atomic<int> normal(0);
+    std::atomic<int> insert(0);
+    std::atomic<int> base(0);
+
+    EXPECT(hotcakey::RegisterInLayer("normal", {"KeyJ"}, Counter(normal))
+               .first == hotcakey::kSuccess);
+    EXPECT(hotcakey::RegisterInLayer("insert", {"KeyJ"}, Counter(insert))
+               .first == hotcakey::kSuccess);
+    EXPECT(hotcakey::Register({"Escape"}, Counter(base)).first ==
+           hotcakey::kSuccess);
+
+    // only the base layer is active at first
+    EXPECT(hotcakey::ActiveLayer() == "");
+    Press("KeyJ");
+    Press("Escape");
+    EXPECT(hotcakey::test::WaitFor([&] { return base == 2; }));
+    EXPECT(normal == 0 && insert == 0);
+
+    EXPECT(hotcakey::SwitchLayer("normal") == hotcakey::kSuccess);
+    EXPECT(hotcakey::ActiveLayer() == "normal");
+    Press("KeyJ");
+    Press("Escape");
+    EXPECT(hotcakey::test::WaitFor([&] { return base == 4; }));
+    EXPECT(normal == 2 && insert == 0);
+
+    EXPECT(hotcakey::SwitchLayer("insert") == hotcakey::kSuccess);
+    Press("KeyJ");
+    EXPECT(hotcakey::test::WaitFor([&] { return insert == 2; }));
+    EXPECT(normal == 2);
+
+    EXPECT(hotcakey::Inactivate() == hotcakey::kSuccess);
+    EXPECT(hotcakey::ActiveLayer() == "");
+  });
+
+  hotcakey::test::Run("the active layer shadows the base layer", [] {
+    EXPECT(hotcakey::Activate() == hotcakey::kSuccess);
+
+    std::atomic<int> base(0);
+    std::atomic<int> layered(0);
+
+    EXPECT(hotcakey::Register({"KeyK"}, Counter(base)).first ==
+           hotcakey::kSuccess);
+    EXPECT(hotcakey::RegisterInLayer("normal", {"KeyK"}, Counter(layered))
+               .first == hotcakey::kSuccess);
+
+    EXPECT(hotcakey::SwitchLayer("normal") == hotcakey::kSuccess);
+    Press("KeyK");
+    EXPECT(hotcakey::test::WaitFor([&] { return layered == 2; }));
+    EXPECT(base == 0);
+
+    // a layer without hotkeys shadows nothing
+    EXPECT(hotcakey::SwitchLayer("empty") == hotcakey::kSuccess);
+    Press("KeyK");
+    EXPECT(hotcakey::test::WaitFor([&] { return base == 2; }));
+
+    EXPECT(hotcakey::Inactivate() == hotcakey::kSuccess);
+  });
+
+  hotcakey::test::Run("listeners switch layers and keyup follows keydown",
+                      [] {
+    EXPECT(hotcakey::Activate() == hotcakey::kSuccess);
+
+    std::atomic<int> downs(0);
+    std::atomic<int> ups(0);
+    std::atomic<int> inserted(0);
+
+    // "i" enters insert mode on keydown, like vim
+    auto [result, registration] = hotcakey::RegisterInLayer(
+        "normal", {"KeyI"}, [&](const hotcakey::Event& event) {
+          if (event.type == hotcakey::kKeyDown) {
+            downs++;
+            EXPECT(hotcakey::SwitchLayer("insert") == hotcakey::kSuccess);
+          } else {
+            ups++;
+          }
+        });
+    EXPECT(result == hotcakey::kSuccess);
+    EXPECT(hotcakey::RegisterInLayer("insert", {"KeyI"}, Counter(inserted))
+               .first == hotcakey::kSuccess);
+
+    EXPECT(hotcakey::SwitchLayer("normal") == hotcakey::kSuccess);
+    Press("KeyI");
+    EXPECT(hotcakey::test::WaitFor([&] { return ups == 1; }));
+    EXPECT(downs == 1 && inserted == 0);
+    EXPECT(hotcakey::ActiveLayer() == "insert");
+
+    Press("KeyI");
+    EXPECT(hotcakey::test::WaitFor([&] { return inserted == 2; }));
+    EXPECT(downs == 1);
+
+    EXPECT(hotcakey::Inactivate() == hotcakey::kSuccess);
+  });
+
+  hotcakey::test::Run("layered hotkeys survive snapshots", [] {
+    EXPECT(hotcakey::Activate() == hotcakey::kSuccess);
+
+    std::atomic<int> calls(0);
+
+    auto [result, registration] =
+        hotcakey::RegisterInLayer("normal", {"KeyL"}, Counter(calls));
+    EXPECT(result == hotcakey::kSuccess);
+    EXPECT(hotcakey::SwitchLayer("normal") == hotcakey::kSuccess);
+
+    auto snapshot = hotcakey::TakeSnapshot();
+    EXPECT(hotcakey::Restore(snapshot.second) == hotcakey::kSuccess);
+
+    Press("KeyL");
+    EXPECT(hotcakey::test::WaitFor([&] { return calls == 2; }));
+
+    EXPECT(hotcakey::Unregister(registration) == hotcakey::kSuccess);
+    EXPECT(hotcakey::Inactivate() == hotcakey::kSuccess);
+  });
+
+  std::cout << "🎉 all layer tests passed" << std::endl;
+
+  return 0;
+}
@@ -0,0 +1,96 @@
+#include <atomic>
+#include <thread>
+
+#include "../../src/hotcakey/queue.h"
+#include "./test.h"
+
+namespace {
+
+hotcakey::Event At(std::time_t time) {
+  return hotcakey::Event(hotcakey::kKeyDown, time);
+}
+
+}  // namespace
+
+int main() {
+  hotcakey::test::Run("the consumer is woken once per drain", [] {
+    hotcakey::EventQueue queue(8, hotcakey::kDropOldest);
+    hotcakey::Event event = At(0);
+
+    EXPECT(queue.Push(At(1)));
+    EXPECT(!queue.Push(At(2)));
+
+    EXPECT(queue.Pop(event) && event.time == 1);
+    EXPECT(queue.Pop(event) && event.time == 2);
+
+    // still woken until the consumer sees the queue empty
+    EXPECT(!queue.Push(At(3)));
+    EXPECT(queue.Pop(event) && event.time == 3);
+    EXPECT(!queue.Pop(event));
+
+    EXPECT(queue.Push(At(4)));
+  });
+
+  hotcakey::test::Run("drop oldest keeps the latest events", [] {
+    hotcakey::EventQueue queue(4, hotcakey::kDropOldest);
+    hotcakey::Event event = At(0);
+
+    for (int i = 1; i <= 10; i++) queue.Push(At(i));
+
+    EXPECT(queue.Dropped() == 6);
+    for (int i = 7; i <= 10; i++) EXPECT(queue.Pop(event) && event.time == i);
+    EXPECT(!queue.Pop(event));
+  });
+
+  hotcakey::test::Run("drop newest keeps the earliest events", [] {
+    hotcakey::EventQueue queue(4, hotcakey::kDropNewest);
+    hotcakey::Event event = At(0);
+
+    for (int i = 1; i <= 10; i++) queue.Push(At(i));
+
+    EXPECT(queue.Dropped() == 6);
+    for (int i = 1; i <= 4; i++) EXPECT(queue.Pop(event) && event.time == i);
+    EXPECT(!queue.Pop(event));
+  });
+
+  hotcakey::test::Run("a slow consumer loses no wake up", [] {
+    constexpr int kEvents = 100000;
+
+    hotcakey::EventQueue queue(64, hotcakey::kDropNewest);
+    std::atomic<int> wakes(0);
+
+    std::thread producer([&] {
+      for (int i = 1; i <= kEvents; i++) {
+        if (queue.Push(At(i))) wakes++;
+      }
+    });
+
+    // consumes only after being woken, like the node.js main thread
+    int consumed = 0;
+    int handled = 0;
+    std::time_t last = 0;
+    hotcakey::Event event = At(0);
+
+    auto drain = [&] {
+      while (queue.Pop(event)) {
+        EXPECT(event.time > last);
+        last = event.time;
+        consumed++;
+      }
+    };
+
+    while (consumed + static_cast<int>(queue.Dropped()) < kEvents) {
+      EXPECT(hotcakey::test::WaitFor([&] { return wakes > handled; }));
+      handled++;
+      drain();
+    }
+
+    producer.join();
+
+    EXPECT(consumed + static_cast<int>(queue.Dropped()) == kEvents);
+  });
+
+  std::cout << "🎉 all queue tests passed" << std::endl;
+
+  return 0;
+}
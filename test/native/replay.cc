@@ -0,0 +1,145 @@
+#include <unistd.h>
+
+#include <atomic>
+#include <string>
+#include <thread>
+
+#include "../../src/hotcakey/daemon.h"
+#include "../../src/hotcakey/hotcakey.h"
+#include "../../src/hotcakey/recording.h"
+#include "../../src/hotcakey/synthetic.h"
+#include "./test.h"
+
+namespace {
+
+std::string TemporaryPath() {
+  return "/tmp/hotcakey-replay-" + std::to_string(getpid()) + ".rec";
+}
+
+}  // namespace
+
+int main() {
+  hotcakey::daemon::SetEnabled(false);
+
+  auto path = TemporaryPath();
+  std::atomic<int> recorded(0);
+
+  hotcakey::test::Run("key events are recorded with their matches", [&] {
+    EXPECT(hotcakey::Activate() == hotcakey::kSuccess);
+
+    auto [result, registration] = hotcakey::Register(
+        {"Shift", "KeyA"}, [&](const hotcakey::Event&) { recorded++; });
+    EXPECT(result == hotcakey::kSuccess);
+
+    EXPECT(hotcakey::StartRecording(path) == hotcakey::kSuccess);
+
+    for (int i = 0; i < 3; i++) {
+      hotcakey::synthetic::Emit("Shift", hotcakey::kKeyDown);
+      hotcakey::synthetic::Emit("KeyA", hotcakey::kKeyDown);
+      hotcakey::synthetic::Emit("KeyA", hotcakey::kKeyUp);
+      hotcakey::synthetic::Emit("Shift", hotcakey::kKeyUp);
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+
+    EXPECT(hotcakey::test::WaitFor([&] { return recorded == 6; }));
+    EXPECT(hotcakey::StopRecording() == hotcakey::kSuccess);
+
+    hotcakey::Inactivate();
+
+    auto reader = hotcakey::recording::Reader::Open(path);
+    EXPECT(reader != nullptr);
+    EXPECT(reader->Size() == 12);
+
+    std::uint32_t matches = 0;
+    for (std::size_t i = 0; i < reader->Size(); i++) {
+      matches += (*reader)[i].matches;
+      if (i > 0) EXPECT((*reader)[i].timestamp >= (*reader)[i - 1].timestamp);
+    }
+    EXPECT(matches == 6);
+  });
+
+  hotcakey::test::Run("replay dispatches the same matches", [&] {
+    EXPECT(hotcakey::Activate() == hotcakey::kSuccess);
+
+    std::atomic<int> replayed(0);
+    auto [result, registration] = hotcakey::Register(
+        {"Shift", "KeyA"}, [&](const hotcakey::Event&) { replayed++; });
+    EXPECT(result == hotcakey::kSuccess);
+
+    hotcakey::ReplayReport report;
+    EXPECT(hotcakey::Replay(path, hotcakey::kReplayFastest, report) ==
+           hotcakey::kSuccess);
+    EXPECT(report.events == 12);
+    EXPECT(report.matches == 6);
+    EXPECT(hotcakey::test::WaitFor([&] { return replayed == 6; }));
+
+    hotcakey::Inactivate();
+  });
+
+  hotcakey::test::Run("only listeners called back are recorded", [&] {
+    auto other = path + ".other";
+
+    EXPECT(hotcakey::Activate() == hotcakey::kSuccess);
+
+    // a chord matched for a keyboard the key did not come from
+    std::atomic<int> fired(0);
+    EXPECT(hotcakey::RegisterOnDevice(
+               {"Macro Pad", 0, 0, ""}, {"KeyB"},
+               [&](const hotcakey::Event&) { fired++; })
+               .first == hotcakey::kSuccess);
+
+    EXPECT(hotcakey::StartRecording(other) == hotcakey::kSuccess);
+    hotcakey::synthetic::Emit("KeyB", hotcakey::kKeyDown);
+    hotcakey::synthetic::Emit("KeyB", hotcakey::kKeyUp);
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    EXPECT(hotcakey::StopRecording() == hotcakey::kSuccess);
+
+    hotcakey::Inactivate();
+
+    auto reader = hotcakey::recording::Reader::Open(other);
+    EXPECT(reader != nullptr);
+    EXPECT(reader->Size() == 2);
+    EXPECT((*reader)[0].matches == 0 && (*reader)[1].matches == 0);
+    EXPECT(fired == 0);
+
+    unlink(other.c_str());
+  });
+
+  hotcakey::test::Run("replay keeps the original pace", [&] {
+    EXPECT(hotcakey::Activate() == hotcakey::kSuccess);
+
+    auto reader = hotcakey::recording::Reader::Open(path);
+    EXPECT(reader != nullptr);
+    auto span =
+        (*reader)[reader->Size() - 1].timestamp - (*reader)[0].timestamp;
+
+    hotcakey::ReplayReport report;
+    EXPECT(hotcakey::Replay(path, hotcakey::kReplayOriginal, report) ==
+           hotcakey::kSuccess);
+    EXPECT(report.elapsed >= span);
+    EXPECT(report.elapsed < span + 50000000);
+
+    hotcakey::Inactivate();
+  });
+
+  hotcakey::test::Run("broken recordings are rejected", [&] {
+    EXPECT(hotcakey::Activate() == hotcakey::kSuccess);
+
+    hotcakey::ReplayReport report;
+    EXPECT(hotcakey::Replay("/dev/null", hotcakey::kReplayFastest, report) ==
+           hotcakey::kFailure);
+    EXPECT(hotcakey::Replay(path + ".missing", hotcakey::kReplayFastest,
+                            report) == hotcakey::kFailure);
+
+    hotcakey::Inactivate();
+
+    EXPECT(hotcakey::Replay(path, hotcakey::kReplayFastest, report) ==
+           hotcakey::kFailure);
+  });
+
+  unlink(path.c_str());
+
+  std::cout << "🎉 all replay tests passed" << std::endl;
+
+  return 0;
+}
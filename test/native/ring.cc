@@ -0,0 +1,106 @@
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <string>
+
+#include "../../src/hotcakey/ring.h"
+#include "./test.h"
+
+namespace {
+
+std::string RingName() { return "test-" + std::to_string(getpid()); }
+
+}  // namespace
+
+int main() {
+  hotcakey::test::Run("records cross the process boundary in order", [] {
+    auto name = RingName();
+    auto writer = hotcakey::ring::Writer::Create(name, 64);
+    EXPECT(writer != nullptr);
+
+    int ready[2];
+    EXPECT(pipe(ready) == 0);
+
+    auto pid = fork();
+    EXPECT(pid >= 0);
+
+    if (pid == 0) {
+      auto reader = hotcakey::ring::Reader::Open(name);
+      if (reader == nullptr) _exit(2);
+
+      char ok = 1;
+      if (write(ready[1], &ok, 1) != 1) _exit(3);
+
+      hotcakey::ring::Record record;
+      for (std::uint64_t i = 1; i <= 1000; i++) {
+        while (!reader->Read(record)) {
+          reader->Wait(std::chrono::milliseconds(1000));
+        }
+        if (record.registration != i) _exit(4);
+        if (record.code != i % 512) _exit(5);
+        if (record.type != (i % 2 ? hotcakey::kKeyDown : hotcakey::kKeyUp)) {
+          _exit(6);
+        }
+      }
+
+      _exit(reader->Lost() == 0 ? 0 : 7);
+    }
+
+    char ok;
+    EXPECT(read(ready[0], &ok, 1) == 1);
+
+    for (std::uint64_t i = 1; i <= 1000; i++) {
+      writer->Write(i, i % 512, i % 2 ? hotcakey::kKeyDown : hotcakey::kKeyUp,
+                    hotcakey::ring::Now());
+      // stay within the capacity so that nothing is lost
+      if (i % 32 == 0) usleep(1000);
+    }
+
+    int status;
+    EXPECT(waitpid(pid, &status, 0) == pid);
+    EXPECT(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+  });
+
+  hotcakey::test::Run("slow readers lose the oldest records", [] {
+    auto name = RingName();
+    auto writer = hotcakey::ring::Writer::Create(name, 16);
+    auto reader = hotcakey::ring::Reader::Open(name);
+    EXPECT(writer != nullptr && reader != nullptr);
+
+    for (std::uint64_t i = 1; i <= 40; i++) {
+      writer->Write(i, 0, hotcakey::kKeyDown, hotcakey::ring::Now());
+    }
+
+    hotcakey::ring::Record record;
+    EXPECT(reader->Read(record));
+    EXPECT(record.registration == 25);
+    EXPECT(reader->Lost() == 24);
+
+    std::uint64_t count = 1;
+    while (reader->Read(record)) count++;
+    EXPECT(count == 16);
+    EXPECT(record.registration == 40);
+  });
+
+  hotcakey::test::Run("readers start from the latest record", [] {
+    auto name = RingName();
+    auto writer = hotcakey::ring::Writer::Create(name, 16);
+    writer->Write(1, 0, hotcakey::kKeyDown, hotcakey::ring::Now());
+
+    auto reader = hotcakey::ring::Reader::Open(name);
+    hotcakey::ring::Record record;
+    EXPECT(!reader->Read(record));
+
+    writer->Write(2, 0, hotcakey::kKeyDown, hotcakey::ring::Now());
+    EXPECT(reader->Read(record));
+    EXPECT(record.registration == 2);
+  });
+
+  hotcakey::test::Run("missing ring cannot be opened", [] {
+    EXPECT(hotcakey::ring::Reader::Open("missing-" + RingName()) == nullptr);
+  });
+
+  std::cout << "🎉 all ring tests passed" << std::endl;
+
+  return 0;
+}
@@ -0,0 +1,77 @@
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include "../../src/hotcakey/daemon.h"
+#include "../../src/hotcakey/hotcakey.h"
+#include "./test.h"
+
+namespace {
+
+// the event loop used to poll every 100ms, so anything close to that
+// means we are polling again
+constexpr auto kMaxShutdown = std::chrono::milliseconds(20);
+
+std::chrono::microseconds MeasureInactivate() {
+  auto start = std::chrono::steady_clock::now();
+  EXPECT(hotcakey::Inactivate() == hotcakey::kSuccess);
+  return std::chrono::duration_cast<std::chrono::microseconds>(
+      std::chrono::steady_clock::now() - start);
+}
+
+void Report(std::vector<std::chrono::microseconds> durations) {
+  std::sort(durations.begin(), durations.end());
+  std::cout << "   median: " << durations[durations.size() / 2].count()
+            << "us, max: " << durations.back().count() << "us" << std::endl;
+  EXPECT(durations.back() < kMaxShutdown);
+}
+
+}  // namespace
+
+int main() {
+  hotcakey::daemon::SetEnabled(false);
+
+  hotcakey::test::Run("idle event loop stops immediately", [] {
+    std::vector<std::chrono::microseconds> durations;
+
+    for (int i = 0; i < 20; i++) {
+      EXPECT(hotcakey::Activate() == hotcakey::kSuccess);
+      EXPECT(hotcakey::Register({"Control", "KeyQ"},
+                                [](const hotcakey::Event&) {})
+                 .first == hotcakey::kSuccess);
+
+      // let the thread fall asleep in epoll_wait
+      std::this_thread::sleep_for(std::chrono::milliseconds(5));
+
+      durations.push_back(MeasureInactivate());
+    }
+
+    Report(durations);
+  });
+
+  hotcakey::test::Run("followers stop immediately", [] {
+    auto name = "shutdown-" + std::to_string(getpid());
+    std::vector<std::chrono::microseconds> durations;
+
+    for (int i = 0; i < 10; i++) {
+      EXPECT(hotcakey::Activate() == hotcakey::kSuccess);
+      EXPECT(hotcakey::Publish(name, 64) == hotcakey::kSuccess);
+      EXPECT(hotcakey::Follow(name, [](const hotcakey::Event&) {}).first ==
+             hotcakey::kSuccess);
+
+      std::this_thread::sleep_for(std::chrono::milliseconds(5));
+
+      durations.push_back(MeasureInactivate());
+      EXPECT(hotcakey::Unpublish() == hotcakey::kSuccess);
+    }
+
+    Report(durations);
+  });
+
+  std::cout << "🎉 all shutdown tests passed" << std::endl;
+
+  return 0;
+}
@@ -0,0 +1,188 @@
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <thread>
+
+#include "../../src/hotcakey/daemon.h"
+#include "../../src/hotcakey/hotcakey.h"
+#include "../../src/hotcakey/synthetic.h"
+#include "./test.h"
+
+namespace {
+
+std::uint32_t words[hotcakey::kKeyStateWords];
+
+bool IsPressed(const std::string& key) {
+  auto index = hotcakey::KeyStateIndexes(key).at(0);
+  auto word = __atomic_load_n(&words[1 + index / 32], __ATOMIC_ACQUIRE);
+  return (word & (1u << (index % 32))) != 0;
+}
+
+using hotcakey::test::Counter;
+using hotcakey::test::Press;
+
+}  // namespace
+
+int main() {
+  hotcakey::daemon::SetEnabled(false);
+
+  hotcakey::test::Run("events are not dispatched while suspended", [] {
+    EXPECT(hotcakey::Activate() == hotcakey::kSuccess);
+    EXPECT(hotcakey::AttachKeyState(words, hotcakey::kKeyStateWords) ==
+           hotcakey::kSuccess);
+
+    std::atomic<int> calls(0);
+    std::atomic<int> sentinel(0);
+
+    auto a = hotcakey::Register({"KeyA"}, Counter(calls));
+    auto z = hotcakey::Register({"KeyZ"}, Counter(sentinel));
+    EXPECT(a.first == hotcakey::kSuccess && z.first == hotcakey::kSuccess);
+
+    EXPECT(hotcakey::Suspend() == hotcakey::kSuccess);
+    EXPECT(hotcakey::IsSuspended());
+
+    // the key state is still tracked while suspended
+    hotcakey::synthetic::Emit("KeyA", hotcakey::kKeyDown);
+    EXPECT(hotcakey::test::WaitFor([] { return IsPressed("KeyA"); }));
+
+    EXPECT(hotcakey::Resume() == hotcakey::kSuccess);
+    EXPECT(!hotcakey::IsSuspended());
+
+    // the keyup of a swallowed keydown is swallowed as well
+    hotcakey::synthetic::Emit("KeyA", hotcakey::kKeyUp);
+    Press("KeyZ");
+    EXPECT(hotcakey::test::WaitFor([&] { return sentinel == 2; }));
+    EXPECT(calls == 0);
+
+    Press("KeyA");
+    EXPECT(hotcakey::test::WaitFor([&] { return calls == 2; }));
+
+    EXPECT(hotcakey::DetachKeyState() == hotcakey::kSuccess);
+    EXPECT(hotcakey::Inactivate() == hotcakey::kSuccess);
+  });
+
+  hotcakey::test::Run("chords fired before suspended are released", [] {
+    EXPECT(hotcakey::Activate() == hotcakey::kSuccess);
+
+    std::atomic<int> downs(0);
+    std::atomic<int> ups(0);
+
+    auto [result, registration] = hotcakey::Register(
+        {"Control", "KeyB"}, [&](const hotcakey::Event& event) {
+          (event.type == hotcakey::kKeyDown ? downs : ups)++;
+        });
+    EXPECT(result == hotcakey::kSuccess);
+
+    hotcakey::synthetic::Emit("ControlLeft", hotcakey::kKeyDown);
+    hotcakey::synthetic::Emit("KeyB", hotcakey::kKeyDown);
+    EXPECT(hotcakey::test::WaitFor([&] { return downs == 1; }));
+
+    // e.g. the chord opened a settings dialog which suspends
+    EXPECT(hotcakey::Suspend() == hotcakey::kSuccess);
+
+    hotcakey::synthetic::Emit("KeyB", hotcakey::kKeyUp);
+    EXPECT(hotcakey::test::WaitFor([&] { return ups == 1; }));
+
+    // while a chord pressed while suspended is not
+    hotcakey::synthetic::Emit("KeyB", hotcakey::kKeyDown);
+    hotcakey::synthetic::Emit("KeyB", hotcakey::kKeyUp);
+    hotcakey::synthetic::Emit("ControlLeft", hotcakey::kKeyUp);
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    EXPECT(downs == 1 && ups == 1);
+
+    EXPECT(hotcakey::Resume() == hotcakey::kSuccess);
+    EXPECT(hotcakey::Inactivate() == hotcakey::kSuccess);
+  });
+
+  hotcakey::test::Run("snapshots detach registrations until restored", [] {
+    EXPECT(hotcakey::Activate() == hotcakey::kSuccess);
+
+    std::atomic<int> kept(0);
+    std::atomic<int> streamed(0);
+    std::atomic<int> dropped(0);
+    std::atomic<int> temporary(0);
+
+    auto a = hotcakey::Register({"KeyA"}, Counter(kept));
+    auto s = hotcakey::Subscribe({{"KeyA"}, {}, false, {}}, Counter(streamed));
+    auto d = hotcakey::Register({"KeyS"}, Counter(dropped));
+    EXPECT(a.first == hotcakey::kSuccess && s.first == hotcakey::kSuccess &&
+           d.first == hotcakey::kSuccess);
+
+    auto [result, snapshot] = hotcakey::TakeSnapshot();
+    EXPECT(result == hotcakey::kSuccess);
+
+    // e.g. a settings dialog recording a shortcut
+    auto t = hotcakey::Register({"KeyA"}, Counter(temporary));
+    EXPECT(t.first == hotcakey::kSuccess);
+
+    Press("KeyS");
+    Press("KeyA");
+    EXPECT(hotcakey::test::WaitFor([&] { return temporary == 2; }));
+    EXPECT(kept == 0 && streamed == 0 && dropped == 0);
+
+    // detached registrations are still valid
+    EXPECT(hotcakey::Unregister(d.second) == hotcakey::kSuccess);
+    EXPECT(hotcakey::Unregister(t.second) == hotcakey::kSuccess);
+
+    EXPECT(hotcakey::Restore(snapshot) == hotcakey::kSuccess);
+    EXPECT(hotcakey::Restore(snapshot) == hotcakey::kFailure);
+
+    Press("KeyS");
+    Press("KeyA");
+    EXPECT(hotcakey::test::WaitFor(
+        [&] { return kept == 2 && streamed == 2; }));
+    EXPECT(dropped == 0 && temporary == 2);
+
+    EXPECT(hotcakey::Inactivate() == hotcakey::kSuccess);
+  });
+
+  hotcakey::test::Run("snapshots can be nested", [] {
+    EXPECT(hotcakey::Activate() == hotcakey::kSuccess);
+
+    std::atomic<int> outer(0);
+    std::atomic<int> inner(0);
+
+    EXPECT(hotcakey::Register({"KeyD"}, Counter(outer)).first ==
+           hotcakey::kSuccess);
+    auto first = hotcakey::TakeSnapshot();
+
+    EXPECT(hotcakey::Register({"KeyD"}, Counter(inner)).first ==
+           hotcakey::kSuccess);
+    auto second = hotcakey::TakeSnapshot();
+
+    EXPECT(first.first == hotcakey::kSuccess &&
+           second.first == hotcakey::kSuccess);
+    EXPECT(first.second != second.second);
+
+    EXPECT(hotcakey::Restore(first.second) == hotcakey::kSuccess);
+    Press("KeyD");
+    EXPECT(hotcakey::test::WaitFor([&] { return outer == 2; }));
+
+    EXPECT(hotcakey::Restore(second.second) == hotcakey::kSuccess);
+    Press("KeyD");
+    EXPECT(hotcakey::test::WaitFor([&] { return inner == 2; }));
+    EXPECT(outer == 4);
+
+    EXPECT(hotcakey::Inactivate() == hotcakey::kSuccess);
+  });
+
+  hotcakey::test::Run("inactivation forgets snapshots and suspension", [] {
+    EXPECT(hotcakey::Activate() == hotcakey::kSuccess);
+
+    auto [result, snapshot] = hotcakey::TakeSnapshot();
+    EXPECT(result == hotcakey::kSuccess);
+    EXPECT(hotcakey::Suspend() == hotcakey::kSuccess);
+
+    EXPECT(hotcakey::Inactivate() == hotcakey::kSuccess);
+    EXPECT(hotcakey::Activate() == hotcakey::kSuccess);
+
+    EXPECT(!hotcakey::IsSuspended());
+    EXPECT(hotcakey::Restore(snapshot) == hotcakey::kFailure);
+
+    EXPECT(hotcakey::Inactivate() == hotcakey::kSuccess);
+  });
+
+  std::cout << "🎉 all snapshot tests passed" << std::endl;
+
+  return 0;
+}
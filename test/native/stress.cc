@@ -0,0 +1,274 @@
+// concurrency torture test of the listener lifecycle.
+//
+// registers, unregisters, dispatches and (in)activates from many threads
+// at once against the synthetic backend. besides its own expectations, it
+// is meant to be run under sanitizers:
+//
+//   npm run test:native:stress:tsan
+//   npm run test:native:stress:asan
+
+#include <unistd.h>
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../../src/hotcakey/daemon.h"
+#include "../../src/hotcakey/hotcakey.h"
+#include "../../src/hotcakey/synthetic.h"
+#include "./test.h"
+
+namespace {
+
+// keys emitted in a loop and registered by churning threads
+const char* const kKeys[] = {"KeyA", "KeyS", "KeyD", "KeyF"};
+
+// calls of listeners made after `Unregister` returned for them
+std::atomic<int> violations(0);
+
+struct Probe {
+  std::atomic<bool> isUnregistered{false};
+  std::atomic<int> calls{0};
+};
+
+hotcakey::Callback ToListener(const std::shared_ptr<Probe>& probe) {
+  return [probe](const hotcakey::Event&) {
+    if (probe->isUnregistered.load()) violations++;
+    probe->calls++;
+  };
+}
+
+void Unregister(hotcakey::Registration registration,
+                const std::shared_ptr<Probe>& probe) {
+  EXPECT(hotcakey::Unregister(registration) == hotcakey::kSuccess);
+  probe->isUnregistered.store(true);
+}
+
+// emits key events as fast as the input thread takes them
+class Emitter {
+ public:
+  Emitter() {
+    thread = std::thread([this] {
+      for (std::size_t i = 0; isRunning.load(); i++) {
+        auto key = kKeys[i % 4];
+
+        // fails while inactive, which is part of the test
+        if (hotcakey::synthetic::Emit(key, hotcakey::kKeyDown) !=
+            hotcakey::kSuccess) {
+          std::this_thread::sleep_for(std::chrono::milliseconds(1));
+          continue;
+        }
+
+        hotcakey::synthetic::Emit(key, hotcakey::kKeyUp);
+      }
+    });
+  }
+
+  ~Emitter() {
+    isRunning.store(false);
+    thread.join();
+  }
+
+ private:
+  std::atomic<bool> isRunning{true};
+  std::thread thread;
+};
+
+void Churn(std::size_t iterations) {
+  for (std::size_t i = 0; i < iterations; i++) {
+    auto probe = std::make_shared<Probe>();
+    auto [result, registration] =
+        i % 2 == 0
+            ? hotcakey::Register({kKeys[i % 4]}, ToListener(probe))
+            : hotcakey::Subscribe({{kKeys[i % 4]}, {}, false, {}},
+                                  ToListener(probe));
+    EXPECT(result == hotcakey::kSuccess);
+
+    if (i % 8 == 0) std::this_thread::yield();
+
+    Unregister(registration, probe);
+  }
+}
+
+}  // namespace
+
+int main() {
+  hotcakey::daemon::SetEnabled(false);
+
+  // a deadlock fails the test instead of hanging it
+  alarm(300);
+
+  hotcakey::test::Run("listeners are never called after unregister", [] {
+    EXPECT(hotcakey::Activate() == hotcakey::kSuccess);
+
+    // a listener which stays for the whole test proves events flow
+    auto steady = std::make_shared<Probe>();
+    auto [result, registration] =
+        hotcakey::Register({"KeyA"}, ToListener(steady));
+    EXPECT(result == hotcakey::kSuccess);
+
+    {
+      Emitter emitter;
+      std::vector<std::thread> churners;
+
+      for (int i = 0; i < 8; i++) churners.emplace_back(Churn, 1000);
+      for (auto& churner : churners) churner.join();
+    }
+
+    EXPECT(steady->calls > 0);
+    Unregister(registration, steady);
+
+    EXPECT(hotcakey::Inactivate() == hotcakey::kSuccess);
+    EXPECT(violations == 0);
+  });
+
+  hotcakey::test::Run("listeners may unregister registrations", [] {
+    EXPECT(hotcakey::Activate() == hotcakey::kSuccess);
+
+    for (int i = 0; i < 100; i++) {
+      std::atomic<hotcakey::Registration> self(0);
+      std::atomic<int> calls(0);
+
+      auto other = std::make_shared<Probe>();
+      auto [result, victim] = hotcakey::Register({"KeyS"}, ToListener(other));
+      EXPECT(result == hotcakey::kSuccess);
+
+      // unregisters itself and another listener of the same chord
+      auto registered = hotcakey::Register(
+          {"KeyS"}, [&self, &calls, other, victim = victim](
+                        const hotcakey::Event&) {
+            auto registration = self.load();
+            if (registration == 0) return;
+            calls++;
+            EXPECT(hotcakey::Unregister(registration) == hotcakey::kSuccess);
+            EXPECT(hotcakey::Unregister(victim) == hotcakey::kSuccess);
+            other->isUnregistered.store(true);
+          });
+      EXPECT(registered.first == hotcakey::kSuccess);
+      self.store(registered.second);
+
+      for (int j = 0; j < 4; j++) {
+        hotcakey::synthetic::Emit("KeyS", hotcakey::kKeyDown);
+        hotcakey::synthetic::Emit("KeyS", hotcakey::kKeyUp);
+      }
+
+      EXPECT(hotcakey::test::WaitFor([&] { return calls > 0; }));
+
+      // no event reaches them once the dispatch is over
+      hotcakey::synthetic::Emit("KeyS", hotcakey::kKeyDown);
+      hotcakey::synthetic::Emit("KeyS", hotcakey::kKeyUp);
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+      EXPECT(calls == 1);
+    }
+
+    EXPECT(hotcakey::Inactivate() == hotcakey::kSuccess);
+    EXPECT(violations == 0);
+  });
+
+  hotcakey::test::Run("api called from a listener fails instead of locking",
+                      [] {
+    EXPECT(hotcakey::Activate() == hotcakey::kSuccess);
+
+    std::atomic<bool> isDone(false);
+
+    auto [result, registration] =
+        hotcakey::Register({"KeyD"}, [&isDone](const hotcakey::Event& event) {
+          if (event.type != hotcakey::kKeyDown || isDone) return;
+          EXPECT(hotcakey::Inactivate() == hotcakey::kFailure);
+          EXPECT(hotcakey::Register({"KeyF"}, [](const hotcakey::Event&) {})
+                     .first == hotcakey::kFailure);
+          isDone.store(true);
+        });
+    EXPECT(result == hotcakey::kSuccess);
+
+    hotcakey::synthetic::Emit("KeyD", hotcakey::kKeyDown);
+    hotcakey::synthetic::Emit("KeyD", hotcakey::kKeyUp);
+    EXPECT(hotcakey::test::WaitFor([&] { return isDone.load(); }));
+
+    EXPECT(hotcakey::Inactivate() == hotcakey::kSuccess);
+  });
+
+  hotcakey::test::Run("activation races with registration and dispatch", [] {
+    EXPECT(hotcakey::Activate() == hotcakey::kSuccess);
+
+    {
+      Emitter emitter;
+      std::vector<std::thread> threads;
+
+      for (int i = 0; i < 4; i++) threads.emplace_back(Churn, 500);
+
+      // two threads flipping the backend on and off against each other
+      for (int i = 0; i < 2; i++) {
+        threads.emplace_back([] {
+          for (int j = 0; j < 25; j++) {
+            EXPECT(hotcakey::Activate() == hotcakey::kSuccess);
+            std::this_thread::sleep_for(std::chrono::microseconds(200));
+            EXPECT(hotcakey::Inactivate() == hotcakey::kSuccess);
+          }
+        });
+      }
+
+      for (auto& thread : threads) thread.join();
+    }
+
+    EXPECT(hotcakey::Inactivate() == hotcakey::kSuccess);
+    EXPECT(violations == 0);
+  });
+
+  hotcakey::test::Run("followers are churned while publishing", [] {
+    auto name = "stress-" + std::to_string(getpid());
+
+    EXPECT(hotcakey::Activate() == hotcakey::kSuccess);
+    EXPECT(hotcakey::Publish(name, 256) == hotcakey::kSuccess);
+    EXPECT(hotcakey::Register({"KeyF"}, [](const hotcakey::Event&) {}).first ==
+           hotcakey::kSuccess);
+
+    {
+      Emitter emitter;
+      std::vector<std::thread> followers;
+
+      for (int i = 0; i < 4; i++) {
+        followers.emplace_back([&name] {
+          for (int j = 0; j < 25; j++) {
+            auto probe = std::make_shared<Probe>();
+            auto [result, registration] =
+                hotcakey::Follow(name, ToListener(probe));
+            EXPECT(result == hotcakey::kSuccess);
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            Unregister(registration, probe);
+          }
+        });
+      }
+
+      for (auto& follower : followers) follower.join();
+    }
+
+    EXPECT(hotcakey::Inactivate() == hotcakey::kSuccess);
+    EXPECT(hotcakey::Unpublish() == hotcakey::kSuccess);
+    EXPECT(violations == 0);
+  });
+
+  hotcakey::test::Run("thousands of short lived threads", [] {
+    EXPECT(hotcakey::Activate() == hotcakey::kSuccess);
+
+    {
+      Emitter emitter;
+
+      for (int batch = 0; batch < 64; batch++) {
+        std::vector<std::thread> threads;
+        for (int i = 0; i < 16; i++) threads.emplace_back(Churn, 4);
+        for (auto& thread : threads) thread.join();
+      }
+    }
+
+    EXPECT(hotcakey::Inactivate() == hotcakey::kSuccess);
+    EXPECT(violations == 0);
+  });
+
+  std::cout << "🎉 all stress tests passed" << std::endl;
+
+  return 0;
+}
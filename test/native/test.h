@@ -0,0 +1,67 @@
+#ifndef HOTCAKEY_TEST_NATIVE_TEST_H_
+#define HOTCAKEY_TEST_NATIVE_TEST_H_
+
+// tiny helpers for native tests which run against the synthetic backend.
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <thread>
+
+#include "../../src/hotcakey/hotcakey.h"
+#include "../../src/hotcakey/synthetic.h"
+
+#define EXPECT(condition)                                              \
+  {                                                                    \
+    if (!(condition)) {                                                \
+      std::cerr << "❌ expectation failed: " #condition " (" __FILE__ \
+                << ":" << __LINE__ << ")" << std::endl;                \
+      std::exit(1);                                                    \
+    }                                                                  \
+  }
+
+namespace hotcakey {
+namespace test {
+
+// waits until `predicate` becomes true since listeners are called
+// asynchronously on the input thread.
+inline bool WaitFor(const std::function<bool()>& predicate,
+                    std::chrono::milliseconds timeout =
+                        std::chrono::milliseconds(1000)) {
+  auto deadline = std::chrono::steady_clock::now() + timeout;
+  while (!predicate()) {
+    if (std::chrono::steady_clock::now() > deadline) return false;
+    std::this_thread::sleep_for(std::chrono::microseconds(100));
+  }
+  return true;
+}
+
+inline void Run(const char* name, const std::function<void()>& test) {
+  std::cout << "🥞 " << name << std::endl;
+  test();
+}
+
+// types `key` into the synthetic keyboard
+inline void Press(const std::string& key) {
+  hotcakey::synthetic::Emit(key, hotcakey::kKeyDown);
+  hotcakey::synthetic::Emit(key, hotcakey::kKeyUp);
+}
+
+// types `key` into a synthetic device added by `synthetic::AddDevice`
+inline void Press(int device, const std::string& key) {
+  hotcakey::synthetic::Emit(device, key, hotcakey::kKeyDown);
+  hotcakey::synthetic::Emit(device, key, hotcakey::kKeyUp);
+}
+
+// a listener counting its calls into `calls`
+inline hotcakey::Callback Counter(std::atomic<int>& calls) {
+  return [&calls](const hotcakey::Event&) { calls++; };
+}
+
+}  // namespace test
+}  // namespace hotcakey
+
+#endif  // HOTCAKEY_TEST_NATIVE_TEST_H_
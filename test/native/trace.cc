@@ -0,0 +1,127 @@
+#include <algorithm>
+#include <atomic>
+#include <string>
+#include <thread>
+
+#include "../../src/hotcakey/daemon.h"
+#include "../../src/hotcakey/hotcakey.h"
+#include "../../src/hotcakey/synthetic.h"
+#include "../../src/hotcakey/trace.h"
+#include "./test.h"
+
+namespace {
+
+bool Contains(const std::string& json, const std::string& part) {
+  return json.find(part) != std::string::npos;
+}
+
+std::size_t Count(const std::string& json, char c) {
+  return std::count(json.begin(), json.end(), c);
+}
+
+}  // namespace
+
+int main() {
+  hotcakey::daemon::SetEnabled(false);
+
+  hotcakey::test::Run("stages of an event are traced across threads", [] {
+    hotcakey::trace::SetThreadName("main");
+    hotcakey::trace::Start(1024);
+
+    EXPECT(hotcakey::Activate() == hotcakey::kSuccess);
+
+    std::atomic<std::uint64_t> traced(0);
+
+    // hands the event over to the main thread like the node.js addon
+    auto [result, registration] =
+        hotcakey::Register({"F15"}, [&](const hotcakey::Event& event) {
+          if (event.type != hotcakey::kKeyDown) return;
+          hotcakey::trace::Record(hotcakey::trace::kEnqueued, event.trace);
+          traced.store(event.trace);
+        });
+    EXPECT(result == hotcakey::kSuccess);
+
+    hotcakey::synthetic::Emit("F15", hotcakey::kKeyDown);
+    hotcakey::synthetic::Emit("F15", hotcakey::kKeyUp);
+    EXPECT(hotcakey::test::WaitFor([&] { return traced != 0; }));
+
+    hotcakey::trace::Record(hotcakey::trace::kInvoked, traced);
+    hotcakey::trace::Record(hotcakey::trace::kReturned, traced);
+
+    hotcakey::Inactivate();
+    hotcakey::trace::Stop();
+
+    auto json = hotcakey::trace::Dump();
+    auto id = std::to_string(traced.load());
+
+    EXPECT(Contains(json, "\"traceEvents\""));
+    EXPECT(Contains(json, "\"name\":\"hotcakey input\""));
+    EXPECT(Contains(json, "\"name\":\"main\""));
+
+    for (auto stage : {"received", "handled", "matched", "enqueued"}) {
+      EXPECT(Contains(json, std::string("\"name\":\"") + stage + "\""));
+    }
+
+    EXPECT(Contains(json, "\"ph\":\"B\",\"name\":\"listener\""));
+    EXPECT(Contains(json, "\"ph\":\"E\",\"name\":\"listener\""));
+    EXPECT(Contains(json, "\"ph\":\"s\",\"name\":\"event\",\"cat\":\"hotcakey\","
+                          "\"id\":" + id));
+    EXPECT(Contains(json, "\"ph\":\"f\",\"name\":\"event\",\"cat\":\"hotcakey\","
+                          "\"id\":" + id));
+
+    EXPECT(Count(json, '{') == Count(json, '}'));
+    EXPECT(Count(json, '[') == Count(json, ']'));
+  });
+
+  hotcakey::test::Run("nothing is recorded while stopped", [] {
+    EXPECT(hotcakey::trace::NextId() == 0);
+
+    hotcakey::trace::Start(16);
+    hotcakey::trace::Stop();
+
+    EXPECT(!Contains(hotcakey::trace::Dump(), "\"received\""));
+  });
+
+  hotcakey::test::Run("records beyond the capacity are dropped", [] {
+    hotcakey::trace::Start(2);
+
+    for (int i = 0; i < 5; i++) {
+      hotcakey::trace::Record(hotcakey::trace::kHandled,
+                              hotcakey::trace::NextId());
+    }
+
+    hotcakey::trace::Stop();
+
+    EXPECT(Contains(hotcakey::trace::Dump(), "dropped 3 records"));
+  });
+
+  hotcakey::test::Run("a buffer without room is dumped", [] {
+    hotcakey::trace::Start(0);
+
+    for (int i = 0; i < 2; i++) {
+      hotcakey::trace::Record(hotcakey::trace::kHandled,
+                              hotcakey::trace::NextId());
+    }
+
+    hotcakey::trace::Stop();
+
+    EXPECT(Contains(hotcakey::trace::Dump(), "dropped 2 records"));
+  });
+
+  hotcakey::test::Run("thread names are escaped", [] {
+    std::thread([] {
+      hotcakey::trace::SetThreadName("a \"quoted\"\\name\n");
+      hotcakey::trace::Start(16);
+      hotcakey::trace::Record(hotcakey::trace::kHandled,
+                              hotcakey::trace::NextId());
+      hotcakey::trace::Stop();
+    }).join();
+
+    EXPECT(Contains(hotcakey::trace::Dump(),
+                    "\"name\":\"a \\\"quoted\\\"\\\\name\\u000a\""));
+  });
+
+  std::cout << "🎉 all trace tests passed" << std::endl;
+
+  return 0;
+}
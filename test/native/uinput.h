@@ -0,0 +1,81 @@
+#ifndef HOTCAKEY_TEST_NATIVE_UINPUT_H_
+#define HOTCAKEY_TEST_NATIVE_UINPUT_H_
+
+// a virtual keyboard made with uinput, which shows up in /dev/input like
+// a real one. tests using it are skipped where /dev/uinput is not
+// writable, such as in containers.
+
+#include <fcntl.h>
+#include <linux/uinput.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+
+#include <cstring>
+#include <string>
+
+namespace hotcakey {
+namespace test {
+
+class VirtualKeyboard {
+ public:
+  ~VirtualKeyboard() { Destroy(); }
+
+  static bool IsAvailable() { return access("/dev/uinput", W_OK) == 0; }
+
+  bool Create(const std::string& name, std::uint16_t vendor,
+              std::uint16_t product) {
+    fd = open("/dev/uinput", O_WRONLY | O_NONBLOCK | O_CLOEXEC);
+    if (fd < 0) return false;
+
+    ioctl(fd, UI_SET_EVBIT, EV_KEY);
+    for (int code = KEY_ESC; code < KEY_MICMUTE; code++) {
+      ioctl(fd, UI_SET_KEYBIT, code);
+    }
+
+    uinput_setup setup{};
+    setup.id.bustype = BUS_USB;
+    setup.id.vendor = vendor;
+    setup.id.product = product;
+    std::strncpy(setup.name, name.c_str(), UINPUT_MAX_NAME_SIZE - 1);
+
+    if (ioctl(fd, UI_DEV_SETUP, &setup) < 0 || ioctl(fd, UI_DEV_CREATE) < 0) {
+      Destroy();
+      return false;
+    }
+
+    return true;
+  }
+
+  void Destroy() {
+    if (fd < 0) return;
+    ioctl(fd, UI_DEV_DESTROY);
+    close(fd);
+    fd = -1;
+  }
+
+  void Key(unsigned int code, int value) {
+    Write(EV_KEY, code, value);
+    Write(EV_SYN, SYN_REPORT, 0);
+  }
+
+  void Press(unsigned int code) {
+    Key(code, 1);
+    Key(code, 0);
+  }
+
+ private:
+  void Write(unsigned int type, unsigned int code, int value) {
+    input_event event{};
+    event.type = type;
+    event.code = code;
+    event.value = value;
+    if (write(fd, &event, sizeof(event)) < 0) return;
+  }
+
+  int fd = -1;
+};
+
+}  // namespace test
+}  // namespace hotcakey
+
+#endif  // HOTCAKEY_TEST_NATIVE_UINPUT_H_